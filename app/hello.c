@@ -16,1350 +16,7963 @@
 #include <sys/socket.h>
 #include <linux/if_link.h>
 #include <regex.h>
+#include <fcntl.h>         // O_NONBLOCK
+#include <poll.h>          // 并发探测镜像
+#include <netdb.h>         // getaddrinfo
+#include <errno.h>
+#include <sys/stat.h>      // mkdir
+#include <sys/sendfile.h>
+#include <pthread.h>       // 缓存代理的连接线程，编译时加 -lpthread
+#include <signal.h>
+#include <termios.h>       // 菜单方向键选择
+#include <stdio_ext.h>     // __fpurge
+#include <sys/ioctl.h>     // 终端大小
+#include <sys/wait.h>      // waitpid
+#include <sys/mman.h>      // 批量汇总映射报告文件
+#include <linux/ethtool.h>   // 网卡调优
+#include <linux/sockios.h>   // SIOCETHTOOL
+#include <sys/syscall.h>     // io_uring、AIO 系统调用
+#include <sys/uio.h>
+#include <linux/io_uring.h>   // 磁盘基准测试
+#include <linux/aio_abi.h>
+#include <linux/fs.h>         // BLKGETSIZE64
+#include <linux/rtnetlink.h>  // 网络自测的 veth 对
+#include <linux/veth.h>
+#include <linux/sched.h>       // CLONE_NEWNET
+#include <linux/errqueue.h>    // MSG_ZEROCOPY 完成通知
+#include <linux/mempolicy.h>   // MPOL_BIND
+#include <sys/xattr.h>         // 改写配置文件时保留 SELinux 标签
 #include <libnl3/netlink/netlink-compat.h>
+#include "libsysinfo.h"
 
 #define MAX_LINE 256
 
-// 结构体：保存发行版信息
-typedef struct {
-    char name[128];
-    char version[128];
-} DistributionInfo;
-
-// 全局系统信息
-struct utsname global_sysinfo;
-
-// 工具函数：检查目录是否存在
-int directory_exists(const char *path) {
-    DIR *dir = opendir(path);
-    if (dir) {
-        closedir(dir);
-        return 1;
-    }
-    return 0;
-}
+// 系统信息探测见 libsysinfo.c，这里只负责显示
+static char report_arena_buf[4096];
 
-// 工具函数：读取文件内容到缓冲区（去除换行符）
-char* read_file_content(const char *filename) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) return NULL;
+// 显示系统时间
+void print_current_time(const SiReport *r) {
+    struct tm *tm_info = localtime(&r->now);
+    char buffer[100];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", tm_info);
+    printf("    当前时间: %s\n", buffer);
+}
 
-    char *line = malloc(MAX_LINE);
-    if (!line) {
-        fclose(fp);
-        return NULL;
-    }
+// 显示系统环境信息
+void print_system_environment(const SiReport *r) {
+    printf("        系统环境: %s\n", r->hardware_model);
+}
 
-    if (fgets(line, MAX_LINE, fp)) {
-        line[strcspn(line, "\n")] = '\0'; // 移除换行符
+// 显示发行版信息
+void print_distribution_info(const SiReport *r) {
+    if (r->distro_ok) {
+        printf("        系统版本: %s %s\n", r->distro.name, r->distro.version);
     } else {
-        free(line);
-        line = NULL;
+        printf("无法识别发行版信息。\n");
     }
+}
 
-    fclose(fp);
-    return line;
+// 显示内核和主机名信息
+void print_kernel_and_hostname(const SiReport *r) {
+    printf("        内核版本: %s %s\n", r->uts.sysname, r->uts.release);
+}
+
+// 显示CPU 型号和逻辑核心数
+void print_cpu_info(const SiReport *r) {
+    printf("        CPU 型号: %s , 总逻辑处理器数量：%d \n", r->cpu.model, r->cpu.logical_cores);
 }
 
-// 工具函数：去除字符串两端的引号和空格
-void trim_quotes_and_whitespace(char *str) {
-    char *src = str;
-    char *dst = str;
+// 四舍五入函数（保留整数）
+double my_round(double x) {
+    int integer = (int)x;
+    return (x - integer >= 0.5) ? integer + 1 : integer;
+}
 
-    while (isspace((unsigned char)*src)) src++;
-    if (*src == '"' || *src == '\'') src++;
+// 打印内存信息
+void print_memory_info(const SiReport *r) {
+    // 容器内通常没有 dmidecode 权限，退回到内核看到的 MemTotal
+    double phys_mem = r->mem.phys_total > 0 ? r->mem.phys_total : r->mem.total;
+    if (phys_mem <= 0) {
+        printf("无法获取物理内存\n");
+        return;
+    }
 
-    while (*src && !((*src == '"' || *src == '\'') && src[1] == '\0' && src != dst))
-        *dst++ = *src++;
+    double used = phys_mem - r->mem.available;
+    double percent = (used / phys_mem) * 100.0;
 
-    while (dst > str && isspace((unsigned char)*(dst - 1)))
-        dst--;
+    // 四舍五入显示
+    double rounded_used = my_round(used);
+    double rounded_total = my_round(phys_mem);
 
-    *dst = '\0';
+    // 输出格式
+    printf("        物理内存: 内存总量: %2.0f GiB   已使用内存：%2.0f GiB(%.2f%%) \n",
+           rounded_total, rounded_used, percent);
+    if (percent >= 80.0)
+        printf("        内存占用偏高，可在主菜单 [2] 查看进程资源排行\n");
 }
 
-// 获取 Android 品牌和型号（模拟 getprop）
-char* get_android_model() {
-    char brand[128] = {0};
-    char model[128] = {0};
+// 资源压力的中文名称
+static const char *psi_labels[SI_PSI_KINDS] = { "CPU ", "内存", "IO  " };
 
-    FILE *fp_brand = popen("getprop ro.product.brand", "r");
-    FILE *fp_model = popen("getprop ro.product.model", "r");
+// 打印一组 PSI：some/full 的 avg10/avg60/avg300
+static void print_psi_line(const char *indent, const SiPsi *psi, int kind) {
+    printf("%s压力 %s: some %5.2f %5.2f %5.2f%%", indent, psi_labels[kind],
+           psi->some[0], psi->some[1], psi->some[2]);
+    if (kind != SI_PSI_CPU || psi->full_total)
+        printf("   full %5.2f %5.2f %5.2f%%", psi->full[0], psi->full[1], psi->full[2]);
+    printf("\n");
+}
 
-    if (!fp_brand || !fp_model) {
-        if (fp_brand) pclose(fp_brand);
-        if (fp_model) pclose(fp_model);
-        return NULL;
+// 打印整机资源压力（最近 10/60/300 秒内处于停顿的时间比例），内核未启用 PSI 时不显示
+void print_pressure_info(const SiReport *r) {
+    int kind;
+    for (kind = 0; kind < SI_PSI_KINDS; kind++) {
+        if (r->psi[kind].present)
+            print_psi_line("        ", &r->psi[kind], kind);
     }
+}
 
-    if (fgets(brand, sizeof(brand), fp_brand))
-        brand[strcspn(brand, "\n")] = '\0';
-
-    if (fgets(model, sizeof(model), fp_model))
-        model[strcspn(model, "\n")] = '\0';
+// 字节数转 GiB
+static double gib(long long bytes) {
+    return bytes / (1024.0 * 1024.0 * 1024.0);
+}
 
-    pclose(fp_brand);
-    pclose(fp_model);
+// 打印 cgroup 有效资源（容器或 systemd 服务的实际限制），没有任何限制时只显示路径
+void print_cgroup_info(const SiReport *r) {
+    const SiCgroup *cg = &r->cgroup;
+    if (!cg->present) return;
 
-    if (!strlen(brand) || !strlen(model))
-        return NULL;
+    printf("        cgroup: %s\n", cg->path);
 
-    char *result = malloc(strlen(brand) + strlen(model) + 2);
-    if (!result) return NULL;
+    printf("        有效 CPU: %.2f", cg->effective_cpus);
+    if (cg->cpu_quota_us > 0)
+        printf("  配额 %lld/%lldus", cg->cpu_quota_us, cg->cpu_period_us);
+    if (cg->cpuset[0])
+        printf("  cpuset %s", cg->cpuset);
+    printf("  (主机 %d)\n", r->cpu.logical_cores);
 
-    sprintf(result, "%s %s", brand, model);
-    return result;
-}
+    if (cg->mem_max > 0 || cg->mem_current >= 0) {
+        double host = r->mem.total;
+        double limit = (cg->mem_max > 0 && gib(cg->mem_max) < host) ? gib(cg->mem_max) : host;
+        printf("        有效内存: ");
+        if (cg->mem_max > 0)
+            printf("上限 %.2f GiB", gib(cg->mem_max));
+        else
+            printf("无限制");
+        if (cg->mem_current >= 0) {
+            printf("  已用 %.2f GiB(%.1f%%)", gib(cg->mem_current),
+                   limit > 0 ? gib(cg->mem_current) / limit * 100.0 : 0.0);
+        }
+        if (cg->mem_anon >= 0 && cg->mem_file >= 0)
+            printf("  anon %.2f / file %.2f GiB", gib(cg->mem_anon), gib(cg->mem_file));
+        printf("  (主机 %.2f GiB)\n", host);
+    }
 
-// 主函数：获取硬件模型信息
-char* get_hardware_model() {
-    char *model = NULL;
+    if (cg->pids_current >= 0) {
+        if (cg->pids_max >= 0)
+            printf("        进程数: %lld / %lld\n", cg->pids_current, cg->pids_max);
+        else
+            printf("        进程数: %lld (无限制)\n", cg->pids_current);
+    }
 
-    // 判断是否为 Android 系统
-    if (directory_exists("/system/app") && directory_exists("/system/priv-app")) {
-        model = get_android_model();
-        if (model) return model;
+    // 根 cgroup 的压力与整机相同，不重复显示
+    int kind;
+    for (kind = 0; kind < SI_PSI_KINDS; kind++) {
+        if (cg->psi[kind].present && strcmp(cg->path, "/"))
+            print_psi_line("        cgroup ", &cg->psi[kind], kind);
     }
 
-    // DMI 设备信息（x86/PC/虚拟机）
-    const char *file1 = "/sys/devices/virtual/dmi/id/product_name";
-    const char *file2 = "/sys/devices/virtual/dmi/id/product_version";
+    // 超过 5% 的调度周期被限流时提示配额不足
+    if (cg->nr_throttled >= 0 && cg->nr_periods > 0) {
+        double ratio = (double)cg->nr_throttled / cg->nr_periods * 100.0;
+        printf("        CPU 限流: %lld / %lld 个周期(%.1f%%)，累计 %.2f 秒%s\n",
+               cg->nr_throttled, cg->nr_periods, ratio,
+               cg->throttled_usec >= 0 ? cg->throttled_usec / 1e6 : 0.0,
+               ratio > 5.0 ? "  ← CPU 配额不足" : "");
+    }
+}
 
-    char *name = read_file_content(file1);
-    char *version = read_file_content(file2);
+// 打印系统开机时间
+void print_uptime(const SiReport *r) {
+    printf("        开机时长: %d天 %02d:%02d:%02d\n",
+           r->uptime.days, r->uptime.hours, r->uptime.minutes, r->uptime.secs);
+}
 
-    if (name && version) {
-        model = malloc(strlen(name) + strlen(version) + 2);
-        if (model) {
-            sprintf(model, "%s %s", name, version);
-            free(name);
-            free(version);
-            return model;
-        }
-        free(name);
-        free(version);
-    }
+// 打印本机IP
+void print_local_ip(const SiReport *r) {
+    printf("        本机IP: %s\n", r->local_ip[0] ? r->local_ip : "未获取到IP");
+}
 
-    // ARM 设备树信息
-    const char *file3 = "/sys/firmware/devicetree/base/model";
-    model = read_file_content(file3);
-    if (model) return model;
+// ==================== 采样历史 ====================
 
-    // tmp 文件缓存
-    const char *file4 = "/tmp/sysinfo/model";
-    model = read_file_content(file4);
-    if (model) return model;
+#define HISTORY_DIR "/var/lib/menu_project"
+#define HISTORY_FILE HISTORY_DIR "/history.ring"
+#define HISTORY_ROWS 100          // 未指定 --step 时按查询范围自动取间隔，输出约这么多行
 
-    // 默认兜底
-    return strdup("Unknown Hardware");
+// 打开历史文件用于追加，目录不存在时创建
+static int history_open_writable(SiHistory *h) {
+    if (mkdir(HISTORY_DIR, 0755) != 0 && errno != EEXIST) return -1;
+    return si_history_open(h, HISTORY_FILE, 0, 1);
 }
 
-// 从 os-release 加载发行版信息
-int load_os_release(const char *filename, DistributionInfo *info) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) return -1;
+// 追加一条当前样本，供显示系统信息时顺带记录
+static void history_append_now(void) {
+    SiHistory h;
+    SiHistSample s;
+    if (history_open_writable(&h) != 0) return;
+    si_history_sample(&h, &s);
+    si_history_append(&h, &s);
+    si_history_close(&h);
+}
 
-    char line[MAX_LINE];
-    int found_name = 0, found_version = 0;
+// --history-record [间隔秒]：不带间隔时采一条后退出（供 cron 调用），带间隔时常驻按间隔采样
+int history_record(int argc, char *argv[]) {
+    int interval = argc > 0 ? atoi(argv[0]) : 0;
+    if (argc > 1 || (argc == 1 && interval <= 0)) {
+        printf("用法: --history-record [间隔秒]\n");
+        return 1;
+    }
+    SiHistory h;
+    if (history_open_writable(&h) != 0) {
+        perror("无法打开 " HISTORY_FILE);
+        return 1;
+    }
+    SiHistSample s;
+    for (;;) {
+        si_history_sample(&h, &s);
+        if (si_history_append(&h, &s) != 0) {
+            perror("写入采样历史失败");
+            si_history_close(&h);
+            return 1;
+        }
+        if (interval <= 0) break;
+        // 对齐到间隔的整数倍，多个实例或重启后时间点保持一致
+        sleep((unsigned int)(interval - time(NULL) % interval));
+    }
+    si_history_close(&h);
+    return 0;
+}
 
-    while (fgets(line, sizeof(line), fp)) {
-        line[strcspn(line, "\n")] = '\0';
-        if (line[0] == '#' || strlen(line) == 0)
-            continue;
+// 解析 "2026-10-18 08:00[:00]"、"2026-10-18"，或相对现在的 "90s"/"30m"/"6h"/"2d"
+static int history_parse_time(const char *arg, time_t now, long long *out) {
+    struct tm tm;
+    int sec = 0, n;
+    char unit;
+    memset(&tm, 0, sizeof(tm));
+    n = sscanf(arg, "%d-%d-%d%*[ T]%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &sec);
+    if (n == 3 || n >= 5) {
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        tm.tm_sec = n == 6 ? sec : 0;
+        tm.tm_isdst = -1;
+        time_t t = mktime(&tm);
+        if (t == (time_t)-1) return -1;
+        *out = t;
+        return 0;
+    }
+    long long v;
+    if (sscanf(arg, "%lld%c", &v, &unit) != 2 || v < 0) return -1;
+    switch (unit) {
+    case 's': break;
+    case 'm': v *= 60; break;
+    case 'h': v *= 3600; break;
+    case 'd': v *= 86400; break;
+    default: return -1;
+    }
+    *out = now - v;
+    return 0;
+}
 
-        char *equal_sign = strchr(line, '=');
-        if (!equal_sign)
-            continue;
+typedef struct {
+    const SiHistory *h;
+    long long step;
+    SiHistSample last;         // 上一行输出的样本，计数器列的速率按两行之间的差值计算
+    int have_last;
+    long rows;
+} HistoryPrint;
 
-        size_t key_len = equal_sign - line;
-        char key[64], value[256];
+static void history_format_ts(long long ts, char *buf, size_t size) {
+    time_t t = (time_t)ts;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(buf, size, "%Y-%m-%d %H:%M:%S", &tm);
+}
 
-        strncpy(key, line, key_len);
-        key[key_len] = '\0';
+// 计数器在区间内的增量占比；计数器回绕（重启）或没有基准时返回负数
+static double history_ratio(long long delta, long long whole) {
+    return delta >= 0 && whole > 0 ? (double)delta / whole * 100.0 : -1;
+}
 
-        strcpy(value, equal_sign + 1);
-        trim_quotes_and_whitespace(value);
+static void history_print_pct(double v) {
+    if (v < 0) printf("  %6s", "-");
+    else printf("  %6.1f", v);
+}
 
-        if (strcmp(key, "NAME") == 0) {
-            snprintf(info->name, sizeof(info->name), "%s", value);
-            found_name = 1;
-        } else if (strcmp(key, "VERSION_ID") == 0) {
-            snprintf(info->version, sizeof(info->version), "%s", value);
-            found_version = 1;
-        }
+static void history_print_row(HistoryPrint *ctx, const SiHistSample *base, const SiHistSample *s) {
+    char when[32];
+    int i;
+    history_format_ts(s->ts, when, sizeof(when));
+    printf("%s  %8.2f  %6.2f", when,
+           (s->mem_total_mib - s->mem_avail_mib) / 1024.0, s->load_x100 / 100.0);
 
-        if (found_name && found_version) break;
+    long long dt = base ? s->ts - base->ts : 0;
+    if (base) {
+        long long dtotal = s->cpu_total - base->cpu_total;
+        long long didle = s->cpu_idle - base->cpu_idle;
+        history_print_pct(didle >= 0 ? history_ratio(dtotal - didle, dtotal) : -1);
+    } else {
+        history_print_pct(-1);
     }
-
-    fclose(fp);
-    return (found_name && found_version) ? 0 : -1;
+    for (i = 0; i < SI_PSI_KINDS; i++)
+        history_print_pct(base ? history_ratio(s->psi_ms[i] - base->psi_ms[i], dt * 1000) : -1);
+    for (i = 0; i < ctx->h->niface; i++) {
+        long long rx = base ? s->rx_kb[i] - base->rx_kb[i] : -1;
+        long long tx = base ? s->tx_kb[i] - base->tx_kb[i] : -1;
+        if (dt > 0 && rx >= 0 && tx >= 0)
+            printf("  %9.1f/%-9.1f", (double)rx / dt, (double)tx / dt);
+        else
+            printf("  %9s/%-9s", "-", "-");
+    }
+    printf("\n");
+    ctx->rows++;
 }
 
-// 尝试从多个来源获取发行版信息
-int get_distribution_info(DistributionInfo *info) {
-    if (load_os_release("/etc/os-release", info) == 0)
+static int history_print_cb(const SiHistSample *prev, const SiHistSample *cur, void *arg) {
+    HistoryPrint *ctx = arg;
+    if (!ctx->have_last) {
+        history_print_row(ctx, prev, cur);
+    } else if (cur->ts - ctx->last.ts >= ctx->step) {
+        history_print_row(ctx, &ctx->last, cur);
+    } else {
         return 0;
+    }
+    ctx->last = *cur;
+    ctx->have_last = 1;
+    return 0;
+}
 
-    const char *paths[] = {
-        "/etc/lsb-release",
-        "/etc/fedora-release",
-        "/etc/centos-release"
-    };
-
-    size_t i;
-    for (i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
-        FILE *fp = fopen(paths[i], "r");
-        if (fp) {
-            char buffer[MAX_LINE];
-            if (fgets(buffer, sizeof(buffer), fp)) {
-                strtok(buffer, " ");
-                snprintf(info->name, sizeof(info->name), "%s", buffer);
-                info->version[0] = '\0';
-            }
-            fclose(fp);
-            return 0;
+// --history [时长 | 起始 [结束]] [--step 秒]：只解码与时间范围相交的块
+int history_query(int argc, char *argv[]) {
+    time_t now = time(NULL);
+    long long from = now - 3600, to = now, step = -1;
+    int npos = 0, i;
+    for (i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--step") && i + 1 < argc) {
+            step = atoll(argv[++i]);
+        } else if (npos < 2 && history_parse_time(argv[i], now, npos == 0 ? &from : &to) == 0) {
+            npos++;
+        } else {
+            printf("用法: --history [时长如 6h | \"起始时间\" [\"结束时间\"]] [--step 秒]\n");
+            printf("      时间格式 2026-10-18 08:00，时长单位 s/m/h/d，默认最近 1 小时\n");
+            return 1;
         }
     }
+    if (from > to) {
+        printf("起始时间晚于结束时间\n");
+        return 1;
+    }
 
-#ifdef __FreeBSD__
-    FILE *fp = popen("uname -sr", "r");
-    if (fp) {
-        char buffer[MAX_LINE];
-        if (fgets(buffer, sizeof(buffer), fp)) {
-            sscanf(buffer, "%s %s", info->name, info->version);
-        }
-        pclose(fp);
+    SiHistory h;
+    if (si_history_open(&h, HISTORY_FILE, 0, 0) != 0) {
+        perror("无法打开 " HISTORY_FILE);
+        printf("先用 --history-record 10 常驻采样，或在 cron 中定时执行 --history-record\n");
+        return 1;
+    }
+    long long oldest, newest;
+    char a[32], b[32];
+    unsigned int used = si_history_span(&h, &oldest, &newest);
+    if (used == 0) {
+        printf("采样历史为空\n");
+        si_history_close(&h);
         return 0;
     }
-#endif
+    history_format_ts(oldest, a, sizeof(a));
+    history_format_ts(newest, b, sizeof(b));
+    printf("采样历史: %s ~ %s，已用 %u / %u 块（%.1f MiB）\n", a, b, used, h.blocks,
+           h.size / (1024.0 * 1024.0));
 
-    snprintf(info->name, sizeof(info->name), "Unknown");
-    snprintf(info->version, sizeof(info->version), "Unknown");
-    return -1;
+    HistoryPrint ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.h = &h;
+    ctx.step = step >= 0 ? step : (to - from) / HISTORY_ROWS;
+    printf("时间                  已用GiB    负载    CPU%%  压力cpu  压力mem   压力io");
+    for (i = 0; i < h.niface; i++) printf("  %-19s", h.ifaces[i]);
+    printf("\n");
+    long n = si_history_query(&h, from, to, history_print_cb, &ctx);
+    printf("范围内 %ld 条样本，输出 %ld 行；压力为区间内 some 停顿时间占比，网卡为收/发 KB/s\n",
+           n, ctx.rows);
+    si_history_close(&h);
+    return 0;
 }
 
-// 显示系统时间
-void print_current_time() {
-    time_t t = time(NULL);
-    struct tm *tm_info = localtime(&t);
-    char buffer[100];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", tm_info);
-    printf("    当前时间: %s\n", buffer);
-}
+// ==================== 内核事件 ====================
 
-// 显示系统环境信息
-void print_system_environment() {
-    char *hardware_model = get_hardware_model();
-    printf("        系统环境: %s\n", hardware_model);
-    free(hardware_model);
+#define KMSG_STATE_FILE HISTORY_DIR "/kmsg.state"
+
+// printk 时间戳是开机后的单调时间，换算成墙上时间（挂起过的机器会有偏差）
+static void kmsg_time(long long usec, char *buf, size_t size) {
+    struct timespec mono;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    time_t t = time(NULL) - (time_t)(mono.tv_sec - usec / 1000000);
+    strftime(buf, size, "%m-%d %H:%M:%S", localtime(&t));
 }
 
-// 显示发行版信息
-void print_distribution_info() {
-    DistributionInfo distro_info;
-    if (get_distribution_info(&distro_info) == 0) {
-        printf("        系统版本: %s %s\n",
-               distro_info.name,
-               distro_info.version[0] ? distro_info.version : "");
-    } else {
-        printf("无法识别发行版信息。\n");
-    }
+// follow 模式的事件回调
+static void print_kmsg_event(const SiKmsgEvent *ev, void *ctx) {
+    char when[32];
+    (void)ctx;
+    kmsg_time(ev->usec, when, sizeof(when));
+    printf("[%s] %s: %s\n", when, si_kmsg_kind_name(ev->kind), ev->text);
 }
 
-// 显示内核和主机名信息
-void print_kernel_and_hostname() {
-    printf("        内核版本: %s %s\n", global_sysinfo.sysname, global_sysinfo.release);
+// 读取游标之后的新记录并保存状态；返回 /dev/kmsg 的 fd（调用方关闭），失败返回 -1
+static int kmsg_update(SiKmsgState *st) {
+    if (si_kmsg_load(st, KMSG_STATE_FILE) != 0) return -1;
+    int fd = si_kmsg_open();
+    if (fd < 0) return -1;
+    if (si_kmsg_scan(fd, st, NULL, NULL) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (mkdir(HISTORY_DIR, 0755) == 0 || errno == EEXIST) si_kmsg_save(st, KMSG_STATE_FILE);
+    return fd;
 }
 
-// 显示CPU 型号和逻辑核心数
-void print_cpu_info() {
-    FILE *fp = fopen("/proc/cpuinfo", "r");
-    if (!fp) {
-        perror("无法打开 /proc/cpuinfo");
+// 在系统信息中显示本次开机以来各类内核事件的次数和最近几条
+void print_kernel_events(void) {
+    SiKmsgState st;
+    int fd = kmsg_update(&st);
+    int kind, i, total = 0;
+    if (fd < 0) {
+        printf("        内核事件: 无法读取 /dev/kmsg (%s)\n", strerror(errno));
+        return;
+    }
+    close(fd);
+    for (kind = 0; kind < SI_KMSG_KINDS; kind++) total += st.counts[kind];
+    if (total == 0) {
+        printf("        内核事件: 本次开机以来未发现异常（已检查 %llu 条日志）\n", st.scanned);
         return;
     }
+    printf("        内核事件: 本次开机以来（括号内为上次查看后新增）\n");
+    for (kind = 0; kind < SI_KMSG_KINDS; kind++) {
+        unsigned int count = st.counts[kind];
+        if (count == 0) continue;
+        printf("          %-12s %u 次 (+%u)\n", si_kmsg_kind_name(kind), count, st.fresh[kind]);
+        // 从最新一条往前显示
+        for (i = 0; i < SI_KMSG_EXAMPLES && (unsigned int)i < count; i++) {
+            const SiKmsgEvent *ev = &st.latest[kind][(count - 1 - i) % SI_KMSG_EXAMPLES];
+            char when[32];
+            kmsg_time(ev->usec, when, sizeof(when));
+            printf("            [%s] %s\n", when, ev->text);
+        }
+    }
+    if (st.lost)
+        printf("          另有 %llu 条日志在读取前已被内核缓冲区覆盖，可能漏计\n", st.lost);
+}
 
-    char line[512];
-    char cpu_model[256] = {0};
-    int logical_cores = 0;
+// --kernel-events [--follow]：显示新增事件；--follow 时常驻，事件到达即输出
+int kernel_events_command(int argc, char *argv[]) {
+    int follow = argc == 1 && !strcmp(argv[0], "--follow");
+    if (argc > 1 || (argc == 1 && !follow)) {
+        printf("用法: --kernel-events [--follow]\n");
+        return 1;
+    }
+    SiKmsgState st;
+    if (si_kmsg_load(&st, KMSG_STATE_FILE) != 0) {
+        perror("读取开机 ID 失败");
+        return 1;
+    }
+    int fd = si_kmsg_open();
+    if (fd < 0) {
+        perror("无法打开 /dev/kmsg");
+        return 1;
+    }
+    if (mkdir(HISTORY_DIR, 0755) != 0 && errno != EEXIST) perror("无法创建 " HISTORY_DIR);
 
-    while (fgets(line, sizeof(line), fp)) {
-        // Trim newline
-        line[strcspn(line, "\n")] = '\0';
+    int kind;
+    long n = si_kmsg_scan(fd, &st, print_kmsg_event, NULL);
+    if (n < 0) {
+        perror("读取 /dev/kmsg 失败");
+        close(fd);
+        return 1;
+    }
+    si_kmsg_save(&st, KMSG_STATE_FILE);
+    printf("新增 %ld 条日志，本次开机累计:", n);
+    for (kind = 0; kind < SI_KMSG_KINDS; kind++) printf(" %s %u", si_kmsg_kind_name(kind), st.counts[kind]);
+    printf("\n");
 
-        // 获取 CPU 型号
-        if (strncmp(line, "model name", 10) == 0 && cpu_model[0] == '\0') {
-            char *colon = strchr(line, ':');
-            if (colon) {
-                const char *model = colon + 1;
-                while (*model == ' ') model++;  // Skip leading spaces
-                strncpy(cpu_model, model, sizeof(cpu_model) - 1);
-                cpu_model[sizeof(cpu_model) - 1] = '\0';
-            }
+    // 没有新日志时 poll 阻塞，每批读完立即保存游标，中途退出也不会重复上报
+    while (follow) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        fflush(stdout);
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
         }
-
-        // 统计逻辑处理器数量
-        if (strncmp(line, "processor", 9) == 0 && line[9] == '\t') {
-            logical_cores++;
+        if (si_kmsg_scan(fd, &st, print_kmsg_event, NULL) < 0) {
+            perror("读取 /dev/kmsg 失败");
+            break;
         }
+        si_kmsg_save(&st, KMSG_STATE_FILE);
     }
+    close(fd);
+    return follow ? 1 : 0;
+}
 
-    fclose(fp);
-
-    // Fallback 到 sysconf 如果 processor 行不存在
-    if (logical_cores == 0) {
-        logical_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+// 显示系统信息主函数
+void system_info() {
+    SiArena arena;
+    SiReport report;
+    si_arena_init(&arena, report_arena_buf, sizeof(report_arena_buf));
+    if (si_collect(&report, &arena, SI_PROBE_ALL) != 0) {
+        perror("uname");
+        return;
     }
 
-    // 打印结果
-    printf("        CPU 型号: %s , 总逻辑处理器数量：%d \n", cpu_model[0] ? cpu_model : "Unknown" , logical_cores);
-    // printf("总逻辑处理器数量：%d\n", logical_cores);
-}
-
+    print_current_time(&report);
+    print_system_environment(&report);
+    print_distribution_info(&report);
+    print_kernel_and_hostname(&report);
+    print_cpu_info(&report);
+    print_memory_info(&report);
+    print_pressure_info(&report);
+    print_cgroup_info(&report);
+    
+    printf("        \n");  
+    printf("        主机名称: %s\n", report.uts.nodename);
+    print_local_ip(&report);
+    print_uptime(&report);
+    print_kernel_events();
 
-// 四舍五入函数（保留整数）
-double my_round(double x) {
-    int integer = (int)x;
-    return (x - integer >= 0.5) ? integer + 1 : integer;
+    // 每次查看顺带记录一条，配合 --history 查看趋势
+    history_append_now();
 }
 
-// 获取物理内存总量（通过 dmidecode）
-double get_phys_mem() {
-    FILE *fp = popen("sudo dmidecode -t memory | grep 'Size' | grep -v 'No Module Installed'", "r");
-    if (!fp) return -1;
+// ==================== 进程资源排行 ====================
 
-    double total = 0;
-    char line[256];
-    int size;
-    char unit[16];
+#define PROCESS_TOP_N 10
 
-    while (fgets(line, sizeof(line), fp)) {
-        if (sscanf(line, " Size: %d %s", &size, unit) == 2) {
-            if (!strcmp(unit, "MB")) total += size / 1024.0;
-            else if (!strcmp(unit, "GB")) total += size;
-        }
+// 打印一个排行表
+static void print_process_table(const char *title, const SiProcess *list, int n) {
+    int i;
+    printf("    %s\n", title);
+    printf("       PID  RSS(MiB)  PSS(MiB)    CPU(秒)  线程  命令\n");
+    for (i = 0; i < n; i++) {
+        const SiProcess *p = &list[i];
+        char pss[16];
+        if (p->pss_kb >= 0)
+            snprintf(pss, sizeof(pss), "%.1f", p->pss_kb / 1024.0);
+        else
+            snprintf(pss, sizeof(pss), "-");
+        printf("    %7d  %8.1f  %8s  %9.1f  %4d  %s\n",
+               p->pid, p->rss_kb / 1024.0, pss, p->cpu_seconds, p->threads, p->comm);
     }
-
-    pclose(fp);
-    return total;
+    printf("\n");
 }
 
-// 打印内存信息
-void print_memory_info() {
-    double phys_mem = get_phys_mem();
-    if (phys_mem <= 0) {
-        printf("无法获取物理内存\n");
+// 内存或 CPU 偏高时找出占用最多的进程
+void process_top() {
+    static SiProcTop result;
+    if (si_scan_processes(&result, PROCESS_TOP_N, 0, 1) != 0) {
+        perror("无法读取 /proc");
         return;
     }
 
-    FILE *fp = fopen("/proc/meminfo", "r");
-    if (!fp) {
-        perror("无法打开 /proc/meminfo");
+    printf("    共 %d 个进程，%d 线程并行扫描，耗时 %.1f ms", result.scanned, result.workers, result.elapsed_ms);
+    if (result.vanished) printf("，期间退出 %d 个", result.vanished);
+    printf("\n");
+    if (result.pss_denied)
+        printf("    有 %d 个进程无权读取 PSS（需要 root）\n", result.pss_denied);
+    printf("\n");
+
+    print_process_table("按 RSS 排序:", result.top[SI_TOP_RSS], result.n);
+    print_process_table("按 PSS 排序:", result.top[SI_TOP_PSS], result.n);
+    print_process_table("按 CPU 时间排序:", result.top[SI_TOP_CPU], result.n);
+    print_process_table("按线程数排序:", result.top[SI_TOP_THREADS], result.n);
+}
+
+// ==================== 资源压力监控 ====================
+
+// 窗口取 2 秒：没有 CAP_SYS_RESOURCE 时内核只接受 2 秒整数倍的窗口
+#define PSI_WATCH_WINDOW_US 2000000
+
+// 触发阈值：窗口内的累计停顿时间
+static const struct { int kind; int full; unsigned int stall_us; } psi_watch_triggers[] = {
+    { SI_PSI_CPU, 0, 1000000 },     // 一半时间有任务在等 CPU
+    { SI_PSI_MEMORY, 0, 200000 },
+    { SI_PSI_MEMORY, 1, 100000 },   // 所有任务同时卡在内存回收上
+    { SI_PSI_IO, 0, 200000 },
+    { SI_PSI_IO, 1, 100000 },
+};
+#define PSI_TRIGGER_COUNT ((int)(sizeof(psi_watch_triggers) / sizeof(psi_watch_triggers[0])))
+
+// 通过 PSI 触发器监控停顿：内核在越过阈值时唤醒 poll，不需要定时轮询
+void psi_watch() {
+    static char arena_buf[1024];
+    SiArena arena;
+    SiCgroup cg;
+    struct pollfd fds[PSI_TRIGGER_COUNT * 2 + 1];
+    int owner[PSI_TRIGGER_COUNT * 2 + 1];     // 触发器序号，cgroup 的加上 PSI_TRIGGER_COUNT
+    int nfds = 1, active = 0, i;
+
+    si_arena_init(&arena, arena_buf, sizeof(arena_buf));
+    si_probe_cgroup(&cg, &arena);
+    int watch_cgroup = cg.present && strcmp(cg.path, "/") != 0;
+
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    owner[0] = -1;
+    for (i = 0; i < PSI_TRIGGER_COUNT * 2; i++) {
+        int t = i % PSI_TRIGGER_COUNT;
+        int in_cgroup = i >= PSI_TRIGGER_COUNT;
+        if (in_cgroup && !watch_cgroup) break;
+        int fd = si_psi_trigger(in_cgroup ? cg.dir : NULL, psi_watch_triggers[t].kind,
+                                psi_watch_triggers[t].full, psi_watch_triggers[t].stall_us,
+                                PSI_WATCH_WINDOW_US);
+        if (fd < 0) continue;
+        fds[nfds].fd = fd;
+        fds[nfds].events = POLLPRI;
+        owner[nfds++] = i;
+        active++;
+    }
+    if (!active) {
+        printf("无法注册 PSI 触发器（需要 4.20 以上内核且开启 CONFIG_PSI，并以 root 运行）\n");
         return;
     }
 
-    double mem_available = 0;
-    char key[64], val[64], line[256];
-
-    while (fgets(line, sizeof(line), fp)) {
-        if (sscanf(line, "%63[^:]: %63s", key, val) != 2)
-            continue;
+    printf("正在监控资源压力（%s%d 个触发器，窗口 %d 秒），按回车结束...\n",
+           watch_cgroup ? "含 cgroup，" : "", active, PSI_WATCH_WINDOW_US / 1000000);
+    for (i = 1; i < nfds; i++) {
+        int t = owner[i] % PSI_TRIGGER_COUNT;
+        printf("    %s%s %s > %u ms\n", owner[i] >= PSI_TRIGGER_COUNT ? "cgroup " : "",
+               psi_labels[psi_watch_triggers[t].kind], psi_watch_triggers[t].full ? "full" : "some",
+               psi_watch_triggers[t].stall_us / 1000);
+    }
+    fflush(stdout);
 
-        if (!strcmp(key, "MemAvailable")) {
-            mem_available = atof(val) / (1024.0 * 1024.0); // KB -> GiB
+    while (active) {
+        if (poll(fds, (nfds_t)nfds, -1) < 0) {
+            if (errno == EINTR) continue;
             break;
         }
+        // 回车（或输入关闭）结束监控
+        if (fds[0].revents) {
+            char line[64];
+            if (fgets(line, sizeof(line), stdin) == NULL) clearerr(stdin);
+            break;
+        }
+        for (i = 1; i < nfds; i++) {
+            if (!fds[i].revents || fds[i].fd < 0) continue;
+            int t = owner[i] % PSI_TRIGGER_COUNT;
+            int in_cgroup = owner[i] >= PSI_TRIGGER_COUNT;
+            if (fds[i].revents & POLLERR) {
+                // cgroup 被删除后触发器失效
+                printf("    触发器失效，停止监控该项\n");
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                active--;
+                continue;
+            }
+            SiPsi psi;
+            char stamp[16];
+            time_t now = time(NULL);
+            strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&now));
+            si_probe_psi(&psi, in_cgroup ? cg.dir : NULL, psi_watch_triggers[t].kind);
+            printf("[%s] %s%s %s 停顿超过 %u ms   avg10 some %.2f%% full %.2f%%\n",
+                   stamp, in_cgroup ? "cgroup " : "", psi_labels[psi_watch_triggers[t].kind],
+                   psi_watch_triggers[t].full ? "full" : "some", psi_watch_triggers[t].stall_us / 1000,
+                   psi.some[0], psi.full[0]);
+            fflush(stdout);
+        }
     }
+    for (i = 1; i < nfds; i++)
+        if (fds[i].fd >= 0) close(fds[i].fd);
+}
 
-    fclose(fp);
+// ==================== 基线漂移比对 ====================
 
-    double used = phys_mem - mem_available;
-    double percent = (used / phys_mem) * 100.0;
+enum { DRIFT_INFO, DRIFT_WARN, DRIFT_CRIT, DRIFT_LEVELS };
+static const char *drift_level_names[DRIFT_LEVELS] = { "提示", "警告", "严重" };
 
-    // 四舍五入显示
-    double rounded_used = my_round(used);
-    double rounded_total = my_round(phys_mem);
+#define DRIFT_MEM_TOLERANCE 0.05      // 内存总量相差 5% 以内视为一致，内核保留的内存因机器而异
+#define DRIFT_MAX_FILE (4 * 1024 * 1024)
+#define DRIFT_MAX_THREADS 64
 
-    // 输出格式
-    printf("        物理内存: 内存总量: %2.0f GiB   已使用内存：%2.0f GiB(%.2f%%) \n",
-           rounded_total, rounded_used, percent);
-}
+static SiSnapshot snapshot_live;
+static char snapshot_arena_buf[65536];
 
-// 获取系统开机时间（返回字符串，需free）
-char* get_uptime_str() {
-    struct sysinfo info;
-    if (sysinfo(&info) != 0) {
-        return strdup("未知");
-    }
-    int days = info.uptime / (60*60*24);
-    int hours = (info.uptime % (60*60*24)) / 3600;
-    int minutes = (info.uptime % 3600) / 60;
-    int seconds = info.uptime % 60;
-    char *buf = malloc(128);
-    if (!buf) return strdup("内存不足");
-    snprintf(buf, 128, "%d天 %02d:%02d:%02d", days, hours, minutes, seconds);
-    return buf;
+typedef struct {
+    FILE *out;                  // 差异明细
+    int min_level;              // 低于该级别的差异不输出也不计数
+    int counts[DRIFT_LEVELS];
+    int sections;               // 参与比较的段数
+    int equal_sections;         // 哈希相同而跳过的段数
+} DriftResult;
+
+static void drift_report(DriftResult *r, int level, int section, const char *key,
+                         const char *base, const char *host) {
+    if (level < r->min_level) return;
+    r->counts[level]++;
+    fprintf(r->out, "  [%s] %s.%s: 基线 %s / 当前 %s\n", drift_level_names[level],
+            si_snapshot_section_name(section), key,
+            !base ? "(缺失)" : *base ? base : "(空)",
+            !host ? "(缺失)" : *host ? host : "(空)");
 }
 
-// 打印系统开机时间
-void print_uptime() {
-    char *uptime = get_uptime_str();
-    printf("        开机时长: %s\n", uptime);
-    free(uptime);
+static int compare_str_ptr(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
 }
 
-// 获取本机第一个非127.0.0.1的IPv4地址（返回字符串，需free）
-char* get_local_ip() {
-    struct ifaddrs *ifaddr, *ifa;
-    char *ip = NULL;
-    if (getifaddrs(&ifaddr) == -1) {
-        return strdup("未知");
+// 网卡地址的"形状"：IPv4 地址数和排序后的 族/前缀 列表，地址本身不参与
+static int drift_addr_shape(const char *value, char *shape, size_t size) {
+    char buf[1024], *items[64], *tok, *save;
+    int n = 0, v4 = 0, i;
+    size_t len = 0;
+    snprintf(buf, sizeof(buf), "%s", value);
+    for (tok = strtok_r(buf, " ", &save); tok && n < 64; tok = strtok_r(NULL, " ", &save)) {
+        char *slash = strchr(tok, '/');
+        int is_v6 = strchr(tok, ':') != NULL;
+        if (!is_v6) v4++;
+        // 原地改写成 "4/24"、"6/64"
+        tok[0] = is_v6 ? '6' : '4';
+        memmove(tok + 1, slash ? slash : "/?", strlen(slash ? slash : "/?") + 1);
+        items[n++] = tok;
     }
-    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == NULL) continue;
-        if (ifa->ifa_addr->sa_family == AF_INET) {
-            struct sockaddr_in *sa = (struct sockaddr_in *)ifa->ifa_addr;
-            if (strcmp(ifa->ifa_name, "lo") != 0) {
-                ip = strdup(inet_ntoa(sa->sin_addr));
-                break;
-            }
-        }
+    qsort(items, n, sizeof(items[0]), compare_str_ptr);
+    shape[0] = '\0';
+    for (i = 0; i < n; i++) {
+        int k = snprintf(shape + len, size - len, "%s ", items[i]);
+        if (k < 0 || (size_t)k >= size - len) break;
+        len += (size_t)k;
     }
-    freeifaddrs(ifaddr);
-    if (!ip) return strdup("未获取到IP");
-    return ip;
+    return v4;
 }
 
-// 打印本机IP
-void print_local_ip() {
-    char *ip = get_local_ip();
-    printf("        本机IP: %s\n", ip);
-    free(ip);
-}
-
-// 显示系统信息主函数
-void system_info() {
-    if (uname(&global_sysinfo) == -1) {
-        perror("uname");
-        return;
+// 两边都有但取值不同时的级别，-1 表示忽略
+static int drift_changed_level(int section, const char *key, const char *base, const char *host) {
+    char base_shape[512], host_shape[512];
+    switch (section) {
+    case SI_SNAP_SYSTEM:
+        if (!strcmp(key, "mem_total_mib")) {
+            double b = atof(base), h = atof(host);
+            return b > 0 && fabs(h - b) / b <= DRIFT_MEM_TOLERANCE ? -1 : DRIFT_CRIT;
+        }
+        if (!strcmp(key, "cpu_model") || !strcmp(key, "hardware")) return DRIFT_WARN;
+        return DRIFT_CRIT;
+    case SI_SNAP_NET:
+        // 每台机器地址本来就不同：丢了 IPv4 为严重，前缀结构不同为警告，仅地址不同为提示
+        if (drift_addr_shape(base, base_shape, sizeof(base_shape)) > 0
+            && drift_addr_shape(host, host_shape, sizeof(host_shape)) == 0)
+            return DRIFT_CRIT;
+        return strcmp(base_shape, host_shape) ? DRIFT_WARN : DRIFT_INFO;
+    default:
+        return DRIFT_WARN;
     }
+}
 
-    print_current_time();
-    print_system_environment();
-    print_distribution_info();
-    print_kernel_and_hostname();
-    print_cpu_info();
-    print_memory_info();
-    
-    printf("        \n");  
-    printf("        主机名称: %s\n", global_sysinfo.nodename);
-    print_local_ip();
-    print_uptime();
+// 基线有而主机没有
+static int drift_missing_level(int section) {
+    return section == SI_SNAP_SYSTEM || section == SI_SNAP_NET ? DRIFT_CRIT : DRIFT_WARN;
 }
 
-// 修改YUM源和APT源的函数
-void change_package_source() {
-    DistributionInfo distro_info;
-    if (get_distribution_info(&distro_info) != 0) {
-        printf("无法识别系统类型，无法自动更换源。\n");
-        return;
-    }
-    printf("检测到系统: %s %s\n", distro_info.name, distro_info.version);
+// 主机多出的条目：多出的软件源可能引入未知软件包，其余只提示
+static int drift_extra_level(int section) {
+    return section == SI_SNAP_SOURCES ? DRIFT_WARN : DRIFT_INFO;
+}
 
-    // Ubuntu/Debian 系列
-    if (strstr(distro_info.name, "Ubuntu") || strstr(distro_info.name, "Debian")) {
-        printf("正在备份并更换APT源...\n");
-        system("cp /etc/apt/sources.list /etc/apt/sources.list.bak 2>/dev/null");
-        // 选择阿里云源
-        FILE *fp = fopen("/etc/apt/sources.list", "w");
-        if (!fp) {
-            printf("无法写入 /etc/apt/sources.list\n");
-            return;
+// 逐段比较；哈希相同的段直接跳过，其余按键归并（两边段内都已按键排序）
+static void drift_compare(const SiSnapshot *base, const SiSnapshot *host, DriftResult *r) {
+    int section;
+    for (section = SI_SNAP_SYSTEM; section < SI_SNAP_SECTIONS; section++) {
+        if (!base->present[section]) continue;
+        r->sections++;
+        if (host->skipped[section] || (host->present[section] && host->hash[section] == base->hash[section])) {
+            r->equal_sections++;
+            continue;
         }
-        if (strstr(distro_info.name, "Ubuntu")) {
-            // 适配不同版本
-            const char *ver = distro_info.version;
-            char *source_content;
-            if (strstr(ver, "14")) {
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ trusty main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ trusty main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ trusty-security main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ trusty-security main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ trusty-updates main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ trusty-updates main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ trusty-backports main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ trusty-backports main restricted universe multiverse\n";
-            } else if (strstr(ver, "16")) {
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ xenial main\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ xenial main\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ xenial-updates main\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ xenial-updates main\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ xenial universe\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ xenial universe\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ xenial-updates universe\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ xenial-updates universe\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ xenial-security main\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ xenial-security main\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ xenial-security universe\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ xenial-security universe\n";
-            } else if (strstr(ver, "18")) {
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ bionic main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ bionic main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ bionic-security main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ bionic-security main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ bionic-updates main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ bionic-updates main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ bionic-backports main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ bionic-backports main restricted universe multiverse\n";
-            } else if (strstr(ver, "20")) {
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal-security main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal-security main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal-updates main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal-updates main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal-backports main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal-backports main restricted universe multiverse\n";
-            } else if (strstr(ver, "22")) {
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ jammy main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ jammy main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ jammy-security main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ jammy-security main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ jammy-updates main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ jammy-updates main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ jammy-backports main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ jammy-backports main restricted universe multiverse\n";
-            } else if (strstr(ver, "23")) {
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ lunar main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ lunar main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ lunar-security main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ lunar-security main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ lunar-updates main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ lunar-updates main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ lunar-backports main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ lunar-backports main restricted universe multiverse\n";
-            } else if (strstr(ver, "24")) {
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ noble main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ noble main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ noble-security main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ noble-security main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ noble-updates main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ noble-updates main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ noble-backports main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ noble-backports main restricted universe multiverse\n";
-            } else {
-                // 默认 fallback
-                source_content =
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal-security main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal-security main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal-updates main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal-updates main restricted universe multiverse\n"
-                    "deb https://mirrors.aliyun.com/ubuntu/ focal-backports main restricted universe multiverse\n"
-                    "deb-src https://mirrors.aliyun.com/ubuntu/ focal-backports main restricted universe multiverse\n";
-            }
-            fprintf(fp, "%s", source_content);
-        } else {
-            // Debian
-            const char *ver = distro_info.version;
-            const char *debian_content = NULL;
-            if (strstr(ver, "7")) {
-                debian_content =
-                    "deb https://mirrors.aliyun.com/debian-archive/debian/ wheezy main non-free contrib\n"
-                    "#deb https://mirrors.aliyun.com/debian-archive/debian/ wheezy-proposed-updates main non-free contrib\n"
-                    "deb-src https://mirrors.aliyun.com/debian-archive/debian/ wheezy main non-free contrib\n"
-                    "#deb-src https://mirrors.aliyun.com/debian-archive/debian/ wheezy-proposed-updates main non-free contrib\n";
-            } else if (strstr(ver, "8")) {
-                debian_content =
-                    "deb https://mirrors.aliyun.com/debian-archive/debian/ jessie main non-free contrib\n"
-                    "deb-src https://mirrors.aliyun.com/debian-archive/debian/ jessie main non-free contrib\n";
-            } else if (strstr(ver, "9")) {
-                debian_content =
-                    "deb https://mirrors.aliyun.com/debian-archive/debian stretch main contrib non-free\n"
-                    "#deb https://mirrors.aliyun.com/debian-archive/debian stretch-proposed-updates main non-free contrib\n"
-                    "#deb https://mirrors.aliyun.com/debian-archive/debian stretch-backports main non-free contrib\n"
-                    "deb https://mirrors.aliyun.com/debian-archive/debian-security stretch/updates main contrib non-free\n"
-                    "deb-src https://mirrors.aliyun.com/debian-archive/debian stretch main contrib non-free\n"
-                    "#deb-src https://mirrors.aliyun.com/debian-archive/debian stretch-proposed-updates main contrib non-free\n"
-                    "#deb-src https://mirrors.aliyun.com/debian-archive/debian stretch-backports main contrib non-free\n"
-                    "deb-src https://mirrors.aliyun.com/debian-archive/debian-security stretch/updates main contrib non-free\n";
-            } else if (strstr(ver, "10")) {
-                debian_content =
-                    "deb https://mirrors.aliyun.com/debian/ buster main non-free contrib\n"
-                    "deb-src https://mirrors.aliyun.com/debian/ buster main non-free contrib\n"
-                    "deb https://mirrors.aliyun.com/debian-security buster/updates main\n"
-                    "deb-src https://mirrors.aliyun.com/debian-security buster/updates main\n"
-                    "deb https://mirrors.aliyun.com/debian/ buster-updates main non-free contrib\n"
-                    "deb-src https://mirrors.aliyun.com/debian/ buster-updates main non-free contrib\n";
-            } else if (strstr(ver, "11")) {
-                debian_content =
-                    "deb https://mirrors.aliyun.com/debian/ bullseye main non-free contrib\n"
-                    "deb-src https://mirrors.aliyun.com/debian/ bullseye main non-free contrib\n"
-                    "deb https://mirrors.aliyun.com/debian-security/ bullseye-security main\n"
-                    "deb-src https://mirrors.aliyun.com/debian-security/ bullseye-security main\n"
-                    "deb https://mirrors.aliyun.com/debian/ bullseye-updates main non-free contrib\n"
-                    "deb-src https://mirrors.aliyun.com/debian/ bullseye-updates main non-free contrib\n"
-                    "deb https://mirrors.aliyun.com/debian/ bullseye-backports main non-free contrib\n"
-                    "deb-src https://mirrors.aliyun.com/debian/ bullseye-backports main non-free contrib\n";
-            } else if (strstr(ver, "12")) {
-                debian_content =
-                    "deb http://mirrors.aliyun.com/debian/ bookworm main contrib non-free\n"
-                    "deb http://mirrors.aliyun.com/debian/ bookworm-updates main contrib non-free\n"
-                    "deb http://mirrors.aliyun.com/debian-security bookworm-security main contrib non-free\n"
-                    "deb http://mirrors.aliyun.com/debian/ bookworm-backports main contrib non-free\n";
+        if (!host->present[section]) {
+            drift_report(r, drift_missing_level(section), section, "*", "", NULL);
+            continue;
+        }
+        const SiSnapEntry *b = &base->entries[base->start[section]];
+        const SiSnapEntry *h = &host->entries[host->start[section]];
+        int nb = base->count[section], nh = host->count[section], i = 0, j = 0;
+        while (i < nb || j < nh) {
+            int cmp = i >= nb ? 1 : j >= nh ? -1 : strcmp(b[i].key, h[j].key);
+            if (cmp < 0) {
+                drift_report(r, drift_missing_level(section), section, b[i].key, b[i].value, NULL);
+                i++;
+            } else if (cmp > 0) {
+                drift_report(r, drift_extra_level(section), section, h[j].key, NULL, h[j].value);
+                j++;
             } else {
-                debian_content =
-                    "deb http://mirrors.aliyun.com/debian/ bullseye main contrib non-free\n"
-                    "deb http://mirrors.aliyun.com/debian/ bullseye-updates main contrib non-free\n"
-                    "deb http://mirrors.aliyun.com/debian-security bullseye-security main contrib non-free\n"
-                    "deb http://mirrors.aliyun.com/debian/ bullseye-backports main contrib non-free\n";
-            }
-            // 先读取原内容
-            FILE *oldfp = fopen("/etc/apt/sources.list", "r");
-            char *old_content = NULL;
-            size_t old_size = 0;
-            if (oldfp) {
-                fseek(oldfp, 0, SEEK_END);
-                old_size = ftell(oldfp);
-                fseek(oldfp, 0, SEEK_SET);
-                old_content = malloc(old_size + 1);
-                if (old_content) {
-                    fread(old_content, 1, old_size, oldfp);
-                    old_content[old_size] = '\0';
+                if (strcmp(b[i].value, h[j].value)) {
+                    int level = drift_changed_level(section, b[i].key, b[i].value, h[j].value);
+                    if (level >= 0) drift_report(r, level, section, b[i].key, b[i].value, h[j].value);
                 }
-                fclose(oldfp);
+                i++;
+                j++;
             }
-            // 覆盖写入新内容+原内容
-            fp = fopen("/etc/apt/sources.list", "w");
-            if (fp) {
-                fprintf(fp, "%s", debian_content);
-                if (old_content) fprintf(fp, "%s", old_content);
-                fclose(fp);
-            }
-            if (old_content) free(old_content);
-        }
-        printf("APT源已切换为阿里云，正在更新缓存...\n");
-        int ret = system("apt update > /dev/null 2>&1");
-        if (ret != 0) {
-            printf("APT源更新失败，请检查网络连接或手动更新。\n");
         }
-        printf("APT源已切换并更新完成。\n");
-        return;
     }
+}
 
-    // CentOS/RHEL 系列
-    if (strstr(distro_info.name, "CentOS") || strstr(distro_info.name, "Red Hat") || strstr(distro_info.name, "RHEL")) {
-        printf("正在备份并更换YUM源...\n");
-        system("mkdir -p /etc/yum.repos.d/backup && mv /etc/yum.repos.d/*.repo /etc/yum.repos.d/backup/ 2>/dev/null");
-        char cmd[512] = {0};
-        int has_wget = (system("command -v wget > /dev/null 2>&1") == 0);
-        int has_curl = (system("command -v curl > /dev/null 2>&1") == 0);
-        const char *repo_url = NULL;
-        const char *ver = distro_info.version;
-        if (strstr(ver, "6")) {
-            repo_url = "https://mirrors.aliyun.com/repo/Centos-vault-6.10.repo";
-        } else if (strstr(ver, "7")) {
-            repo_url = "https://mirrors.aliyun.com/repo/Centos-7.repo";
-        } else if (strstr(ver, "8")) {
-            repo_url = "https://mirrors.aliyun.com/repo/Centos-vault-8.5.2111.repo";
-        } else if (strstr(ver, "9")) {
-            printf("该系统目前无阿里云源，请手动处理。\n");
-            return;
-        } else {
-            repo_url = "https://mirrors.aliyun.com/repo/Centos-7.repo";
-        }
-        if (has_wget) {
-            snprintf(cmd, sizeof(cmd), "wget -O /etc/yum.repos.d/CentOS-Base.repo %s", repo_url);
-        } else if (has_curl) {
-            snprintf(cmd, sizeof(cmd), "curl -o /etc/yum.repos.d/CentOS-Base.repo %s", repo_url);
-        } else {
-            printf("未检测到wget或curl命令，无法下载YUM源配置文件！\n");
-            return;
+// 读入整个文件，末尾多留一个字节给解析器写 '\0'；buf 可复用，按需扩大
+static int drift_read_file(const char *path, char **buf, size_t *cap, size_t *len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > DRIFT_MAX_FILE) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    if ((size_t)st.st_size + 1 > *cap) {
+        char *p = realloc(*buf, (size_t)st.st_size + 1);
+        if (!p) {
+            close(fd);
+            return -1;
         }
-        system(cmd);
-        printf("YUM源已切换为阿里云，正在清理并生成缓存...\n");
-        int ret = system("yum clean all > /dev/null 2>&1 && yum makecache > /dev/null 2>&1");
-        if (ret != 0) {
-            printf("YUM源清理和缓存生成失败，请检查网络连接或手动处理。\n");
-        }
-        printf("YUM源已切换并缓存更新完成。\n");
-        return;
+        *buf = p;
+        *cap = (size_t)st.st_size + 1;
     }
-
-    printf("暂不支持该系统自动换源，请手动处理。\n");
+    size_t got = 0;
+    while (got < (size_t)st.st_size) {
+        ssize_t k = read(fd, *buf + got, (size_t)st.st_size - got);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) break;
+        got += (size_t)k;
+    }
+    close(fd);
+    *len = got;
+    return 0;
 }
 
-// 功能示例：功能一
-void feature_1() {
-    printf("👉 功能 1 已执行。\n");
+typedef struct {
+    const char *path;
+    char *details;
+    size_t details_len;
+    DriftResult result;
+    int failed;                 // 读取或解析失败时为 1
+} DriftJob;
+
+typedef struct {
+    const SiSnapshot *base;
+    DriftJob *jobs;
+    int njobs;
+    int next;                   // 下一个待领取的任务
+    int min_level;
+} DriftPool;
+
+static void *drift_worker(void *arg) {
+    DriftPool *w = arg;
+    SiSnapshot *snap = malloc(sizeof(SiSnapshot));
+    char *buf = NULL;
+    size_t cap = 0, len;
+    if (!snap) return NULL;
+    for (;;) {
+        int i = __sync_fetch_and_add(&w->next, 1);
+        if (i >= w->njobs) break;
+        DriftJob *job = &w->jobs[i];
+        job->result.min_level = w->min_level;
+        if (drift_read_file(job->path, &buf, &cap, &len) != 0
+            || si_snapshot_parse(snap, buf, len, w->base, 0) != 0 || !snap->present[SI_SNAP_SYSTEM]) {
+            job->failed = 1;
+            continue;
+        }
+        job->result.out = open_memstream(&job->details, &job->details_len);
+        if (!job->result.out) {
+            job->failed = 1;
+            continue;
+        }
+        drift_compare(w->base, snap, &job->result);
+        fclose(job->result.out);
+    }
+    free(buf);
+    free(snap);
+    return NULL;
 }
 
-// 功能三：修改源
-void feature_3() {
-    printf("👉 功能 3：自动更换YUM/APT源\n");
-    change_package_source();
+// 展开命令行上的文件和目录（目录只取一层普通文件，按名称排序）
+static int drift_collect_paths(char **args, int n, char ***paths_out) {
+    char **paths = NULL;
+    int count = 0, cap = 0, i, k, oom = 0;
+    for (i = 0; i < n && !oom; i++) {
+        struct stat st;
+        struct dirent **list = NULL;
+        int nlist = 0;
+        if (stat(args[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            nlist = scandir(args[i], &list, NULL, alphasort);
+            if (nlist < 0) nlist = 0;
+        }
+        for (k = 0; k < (nlist ? nlist : 1); k++) {
+            char path[4096];
+            if (nlist) {
+                snprintf(path, sizeof(path), "%s/%s", args[i], list[k]->d_name);
+                int skip = list[k]->d_name[0] == '.' || stat(path, &st) != 0 || !S_ISREG(st.st_mode);
+                free(list[k]);
+                if (skip) continue;
+            } else {
+                snprintf(path, sizeof(path), "%s", args[i]);
+            }
+            if (count == cap) {
+                int grown_cap = cap ? cap * 2 : 256;
+                char **p = realloc(paths, (size_t)grown_cap * sizeof(*paths));
+                if (!p) { oom = 1; break; }
+                paths = p;
+                cap = grown_cap;
+            }
+            if ((paths[count] = strdup(path)) == NULL) { oom = 1; break; }
+            count++;
+        }
+        // 内存不足时停止展开，已展开的照常处理；目录中尚未处理的条目在这里释放
+        if (oom && nlist)
+            for (k++; k < nlist; k++) free(list[k]);
+        free(list);
+    }
+    if (oom) printf("警告: 内存不足，只处理前 %d 个文件\n", count);
+    *paths_out = paths;
+    return count;
 }
 
-// 校验IP地址格式
-int is_valid_ip(const char *ip) {
-    struct in_addr addr;
-    return inet_pton(AF_INET, ip, &addr) == 1;
+static int drift_exit_code(const int *counts) {
+    return counts[DRIFT_CRIT] ? 3 : counts[DRIFT_WARN] ? 2 : 0;
 }
 
-// 校验掩码格式（255.255.255.0 或 /24）
-int is_valid_mask(const char *mask) {
-    // 支持 /24
-    if (mask[0] == '/' && atoi(mask+1) >= 0 && atoi(mask+1) <= 32) return 1;
-    // 支持 255.255.255.0
-    struct in_addr addr;
-    return inet_pton(AF_INET, mask, &addr) == 1;
+// --snapshot [文件]：输出本机快照，作为基线或供批量比对
+int snapshot_command(int argc, char *argv[]) {
+    SiArena arena;
+    si_arena_init(&arena, snapshot_arena_buf, sizeof(snapshot_arena_buf));
+    if (si_snapshot_collect(&snapshot_live, &arena, NULL) != 0)
+        printf("警告: 快照条目过多，部分内容被截断\n");
+    if (argc == 0 || !strcmp(argv[0], "-"))
+        return si_snapshot_write(&snapshot_live, STDOUT_FILENO) == 0 ? 0 : 1;
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", argv[0]);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(tmp_path);
+        return 1;
+    }
+    int ok = si_snapshot_write(&snapshot_live, fd) == 0;
+    if (close(fd) != 0 || !ok || rename(tmp_path, argv[0]) != 0) {
+        perror(argv[0]);
+        unlink(tmp_path);
+        return 1;
+    }
+    printf("快照已写入 %s\n", argv[0]);
+    return 0;
 }
 
-// 获取所有物理网卡名，返回数量，names为输出数组
-int get_all_ifnames(char names[][IFNAMSIZ], int max) {
-    struct ifaddrs *ifaddr, *ifa;
-    int count = 0;
-    if (getifaddrs(&ifaddr) == -1) return 0;
-    for (ifa = ifaddr; ifa != NULL && count < max; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_PACKET) {
-            // 不重复
-            int found = 0;
-            int i;
-            for (i = 0; i < count; ++i) if (strcmp(names[i], ifa->ifa_name) == 0) { found = 1; break; }
-            if (!found) strncpy(names[count++], ifa->ifa_name, IFNAMSIZ);
+// --drift 基线 [快照文件或目录 ...] [--threads N] [--level info|warn|crit]
+// 不给快照时比较本机；退出码：0 一致，1 出错，2 有警告，3 有严重差异
+int drift_command(int argc, char *argv[]) {
+    const char *baseline = NULL;
+    char **targets = malloc(sizeof(char *) * (size_t)(argc + 1));
+    int ntargets = 0, threads = 0, min_level = DRIFT_INFO, i;
+    for (i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--level") && i + 1 < argc) {
+            const char *v = argv[++i];
+            min_level = !strcmp(v, "crit") ? DRIFT_CRIT : !strcmp(v, "warn") ? DRIFT_WARN : DRIFT_INFO;
+        } else if (!baseline) {
+            baseline = argv[i];
+        } else {
+            targets[ntargets++] = argv[i];
         }
     }
-    freeifaddrs(ifaddr);
-    return count;
+    if (!baseline) {
+        printf("用法: --drift 基线文件 [快照文件或目录 ...] [--threads N] [--level info|warn|crit]\n");
+        printf("      基线用 --snapshot 文件 在标准主机上生成；不给快照时比较本机\n");
+        free(targets);
+        return 1;
+    }
+
+    // 基线可能被手工修改过，哈希按内容重新计算
+    static SiSnapshot base;
+    char *base_buf = NULL;
+    size_t base_cap = 0, base_len;
+    if (drift_read_file(baseline, &base_buf, &base_cap, &base_len) != 0
+        || si_snapshot_parse(&base, base_buf, base_len, NULL, 1) != 0) {
+        perror(baseline);
+        free(base_buf);
+        free(targets);
+        return 1;
+    }
+
+    int code = 0;
+    if (ntargets == 0) {
+        SiArena arena;
+        DriftResult r;
+        memset(&r, 0, sizeof(r));
+        r.out = stdout;
+        r.min_level = min_level;
+        si_arena_init(&arena, snapshot_arena_buf, sizeof(snapshot_arena_buf));
+        si_snapshot_collect(&snapshot_live, &arena, &base);
+        drift_compare(&base, &snapshot_live, &r);
+        printf("本机与基线 %s: 严重 %d，警告 %d，提示 %d（%d / %d 段一致）\n", baseline,
+               r.counts[DRIFT_CRIT], r.counts[DRIFT_WARN], r.counts[DRIFT_INFO],
+               r.equal_sections, r.sections);
+        code = drift_exit_code(r.counts);
+        free(base_buf);
+        free(targets);
+        return code;
+    }
+
+    char **paths;
+    int njobs = drift_collect_paths(targets, ntargets, &paths);
+    free(targets);
+    DriftJob *jobs = calloc((size_t)(njobs ? njobs : 1), sizeof(DriftJob));
+    if (!jobs) {
+        free(base_buf);
+        return 1;
+    }
+    for (i = 0; i < njobs; i++) jobs[i].path = paths[i];
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > DRIFT_MAX_THREADS) threads = DRIFT_MAX_THREADS;
+    if (threads > njobs) threads = njobs;
+    if (threads < 1) threads = 1;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    // 所有线程共用一个任务计数器，快的线程自然多领；第 0 份在当前线程执行
+    DriftPool shared = { &base, jobs, njobs, 0, min_level };
+    pthread_t tids[DRIFT_MAX_THREADS];
+    int started[DRIFT_MAX_THREADS] = {0};
+    for (i = 1; i < threads; i++)
+        started[i] = pthread_create(&tids[i], NULL, drift_worker, &shared) == 0;
+    drift_worker(&shared);
+    for (i = 1; i < threads; i++)
+        if (started[i]) pthread_join(tids[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+    int totals[DRIFT_LEVELS] = {0}, same = 0, differ = 0, failed = 0, sections = 0, equal = 0, k;
+    for (i = 0; i < njobs; i++) {
+        DriftJob *job = &jobs[i];
+        if (job->failed) {
+            printf("== %s: 无法读取或不是有效快照\n", job->path);
+            failed++;
+        } else if (job->details_len) {
+            printf("== %s: 严重 %d，警告 %d，提示 %d\n%s", job->path, job->result.counts[DRIFT_CRIT],
+                   job->result.counts[DRIFT_WARN], job->result.counts[DRIFT_INFO], job->details);
+            differ++;
+        } else {
+            same++;
+        }
+        for (k = 0; k < DRIFT_LEVELS; k++) totals[k] += job->result.counts[k];
+        sections += job->result.sections;
+        equal += job->result.equal_sections;
+        free(job->details);
+        free(paths[i]);
+    }
+    printf("比较 %d 个快照（%d 线程，%.1f ms，%.0f 个/秒）：一致 %d，有差异 %d，失败 %d；%d / %d 段哈希相同直接跳过\n",
+           njobs, threads, ms, ms > 0 ? njobs / (ms / 1000.0) : 0.0, same, differ, failed, equal, sections);
+    code = drift_exit_code(totals);
+    if (!code && failed) code = 1;
+    free(jobs);
+    free(paths);
+    free(base_buf);
+    return code;
 }
 
+// ==================== 批量汇总（--aggregate） ====================
 
+#define FLEET_DISTROS 64
+#define FLEET_EXAMPLES 20
+#define FLEET_BUCKETS 14          // 按 2 的幂分桶：内存 GiB、CPU 核数
+#define FLEET_CHUNK 32            // 每次从自己的区间领取的文件数
 
-// 掩码长度转点分十进制
-void masklen_to_str(int masklen, char *out) {
-    unsigned int mask = masklen == 0 ? 0 : 0xFFFFFFFF << (32 - masklen);
-    sprintf(out, "%u.%u.%u.%u",
-        (mask >> 24) & 0xFF,
-        (mask >> 16) & 0xFF,
-        (mask >> 8) & 0xFF,
-        mask & 0xFF);
+typedef struct {
+    char name[96];
+    long count;
+} FleetCount;
+
+// 每个线程的局部汇总，结束后合并
+typedef struct {
+    long files, failed;
+    FleetCount distros[FLEET_DISTROS];
+    int ndistro;
+    long distro_other;            // 超出 FLEET_DISTROS 种的发行版
+    long mem_buckets[FLEET_BUCKETS], cpu_buckets[FLEET_BUCKETS];
+    long mem_n, cpu_n;
+    long long mem_sum, mem_min, mem_max;   // MiB
+    long long cpu_sum, cpu_min, cpu_max;
+    long legacy_hosts;            // CentOS 7 且仍指向阿里云源
+    char legacy[FLEET_EXAMPLES][96];
+    int nlegacy;
+    long noip_hosts, noip_ifaces; // 有网卡没有任何地址的主机 / 网卡数
+    char noip[FLEET_EXAMPLES][96];
+    int nnoip;
+} FleetAgg;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int begin, end;               // 尚未处理的文件区间，自己从前面取，别人从后面偷
+    FleetAgg agg;
+    pthread_t thread;
+    int started;
+} FleetWorker;
+
+typedef struct {
+    char **paths;
+    FleetWorker *workers;
+    int nworkers;
+    long steals;
+} FleetPool;
+
+typedef struct {
+    FleetPool *pool;
+    int self;
+} FleetArg;
+
+// 值按 2 的幂分桶：0 为 <1，1 为 1，k 为 (2^(k-2), 2^(k-1)]，最后一桶不设上界
+static int fleet_bucket(double v) {
+    int k = 1;
+    double top = 1;
+    if (v < 1) return 0;
+    while (v > top && k < FLEET_BUCKETS - 1) {
+        top *= 2;
+        k++;
+    }
+    return k;
 }
 
-// 检查文件是否存在
-int file_exists(const char *path) {
-    FILE *fp = fopen(path, "r");
-    if (fp) { fclose(fp); return 1; }
-    return 0;
+static void fleet_bucket_label(int k, char *buf, size_t size) {
+    if (k == 0) snprintf(buf, size, "<1");
+    else if (k == 1) snprintf(buf, size, "1");
+    else if (k == FLEET_BUCKETS - 1) snprintf(buf, size, ">%lld", 1LL << (k - 2));
+    else snprintf(buf, size, "(%lld,%lld]", 1LL << (k - 2), 1LL << (k - 1));
 }
 
-// 查找下一个可用的 IPADDRX 编号
-int find_next_ip_index(const char *path) {
-    FILE *f = fopen(path, "r");
-    if (!f) return 0;
-    int max_idx = 0;
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-        int idx;
-        if (sscanf(line, "IPADDR%d=", &idx) == 1) {
-            if (idx > max_idx) max_idx = idx;
-        } else if (strncmp(line, "IPADDR=", 7) == 0 && max_idx == 0) {
-            max_idx = 0; // IPADDR= 视为0号
-        }
+// 保留字典序最小的 FLEET_EXAMPLES 个样例，合并顺序不影响结果
+static void fleet_example_add(char list[][96], int *n, const char *name) {
+    int i = *n;
+    if (i == FLEET_EXAMPLES && strcmp(name, list[i - 1]) >= 0) return;
+    if (i == FLEET_EXAMPLES) i--;
+    while (i > 0 && strcmp(name, list[i - 1]) < 0) {
+        memcpy(list[i], list[i - 1], sizeof(list[i]));
+        i--;
     }
-    fclose(f);
-    return max_idx + 1;
+    snprintf(list[i], sizeof(list[i]), "%s", name);
+    if (*n < FLEET_EXAMPLES) (*n)++;
 }
 
-// 实际添加IP到配置文件
-void do_add_ip(const char *ifname, const char *ip, const char *mask) {
-    // 检查 NetworkManager 是否 running
-    int is_nm_running = (system("systemctl is-active --quiet NetworkManager") == 0);
-    if (is_nm_running) {
-        // 优先用 nmcli 配置
-        char nmcli_cmd[512];
-        // 先查找对应网卡的 connection 名称
-        char con_name[128] = "";
-        char nmcli_query_cmd[256];
-        snprintf(nmcli_query_cmd, sizeof(nmcli_query_cmd), "nmcli -g GENERAL.CONNECTION device show %s 2>/dev/null", ifname);
-        FILE *con_fp = popen(nmcli_query_cmd, "r");
-        if (con_fp) {
-            if (fgets(con_name, sizeof(con_name), con_fp)) {
-                con_name[strcspn(con_name, "\n")] = '\0'; // 去除换行
-            }
-            pclose(con_fp);
-        }
-        if (strlen(con_name) == 0 || strcmp(con_name, "--") == 0) {
-            printf("未找到网卡 %s 的 NetworkManager 连接名，自动切换为配置文件方式。\n", ifname);
-            // 不 return，继续走后面配置文件逻辑
-        } else {
-            // 需要拼接 CIDR 掩码
-            int masklen = 0;
-            if (strchr(mask, '.')) {
-                // 点分十进制转掩码长度
-                unsigned int m1, m2, m3, m4;
-                if (sscanf(mask, "%u.%u.%u.%u", &m1, &m2, &m3, &m4) == 4) {
-                    int i;
-                    unsigned int mask32 = (m1 << 24) | (m2 << 16) | (m3 << 8) | m4;
-                    for (i = 31; i >= 0; --i) {
-                        if ((mask32 >> i) & 1) masklen++;
-                    }
-                }
-            } else if (mask[0] == '/' && atoi(mask+1) > 0) {
-                masklen = atoi(mask+1);
-            }
-            if (masklen <= 0 || masklen > 32) masklen = 24; // 默认
-            snprintf(nmcli_cmd, sizeof(nmcli_cmd),
-                "nmcli connection modify '%s' +ipv4.addresses %s/%d",
-                con_name, ip, masklen);
-            printf("检测到 NetworkManager 正在运行，推荐使用 nmcli 配置：\n%s\n", nmcli_cmd);
-            int ret = system(nmcli_cmd);
-            if (ret == 0) {
-                // 配置成功后激活连接
-                char up_cmd[256];
-                snprintf(up_cmd, sizeof(up_cmd), "nmcli connection up '%s' || ifup %s", con_name, ifname);
-                printf("正在激活连接: %s\n", up_cmd);
-                system(up_cmd);
-                printf("IP 已通过 nmcli 添加并激活。\n");
-                return;
-            } else {
-                printf("nmcli 配置失败，建议用 'nmcli connection show' 查看所有连接名，并手动配置。\n");
-                // 失败时也继续走配置文件逻辑
-            }
+static void fleet_count_distro(FleetAgg *a, const char *name, long count) {
+    int i;
+    for (i = 0; i < a->ndistro; i++) {
+        if (!strcmp(a->distros[i].name, name)) {
+            a->distros[i].count += count;
+            return;
         }
     }
-    // 检测系统类型
-    FILE *fp = fopen("/etc/os-release", "r");
-    char osid[64] = "", line[256];
-    if (fp) {
-        while (fgets(line, sizeof(line), fp)) {
-            if (strncmp(line, "ID=", 3) == 0) {
-                sscanf(line, "ID=%63s", osid);
-                // 去除引号
-                size_t len = strlen(osid);
-                if (osid[0] == '"' || osid[0] == '\'') memmove(osid, osid+1, len-1);
-                if (osid[strlen(osid)-1] == '"' || osid[strlen(osid)-1] == '\'') osid[strlen(osid)-1] = 0;
+    if (a->ndistro == FLEET_DISTROS) {
+        a->distro_other += count;
+        return;
+    }
+    snprintf(a->distros[a->ndistro].name, sizeof(a->distros[0].name), "%s", name);
+    a->distros[a->ndistro++].count = count;
+}
+
+static void fleet_minmax(long long v, long *n, long long *sum, long long *min, long long *max) {
+    if (*n == 0 || v < *min) *min = v;
+    if (*n == 0 || v > *max) *max = v;
+    *sum += v;
+    (*n)++;
+}
+
+static void fleet_account(FleetAgg *a, const SiSnapshot *s) {
+    const char *host = si_snapshot_get(s, SI_SNAP_HOST, "hostname");
+    const char *distro = si_snapshot_get(s, SI_SNAP_SYSTEM, "distro");
+    const char *version = si_snapshot_get(s, SI_SNAP_SYSTEM, "version");
+    const char *mem = si_snapshot_get(s, SI_SNAP_SYSTEM, "mem_total_mib");
+    const char *cores = si_snapshot_get(s, SI_SNAP_SYSTEM, "cpu_cores");
+    char name[96];
+    int i;
+    if (!host) host = "?";
+    if (!distro) distro = "Unknown";
+    if (!version) version = "";
+
+    snprintf(name, sizeof(name), "%s%s%s", distro, *version ? " " : "", version);
+    fleet_count_distro(a, name, 1);
+    if (mem) {
+        long long mib = atoll(mem);
+        a->mem_buckets[fleet_bucket(mib / 1024.0)]++;
+        fleet_minmax(mib, &a->mem_n, &a->mem_sum, &a->mem_min, &a->mem_max);
+    }
+    if (cores) {
+        long long n = atoll(cores);
+        a->cpu_buckets[fleet_bucket((double)n)]++;
+        fleet_minmax(n, &a->cpu_n, &a->cpu_sum, &a->cpu_min, &a->cpu_max);
+    }
+
+    if (strstr(distro, "CentOS") && version[0] == '7') {
+        for (i = 0; i < s->count[SI_SNAP_SOURCES]; i++) {
+            if (strstr(s->entries[s->start[SI_SNAP_SOURCES] + i].value, "aliyun")) {
+                a->legacy_hosts++;
+                fleet_example_add(a->legacy, &a->nlegacy, host);
                 break;
             }
         }
-        fclose(fp);
     }
-    // Ubuntu/Debian
-    if (strstr(osid, "ubuntu") || strstr(osid, "debian")) {
-        char path[256];
-        snprintf(path, sizeof(path), "/etc/network/interfaces.d/%s.cfg", ifname);
-        if (!file_exists(path)) {
-            // 若主 interfaces 存在但 interfaces.d 不存在，则写主文件
-            if (!file_exists("/etc/network/interfaces.d") && file_exists("/etc/network/interfaces")) {
-                strcpy(path, "/etc/network/interfaces");
-            }
+
+    int noip = 0;
+    for (i = 0; i < s->count[SI_SNAP_NET]; i++) {
+        const SiSnapEntry *e = &s->entries[s->start[SI_SNAP_NET] + i];
+        if (*e->value) continue;
+        noip++;
+        snprintf(name, sizeof(name), "%s:%s", host, e->key);
+        fleet_example_add(a->noip, &a->nnoip, name);
+    }
+    a->noip_ifaces += noip;
+    if (noip) a->noip_hosts++;
+}
+
+static void fleet_merge(FleetAgg *dst, const FleetAgg *src) {
+    int i;
+    dst->files += src->files;
+    dst->failed += src->failed;
+    for (i = 0; i < src->ndistro; i++) fleet_count_distro(dst, src->distros[i].name, src->distros[i].count);
+    dst->distro_other += src->distro_other;
+    for (i = 0; i < FLEET_BUCKETS; i++) {
+        dst->mem_buckets[i] += src->mem_buckets[i];
+        dst->cpu_buckets[i] += src->cpu_buckets[i];
+    }
+    if (src->mem_n) {
+        if (!dst->mem_n || src->mem_min < dst->mem_min) dst->mem_min = src->mem_min;
+        if (!dst->mem_n || src->mem_max > dst->mem_max) dst->mem_max = src->mem_max;
+        dst->mem_sum += src->mem_sum;
+        dst->mem_n += src->mem_n;
+    }
+    if (src->cpu_n) {
+        if (!dst->cpu_n || src->cpu_min < dst->cpu_min) dst->cpu_min = src->cpu_min;
+        if (!dst->cpu_n || src->cpu_max > dst->cpu_max) dst->cpu_max = src->cpu_max;
+        dst->cpu_sum += src->cpu_sum;
+        dst->cpu_n += src->cpu_n;
+    }
+    dst->legacy_hosts += src->legacy_hosts;
+    for (i = 0; i < src->nlegacy; i++) fleet_example_add(dst->legacy, &dst->nlegacy, src->legacy[i]);
+    dst->noip_hosts += src->noip_hosts;
+    dst->noip_ifaces += src->noip_ifaces;
+    for (i = 0; i < src->nnoip; i++) fleet_example_add(dst->noip, &dst->nnoip, src->noip[i]);
+}
+
+// 映射并解析一个文件。解析器要在 text[len] 写 '\0'：文件长度不是页大小整数倍时
+// 映射页尾部可写（MAP_PRIVATE 写时复制，不改文件），否则退回读入缓冲区
+static int fleet_parse_file(const char *path, SiSnapshot *snap, char **buf, size_t *cap,
+                            void **map, size_t *map_len) {
+    static long page;
+    size_t len;
+    *map = NULL;
+    if (!page) page = sysconf(_SC_PAGESIZE);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || st.st_size > DRIFT_MAX_FILE) {
+        close(fd);
+        return -1;
+    }
+    len = (size_t)st.st_size;
+    if (len % (size_t)page) {
+        void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) return -1;
+        *map = p;
+        *map_len = len;
+        return si_snapshot_parse(snap, p, len, NULL, 0);
+    }
+    close(fd);
+    if (drift_read_file(path, buf, cap, &len) != 0) return -1;
+    return si_snapshot_parse(snap, *buf, len, NULL, 0);
+}
+
+// 领取下一批文件：先取自己区间的前端，空了就从其他线程区间的后半段偷一半过来
+static int fleet_take(FleetPool *pool, int self, int *first, int *count) {
+    FleetWorker *me = &pool->workers[self];
+    int k;
+    for (;;) {
+        pthread_mutex_lock(&me->lock);
+        if (me->begin < me->end) {
+            *first = me->begin;
+            *count = me->end - me->begin < FLEET_CHUNK ? me->end - me->begin : FLEET_CHUNK;
+            me->begin += *count;
+            pthread_mutex_unlock(&me->lock);
+            return 1;
         }
-        // 检查IP是否已存在
-        int ip_exists = 0;
-        FILE *checkf = fopen(path, "r");
-        if (checkf) {
-            char linebuf[256];
-            while (fgets(linebuf, sizeof(linebuf), checkf)) {
-                if (strstr(linebuf, ip)) { ip_exists = 1; break; }
+        pthread_mutex_unlock(&me->lock);
+
+        int stolen = 0;
+        for (k = 1; k < pool->nworkers && !stolen; k++) {
+            FleetWorker *victim = &pool->workers[(self + k) % pool->nworkers];
+            pthread_mutex_lock(&victim->lock);
+            int left = victim->end - victim->begin;
+            if (left > 0) {
+                int mid = victim->end - (left + 1) / 2;
+                pthread_mutex_lock(&me->lock);
+                me->begin = mid;
+                me->end = victim->end;
+                pthread_mutex_unlock(&me->lock);
+                victim->end = mid;
+                stolen = 1;
             }
-            fclose(checkf);
-        }
-        if (ip_exists) {
-            printf("该IP %s 已存在于 %s ，不重复添加。\n", ip, path);
-            return;
+            pthread_mutex_unlock(&victim->lock);
         }
-        FILE *f = fopen(path, "a");
-        if (!f) { printf("无法写入 %s\n", path); return; }
-        fprintf(f, "auto %s\niface %s inet static\n    address %s\n    netmask %s\n", ifname, ifname, ip, mask);
-        fclose(f);
-        printf("已写入 %s\n", path);
-        // 配置文件方式直接重启network服务
-        printf("正在重启网络服务: systemctl restart network\n");
-        system("systemctl restart network");
-        return;
+        if (!stolen) return 0;
+        __sync_fetch_and_add(&pool->steals, 1);
     }
-    // CentOS/RHEL/Fedora
-    if (strstr(osid, "centos") || strstr(osid, "rhel") || strstr(osid, "fedora")) {
-        char path[256];
-        snprintf(path, sizeof(path), "/etc/sysconfig/network-scripts/ifcfg-%s", ifname);
-        int is_new_file = 0;
-        if (!file_exists(path)) {
-            snprintf(path, sizeof(path), "/etc/sysconfig/network-scripts/ifcfg-%s", ifname);
-            if (!file_exists(path)) {
-                is_new_file = 1;
-            }
-        }
-        // 检查IP是否已存在
-        int ip_exists = 0;
-        FILE *checkf = fopen(path, "r");
-        if (checkf) {
-            char linebuf[256];
-            while (fgets(linebuf, sizeof(linebuf), checkf)) {
-                if (strstr(linebuf, ip)) { ip_exists = 1; break; }
+}
+
+static void *fleet_worker(void *arg) {
+    FleetArg *fa = arg;
+    FleetPool *pool = fa->pool;
+    FleetAgg *agg = &pool->workers[fa->self].agg;
+    SiSnapshot *snap = malloc(sizeof(SiSnapshot));
+    char *buf = NULL;
+    size_t cap = 0, map_len = 0;
+    int first, count, i;
+    if (!snap) return NULL;
+    while (fleet_take(pool, fa->self, &first, &count)) {
+        for (i = first; i < first + count; i++) {
+            void *map;
+            if (fleet_parse_file(pool->paths[i], snap, &buf, &cap, &map, &map_len) == 0
+                && snap->present[SI_SNAP_SYSTEM]) {
+                fleet_account(agg, snap);
+                agg->files++;
+            } else {
+                agg->failed++;
             }
-            fclose(checkf);
+            if (map) munmap(map, map_len);
         }
-        if (ip_exists) {
-            printf("该IP %s 已存在于 %s ，不重复添加。\n", ip, path);
-            return;
+    }
+    free(buf);
+    free(snap);
+    return NULL;
+}
+
+static int compare_fleet_count(const void *a, const void *b) {
+    const FleetCount *x = a, *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+// CSV 字段：含逗号、引号或换行时加引号
+static void csv_field(const char *s) {
+    if (!strpbrk(s, ",\"\n")) {
+        fputs(s, stdout);
+        return;
+    }
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"') putchar('"');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+static void csv_row(const char *category, const char *key, const char *value) {
+    csv_field(category);
+    putchar(',');
+    csv_field(key);
+    putchar(',');
+    csv_field(value);
+    putchar('\n');
+}
+
+static void csv_row_num(const char *category, const char *key, long long value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%lld", value);
+    csv_row(category, key, buf);
+}
+
+static void fleet_print_csv(const FleetAgg *a) {
+    char label[32];
+    int i;
+    csv_row("category", "key", "value");
+    csv_row_num("summary", "files", a->files);
+    csv_row_num("summary", "failed", a->failed);
+    for (i = 0; i < a->ndistro; i++) csv_row_num("distro", a->distros[i].name, a->distros[i].count);
+    if (a->distro_other) csv_row_num("distro", "other", a->distro_other);
+    for (i = 0; i < FLEET_BUCKETS; i++) {
+        if (!a->mem_buckets[i]) continue;
+        fleet_bucket_label(i, label, sizeof(label));
+        csv_row_num("mem_gib", label, a->mem_buckets[i]);
+    }
+    for (i = 0; i < FLEET_BUCKETS; i++) {
+        if (!a->cpu_buckets[i]) continue;
+        fleet_bucket_label(i, label, sizeof(label));
+        csv_row_num("cpu_cores", label, a->cpu_buckets[i]);
+    }
+    csv_row_num("centos7_aliyun", "hosts", a->legacy_hosts);
+    for (i = 0; i < a->nlegacy; i++) csv_row("centos7_aliyun", "example", a->legacy[i]);
+    csv_row_num("no_ip", "hosts", a->noip_hosts);
+    csv_row_num("no_ip", "interfaces", a->noip_ifaces);
+    for (i = 0; i < a->nnoip; i++) csv_row("no_ip", "example", a->noip[i]);
+}
+
+static void fleet_print_histogram(const char *title, const long *buckets, long total, const char *unit) {
+    char label[32];
+    int i;
+    printf("    %s\n", title);
+    for (i = 0; i < FLEET_BUCKETS; i++) {
+        if (!buckets[i]) continue;
+        fleet_bucket_label(i, label, sizeof(label));
+        printf("      %10s %-4s %8ld  %5.1f%%\n", label, unit, buckets[i],
+               total ? buckets[i] * 100.0 / total : 0.0);
+    }
+}
+
+static void fleet_print_table(const FleetAgg *a) {
+    int i;
+    long total = a->files;
+    printf("    发行版分布\n");
+    for (i = 0; i < a->ndistro; i++)
+        printf("      %-40s %8ld  %5.1f%%\n", a->distros[i].name, a->distros[i].count,
+               total ? a->distros[i].count * 100.0 / total : 0.0);
+    if (a->distro_other) printf("      %-40s %8ld\n", "其他", a->distro_other);
+
+    fleet_print_histogram("内存分布", a->mem_buckets, a->mem_n, "GiB");
+    if (a->mem_n)
+        printf("      最小 %.1f / 平均 %.1f / 最大 %.1f GiB\n", a->mem_min / 1024.0,
+               a->mem_sum / 1024.0 / a->mem_n, a->mem_max / 1024.0);
+    fleet_print_histogram("CPU 核数分布", a->cpu_buckets, a->cpu_n, "核");
+    if (a->cpu_n)
+        printf("      最小 %lld / 平均 %.1f / 最大 %lld 核\n", a->cpu_min,
+               (double)a->cpu_sum / a->cpu_n, a->cpu_max);
+
+    printf("    仍使用阿里云 CentOS 7 源的主机: %ld\n", a->legacy_hosts);
+    for (i = 0; i < a->nlegacy; i++) printf("      %s\n", a->legacy[i]);
+    if (a->legacy_hosts > a->nlegacy) printf("      ……（仅列出前 %d 个）\n", a->nlegacy);
+    printf("    有网卡未配置地址的主机: %ld（共 %ld 块网卡）\n", a->noip_hosts, a->noip_ifaces);
+    for (i = 0; i < a->nnoip; i++) printf("      %s\n", a->noip[i]);
+    if (a->noip_ifaces > a->nnoip) printf("      ……（仅列出前 %d 个）\n", a->nnoip);
+}
+
+// --aggregate 目录或文件 ... [--threads N] [--csv]：汇总 --snapshot 生成的报告
+int aggregate_command(int argc, char *argv[]) {
+    char **targets = malloc(sizeof(char *) * (size_t)(argc + 1));
+    int ntargets = 0, threads = 0, csv = 0, i;
+    for (i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--csv")) csv = 1;
+        else targets[ntargets++] = argv[i];
+    }
+    if (ntargets == 0) {
+        printf("用法: --aggregate 报告目录或文件 ... [--threads N] [--csv]\n");
+        free(targets);
+        return 1;
+    }
+    char **paths;
+    int nfiles = drift_collect_paths(targets, ntargets, &paths);
+    free(targets);
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > DRIFT_MAX_THREADS) threads = DRIFT_MAX_THREADS;
+    if (threads > nfiles) threads = nfiles;
+    if (threads < 1) threads = 1;
+
+    FleetPool pool = { paths, calloc((size_t)threads, sizeof(FleetWorker)), threads, 0 };
+    FleetArg args[DRIFT_MAX_THREADS];
+    if (!pool.workers) {
+        free(paths);
+        return 1;
+    }
+    // 初始按文件序号平均切分，之后靠窃取平衡
+    for (i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool.workers[i].lock, NULL);
+        pool.workers[i].begin = (int)((long long)nfiles * i / threads);
+        pool.workers[i].end = (int)((long long)nfiles * (i + 1) / threads);
+        args[i].pool = &pool;
+        args[i].self = i;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 1; i < threads; i++)
+        pool.workers[i].started = pthread_create(&pool.workers[i].thread, NULL, fleet_worker, &args[i]) == 0;
+    fleet_worker(&args[0]);
+    for (i = 1; i < threads; i++)
+        if (pool.workers[i].started) pthread_join(pool.workers[i].thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+    static FleetAgg total;
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < threads; i++) {
+        fleet_merge(&total, &pool.workers[i].agg);
+        pthread_mutex_destroy(&pool.workers[i].lock);
+    }
+    qsort(total.distros, total.ndistro, sizeof(total.distros[0]), compare_fleet_count);
+
+    if (csv) {
+        fleet_print_csv(&total);
+    } else {
+        printf("汇总 %ld 个报告（失败 %ld）\n", total.files, total.failed);
+        fleet_print_table(&total);
+    }
+    // CSV 输出到标准输出时吞吐量写到标准错误，不混进数据
+    fprintf(csv ? stderr : stdout, "解析 %d 个文件，用时 %.1f ms，%.0f 个/秒（%d 线程，窃取 %ld 次）\n",
+            nfiles, ms, ms > 0 ? nfiles / (ms / 1000.0) : 0.0, threads, pool.steals);
+
+    for (i = 0; i < nfiles; i++) free(paths[i]);
+    free(paths);
+    free(pool.workers);
+    return total.failed ? 1 : 0;
+}
+
+// ==================== 镜像测速与选择 ====================
+
+#define MIRROR_MAX 32
+#define MIRROR_PROBE_TIMEOUT_MS 3000
+#define MIRROR_PROBE_MAX_BYTES (512 * 1024)   // 每个镜像最多读取的正文字节数
+#define MIRROR_LIST_FILE "/etc/menu_project/mirrors.list"
+#define DEFAULT_MIRROR_ROOT "https://mirrors.aliyun.com/"
+#define MIRROR_PROXY_FILE "/etc/menu_project/cache_proxy"   // 机房缓存代理地址，存在时跳过测速
+
+// 探测状态
+enum {
+    PROBE_FAILED = -1,
+    PROBE_IDLE = 0,
+    PROBE_CONNECTING,
+    PROBE_SENDING,
+    PROBE_RECEIVING,
+    PROBE_DONE
+};
+
+// 结构体：单个候选镜像及其探测结果
+typedef struct {
+    char root[256];          // 镜像根地址，如 https://mirrors.aliyun.com/
+    char host[128];
+    char port[8];
+    char prefix[128];        // 根地址里的路径部分，以 / 结尾
+    int tls;                 // https 根地址：测速仍走 80 端口明文，写入源时保留 https
+    int fd;
+    int state;
+    struct addrinfo *addrs;  // 解析结果，连接失败时依次尝试下一个
+    struct addrinfo *next_addr;
+    char request[768];
+    size_t req_len;
+    size_t sent;
+    char head[1024];         // 响应头（只用于解析状态码）
+    size_t head_len;
+    int header_done;
+    int status;
+    size_t body_bytes;
+    double t_start;          // 开始连接
+    double t_first_byte;     // 收到首字节
+    double t_end;            // 读取结束
+    char error[64];
+} MirrorProbe;
+
+// 单调时钟（毫秒）
+double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// 解析 URL：http(s)://host[:port][/path]，tls 不为 NULL 时返回是否为 https。
+// https 地址的 port 固定为 80：内置客户端只用它做测速，下载交给 curl/wget（见 http_fetch）。
+// 显式端口的 https 地址是 TLS 端口，不能明文访问，直接拒绝
+int parse_http_url(const char *url, char *host, size_t host_size,
+                   char *port, size_t port_size, char *path, size_t path_size, int *tls) {
+    const char *s = url;
+    int https = 0;
+    if (strncmp(s, "http://", 7) == 0) s += 7;
+    else if (strncmp(s, "https://", 8) == 0) { s += 8; https = 1; }
+    else return -1;
+    if (tls) *tls = https;
+
+    size_t host_len = strcspn(s, ":/");
+    if (host_len == 0 || host_len >= host_size) return -1;
+    memcpy(host, s, host_len);
+    host[host_len] = '\0';
+    s += host_len;
+
+    snprintf(port, port_size, "80");
+    if (*s == ':') {
+        if (https) return -1;
+        s++;
+        size_t port_len = strcspn(s, "/");
+        if (port_len == 0 || port_len >= port_size) return -1;
+        memcpy(port, s, port_len);
+        port[port_len] = '\0';
+        s += port_len;
+    }
+
+    snprintf(path, path_size, "%s", *s ? s : "/");
+    return 0;
+}
+
+// 解析镜像根地址，prefix 与 root 都以 / 结尾
+int parse_mirror_url(const char *url, MirrorProbe *p) {
+    if (parse_http_url(url, p->host, sizeof(p->host), p->port, sizeof(p->port),
+                       p->prefix, sizeof(p->prefix), &p->tls) != 0)
+        return -1;
+
+    size_t len = strlen(p->prefix);
+    if (p->prefix[len - 1] != '/' && len + 1 < sizeof(p->prefix)) strcat(p->prefix, "/");
+
+    snprintf(p->root, sizeof(p->root), "%s", url);
+    len = strlen(p->root);
+    if (p->root[len - 1] != '/' && len + 1 < sizeof(p->root)) strcat(p->root, "/");
+    return 0;
+}
+
+// 候选列表中是否已有该根地址
+static int mirror_listed(const MirrorProbe *probes, int count, const char *root) {
+    int i;
+    for (i = 0; i < count; i++) {
+        if (!strcmp(probes[i].root, root)) return 1;
+    }
+    return 0;
+}
+
+// 加载候选镜像列表：preferred 排在首位，其余优先读取 /etc/menu_project/mirrors.list
+// （每行一个地址，# 为注释），没有该文件时使用内置列表。
+// 测速只用明文 HTTP：https 地址也连 80 端口测速，写入源时仍用 https。只提供 https 的镜像
+// 连不上 80 端口，会标为"仅 HTTPS，未测速"而不参与排名，这类镜像不要放进候选列表，
+// 需要时用 --mirror 直接指定。内置列表中的镜像都同时提供 http 和 https
+int load_mirror_candidates(MirrorProbe *probes, int max, const char *preferred) {
+    static const char *defaults[] = {
+        "https://mirrors.aliyun.com/",
+        "https://mirrors.tuna.tsinghua.edu.cn/",
+        "https://mirrors.ustc.edu.cn/",
+        "https://mirrors.huaweicloud.com/",
+        "https://mirrors.cloud.tencent.com/",
+        "https://mirrors.163.com/"
+    };
+    int count = 0;
+
+    if (preferred && max > 0) {
+        memset(&probes[0], 0, sizeof(probes[0]));
+        if (parse_mirror_url(preferred, &probes[0]) == 0) count++;
+    }
+    int first_listed = count;
+
+    FILE *fp = fopen(MIRROR_LIST_FILE, "r");
+    if (fp) {
+        char line[MAX_LINE];
+        while (fgets(line, sizeof(line), fp) && count < max) {
+            line[strcspn(line, "\r\n")] = '\0';
+            si_trim_quotes(line);
+            if (line[0] == '\0' || line[0] == '#') continue;
+            memset(&probes[count], 0, sizeof(probes[count]));
+            if (parse_mirror_url(line, &probes[count]) != 0) {
+                printf("忽略无效镜像地址: %s\n", line);
+            } else if (!mirror_listed(probes, count, probes[count].root)) {
+                count++;
+            }
         }
-        int idx = file_exists(path) ? find_next_ip_index(path) : 0;
-        FILE *f = fopen(path, is_new_file ? "w" : "a");
-        if (!f) { printf("无法写入 %s\n", path); return; }
-        if (is_new_file) {
-            // 新建文件，写入完整配置
-            char gw[64] = "";
-            printf("请输入网关地址（可直接回车跳过）：");
-            fgets(gw, sizeof(gw), stdin); // 先清空输入缓冲
-            if (gw[0] == '\0' || gw[0] == '\n') {
-                // 可能上次scanf未清空，补一次
-                fgets(gw, sizeof(gw), stdin);
+        fclose(fp);
+    }
+    if (count > first_listed) return count;
+
+    size_t i;
+    for (i = 0; i < sizeof(defaults) / sizeof(defaults[0]) && count < max; i++) {
+        memset(&probes[count], 0, sizeof(probes[count]));
+        if (parse_mirror_url(defaults[i], &probes[count]) == 0
+            && !mirror_listed(probes, count, probes[count].root)) count++;
+    }
+    return count;
+}
+
+// 探测失败，关闭连接并记录原因
+static void probe_fail(MirrorProbe *p, const char *why) {
+    if (p->fd >= 0) close(p->fd);
+    p->fd = -1;
+    p->state = PROBE_FAILED;
+    snprintf(p->error, sizeof(p->error), "%s", why);
+}
+
+// 连接阶段失败：https 镜像连不上 80 端口多半是只提供 https，单独标出，不当作镜像故障
+static void probe_connect_fail(MirrorProbe *p, const char *why) {
+    probe_fail(p, p->tls ? "仅 HTTPS，未测速" : why);
+}
+
+// 探测结束（EOF 或已读够字节数）
+static void probe_finish(MirrorProbe *p) {
+    if (p->fd >= 0) close(p->fd);
+    p->fd = -1;
+    p->t_end = now_ms();
+    if (!p->header_done) {
+        probe_fail(p, "响应不完整");
+    } else if (p->status != 200) {
+        char why[32];
+        snprintf(why, sizeof(why), "HTTP %d", p->status);
+        probe_fail(p, why);
+    } else {
+        p->state = PROBE_DONE;
+    }
+}
+
+// 从 next_addr 起依次发起非阻塞连接。没有 IPv6 路由时 AAAA 地址会立即返回 ENETUNREACH，
+// 对端拒绝则在 SO_ERROR 里报告，两种情况都换下一个地址；全部失败返回 -1
+static int probe_connect_next(MirrorProbe *p) {
+    while (p->next_addr) {
+        struct addrinfo *ai = p->next_addr;
+        p->next_addr = ai->ai_next;
+        p->fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (p->fd < 0) continue;
+        if (connect(p->fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            p->state = PROBE_SENDING;
+            return 0;
+        }
+        if (errno == EINPROGRESS) {
+            p->state = PROBE_CONNECTING;
+            return 0;
+        }
+        close(p->fd);
+        p->fd = -1;
+    }
+    return -1;
+}
+
+// 发起非阻塞连接
+static void probe_start(MirrorProbe *p, const char *path) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    p->fd = -1;
+    p->addrs = NULL;
+    p->t_start = now_ms();
+    if (getaddrinfo(p->host, p->port, &hints, &p->addrs) != 0 || !p->addrs) {
+        p->addrs = NULL;
+        probe_fail(p, "域名解析失败");
+        return;
+    }
+    p->next_addr = p->addrs;
+    if (probe_connect_next(p) != 0) {
+        probe_connect_fail(p, "连接失败");
+        return;
+    }
+
+    p->req_len = (size_t)snprintf(p->request, sizeof(p->request),
+        "GET %s%s HTTP/1.1\r\nHost: %s\r\nUser-Agent: menu_project\r\n"
+        "Accept: */*\r\nConnection: close\r\n\r\n",
+        p->prefix, path, p->host);
+}
+
+// 处理收到的数据：解析状态行并统计正文字节
+static void probe_on_data(MirrorProbe *p, const char *buf, size_t n) {
+    if (p->t_first_byte == 0) p->t_first_byte = now_ms();
+    if (p->header_done) {
+        p->body_bytes += n;
+        return;
+    }
+    size_t room = sizeof(p->head) - 1 - p->head_len;
+    size_t take = n < room ? n : room;
+    memcpy(p->head + p->head_len, buf, take);
+    p->head_len += take;
+    p->head[p->head_len] = '\0';
+
+    char *end = strstr(p->head, "\r\n\r\n");
+    if (!end) {
+        if (p->head_len == sizeof(p->head) - 1) probe_fail(p, "响应头过长");
+        return;
+    }
+    p->header_done = 1;
+    sscanf(p->head, "HTTP/%*s %d", &p->status);
+    // 头部之后、本次读到的部分都算正文
+    size_t head_bytes = (size_t)(end + 4 - p->head) - (p->head_len - take);
+    p->body_bytes += n - head_bytes;
+}
+
+// 并发探测所有候选镜像，path 为相对镜像根目录的元数据文件路径
+void probe_mirrors(MirrorProbe *probes, int n, const char *path, int timeout_ms) {
+    struct pollfd pfds[MIRROR_MAX];
+    int idx[MIRROR_MAX];
+    int i;
+
+    for (i = 0; i < n; i++) probe_start(&probes[i], path);
+
+    double deadline = now_ms() + timeout_ms;
+    while (1) {
+        int nfds = 0;
+        for (i = 0; i < n; i++) {
+            MirrorProbe *p = &probes[i];
+            if (p->state != PROBE_CONNECTING && p->state != PROBE_SENDING && p->state != PROBE_RECEIVING)
+                continue;
+            pfds[nfds].fd = p->fd;
+            pfds[nfds].events = p->state == PROBE_RECEIVING ? POLLIN : POLLOUT;
+            pfds[nfds].revents = 0;
+            idx[nfds++] = i;
+        }
+        if (nfds == 0) break;
+
+        int wait = (int)(deadline - now_ms());
+        if (wait <= 0) break;
+        if (poll(pfds, nfds, wait) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        int k;
+        for (k = 0; k < nfds; k++) {
+            MirrorProbe *p = &probes[idx[k]];
+            short ev = pfds[k].revents;
+            if (!ev) continue;
+
+            if (p->state == PROBE_CONNECTING) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(p->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err) {
+                    close(p->fd);
+                    p->fd = -1;
+                    if (probe_connect_next(p) != 0) probe_connect_fail(p, "连接失败");
+                    continue;
+                }
+                p->state = PROBE_SENDING;
             }
-            gw[strcspn(gw, "\n")] = '\0';
-            // 校验网关格式
-            int gw_valid = 0;
-            if (gw[0]) {
-                struct in_addr gw_addr;
-                if (inet_pton(AF_INET, gw, &gw_addr) == 1) {
-                    gw_valid = 1;
-                } else {
-                    printf("网关格式无效，未写入GATEWAY字段！\n");
+            if (p->state == PROBE_SENDING) {
+                ssize_t w = send(p->fd, p->request + p->sent, p->req_len - p->sent, MSG_NOSIGNAL);
+                if (w < 0) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) probe_fail(p, "发送失败");
+                    continue;
                 }
+                p->sent += (size_t)w;
+                if (p->sent == p->req_len) p->state = PROBE_RECEIVING;
+                continue;
             }
-            fprintf(f, "DEVICE=%s\nBOOTPROTO=static\nONBOOT=yes\nIPADDR=%s\nNETMASK=%s\n", ifname, ip, mask);
-            if (gw_valid) {
-                fprintf(f, "GATEWAY=%s\n", gw);
+            if (p->state == PROBE_RECEIVING) {
+                char buf[16384];
+                ssize_t r = recv(p->fd, buf, sizeof(buf), 0);
+                if (r < 0) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) probe_fail(p, "接收失败");
+                    continue;
+                }
+                if (r == 0) { probe_finish(p); continue; }
+                probe_on_data(p, buf, (size_t)r);
+                if (p->state == PROBE_RECEIVING && p->body_bytes >= MIRROR_PROBE_MAX_BYTES)
+                    probe_finish(p);
             }
+        }
+    }
+
+    // 超时处理：已拿到正文的按已读数据计算，其余判定失败
+    for (i = 0; i < n; i++) {
+        MirrorProbe *p = &probes[i];
+        if (p->state == PROBE_RECEIVING && p->header_done && p->body_bytes > 0) {
+            probe_finish(p);
+        } else if (p->state == PROBE_CONNECTING) {
+            probe_connect_fail(p, "超时");
+        } else if (p->state != PROBE_DONE && p->state != PROBE_FAILED) {
+            probe_fail(p, "超时");
+        }
+        if (p->addrs) freeaddrinfo(p->addrs);
+        p->addrs = p->next_addr = NULL;
+    }
+}
+
+// 吞吐量（字节/毫秒），从首字节开始计算
+double mirror_throughput(const MirrorProbe *p) {
+    double elapsed = p->t_end - p->t_first_byte;
+    if (elapsed < 1.0) elapsed = 1.0;
+    return p->body_bytes / elapsed;
+}
+
+// 综合得分：首字节时间 + 以该吞吐下载 1MiB 的估算耗时，越小越好
+double mirror_score(const MirrorProbe *p) {
+    double ttfb = p->t_first_byte - p->t_start;
+    double tput = mirror_throughput(p);
+    if (tput <= 0) return 1e12;
+    return ttfb + (1024.0 * 1024.0) / tput;
+}
+
+static int compare_mirror(const void *a, const void *b) {
+    const MirrorProbe *pa = a, *pb = b;
+    if ((pa->state == PROBE_DONE) != (pb->state == PROBE_DONE))
+        return pa->state == PROBE_DONE ? -1 : 1;
+    if (pa->state != PROBE_DONE) return 0;
+    double sa = mirror_score(pa), sb = mirror_score(pb);
+    return sa < sb ? -1 : sa > sb;
+}
+
+// 并发测速并按得分排序，成功的排在前面
+void rank_mirrors(MirrorProbe *probes, int n, const char *probe_path) {
+    probe_mirrors(probes, n, probe_path, MIRROR_PROBE_TIMEOUT_MS);
+    qsort(probes, n, sizeof(probes[0]), compare_mirror);
+}
+
+// 测速并选出最快镜像，成功返回 0 并写入 winner
+int select_fastest_mirror(const char *probe_path, const char *preferred, char *winner, size_t size) {
+    MirrorProbe probes[MIRROR_MAX];
+    int n = load_mirror_candidates(probes, MIRROR_MAX, preferred);
+    if (n == 0) return -1;
+
+    printf("正在并发测速 %d 个镜像: %s\n", n, probe_path);
+    rank_mirrors(probes, n, probe_path);
+
+    printf("  %-40s %10s %12s\n", "镜像", "首字节(ms)", "吞吐(KB/s)");
+    int i;
+    for (i = 0; i < n; i++) {
+        MirrorProbe *p = &probes[i];
+        if (p->state == PROBE_DONE) {
+            printf("  %-40s %10.1f %12.1f\n", p->root,
+                   p->t_first_byte - p->t_start, mirror_throughput(p) * 1000.0 / 1024.0);
         } else {
-            fprintf(f, "IPADDR%d=%s\nNETMASK%d=%s\n", idx, ip, idx, mask);
+            printf("  %-40s %s\n", p->root, p->error);
         }
-        fclose(f);
-        printf("已写入 %s\n", path);
-        // 判断是否为 CentOS 6
-        int is_centos6 = 0;
-        FILE *rel = fopen("/etc/centos-release", "r");
-        if (rel) {
-            char relstr[128] = "";
-            if (fgets(relstr, sizeof(relstr), rel)) {
-                if (strstr(relstr, "release 6")) is_centos6 = 1;
-            }
-            fclose(rel);
+    }
+
+    if (probes[0].state != PROBE_DONE) {
+        printf("所有镜像测速失败。\n");
+        return -1;
+    }
+    snprintf(winner, size, "%s", probes[0].root);
+    printf("最快镜像: %s\n", winner);
+    return 0;
+}
+
+// 把内容中的旧镜像根地址（http/https 均可）替换为新的根地址，返回新字符串（需free）
+char* replace_mirror_root(const char *content, const char *old_root, const char *new_root) {
+    // 去掉协议头，只按 host/path 匹配
+    const char *old_rest = strstr(old_root, "://");
+    old_rest = old_rest ? old_rest + 3 : old_root;
+    char old_roots[2][256];
+    snprintf(old_roots[0], sizeof(old_roots[0]), "https://%s", old_rest);
+    snprintf(old_roots[1], sizeof(old_roots[1]), "http://%s", old_rest);
+
+    size_t new_len = strlen(new_root);
+    size_t cap = strlen(content) + 1;
+    const char *s;
+
+    // 先计算所需长度
+    for (s = content; *s; ) {
+        size_t i, matched = 0;
+        for (i = 0; i < 2; i++) {
+            size_t ol = strlen(old_roots[i]);
+            if (strncmp(s, old_roots[i], ol) == 0) { matched = ol; break; }
         }
-        if (is_centos6) {
-            printf("正在重启网络服务: service network restart\n");
-            system("service network restart");
+        if (matched) { cap += new_len; s += matched; } else s++;
+    }
+
+    char *out = malloc(cap);
+    if (!out) return NULL;
+    char *d = out;
+    for (s = content; *s; ) {
+        size_t i, matched = 0;
+        for (i = 0; i < 2; i++) {
+            size_t ol = strlen(old_roots[i]);
+            if (strncmp(s, old_roots[i], ol) == 0) { matched = ol; break; }
+        }
+        if (matched) {
+            memcpy(d, new_root, new_len);
+            d += new_len;
+            s += matched;
         } else {
-            printf("正在重启网络服务: systemctl restart network\n");
-            system("systemctl restart network");
+            *d++ = *s++;
+        }
+    }
+    *d = '\0';
+    return out;
+}
+
+// 把文件中的旧镜像根地址替换为新的根地址（先写临时文件再 rename）
+int rewrite_file_mirror_root(const char *path, const char *old_root, const char *new_root) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *content = malloc(size + 1);
+    if (!content) { fclose(fp); return -1; }
+    size_t n = fread(content, 1, size, fp);
+    content[n] = '\0';
+    fclose(fp);
+
+    char *replaced = replace_mirror_root(content, old_root, new_root);
+    free(content);
+    if (!replaced) return -1;
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    fp = fopen(tmp_path, "w");
+    if (!fp) { free(replaced); return -1; }
+    fputs(replaced, fp);
+    free(replaced);
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// ==================== 内置 HTTP 下载与缓存 ====================
+
+#define HTTP_CACHE_DIR "/var/cache/menu_project/http"
+#define HTTP_TIMEOUT_SEC 10
+#define HTTP_MAX_REDIRECTS 5
+
+// 带缓冲的 socket 读取器
+typedef struct {
+    int fd;
+    char buf[8192];
+    size_t pos;
+    size_t len;
+} HttpReader;
+
+// 缓存元数据：与正文文件放在一起的 .meta
+typedef struct {
+    char etag[256];
+    char last_modified[128];
+} HttpCacheMeta;
+
+// 逐级创建目录（mkdir -p）
+int mkdir_p(const char *path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    char *p;
+    for (p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+// 完整写入
+int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
         }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+// 读取若干字节，返回实际读取数，0 表示连接关闭
+static ssize_t http_read(HttpReader *r, char *out, size_t size) {
+    if (r->pos == r->len) {
+        ssize_t n;
+        do {
+            n = recv(r->fd, r->buf, sizeof(r->buf), 0);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) return n;
+        r->pos = 0;
+        r->len = (size_t)n;
+    }
+    size_t take = r->len - r->pos;
+    if (take > size) take = size;
+    memcpy(out, r->buf + r->pos, take);
+    r->pos += take;
+    return (ssize_t)take;
+}
+
+// 读取一行（去掉 \r\n），成功返回 0
+static int http_read_line(HttpReader *r, char *line, size_t size) {
+    size_t len = 0;
+    char c;
+    while (1) {
+        ssize_t n = http_read(r, &c, 1);
+        if (n <= 0) return -1;
+        if (c == '\n') break;
+        if (len + 1 < size) line[len++] = c;
+    }
+    if (len > 0 && line[len - 1] == '\r') len--;
+    line[len] = '\0';
+    return 0;
+}
+
+// 建立带超时的阻塞连接
+int http_connect(const char *host, const char *port) {
+    struct addrinfo hints, *res = NULL, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) continue;
+        struct timeval tv = { HTTP_TIMEOUT_SEC, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+// FNV-1a 64 位哈希
+unsigned long long fnv1a64(const char *s) {
+    unsigned long long h = 1469598103934665603ULL;
+    const unsigned char *p;
+    for (p = (const unsigned char *)s; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// 缓存目录，mirror fetch --cache-dir 可以改到不需要 root 的位置
+static const char *http_cache_dir = HTTP_CACHE_DIR;
+
+// URL 的缓存文件路径
+void http_cache_path(const char *url, const char *suffix, char *out, size_t size) {
+    snprintf(out, size, "%s/%016llx%s", http_cache_dir, fnv1a64(url), suffix);
+}
+
+// 读取缓存元数据，缓存正文不存在时返回 -1
+int http_cache_load(const char *url, HttpCacheMeta *meta) {
+    char path[512], line[512];
+    memset(meta, 0, sizeof(*meta));
+
+    http_cache_path(url, ".body", path, sizeof(path));
+    if (access(path, R_OK) != 0) return -1;
+
+    http_cache_path(url, ".meta", path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int url_ok = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!strncmp(line, "url=", 4)) url_ok = !strcmp(line + 4, url);
+        // 截断的校验值不会与服务器匹配，过长时当作没有
+        else if (!strncmp(line, "etag=", 5) && strlen(line + 5) < sizeof(meta->etag))
+            snprintf(meta->etag, sizeof(meta->etag), "%.*s", (int)sizeof(meta->etag) - 1, line + 5);
+        else if (!strncmp(line, "last_modified=", 14) && strlen(line + 14) < sizeof(meta->last_modified))
+            snprintf(meta->last_modified, sizeof(meta->last_modified), "%.*s",
+                     (int)sizeof(meta->last_modified) - 1, line + 14);
+    }
+    fclose(fp);
+    if (!url_ok || (!meta->etag[0] && !meta->last_modified[0])) return -1;
+    return 0;
+}
+
+// 写入缓存元数据
+void http_cache_save(const char *url, const HttpCacheMeta *meta) {
+    char path[512], tmp_path[520];
+    http_cache_path(url, ".meta", path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) return;
+    fprintf(fp, "url=%s\netag=%s\nlast_modified=%s\n", url, meta->etag, meta->last_modified);
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) unlink(tmp_path);
+}
+
+// 复制文件（先写临时文件再 rename）
+int copy_file_atomic(const char *src, const char *dest) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", dest);
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return -1;
+    int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) { close(in); return -1; }
+
+    char buf[16384];
+    ssize_t n;
+    int ok = 1;
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        if (write_all(out, buf, (size_t)n) != 0) { ok = 0; break; }
+    }
+    if (n < 0) ok = 0;
+    close(in);
+    if (close(out) != 0) ok = 0;
+    if (!ok || rename(tmp_path, dest) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// 把正文同时写入目标临时文件和缓存临时文件（缓存 fd 可为 -1）
+static int http_sink(int dest_fd, int cache_fd, const char *data, size_t len) {
+    if (write_all(dest_fd, data, len) != 0) return -1;
+    if (cache_fd >= 0 && write_all(cache_fd, data, len) != 0) return -1;
+    return 0;
+}
+
+// 读取响应正文：支持 Content-Length、chunked 以及读到连接关闭为止
+static int http_read_body(HttpReader *r, long long content_length, int chunked,
+                          int dest_fd, int cache_fd) {
+    char buf[8192];
+    if (chunked) {
+        char line[128];
+        while (1) {
+            if (http_read_line(r, line, sizeof(line)) != 0) return -1;
+            long long chunk = strtoll(line, NULL, 16);
+            if (chunk <= 0) break;
+            while (chunk > 0) {
+                ssize_t n = http_read(r, buf, chunk < (long long)sizeof(buf) ? (size_t)chunk : sizeof(buf));
+                if (n <= 0) return -1;
+                if (http_sink(dest_fd, cache_fd, buf, (size_t)n) != 0) return -1;
+                chunk -= n;
+            }
+            if (http_read_line(r, line, sizeof(line)) != 0) return -1;
+        }
+        // 跳过 trailer
+        while (http_read_line(r, line, sizeof(line)) == 0 && line[0]) {}
+        return 0;
+    }
+
+    long long left = content_length;
+    while (left != 0) {
+        size_t want = sizeof(buf);
+        if (left > 0 && left < (long long)want) want = (size_t)left;
+        ssize_t n = http_read(r, buf, want);
+        if (n < 0) return -1;
+        if (n == 0) return left > 0 ? -1 : 0;
+        if (http_sink(dest_fd, cache_fd, buf, (size_t)n) != 0) return -1;
+        if (left > 0) left -= n;
+    }
+    return 0;
+}
+
+// https 下载：内置客户端不支持 TLS，交给 curl（没有时用 wget），两者都没有时失败而不是退回明文。
+// 参数直接传给 execvp，不经过 shell；curl 限定重定向也只能到 https
+static int http_fetch_tls(const char *url, const char *dest, int *status_out) {
+    char tmp_path[512], timeout[16], redirects[32];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", dest);
+    snprintf(timeout, sizeof(timeout), "%d", HTTP_TIMEOUT_SEC);
+    snprintf(redirects, sizeof(redirects), "--max-redirect=%d", HTTP_MAX_REDIRECTS);
+    char *const curl_argv[] = { "curl", "-fsSL", "--proto", "=https", "--proto-redir", "=https",
+                                "--connect-timeout", timeout, "-o", tmp_path, (char *)url, NULL };
+    char *const wget_argv[] = { "wget", "-q", "-T", timeout, redirects,
+                                "-O", tmp_path, (char *)url, NULL };
+    char *const *tools[] = { curl_argv, wget_argv };
+    size_t i;
+
+    for (i = 0; i < sizeof(tools) / sizeof(tools[0]); i++) {
+        pid_t pid = fork();
+        if (pid < 0) return -1;
+        if (pid == 0) {
+            int devnull = open("/dev/null", O_RDONLY);
+            if (devnull >= 0) dup2(devnull, STDIN_FILENO);
+            execvp(tools[i][0], tools[i]);
+            _exit(127);
+        }
+        int status;
+        if (waitpid(pid, &status, 0) < 0) return -1;
+        // 127：没有安装该工具，换下一个
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 127) continue;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && rename(tmp_path, dest) == 0) {
+            if (status_out) *status_out = 200;
+            return 0;
+        }
+        unlink(tmp_path);
+        printf("下载失败（%s 退出码 %d）: %s\n", tools[i][0],
+               WIFEXITED(status) ? WEXITSTATUS(status) : -1, url);
+        return -1;
+    }
+    printf("下载 https 地址需要 curl 或 wget，请先安装: %s\n", url);
+    return -1;
+}
+
+// 把 Location 解析成完整地址：绝对地址、//host/path、/path，以及相对当前路径所在目录的
+// 路径（不处理 ../，原样交给服务器）。当前地址一定是 http，https 已在前面交出去
+static int http_resolve_location(const char *location, const char *host, const char *port,
+                                 const char *path, char *out, size_t size) {
+    int n;
+    if (!strncmp(location, "http://", 7) || !strncmp(location, "https://", 8)) {
+        n = snprintf(out, size, "%s", location);
+    } else if (location[0] == '/' && location[1] == '/') {
+        n = snprintf(out, size, "http:%s", location);
+    } else if (location[0] == '/') {
+        n = snprintf(out, size, "http://%s:%s%s", host, port, location);
+    } else {
+        size_t dir = strcspn(path, "?");
+        while (dir > 0 && path[dir - 1] != '/') dir--;
+        n = snprintf(out, size, "http://%s:%s%.*s%s", host, port, (int)dir, path, location);
+    }
+    return n >= 0 && (size_t)n < size ? 0 : -1;
+}
+
+// 下载 url 到 dest：正文直接流式写入临时文件后 rename；
+// use_cache 时带 If-None-Match / If-Modified-Since，服务器返回 304 则直接使用本地缓存；
+// status 不为 NULL 时返回最终的 HTTP 状态码（连接失败为 0）；https 地址见 http_fetch_tls
+int http_fetch(const char *url, const char *dest, int use_cache, int *status_out) {
+    char cur_url[1024];
+    snprintf(cur_url, sizeof(cur_url), "%s", url);
+    int cache_ok = use_cache && mkdir_p(http_cache_dir) == 0;
+    if (status_out) *status_out = 0;
+    int redirects;
+
+    for (redirects = 0; redirects <= HTTP_MAX_REDIRECTS; redirects++) {
+        char host[128], port[8], path[768];
+        int tls;
+        if (parse_http_url(cur_url, host, sizeof(host), port, sizeof(port), path, sizeof(path), &tls) != 0) {
+            printf("不支持的下载地址: %s\n", cur_url);
+            return -1;
+        }
+        // https（包括从 http 重定向过去的）不走明文，也就没有条件请求缓存
+        if (tls) return http_fetch_tls(cur_url, dest, status_out);
+
+        HttpCacheMeta meta;
+        int have_cache = cache_ok && http_cache_load(cur_url, &meta) == 0;
+
+        int fd = http_connect(host, port);
+        if (fd < 0) {
+            printf("无法连接 %s:%s\n", host, port);
+            return -1;
+        }
+
+        char req[2048];
+        int req_len = snprintf(req, sizeof(req),
+            "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: menu_project\r\nAccept: */*\r\nConnection: close\r\n",
+            path, host);
+        if (have_cache && meta.etag[0])
+            req_len += snprintf(req + req_len, sizeof(req) - req_len, "If-None-Match: %s\r\n", meta.etag);
+        if (have_cache && meta.last_modified[0])
+            req_len += snprintf(req + req_len, sizeof(req) - req_len, "If-Modified-Since: %s\r\n", meta.last_modified);
+        req_len += snprintf(req + req_len, sizeof(req) - req_len, "\r\n");
+        if (req_len >= (int)sizeof(req) || write_all(fd, req, (size_t)req_len) != 0) {
+            close(fd);
+            return -1;
+        }
+
+        // 状态行与响应头
+        HttpReader reader;
+        memset(&reader, 0, sizeof(reader));
+        reader.fd = fd;
+        char line[1024];
+        int status = 0;
+        if (http_read_line(&reader, line, sizeof(line)) != 0 || sscanf(line, "HTTP/%*s %d", &status) != 1) {
+            printf("无效的 HTTP 响应: %s\n", cur_url);
+            close(fd);
+            return -1;
+        }
+        if (status_out) *status_out = status;
+
+        long long content_length = -1;
+        int chunked = 0;
+        char location[1024] = "";
+        HttpCacheMeta fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        while (http_read_line(&reader, line, sizeof(line)) == 0 && line[0]) {
+            char *colon = strchr(line, ':');
+            if (!colon) continue;
+            *colon = '\0';
+            char *value = colon + 1;
+            while (*value == ' ' || *value == '\t') value++;
+            if (!strcasecmp(line, "Content-Length")) content_length = atoll(value);
+            else if (!strcasecmp(line, "Transfer-Encoding")) chunked = strstr(value, "chunked") != NULL;
+            else if (!strcasecmp(line, "Location")) snprintf(location, sizeof(location), "%s", value);
+            else if (!strcasecmp(line, "ETag")) snprintf(fresh.etag, sizeof(fresh.etag), "%s", value);
+            else if (!strcasecmp(line, "Last-Modified"))
+                snprintf(fresh.last_modified, sizeof(fresh.last_modified), "%s", value);
+        }
+
+        if (status == 304 && have_cache) {
+            close(fd);
+            char body_path[512];
+            http_cache_path(cur_url, ".body", body_path, sizeof(body_path));
+            printf("内容未变化（304），使用本地缓存: %s\n", cur_url);
+            return copy_file_atomic(body_path, dest);
+        }
+
+        if (status == 301 || status == 302 || status == 303 || status == 307 || status == 308) {
+            close(fd);
+            if (!location[0]
+                || http_resolve_location(location, host, port, path, cur_url, sizeof(cur_url)) != 0) {
+                printf("无效的重定向（HTTP %d）: %s\n", status, cur_url);
+                return -1;
+            }
+            continue;
+        }
+
+        if (status != 200) {
+            printf("下载失败（HTTP %d）: %s\n", status, cur_url);
+            close(fd);
+            return -1;
+        }
+
+        char tmp_path[512], cache_tmp[520], body_path[512];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", dest);
+        int dest_fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (dest_fd < 0) {
+            printf("无法写入 %s\n", tmp_path);
+            close(fd);
+            return -1;
+        }
+        // 只有带校验字段的响应才值得缓存
+        int cache_fd = -1;
+        if (cache_ok && (fresh.etag[0] || fresh.last_modified[0])) {
+            http_cache_path(cur_url, ".body", body_path, sizeof(body_path));
+            snprintf(cache_tmp, sizeof(cache_tmp), "%s.tmp", body_path);
+            cache_fd = open(cache_tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        }
+
+        int ret = http_read_body(&reader, content_length, chunked, dest_fd, cache_fd);
+        close(fd);
+        if (close(dest_fd) != 0) ret = -1;
+        if (ret == 0 && rename(tmp_path, dest) != 0) ret = -1;
+        if (ret != 0) unlink(tmp_path);
+
+        if (cache_fd >= 0) {
+            if (close(cache_fd) == 0 && ret == 0 && rename(cache_tmp, body_path) == 0) {
+                http_cache_save(cur_url, &fresh);
+            } else {
+                unlink(cache_tmp);
+            }
+        }
+        if (ret != 0) printf("下载中断: %s\n", cur_url);
+        return ret;
+    }
+
+    printf("重定向次数过多: %s\n", url);
+    return -1;
+}
+
+// ==================== 终端差分渲染 ====================
+
+#define SCR_BOLD    0x01
+#define SCR_REVERSE 0x02
+#define SCR_CONT    0x80   // 宽字符占用的第二格
+
+// 屏幕上的一个字符格
+typedef struct {
+    char ch[8];            // 该格字符的 UTF-8 编码
+    unsigned char fg;      // 前景色 30-37，0 为默认
+    unsigned char flags;
+} ScreenCell;
+
+// 保存上一帧，刷新时只输出发生变化的字符格
+static struct {
+    int rows, cols;
+    ScreenCell *cur, *prev;
+    int valid;             // prev 是否与终端上的实际内容一致
+    int cur_row, cur_col;  // 终端光标位置
+    unsigned char fg, flags;
+    int sgr_known;         // 终端当前的 SGR 是否已知
+    char *out;
+    size_t out_len, out_cap;
+    size_t last_frame_bytes;
+    int park_row, park_col;
+} screen;
+
+static void scr_emit(const char *data, size_t len) {
+    if (screen.out_len + len > screen.out_cap) {
+        size_t cap = screen.out_cap ? screen.out_cap * 2 : 4096;
+        while (cap < screen.out_len + len) cap *= 2;
+        char *grown = realloc(screen.out, cap);
+        if (!grown) return;
+        screen.out = grown;
+        screen.out_cap = cap;
+    }
+    memcpy(screen.out + screen.out_len, data, len);
+    screen.out_len += len;
+}
+
+static void scr_emitf(const char *fmt, int a, int b) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), fmt, a, b);
+    scr_emit(buf, (size_t)n);
+}
+
+// 解码一个 UTF-8 字符，返回字节数
+static int utf8_decode(const char *s, unsigned int *cp) {
+    const unsigned char *u = (const unsigned char *)s;
+    if (u[0] < 0x80) { *cp = u[0]; return 1; }
+    if ((u[0] & 0xE0) == 0xC0 && u[1]) { *cp = ((u[0] & 0x1F) << 6) | (u[1] & 0x3F); return 2; }
+    if ((u[0] & 0xF0) == 0xE0 && u[1] && u[2]) {
+        *cp = ((u[0] & 0x0F) << 12) | ((u[1] & 0x3F) << 6) | (u[2] & 0x3F);
+        return 3;
+    }
+    if ((u[0] & 0xF8) == 0xF0 && u[1] && u[2] && u[3]) {
+        *cp = ((u[0] & 0x07) << 18) | ((u[1] & 0x3F) << 12) | ((u[2] & 0x3F) << 6) | (u[3] & 0x3F);
+        return 4;
+    }
+    *cp = '?';
+    return 1;
+}
+
+// 字符显示宽度：中日韩文字、全角符号和 emoji 占两格
+static int char_width(unsigned int cp) {
+    if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) ||
+        (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+        (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+        (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1FAFF) ||
+        (cp >= 0x20000 && cp <= 0x3FFFD))
+        return 2;
+    return 1;
+}
+
+// 按终端大小分配帧缓冲，大小变化时强制整屏重绘
+static int scr_resize() {
+    struct winsize ws;
+    int rows = 24, cols = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row && ws.ws_col) {
+        rows = ws.ws_row;
+        cols = ws.ws_col;
+    }
+    if (screen.cur && rows == screen.rows && cols == screen.cols) return 0;
+
+    free(screen.cur);
+    free(screen.prev);
+    screen.cur = calloc((size_t)rows * cols, sizeof(ScreenCell));
+    screen.prev = calloc((size_t)rows * cols, sizeof(ScreenCell));
+    if (!screen.cur || !screen.prev) return -1;
+    screen.rows = rows;
+    screen.cols = cols;
+    screen.valid = 0;
+    return 0;
+}
+
+// 清空当前帧（开始绘制新的一帧）
+void scr_clear() {
+    if (scr_resize() != 0) return;
+    int i;
+    for (i = 0; i < screen.rows * screen.cols; i++) {
+        memset(&screen.cur[i], 0, sizeof(ScreenCell));
+        screen.cur[i].ch[0] = ' ';
+    }
+}
+
+// 终端内容被其他输出破坏后调用，下一帧整屏重绘
+void scr_invalidate() {
+    screen.valid = 0;
+}
+
+// 在当前帧 (row, col) 处写入文本，返回结束列
+int scr_put(int row, int col, unsigned char fg, unsigned char flags, const char *text) {
+    if (!screen.cur || row < 0 || row >= screen.rows) return col;
+    while (*text && col < screen.cols) {
+        unsigned int cp;
+        int len = utf8_decode(text, &cp);
+        int width = char_width(cp);
+        if (col + width > screen.cols) break;
+
+        ScreenCell *cell = &screen.cur[row * screen.cols + col];
+        memcpy(cell->ch, text, (size_t)len);
+        cell->ch[len] = '\0';
+        cell->fg = fg;
+        cell->flags = flags;
+        if (width == 2) {
+            ScreenCell *cont = cell + 1;
+            cont->ch[0] = '\0';
+            cont->fg = fg;
+            cont->flags = flags | SCR_CONT;
+        }
+        col += width;
+        text += len;
+    }
+    return col;
+}
+
+// 刷新后光标停留的位置
+void scr_park(int row, int col) {
+    screen.park_row = row;
+    screen.park_col = col;
+}
+
+static int cell_equal(const ScreenCell *a, const ScreenCell *b) {
+    return a->fg == b->fg && a->flags == b->flags && !strcmp(a->ch, b->ch);
+}
+
+// 移动光标：同一行向右用 CUF，其余用 CUP
+static void scr_move(int row, int col) {
+    if (row == screen.cur_row && col == screen.cur_col) return;
+    if (row == screen.cur_row && col > screen.cur_col)
+        scr_emitf("\033[%dC", col - screen.cur_col, 0);
+    else
+        scr_emitf("\033[%d;%dH", row + 1, col + 1);
+    screen.cur_row = row;
+    screen.cur_col = col;
+}
+
+static void scr_set_attr(unsigned char fg, unsigned char flags) {
+    flags &= (unsigned char)~SCR_CONT;
+    if (screen.sgr_known && fg == screen.fg && flags == screen.flags) return;
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "\033[0%s%s", (flags & SCR_BOLD) ? ";1" : "", (flags & SCR_REVERSE) ? ";7" : "");
+    if (fg) n += snprintf(buf + n, sizeof(buf) - n, ";%d", fg);
+    buf[n++] = 'm';
+    scr_emit(buf, (size_t)n);
+    screen.fg = fg;
+    screen.flags = flags;
+    screen.sgr_known = 1;
+}
+
+// 同一行上相隔很近且属性相同的未变化字符格，直接重写比发送光标移动序列更短
+static void scr_fill_gap(int row, int col) {
+    int gap = col - screen.cur_col, c;
+    if (row != screen.cur_row || gap <= 0 || gap > 3 || !screen.sgr_known) return;
+    for (c = screen.cur_col; c < col; c++) {
+        const ScreenCell *cell = &screen.cur[row * screen.cols + c];
+        if (cell->flags & SCR_CONT || cell->ch[1] || cell->fg != screen.fg || cell->flags != screen.flags)
+            return;
+        if (c + 1 < screen.cols && (cell[1].flags & SCR_CONT)) return;
+    }
+    for (c = screen.cur_col; c < col; c++) scr_emit(screen.cur[row * screen.cols + c].ch, 1);
+    screen.cur_col = col;
+}
+
+// 对比上一帧，只输出变化的字符格，整帧合并为一次 write
+void scr_flush() {
+    if (!screen.cur) return;
+    screen.out_len = 0;
+
+    if (!screen.valid) {
+        // 整屏重绘：清屏后上一帧视为全空白
+        scr_emit("\033[0m\033[H\033[2J", 11);
+        screen.cur_row = screen.cur_col = 0;
+        screen.sgr_known = 0;
+        int i;
+        for (i = 0; i < screen.rows * screen.cols; i++) {
+            memset(&screen.prev[i], 0, sizeof(ScreenCell));
+            screen.prev[i].ch[0] = ' ';
+        }
+        screen.valid = 1;
+    }
+
+    int r, c;
+    for (r = 0; r < screen.rows; r++) {
+        for (c = 0; c < screen.cols; c++) {
+            int idx = r * screen.cols + c;
+            ScreenCell *cell = &screen.cur[idx];
+            if (cell->flags & SCR_CONT) continue;
+            int wide = c + 1 < screen.cols && (screen.cur[idx + 1].flags & SCR_CONT);
+            if (cell_equal(cell, &screen.prev[idx]) && (!wide || cell_equal(cell + 1, &screen.prev[idx + 1])))
+                continue;
+            scr_fill_gap(r, c);
+            scr_move(r, c);
+            scr_set_attr(cell->fg, cell->flags);
+            scr_emit(cell->ch, strlen(cell->ch));
+            screen.cur_col += wide ? 2 : 1;
+            // 写到行尾后光标位置由终端决定，下次一律用 CUP
+            if (screen.cur_col >= screen.cols) screen.cur_row = -1;
+        }
+    }
+    scr_set_attr(0, 0);
+    scr_move(screen.park_row, screen.park_col);
+
+    if (screen.out_len > 0 && write_all(STDOUT_FILENO, screen.out, screen.out_len) != 0)
+        screen.valid = 0;
+    screen.last_frame_bytes = screen.out_len;
+    memcpy(screen.prev, screen.cur, (size_t)screen.rows * screen.cols * sizeof(ScreenCell));
+}
+
+// ==================== 按键读取与后台任务 ====================
+
+#define ESC_TIMEOUT_MS 50          // ESC 后等待转义序列剩余字节的时间
+#define JOB_TICK_MS 200            // 任务状态行刷新间隔
+#define JOB_KILL_GRACE_MS 3000     // 取消后等待退出的时间，超时发送 SIGKILL
+
+// 特殊按键
+enum {
+    KEY_NONE = -1,
+    KEY_CTRL_C = 3,
+    KEY_ESC = 27,
+    KEY_UP = 1000,
+    KEY_DOWN,
+    KEY_RIGHT,
+    KEY_LEFT
+};
+
+// 在超时内读取一个字节，超时返回 -1
+static int read_byte_timeout(int timeout_ms) {
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    int ret;
+    do {
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+    if (ret <= 0) return -1;
+    unsigned char c;
+    if (read(STDIN_FILENO, &c, 1) != 1) return -1;
+    return c;
+}
+
+// 读取一个按键（timeout_ms < 0 表示一直等待），解析方向键转义序列；
+// 单独按下 ESC 时在 ESC_TIMEOUT_MS 后返回 KEY_ESC，不会一直阻塞
+int read_key(int timeout_ms) {
+    int c = read_byte_timeout(timeout_ms);
+    if (c != 27) return c < 0 ? KEY_NONE : c;
+
+    int c1 = read_byte_timeout(ESC_TIMEOUT_MS);
+    if (c1 != '[' && c1 != 'O') return KEY_ESC;
+
+    // CSI/SS3：参数字节后跟一个结束字节（0x40-0x7E）
+    int final;
+    do {
+        final = read_byte_timeout(ESC_TIMEOUT_MS);
+    } while (final >= 0x20 && final < 0x40);
+    switch (final) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'C': return KEY_RIGHT;
+        case 'D': return KEY_LEFT;
+        default: return KEY_NONE;
+    }
+}
+
+// 任务运行期间可随时查看的只读系统概况（只读 /proc，不调用外部命令）
+void print_quick_probe() {
+    double load[3];
+    SiMemory mem;
+    SiUptime up;
+    si_probe_load(load);
+    si_probe_memory(&mem, 0);
+    si_probe_uptime(&up);
+    printf("    负载: %.2f %.2f %.2f   可用内存: %.1f / %.1f GiB   开机时长: %d天 %02d:%02d:%02d\n",
+           load[0], load[1], load[2], mem.available, mem.total,
+           up.days, up.hours, up.minutes, up.secs);
+}
+
+// 截断到终端宽度（按显示宽度计算）
+static void fit_to_width(const char *src, char *out, size_t size, int width) {
+    size_t len = 0;
+    int used = 0;
+    while (*src && used < width) {
+        unsigned int cp;
+        int n = utf8_decode(src, &cp);
+        int w = char_width(cp);
+        if (cp < 0x20 || used + w > width || len + n >= size) break;
+        memcpy(out + len, src, (size_t)n);
+        len += n;
+        used += w;
+        src += n;
+    }
+    out[len] = '\0';
+}
+
+// 逐行处理任务输出的回调，可在 status 中填写状态行摘要（留空则显示最新一行输出）
+typedef void (*JobLineFn)(void *ctx, const char *line, char *status, size_t status_size);
+
+// 截断并用空格补齐到固定显示宽度（printf 的宽度按字节计算，中文会错位）
+void pad_to_width(const char *src, char *out, size_t size, int width) {
+    fit_to_width(src, out, size, width);
+    int used = 0;
+    const char *s = out;
+    while (*s) {
+        unsigned int cp;
+        s += utf8_decode(s, &cp);
+        used += char_width(cp);
+    }
+    size_t len = strlen(out);
+    while (used < width && len + 1 < size) {
+        out[len++] = ' ';
+        used++;
+    }
+    out[len] = '\0';
+}
+
+// 在子进程中运行耗时命令，输出通过管道读回，与键盘输入一起用 poll 复用：
+// 状态行显示耗时和最新输出，c/ESC/Ctrl-C 取消，i 查看系统概况，v 切换显示完整输出。
+// on_line 不为 NULL 时每收到一行输出调用一次。返回命令的退出码，取消或异常结束时返回 -1
+int run_job(const char *title, const char *cmd, JobLineFn on_line, void *ctx) {
+    int pipefd[2];
+    if (pipe(pipefd) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        // 独立进程组，取消时可以连同其子进程一起结束
+        setpgid(0, 0);
+        int devnull = open("/dev/null", O_RDONLY);
+        if (devnull >= 0) dup2(devnull, STDIN_FILENO);
+        dup2(pipefd[1], STDOUT_FILENO);
+        dup2(pipefd[1], STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    setpgid(pid, pid);
+    close(pipefd[1]);
+    int out_fd = pipefd[0];
+    fcntl(out_fd, F_SETFL, fcntl(out_fd, F_GETFL) | O_NONBLOCK);
+
+    int tty = isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+    struct termios saved;
+    if (tty && tcgetattr(STDIN_FILENO, &saved) == 0) {
+        // 关闭 ISIG：Ctrl-C 作为取消键处理，而不是结束本程序
+        struct termios raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    } else {
+        tty = 0;
+    }
+
+    int cols = 80;
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col) cols = ws.ws_col;
+
+    static const char *spinner[] = { "⠋", "⠙", "⠹", "⠸", "⠼", "⠴", "⠦", "⠧", "⠇", "⠏" };
+    char partial[1024] = "";      // 尚未收到换行的输出
+    size_t partial_len = 0;
+    char last_line[1024] = "";
+    char summary[256] = "";
+    int verbose = 0, cancelled = 0, exited = 0, status = 0, tick = 0;
+    double start = now_ms(), kill_at = 0;
+
+    if (tty) printf("%s（c 取消，i 系统概况，v 显示输出）\n", title);
+    while (1) {
+        struct pollfd pfds[2];
+        int nfds = 0;
+        if (out_fd >= 0) { pfds[nfds].fd = out_fd; pfds[nfds].events = POLLIN; pfds[nfds].revents = 0; nfds++; }
+        if (tty) { pfds[nfds].fd = STDIN_FILENO; pfds[nfds].events = POLLIN; pfds[nfds].revents = 0; nfds++; }
+        int ret = poll(pfds, nfds, JOB_TICK_MS);
+        if (ret < 0 && errno != EINTR) break;
+
+        int k;
+        for (k = 0; ret > 0 && k < nfds; k++) {
+            if (!pfds[k].revents) continue;
+            if (pfds[k].fd == out_fd) {
+                char buf[4096];
+                ssize_t n = read(out_fd, buf, sizeof(buf));
+                if (n <= 0) {
+                    if (n == 0 || (errno != EAGAIN && errno != EINTR)) { close(out_fd); out_fd = -1; }
+                    continue;
+                }
+                ssize_t i;
+                for (i = 0; i < n; i++) {
+                    // apt/yum 的进度条用 \r 覆盖同一行，也按行结束处理
+                    if (buf[i] == '\n' || buf[i] == '\r') {
+                        if (partial_len == 0) continue;
+                        partial[partial_len] = '\0';
+                        snprintf(last_line, sizeof(last_line), "%s", partial);
+                        if (on_line) on_line(ctx, partial, summary, sizeof(summary));
+                        if (tty && verbose) printf("\r\033[2K%s\n", partial);
+                        partial_len = 0;
+                    } else if (partial_len + 1 < sizeof(partial)) {
+                        partial[partial_len++] = buf[i];
+                    }
+                }
+            } else {
+                int key = read_key(0);
+                if (key == 'c' || key == 'C' || key == KEY_ESC || key == KEY_CTRL_C) {
+                    if (!cancelled) {
+                        cancelled = 1;
+                        kill(-pid, SIGTERM);
+                        kill_at = now_ms() + JOB_KILL_GRACE_MS;
+                        printf("\r\033[2K正在取消: %s\n", title);
+                    }
+                } else if (key == 'i' || key == 'I') {
+                    printf("\r\033[2K");
+                    print_quick_probe();
+                } else if (key == 'v' || key == 'V') {
+                    verbose = !verbose;
+                }
+            }
+        }
+
+        if (!exited && waitpid(pid, &status, WNOHANG) == pid) exited = 1;
+        if (cancelled && !exited && kill_at > 0 && now_ms() > kill_at) {
+            kill(-pid, SIGKILL);
+            kill_at = 0;
+        }
+        // 子进程已退出：管道关闭，或遗留的孙进程仍占着管道但本轮已无输出
+        if (exited && (out_fd < 0 || ret == 0)) break;
+
+        if (tty) {
+            char shown[1024], line[1200];
+            snprintf(line, sizeof(line), "%s %s %.1fs  %s", spinner[tick++ % 10], title,
+                     (now_ms() - start) / 1000.0, summary[0] ? summary : last_line);
+            fit_to_width(line, shown, sizeof(shown), cols - 1);
+            printf("\r\033[2K%s", shown);
+            fflush(stdout);
+        }
+    }
+    if (out_fd >= 0) close(out_fd);
+    if (!exited) {
+        kill(-pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+
+    if (tty) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        printf("\r\033[2K");
+    }
+    double elapsed = (now_ms() - start) / 1000.0;
+    if (cancelled) {
+        printf("已取消: %s（%.1f 秒）\n", title, elapsed);
+        return -1;
+    }
+    if (!WIFEXITED(status)) return -1;
+    if (tty) printf("%s %s（%.1f 秒）\n", WEXITSTATUS(status) == 0 ? "完成:" : "失败:", title, elapsed);
+    return WEXITSTATUS(status);
+}
+
+// ==================== 镜像源目录（发行版 -> 源配置） ====================
+
+#define MIRROR_CATALOG_FILE "/etc/menu_project/catalog.conf"
+
+// 结构体：一个发行版版本的源配置
+// APT: suites 为空格分隔的套件列表，{codename} 会被替换为代号
+// YUM: suites 为空格分隔的 "仓库ID=子路径" 列表，components 不使用
+typedef struct {
+    const char *distro;          // ubuntu / debian / centos
+    const char *version;         // 精确匹配的版本号
+    const char *codename;
+    const char *path;            // 主仓库相对镜像根的目录
+    const char *suites;
+    const char *security_path;   // 安全更新目录，NULL 表示没有单独的安全源
+    const char *security_suite;
+    const char *components;
+    int deb_src;                 // 是否同时生成 deb-src
+    const char *gpgkey;          // YUM: /etc/pki/rpm-gpg 下的公钥文件名
+    const char *mirror;          // 默认镜像根地址，NULL 表示该版本没有可用镜像
+    const char *repo_url;        // YUM: 直接下载现成 .repo 文件，NULL 则按模板生成
+} MirrorCatalogEntry;
+
+#define UBUNTU_SUITES "{codename} {codename}-security {codename}-updates {codename}-backports"
+#define UBUNTU_COMPONENTS "main restricted universe multiverse"
+#define CENTOS_SUITES "base=os/$basearch/ updates=updates/$basearch/ extras=extras/$basearch/"
+
+// 内置目录，必须按 (distro, version) 的 strcmp 顺序排列，查找时使用二分
+static const MirrorCatalogEntry builtin_catalog[] = {
+    { "centos", "6", "", "centos-vault/6.10/", CENTOS_SUITES, NULL, NULL, NULL, 0,
+      "RPM-GPG-KEY-CentOS-6", DEFAULT_MIRROR_ROOT, NULL },
+    { "centos", "7", "", "centos/7/", CENTOS_SUITES, NULL, NULL, NULL, 0,
+      "RPM-GPG-KEY-CentOS-7", DEFAULT_MIRROR_ROOT, NULL },
+    { "centos", "8", "", "centos-vault/8.5.2111/",
+      "BaseOS=BaseOS/$basearch/os/ AppStream=AppStream/$basearch/os/ extras=extras/$basearch/os/",
+      NULL, NULL, NULL, 0, "RPM-GPG-KEY-centosofficial", DEFAULT_MIRROR_ROOT, NULL },
+    { "centos", "9", "", NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL },
+    { "debian", "10", "buster", "debian/", "{codename} {codename}-updates",
+      "debian-security/", "{codename}/updates", "main non-free contrib", 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "debian", "11", "bullseye", "debian/", "{codename} {codename}-updates {codename}-backports",
+      "debian-security/", "{codename}-security", "main non-free contrib", 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "debian", "12", "bookworm", "debian/", "{codename} {codename}-updates {codename}-backports",
+      "debian-security/", "{codename}-security", "main contrib non-free", 0, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "debian", "7", "wheezy", "debian-archive/debian/", "{codename}",
+      NULL, NULL, "main non-free contrib", 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "debian", "8", "jessie", "debian-archive/debian/", "{codename}",
+      NULL, NULL, "main non-free contrib", 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "debian", "9", "stretch", "debian-archive/debian/", "{codename}",
+      "debian-archive/debian-security/", "{codename}/updates", "main contrib non-free", 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "ubuntu", "14.04", "trusty", "ubuntu/", UBUNTU_SUITES, NULL, NULL, UBUNTU_COMPONENTS, 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "ubuntu", "16.04", "xenial", "ubuntu/", UBUNTU_SUITES, NULL, NULL, UBUNTU_COMPONENTS, 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "ubuntu", "18.04", "bionic", "ubuntu/", UBUNTU_SUITES, NULL, NULL, UBUNTU_COMPONENTS, 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "ubuntu", "20.04", "focal", "ubuntu/", UBUNTU_SUITES, NULL, NULL, UBUNTU_COMPONENTS, 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "ubuntu", "22.04", "jammy", "ubuntu/", UBUNTU_SUITES, NULL, NULL, UBUNTU_COMPONENTS, 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "ubuntu", "23.04", "lunar", "ubuntu/", UBUNTU_SUITES, NULL, NULL, UBUNTU_COMPONENTS, 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+    { "ubuntu", "24.04", "noble", "ubuntu/", UBUNTU_SUITES, NULL, NULL, UBUNTU_COMPONENTS, 1, NULL, DEFAULT_MIRROR_ROOT, NULL },
+};
+
+// 覆盖文件中加载的条目（运行期排序后同样二分查找）
+static MirrorCatalogEntry *catalog_overrides = NULL;
+static int catalog_override_count = 0;
+
+static int compare_catalog_entry(const void *a, const void *b) {
+    const MirrorCatalogEntry *ea = a, *eb = b;
+    int r = strcmp(ea->distro, eb->distro);
+    return r ? r : strcmp(ea->version, eb->version);
+}
+
+static const MirrorCatalogEntry* catalog_search(const MirrorCatalogEntry *table, int count,
+                                                const char *distro, const char *version) {
+    MirrorCatalogEntry key;
+    memset(&key, 0, sizeof(key));
+    key.distro = distro;
+    key.version = version;
+    return bsearch(&key, table, count, sizeof(table[0]), compare_catalog_entry);
+}
+
+// 设置覆盖条目的字段（字符串常驻内存，程序退出时释放）
+static void catalog_set_field(MirrorCatalogEntry *e, const char *key, const char *value) {
+    char *v = strdup(value);
+    if (!v) return;
+    if (!strcmp(key, "codename")) e->codename = v;
+    else if (!strcmp(key, "path")) e->path = v;
+    else if (!strcmp(key, "suites")) e->suites = v;
+    else if (!strcmp(key, "security_path")) e->security_path = v;
+    else if (!strcmp(key, "security_suite")) e->security_suite = v;
+    else if (!strcmp(key, "components")) e->components = v;
+    else if (!strcmp(key, "gpgkey")) e->gpgkey = v;
+    else if (!strcmp(key, "mirror")) e->mirror = v;
+    else if (!strcmp(key, "repo_url")) e->repo_url = v;
+    else if (!strcmp(key, "deb_src")) { e->deb_src = atoi(v); free(v); }
+    else { printf("忽略未知字段: %s\n", key); free(v); }
+}
+
+// 加载覆盖文件，格式：
+//   [ubuntu 22.04]
+//   mirror = http://mirror.internal/
+// 未写出的字段继承内置条目
+void load_catalog_overrides() {
+    static int loaded = 0;
+    if (loaded) return;
+    loaded = 1;
+
+    FILE *fp = fopen(MIRROR_CATALOG_FILE, "r");
+    if (!fp) return;
+
+    char line[MAX_LINE];
+    int cap = 0;
+    MirrorCatalogEntry *cur = NULL;
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        si_trim_quotes(line);
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        if (line[0] == '[') {
+            char distro[32], version[32];
+            cur = NULL;
+            if (sscanf(line, "[%31s %31[^]]]", distro, version) != 2) {
+                printf("忽略无效的目录段: %s\n", line);
+                continue;
+            }
+            if (catalog_override_count == cap) {
+                cap = cap ? cap * 2 : 8;
+                MirrorCatalogEntry *grown = realloc(catalog_overrides, cap * sizeof(*grown));
+                if (!grown) break;
+                catalog_overrides = grown;
+            }
+            cur = &catalog_overrides[catalog_override_count++];
+            const MirrorCatalogEntry *base = catalog_search(builtin_catalog,
+                sizeof(builtin_catalog) / sizeof(builtin_catalog[0]), distro, version);
+            if (base) *cur = *base;
+            else memset(cur, 0, sizeof(*cur));
+            cur->distro = strdup(distro);
+            cur->version = strdup(version);
+            if (!base) cur->codename = "";
+            continue;
+        }
+
+        char *eq = strchr(line, '=');
+        if (!cur || !eq) continue;
+        *eq = '\0';
+        char *value = eq + 1;
+        si_trim_quotes(line);
+        si_trim_quotes(value);
+        catalog_set_field(cur, line, value);
+    }
+    fclose(fp);
+
+    if (catalog_override_count > 1)
+        qsort(catalog_overrides, catalog_override_count, sizeof(catalog_overrides[0]), compare_catalog_entry);
+}
+
+// 查找发行版对应的源配置：精确版本 -> 主版本号（如 RHEL 8.6 -> 8）。
+// 未收录的版本不回落到其他版本：写入别的版本的源会导致升级或降级（CentOS 换源前还会
+// 移走全部 .repo），一律返回 NULL 由用户手动处理
+const MirrorCatalogEntry* catalog_find(const char *distro, const char *version) {
+    load_catalog_overrides();
+
+    char major[32];
+    snprintf(major, sizeof(major), "%.*s", (int)strcspn(version, "."), version);
+    const char *tries[2] = { version, major };
+    size_t i;
+
+    for (i = 0; i < 2; i++) {
+        const MirrorCatalogEntry *e;
+        if (!tries[i] || !tries[i][0]) continue;
+        e = catalog_search(catalog_overrides, catalog_override_count, distro, tries[i]);
+        if (e) return e;
+        e = catalog_search(builtin_catalog, sizeof(builtin_catalog) / sizeof(builtin_catalog[0]),
+                           distro, tries[i]);
+        if (e) return e;
+    }
+    return NULL;
+}
+
+// 展开模板中的 {codename}
+void expand_codename(const char *tmpl, const char *codename, char *out, size_t size) {
+    size_t len = 0;
+    while (*tmpl && len + 1 < size) {
+        if (strncmp(tmpl, "{codename}", 10) == 0) {
+            len += snprintf(out + len, size - len, "%s", codename);
+            if (len >= size) len = size - 1;
+            tmpl += 10;
+        } else {
+            out[len++] = *tmpl++;
+        }
+    }
+    out[len] = '\0';
+}
+
+// 按模板生成 sources.list 内容
+void render_apt_sources(const MirrorCatalogEntry *e, const char *root, FILE *out) {
+    char suites[MAX_LINE], suite[128];
+    expand_codename(e->suites, e->codename, suites, sizeof(suites));
+
+    char *save = NULL;
+    char *tok = strtok_r(suites, " ", &save);
+    for (; tok; tok = strtok_r(NULL, " ", &save)) {
+        fprintf(out, "deb %s%s %s %s\n", root, e->path, tok, e->components);
+        if (e->deb_src) fprintf(out, "deb-src %s%s %s %s\n", root, e->path, tok, e->components);
+    }
+    if (e->security_path && e->security_suite) {
+        expand_codename(e->security_suite, e->codename, suite, sizeof(suite));
+        fprintf(out, "deb %s%s %s %s\n", root, e->security_path, suite, e->components);
+        if (e->deb_src) fprintf(out, "deb-src %s%s %s %s\n", root, e->security_path, suite, e->components);
+    }
+}
+
+// 按模板生成 .repo 内容
+void render_yum_repo(const MirrorCatalogEntry *e, const char *root, FILE *out) {
+    char sections[MAX_LINE];
+    snprintf(sections, sizeof(sections), "%s", e->suites);
+
+    char *save = NULL;
+    char *tok = strtok_r(sections, " ", &save);
+    for (; tok; tok = strtok_r(NULL, " ", &save)) {
+        char *eq = strchr(tok, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        fprintf(out, "[%s]\nname=CentOS-$releasever - %s - %s\nbaseurl=%s%s%s\n", tok, tok, root, root, e->path, eq + 1);
+        if (e->gpgkey)
+            fprintf(out, "gpgcheck=1\ngpgkey=file:///etc/pki/rpm-gpg/%s\n\n", e->gpgkey);
+        else
+            fprintf(out, "gpgcheck=0\n\n");
+    }
+}
+
+// 测速用的元数据文件路径：APT 为 Release，YUM 为第一个仓库的 repomd.xml
+int catalog_probe_path(const MirrorCatalogEntry *e, int is_yum, char *out, size_t size) {
+    if (!is_yum) {
+        snprintf(out, size, "%sdists/%s/Release", e->path, e->codename);
+        return 0;
+    }
+    char first[MAX_LINE];
+    snprintf(first, sizeof(first), "%s", e->suites);
+    first[strcspn(first, " ")] = '\0';
+    char *eq = strchr(first, '=');
+    if (!eq) return -1;
+    char *arch = strstr(eq + 1, "$basearch");
+    if (arch) {
+        *arch = '\0';
+        snprintf(out, size, "%s%s%s%srepodata/repomd.xml", e->path, eq + 1, "x86_64", arch + 9);
+    } else {
+        snprintf(out, size, "%s%srepodata/repomd.xml", e->path, eq + 1);
+    }
+    return 0;
+}
+
+// 生成内容写入临时文件后 rename 到目标位置
+int write_rendered_file(const char *path, const MirrorCatalogEntry *e, const char *root,
+                        void (*render)(const MirrorCatalogEntry *, const char *, FILE *)) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) return -1;
+    render(e, root, fp);
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// ==================== 包管理器下载参数调优 ====================
+
+#define APT_TUNING_FILE "/etc/apt/apt.conf.d/99menu-project-tuning"
+#define REFRESH_TIME_FILE "/var/cache/menu_project/refresh_time"
+
+// dnf/yum [main] 段写入的参数
+static const char *yum_tuning[][2] = {
+    { "max_parallel_downloads", "10" },
+    { "fastestmirror", "True" },
+    { "keepcache", "1" },
+    { "metadata_expire", "6h" },
+};
+
+// APT 下载参数：按主机并行队列、加深 HTTP 流水线、不下载翻译索引
+static const char *apt_tuning =
+    "// 由 menu_project 换源时生成\n"
+    "Acquire::Queue-Mode \"host\";\n"
+    "Acquire::http::Pipeline-Depth \"10\";\n"
+    "Acquire::Languages \"none\";\n";
+
+// 行首是否为 key=（允许空格）
+static int ini_line_has_key(const char *line, const char *key) {
+    while (*line == ' ' || *line == '\t') line++;
+    size_t len = strlen(key);
+    if (strncmp(line, key, len) != 0) return 0;
+    line += len;
+    while (*line == ' ' || *line == '\t') line++;
+    return *line == '=';
+}
+
+// 在 ini 文件的 [main] 段中设置若干键值，已有的键原地替换，没有的追加到段尾。
+// 先写临时文件再 rename，临时文件沿用原文件的权限、属主和 SELinux 标签
+int set_ini_main_options(const char *path, const char *options[][2], int count) {
+    // 整个文件按行读入（行数、行长都不限），改写时原样写回其余内容
+    char **lines = NULL, *line = NULL;
+    size_t cap = 0, line_cap = 0;
+    int n = 0, ret = -1;
+    struct stat st;
+    char selinux[256];
+    ssize_t selinux_len = -1;
+    int existed = 0;
+    int *done = calloc((size_t)count + 1, sizeof(int));   // 每个键是否已写出
+    if (!done) return -1;
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        if (fstat(fileno(fp), &st) != 0) {
+            fclose(fp);
+            goto out;
+        }
+        existed = 1;
+        selinux_len = fgetxattr(fileno(fp), "security.selinux", selinux, sizeof(selinux));
+        while (getline(&line, &line_cap, fp) >= 0) {
+            if ((size_t)n == cap) {
+                size_t grown_cap = cap ? cap * 2 : 64;
+                char **grown = realloc(lines, grown_cap * sizeof(*grown));
+                if (!grown) break;
+                lines = grown;
+                cap = grown_cap;
+            }
+            lines[n] = line;
+            n++;
+            line = NULL;
+            line_cap = 0;
+        }
+        free(line);
+        // 没读到文件末尾（读错误或内存不足）时不改写，否则会丢掉后面的内容
+        int complete = !ferror(fp) && feof(fp);
+        fclose(fp);
+        if (!complete) goto out;
+    } else if (errno != ENOENT) {
+        goto out;
+    }
+
+    int main_start = -1, main_end = n;
+    int i, k;
+    for (i = 0; i < n; i++) {
+        if (lines[i][0] != '[') continue;
+        if (main_start >= 0) { main_end = i; break; }
+        if (!strncmp(lines[i], "[main]", 6)) main_start = i;
+    }
+    // 新键追加到 [main] 段最后一个非空行之后
+    int insert_at = main_end;
+    while (insert_at - 1 > main_start && strspn(lines[insert_at - 1], " \t\r\n") == strlen(lines[insert_at - 1]))
+        insert_at--;
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *out = fopen(tmp_path, "w");
+    if (!out) goto out;
+    if (existed && (fchmod(fileno(out), st.st_mode & 07777) != 0
+               || (fchown(fileno(out), st.st_uid, st.st_gid) != 0 && errno != EPERM)
+               || (selinux_len > 0 && fsetxattr(fileno(out), "security.selinux", selinux, (size_t)selinux_len, 0) != 0
+                   && errno != ENOTSUP))) {
+        fclose(out);
+        unlink(tmp_path);
+        goto out;
+    }
+
+    // 原文件最后一行可能没有换行，在它后面追加键之前要先补上
+    int need_newline = 0;
+    if (main_start < 0) {
+        // 没有 [main] 段时放在文件最前面
+        fprintf(out, "[main]\n");
+        for (k = 0; k < count; k++) fprintf(out, "%s=%s\n", options[k][0], options[k][1]);
+        for (k = 0; k < count; k++) done[k] = 1;
+    }
+    for (i = 0; i < n; i++) {
+        if (main_start >= 0 && i == insert_at) {
+            for (k = 0; k < count; k++) {
+                if (!done[k]) fprintf(out, "%s=%s\n", options[k][0], options[k][1]);
+                done[k] = 1;
+            }
+        }
+        int replaced = 0;
+        if (i > main_start && i < main_end) {
+            for (k = 0; k < count; k++) {
+                if (ini_line_has_key(lines[i], options[k][0])) {
+                    fprintf(out, "%s=%s\n", options[k][0], options[k][1]);
+                    done[k] = 1;
+                    replaced = 1;
+                    break;
+                }
+            }
+        }
+        if (!replaced) fputs(lines[i], out);
+        need_newline = !replaced && lines[i][strlen(lines[i]) - 1] != '\n';
+    }
+    for (k = 0; k < count; k++) {
+        if (done[k]) continue;
+        if (need_newline) fputc('\n', out);
+        need_newline = 0;
+        fprintf(out, "%s=%s\n", options[k][0], options[k][1]);
+    }
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) unlink(tmp_path);
+    else ret = 0;
+
+out:
+    for (i = 0; i < n; i++) free(lines[i]);
+    free(lines);
+    free(done);
+    return ret;
+}
+
+// 写入包管理器的并行下载/缓存参数
+void tune_package_manager(int is_yum) {
+    if (!is_yum) {
+        FILE *fp = fopen(APT_TUNING_FILE, "w");
+        if (!fp) {
+            printf("无法写入 %s\n", APT_TUNING_FILE);
+            return;
+        }
+        fputs(apt_tuning, fp);
+        fclose(fp);
+        printf("已写入APT下载参数: %s\n", APT_TUNING_FILE);
+        return;
+    }
+
+    // 有 dnf 时只改 dnf.conf，否则改 yum.conf
+    const char *conf = access("/etc/dnf/dnf.conf", F_OK) == 0 ? "/etc/dnf/dnf.conf" : "/etc/yum.conf";
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "[ -f %s.bak ] || cp %s %s.bak 2>/dev/null", conf, conf, conf);
+    system(cmd);
+    if (set_ini_main_options(conf, yum_tuning, sizeof(yum_tuning) / sizeof(yum_tuning[0])) != 0) {
+        printf("无法写入 %s\n", conf);
+        return;
+    }
+    printf("已写入YUM下载参数: %s\n", conf);
+}
+
+// ==================== 缓存刷新进度解析 ====================
+
+#define REPO_STAT_MAX 64
+
+// 仓库名：apt 为 "URL 套件"（URL 最长 159、套件最长 63 字节）
+#define REPO_NAME_MAX (160 + 1 + 64)
+
+// 单个仓库的刷新统计
+typedef struct {
+    char name[REPO_NAME_MAX];
+    int files;
+    long long bytes;
+    double last_ms;          // 该仓库最后一个文件完成时距开始的毫秒数
+    double reported_sec;     // yum/dnf 输出中自带的下载耗时之和
+    int failed;
+} RepoStat;
+
+// apt update / yum makecache 输出的增量解析状态
+typedef struct {
+    RepoStat repos[REPO_STAT_MAX];
+    int count;
+    double start_ms;
+    long long total_bytes;
+} RefreshProgress;
+
+static RepoStat* refresh_repo(RefreshProgress *p, const char *name) {
+    int i;
+    for (i = 0; i < p->count; i++) {
+        if (!strcmp(p->repos[i].name, name)) return &p->repos[i];
+    }
+    if (p->count == REPO_STAT_MAX) return NULL;
+    RepoStat *r = &p->repos[p->count++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    return r;
+}
+
+// 解析 "270 kB" / "6.1 MB" / "1,234 B" 这样的大小
+static long long parse_size_text(const char *s) {
+    char num[32];
+    size_t n = 0;
+    while (*s == ' ') s++;
+    while ((isdigit((unsigned char)*s) || *s == '.' || *s == ',') && n + 1 < sizeof(num)) {
+        if (*s != ',') num[n++] = *s;
+        s++;
+    }
+    num[n] = '\0';
+    while (*s == ' ') s++;
+    double v = atof(num);
+    if (*s == 'k' || *s == 'K') v *= 1000;
+    else if (*s == 'M') v *= 1000 * 1000;
+    else if (*s == 'G') v *= 1000.0 * 1000 * 1000;
+    return (long long)v;
+}
+
+// apt: "Get:1 http://mirror/ubuntu jammy InRelease [270 kB]"，仓库为 URL + 套件
+static int parse_apt_line(RefreshProgress *p, const char *line, double t) {
+    const char *kinds[] = { "Get:", "Hit:", "Ign:", "Err:" };
+    size_t k;
+    for (k = 0; k < 4; k++) {
+        if (!strncmp(line, kinds[k], 4)) break;
+    }
+    if (k == 4) return 0;
+
+    char url[160], suite[64];
+    if (sscanf(line + 4, "%*d %159s %63s", url, suite) != 2) return 0;
+    // "jammy-updates/main amd64 Packages" 归入已出现过的 "jammy-updates"
+    char name[REPO_NAME_MAX];
+    char *slash = strrchr(suite, '/');
+    if (slash) {
+        snprintf(name, sizeof(name), "%s %.*s", url, (int)(slash - suite), suite);
+        int i, found = 0;
+        for (i = 0; i < p->count && !found; i++) found = !strcmp(p->repos[i].name, name);
+        if (!found) snprintf(name, sizeof(name), "%s %s", url, suite);
+    } else {
+        snprintf(name, sizeof(name), "%s %s", url, suite);
+    }
+    RepoStat *r = refresh_repo(p, name);
+    if (!r) return 1;
+
+    r->files++;
+    r->last_ms = t;
+    if (k == 3) r->failed = 1;
+    const char *bracket = strrchr(line, '[');
+    if (k == 0 && bracket) {
+        long long bytes = parse_size_text(bracket + 1);
+        r->bytes += bytes;
+        p->total_bytes += bytes;
+    }
+    return 1;
+}
+
+// yum: "base/7/x86_64/primary_db       | 6.1 MB  00:00:02"
+// dnf: "CentOS Stream 9 - BaseOS   2.3 MB/s | 8.0 MB     00:03"
+static int parse_yum_line(RefreshProgress *p, const char *line, double t) {
+    char name[REPO_NAME_MAX];
+    const char *quote;
+
+    // 失败的仓库
+    if ((quote = strstr(line, "for repository '")) != NULL) {
+        quote += 16;
+        snprintf(name, sizeof(name), "%.*s", (int)strcspn(quote, "'"), quote);
+        RepoStat *r = refresh_repo(p, name);
+        if (r) { r->failed = 1; r->last_ms = t; }
+        return 1;
+    }
+    if (!strncmp(line, "failure: ", 9) && (quote = strstr(line, " from ")) != NULL) {
+        quote += 6;
+        snprintf(name, sizeof(name), "%.*s", (int)strcspn(quote, ":"), quote);
+        RepoStat *r = refresh_repo(p, name);
+        if (r) { r->failed = 1; r->last_ms = t; }
+        return 1;
+    }
+
+    const char *bar = strrchr(line, '|');
+    if (!bar || bar == line) return 0;
+    size_t len = (size_t)(bar - line);
+    if (len >= sizeof(name)) len = sizeof(name) - 1;
+    memcpy(name, line, len);
+    name[len] = '\0';
+
+    // 去掉 dnf 的速率列和尾部空格，yum 的 "repo/路径" 只保留仓库 ID
+    char *end = name + strlen(name);
+    while (end > name && end[-1] == ' ') *--end = '\0';
+    if (end - name > 2 && !strcmp(end - 2, "/s")) {
+        int words = 0;
+        while (end > name && words < 2) {
+            end--;
+            if (*end == ' ' && end[-1] != ' ') words++;
+        }
+        *end = '\0';
+        while (end > name && end[-1] == ' ') *--end = '\0';
+    }
+    if (!strchr(name, ' ')) name[strcspn(name, "/")] = '\0';
+    if (!name[0]) return 0;
+
+    int h = 0, m = 0, sec = 0;
+    const char *right = bar + 1;
+    const char *colon = strchr(right, ':');
+    if (!colon) return 0;
+    const char *ts = colon;
+    while (ts > right && isdigit((unsigned char)ts[-1])) ts--;
+    if (sscanf(ts, "%d:%d:%d", &h, &m, &sec) != 3) {
+        h = 0;
+        if (sscanf(ts, "%d:%d", &m, &sec) != 2) return 0;
+    }
+
+    RepoStat *r = refresh_repo(p, name);
+    if (!r) return 1;
+    long long bytes = parse_size_text(right);
+    r->files++;
+    r->bytes += bytes;
+    r->reported_sec += h * 3600 + m * 60 + sec;
+    r->last_ms = t;
+    p->total_bytes += bytes;
+    return 1;
+}
+
+// run_job 的行回调：增量更新各仓库统计，并在状态行显示汇总
+void refresh_on_line(void *ctx, const char *line, char *status, size_t status_size) {
+    RefreshProgress *p = ctx;
+    double t = now_ms() - p->start_ms;
+    if (!parse_apt_line(p, line, t) && !parse_yum_line(p, line, t)) return;
+
+    int i, failed = 0;
+    for (i = 0; i < p->count; i++) failed += p->repos[i].failed;
+    snprintf(status, status_size, "[%d 个仓库 %.1f MB%s] %s", p->count, p->total_bytes / 1e6,
+             failed ? " 有失败" : "", line);
+}
+
+static int compare_repo_time(const void *a, const void *b) {
+    const RepoStat *x = a, *y = b;
+    double tx = x->reported_sec > 0 ? x->reported_sec * 1000 : x->last_ms;
+    double ty = y->reported_sec > 0 ? y->reported_sec * 1000 : y->last_ms;
+    return tx < ty ? 1 : tx > ty ? -1 : 0;
+}
+
+// 打印各仓库耗时表（最慢的在前）。apt 的耗时为该仓库最后一个文件完成的时刻，
+// yum/dnf 为其输出中各文件下载耗时之和
+void print_refresh_table(RefreshProgress *p) {
+    if (p->count == 0) return;
+    qsort(p->repos, p->count, sizeof(p->repos[0]), compare_repo_time);
+    char shown[256];
+    pad_to_width("仓库", shown, sizeof(shown), 56);
+    printf("  %s   文件         KB       秒  状态\n", shown);
+    int i;
+    for (i = 0; i < p->count; i++) {
+        RepoStat *r = &p->repos[i];
+        pad_to_width(r->name, shown, sizeof(shown), 56);
+        double sec = r->reported_sec > 0 ? r->reported_sec : r->last_ms / 1000.0;
+        printf("  %s %6d %10.1f %8.1f  %s\n", shown, r->files, r->bytes / 1000.0, sec,
+               r->failed ? "失败" : "正常");
+    }
+}
+
+// 后台执行缓存刷新命令并计时，与上次记录的耗时对比，结束后输出各仓库耗时表
+int run_timed_refresh(const char *title, const char *cmd) {
+    double prev = -1;
+    FILE *fp = fopen(REFRESH_TIME_FILE, "r");
+    if (fp) {
+        if (fscanf(fp, "%lf", &prev) != 1) prev = -1;
+        fclose(fp);
+    }
+
+    RefreshProgress *progress = calloc(1, sizeof(*progress));
+    double start = now_ms();
+    if (progress) progress->start_ms = start;
+    int ret = run_job(title, cmd, progress ? refresh_on_line : NULL, progress);
+    double elapsed = (now_ms() - start) / 1000.0;
+
+    if (progress) {
+        print_refresh_table(progress);
+        free(progress);
+    }
+
+    if (prev >= 0)
+        printf("缓存刷新耗时: %.1f 秒（上次 %.1f 秒）\n", elapsed, prev);
+    else
+        printf("缓存刷新耗时: %.1f 秒\n", elapsed);
+
+    if (ret == 0 && mkdir_p("/var/cache/menu_project") == 0) {
+        fp = fopen(REFRESH_TIME_FILE, "w");
+        if (fp) {
+            fprintf(fp, "%.3f\n", elapsed);
+            fclose(fp);
+        }
+    }
+    return ret;
+}
+
+// 修改YUM源和APT源：mirror 不为 NULL 时直接使用该镜像地址，不读代理配置也不测速
+// 实际使用的镜像写入 chosen_out；返回 0 成功，1 已切换但刷新缓存失败，-1 失败
+int switch_package_source(const char *mirror, char *chosen_out, size_t chosen_size) {
+    char arena_buf[1024];
+    SiArena arena;
+    SiDistro distro_info;
+    si_arena_init(&arena, arena_buf, sizeof(arena_buf));
+    if (si_probe_distro(&distro_info, &arena) != 0) {
+        printf("无法识别系统类型，无法自动更换源。\n");
+        return -1;
+    }
+    printf("检测到系统: %s %s\n", distro_info.name, distro_info.version);
+
+    const char *distro = NULL;
+    int is_yum = 0;
+    if (strstr(distro_info.name, "Ubuntu")) {
+        distro = "ubuntu";
+    } else if (strstr(distro_info.name, "Debian")) {
+        distro = "debian";
+    } else if (strstr(distro_info.name, "CentOS") || strstr(distro_info.name, "Red Hat") || strstr(distro_info.name, "RHEL")) {
+        distro = "centos";
+        is_yum = 1;
+    } else {
+        printf("暂不支持该系统自动换源，请手动处理。\n");
+        return -1;
+    }
+
+    const MirrorCatalogEntry *entry = catalog_find(distro, distro_info.version);
+    if (!entry) {
+        printf("暂不支持该系统自动换源，请手动处理。\n");
+        return -1;
+    }
+    if (!entry->mirror || !entry->path || !entry->suites) {
+        printf("该系统目前无可用镜像源，请手动处理。\n");
+        return -1;
+    }
+
+    // 配置了机房缓存代理时直接指向代理，否则测速选出最快镜像，失败时使用目录中的默认镜像
+    char chosen_root[256];
+    char probe_path[MAX_LINE];
+    snprintf(chosen_root, sizeof(chosen_root), "%s", entry->mirror);
+    char proxy_root[256];
+    // 补上结尾的 / 后放不下的地址直接拒绝，截断的地址会写出错误的源
+    if (mirror) {
+        size_t len = strlen(mirror);
+        if (snprintf(chosen_root, sizeof(chosen_root), "%s%s", mirror,
+                     (len && mirror[len - 1] != '/') ? "/" : "") >= (int)sizeof(chosen_root)) {
+            printf("镜像地址过长: %s\n", mirror);
+            return -1;
+        }
+        printf("使用指定镜像: %s\n", chosen_root);
+    } else if (si_read_line(MIRROR_PROXY_FILE, proxy_root, sizeof(proxy_root)) == 0 && proxy_root[0]) {
+        si_trim_quotes(proxy_root);
+        size_t len = strlen(proxy_root);
+        const char *slash = (len && proxy_root[len - 1] != '/') ? "/" : "";
+        if (len + strlen(slash) >= sizeof(chosen_root)) {
+            printf("%s 中的代理地址过长\n", MIRROR_PROXY_FILE);
+            return -1;
+        }
+        snprintf(chosen_root, sizeof(chosen_root), "%.*s%s", (int)(sizeof(chosen_root) - 1 - strlen(slash)),
+                 proxy_root, slash);
+        printf("使用机房缓存代理: %s\n", chosen_root);
+    } else if (catalog_probe_path(entry, is_yum, probe_path, sizeof(probe_path)) != 0
+        || select_fastest_mirror(probe_path, entry->mirror, chosen_root, sizeof(chosen_root)) != 0) {
+        snprintf(chosen_root, sizeof(chosen_root), "%s", entry->mirror);
+    }
+
+    // Ubuntu/Debian 系列
+    if (!is_yum) {
+        printf("正在备份并更换APT源...\n");
+        system("cp /etc/apt/sources.list /etc/apt/sources.list.bak 2>/dev/null");
+        if (write_rendered_file("/etc/apt/sources.list", entry, chosen_root, render_apt_sources) != 0) {
+            printf("无法写入 /etc/apt/sources.list\n");
+            return -1;
+        }
+        tune_package_manager(0);
+        printf("APT源已切换为 %s，正在更新缓存...\n", chosen_root);
+        snprintf(chosen_out, chosen_size, "%s", chosen_root);
+        int ret = run_timed_refresh("apt update", "apt update");
+        if (ret != 0) {
+            printf("APT源更新失败，请检查网络连接或手动更新。\n");
+            return 1;
+        }
+        printf("APT源已切换并更新完成。\n");
+        return 0;
+    }
+
+    // CentOS/RHEL 系列
+    printf("正在备份并更换YUM源...\n");
+    system("mkdir -p /etc/yum.repos.d/backup && mv /etc/yum.repos.d/*.repo /etc/yum.repos.d/backup/ 2>/dev/null");
+    const char *repo_path = "/etc/yum.repos.d/CentOS-Base.repo";
+    // 内置目录按模板生成 .repo，不需要下载。catalog.conf 指定了 repo_url 时才用内置客户端下载
+    // 现成文件（http 带条件请求缓存，https 交给 curl/wget）；下载失败时（如最小镜像里没有
+    // curl/wget 又是 https 地址）退回模板，旧的 .repo 已经移走，不能停在没有源的状态
+    int fetched = 0;
+    if (entry->repo_url) {
+        if (http_fetch(entry->repo_url, repo_path, 1, NULL) != 0) {
+            printf("下载YUM源配置文件失败，改为按目录模板生成。\n");
+        } else {
+            fetched = 1;
+            if (strcmp(chosen_root, entry->mirror) != 0
+                && rewrite_file_mirror_root(repo_path, entry->mirror, chosen_root) != 0) {
+                printf("改写 .repo 文件失败，保留默认镜像。\n");
+                snprintf(chosen_root, sizeof(chosen_root), "%s", entry->mirror);
+            }
+        }
+    }
+    if (!fetched && write_rendered_file(repo_path, entry, chosen_root, render_yum_repo) != 0) {
+        printf("无法写入 %s\n", repo_path);
+        return -1;
+    }
+    tune_package_manager(1);
+    printf("YUM源已切换为 %s，正在清理并生成缓存...\n", chosen_root);
+    snprintf(chosen_out, chosen_size, "%s", chosen_root);
+    int ret = run_timed_refresh("yum makecache", "yum clean all && yum makecache");
+    if (ret != 0) {
+        printf("YUM源清理和缓存生成失败，请检查网络连接或手动处理。\n");
+        return 1;
+    }
+    printf("YUM源已切换并缓存更新完成。\n");
+    return 0;
+}
+
+// 菜单入口：按代理配置或测速结果换源
+void change_package_source() {
+    char chosen[256];
+    switch_package_source(NULL, chosen, sizeof(chosen));
+}
+
+// ==================== 机房本地缓存代理（--cache-proxy） ====================
+
+#define PROXY_DEFAULT_PORT 3142
+#define PROXY_DEFAULT_DIR "/var/cache/menu_project/proxy"
+#define PROXY_DEFAULT_SIZE_MB 10240
+#define PROXY_DEFAULT_TTL 300          // 索引类文件的缓存有效期（秒）
+#define PROXY_DEFAULT_MAX_CONN 256     // 同时服务的连接数，每个连接最多占 3 个 fd，低于默认的 1024 上限
+#define PROXY_BUCKETS 4096
+
+// 缓存条目：哈希桶 + LRU 双向链表（头部为最近使用）
+typedef struct ProxyEntry {
+    unsigned long long key;
+    long long size;
+    struct ProxyEntry *prev, *next;
+    struct ProxyEntry *hnext;
+} ProxyEntry;
+
+// 正在回源的请求，相同 URL 的并发请求在此等待同一次下载
+typedef struct ProxyInflight {
+    unsigned long long key;
+    int done;
+    int ok;
+    int waiters;
+    pthread_cond_t cond;
+    struct ProxyInflight *next;
+} ProxyInflight;
+
+static struct {
+    char cache_dir[256];
+    char upstream[256];
+    char upstream_host[128];       // 上游的协议、主机和端口，绝对地址请求只接受与之相同的
+    char upstream_port[8];
+    int upstream_tls;
+    long long max_bytes;
+    long long used_bytes;
+    int ttl;
+    ProxyEntry *buckets[PROXY_BUCKETS];
+    ProxyEntry *lru_head, *lru_tail;
+    ProxyInflight *inflight;
+    int active;                    // 正在服务的连接数，到 max_conn 时主循环暂停 accept
+    int max_conn;
+    pthread_cond_t slot_free;
+    pthread_mutex_t lock;
+} proxy = { .lock = PTHREAD_MUTEX_INITIALIZER, .slot_free = PTHREAD_COND_INITIALIZER };
+
+static void proxy_file_path(unsigned long long key, char *out, size_t size) {
+    snprintf(out, size, "%s/%016llx", proxy.cache_dir, key);
+}
+
+static ProxyEntry* proxy_lookup(unsigned long long key) {
+    ProxyEntry *e = proxy.buckets[key % PROXY_BUCKETS];
+    while (e && e->key != key) e = e->hnext;
+    return e;
+}
+
+static void proxy_lru_unlink(ProxyEntry *e) {
+    if (e->prev) e->prev->next = e->next; else proxy.lru_head = e->next;
+    if (e->next) e->next->prev = e->prev; else proxy.lru_tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void proxy_lru_push(ProxyEntry *e) {
+    e->prev = NULL;
+    e->next = proxy.lru_head;
+    if (proxy.lru_head) proxy.lru_head->prev = e;
+    proxy.lru_head = e;
+    if (!proxy.lru_tail) proxy.lru_tail = e;
+}
+
+static void proxy_remove(ProxyEntry *e) {
+    ProxyEntry **pp = &proxy.buckets[e->key % PROXY_BUCKETS];
+    while (*pp != e) pp = &(*pp)->hnext;
+    *pp = e->hnext;
+    proxy_lru_unlink(e);
+    proxy.used_bytes -= e->size;
+    free(e);
+}
+
+// 记录（或更新）缓存条目并置为最近使用，超出容量时从 LRU 尾部淘汰（需持锁）
+static void proxy_store(unsigned long long key, long long size) {
+    ProxyEntry *e = proxy_lookup(key);
+    if (e) {
+        proxy.used_bytes -= e->size;
+        proxy_lru_unlink(e);
+    } else {
+        e = calloc(1, sizeof(*e));
+        if (!e) return;
+        e->key = key;
+        e->hnext = proxy.buckets[key % PROXY_BUCKETS];
+        proxy.buckets[key % PROXY_BUCKETS] = e;
+    }
+    e->size = size;
+    proxy.used_bytes += size;
+    proxy_lru_push(e);
+
+    while (proxy.used_bytes > proxy.max_bytes && proxy.lru_tail && proxy.lru_tail != e) {
+        ProxyEntry *victim = proxy.lru_tail;
+        char path[512];
+        proxy_file_path(victim->key, path, sizeof(path));
+        unlink(path);
+        proxy_remove(victim);
+    }
+}
+
+// 启动时按修改时间重建缓存索引，清理残留的临时文件
+static int compare_mtime(const void *a, const void *b) {
+    const struct { unsigned long long key; long long size; time_t mtime; } *x = a, *y = b;
+    return x->mtime < y->mtime ? -1 : x->mtime > y->mtime;
+}
+
+static void proxy_load_index() {
+    DIR *dir = opendir(proxy.cache_dir);
+    if (!dir) return;
+
+    struct { unsigned long long key; long long size; time_t mtime; } *files = NULL;
+    int count = 0, cap = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", proxy.cache_dir, de->d_name);
+        if (strstr(de->d_name, ".tmp")) { unlink(path); continue; }
+        if (strlen(de->d_name) != 16 || strspn(de->d_name, "0123456789abcdef") != 16) continue;
+
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            void *grown = realloc(files, cap * sizeof(*files));
+            if (!grown) break;
+            files = grown;
+        }
+        files[count].key = strtoull(de->d_name, NULL, 16);
+        files[count].size = st.st_size;
+        files[count].mtime = st.st_mtime;
+        count++;
+    }
+    closedir(dir);
+
+    // 从旧到新插入，最新的在 LRU 头部
+    qsort(files, count, sizeof(*files), compare_mtime);
+    int i;
+    for (i = 0; i < count; i++) proxy_store(files[i].key, files[i].size);
+    free(files);
+    printf("缓存索引: %d 个文件，%.1f MiB\n", count, proxy.used_bytes / 1048576.0);
+}
+
+// 内容不可变的文件（软件包、按哈希寻址的索引）可以一直使用，其余索引文件按 TTL 过期
+static int proxy_is_immutable(const char *url) {
+    const char *exts[] = { ".deb", ".udeb", ".rpm", ".drpm" };
+    size_t i, len = strlen(url);
+    for (i = 0; i < sizeof(exts) / sizeof(exts[0]); i++) {
+        size_t el = strlen(exts[i]);
+        if (len > el && !strcmp(url + len - el, exts[i])) return 1;
+    }
+    if (strstr(url, "/by-hash/")) return 1;
+    return strstr(url, "/repodata/") && !strstr(url, "repomd.xml");
+}
+
+static int proxy_is_fresh(const char *url, const char *path) {
+    if (proxy_is_immutable(url)) return 1;
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    return time(NULL) - st.st_mtime < proxy.ttl;
+}
+
+// 获取 URL 对应的缓存文件：命中直接返回；未命中时同一 URL 只回源一次，其余请求等待结果
+// 返回 0 表示 path 可用，hit 标记是否直接命中
+static int proxy_get(const char *url, char *path, size_t size, const char **how) {
+    unsigned long long key = fnv1a64(url);
+    proxy_file_path(key, path, size);
+
+    pthread_mutex_lock(&proxy.lock);
+    ProxyEntry *e = proxy_lookup(key);
+    if (e && proxy_is_fresh(url, path)) {
+        proxy_lru_unlink(e);
+        proxy_lru_push(e);
+        pthread_mutex_unlock(&proxy.lock);
+        *how = "HIT";
+        return 0;
+    }
+    int stale = e != NULL;
+
+    ProxyInflight *f = proxy.inflight;
+    while (f && f->key != key) f = f->next;
+    if (f) {
+        // 已有请求在回源，等待其完成
+        f->waiters++;
+        while (!f->done) pthread_cond_wait(&f->cond, &proxy.lock);
+        int ok = f->ok;
+        if (--f->waiters == 0) {
+            pthread_cond_destroy(&f->cond);
+            free(f);
+        }
+        pthread_mutex_unlock(&proxy.lock);
+        *how = "WAIT";
+        return ok ? 0 : -1;
+    }
+
+    f = calloc(1, sizeof(*f));
+    if (!f) {
+        pthread_mutex_unlock(&proxy.lock);
+        return -1;
+    }
+    f->key = key;
+    pthread_cond_init(&f->cond, NULL);
+    f->next = proxy.inflight;
+    proxy.inflight = f;
+    pthread_mutex_unlock(&proxy.lock);
+
+    int status = 0;
+    int ret = http_fetch(url, path, 0, &status);
+    struct stat st;
+    int ok = ret == 0 && stat(path, &st) == 0;
+
+    pthread_mutex_lock(&proxy.lock);
+    if (ok) {
+        proxy_store(key, st.st_size);
+        *how = "MISS";
+    } else if (stale && access(path, R_OK) == 0) {
+        // 回源失败时继续使用过期的缓存
+        ok = 1;
+        *how = "STALE";
+    }
+    ProxyInflight **pp = &proxy.inflight;
+    while (*pp != f) pp = &(*pp)->next;
+    *pp = f->next;
+    f->done = 1;
+    f->ok = ok;
+    if (f->waiters > 0) {
+        pthread_cond_broadcast(&f->cond);
+    } else {
+        pthread_cond_destroy(&f->cond);
+        free(f);
+    }
+    pthread_mutex_unlock(&proxy.lock);
+    return ok ? 0 : -1;
+}
+
+static int proxy_send_status(int fd, int code, const char *reason, int keep_alive) {
+    char head[256];
+    int len = snprintf(head, sizeof(head),
+        "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+        code, reason, keep_alive ? "keep-alive" : "close");
+    return write_all(fd, head, (size_t)len);
+}
+
+// 用 sendfile 发送缓存文件
+static int proxy_send_file(int fd, const char *path, int head_only, int keep_alive) {
+    int in = open(path, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return proxy_send_status(fd, 404, "Not Found", keep_alive);
+    struct stat st;
+    fstat(in, &st);
+
+    char head[256];
+    int len = snprintf(head, sizeof(head),
+        "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %lld\r\n"
+        "Connection: %s\r\n\r\n", (long long)st.st_size, keep_alive ? "keep-alive" : "close");
+    int ret = write_all(fd, head, (size_t)len);
+
+    off_t off = 0;
+    while (ret == 0 && !head_only && off < st.st_size) {
+        ssize_t n = sendfile(fd, in, &off, (size_t)(st.st_size - off));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) ret = -1;
+    }
+    close(in);
+    return ret;
+}
+
+// 绝对地址是否指向上游镜像站。只代理上游，否则任何能连上端口的主机都可以借代理访问内网地址
+// （如 169.254.169.254），并从缓存中读回结果
+static int proxy_same_origin(const char *target) {
+    char host[128], port[8], path[1536];
+    int tls;
+    if (parse_http_url(target, host, sizeof(host), port, sizeof(port), path, sizeof(path), &tls) != 0)
+        return 0;
+    return tls == proxy.upstream_tls && !strcasecmp(host, proxy.upstream_host) && !strcmp(port, proxy.upstream_port);
+}
+
+// 单个客户端连接：支持 keep-alive 和流水线请求
+// 连接结束，让出一个连接名额
+static void proxy_release_slot() {
+    pthread_mutex_lock(&proxy.lock);
+    proxy.active--;
+    pthread_cond_signal(&proxy.slot_free);
+    pthread_mutex_unlock(&proxy.lock);
+}
+
+static void* proxy_client(void *arg) {
+    int fd = (int)(long)arg;
+    HttpReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.fd = fd;
+
+    while (1) {
+        char line[2048], method[16], target[1536], version[16];
+        if (http_read_line(&reader, line, sizeof(line)) != 0) break;
+        if (!line[0]) continue;
+        if (sscanf(line, "%15s %1535s %15s", method, target, version) != 3) {
+            proxy_send_status(fd, 400, "Bad Request", 0);
+            break;
+        }
+
+        int keep_alive = strcmp(version, "HTTP/1.0") != 0;
+        while (http_read_line(&reader, line, sizeof(line)) == 0 && line[0]) {
+            if (!strncasecmp(line, "Connection:", 11)) {
+                if (strstr(line + 11, "close")) keep_alive = 0;
+                else if (strstr(line + 11, "eep-")) keep_alive = 1;
+            }
+        }
+
+        int head_only = !strcmp(method, "HEAD");
+        if (!head_only && strcmp(method, "GET") != 0) {
+            proxy_send_status(fd, 501, "Not Implemented", 0);
+            break;
+        }
+
+        // 绝对地址（客户端把这里配置成 HTTP 代理时）只接受上游镜像站，路径形式拼接到上游镜像根地址
+        char url[2048];
+        if (!strncmp(target, "http://", 7) || !strncmp(target, "https://", 8)) {
+            if (!proxy_same_origin(target)) {
+                printf("DENY  %s\n", target);
+                proxy_send_status(fd, 403, "Forbidden", 0);
+                break;
+            }
+            snprintf(url, sizeof(url), "%s", target);
+        } else {
+            snprintf(url, sizeof(url), "%s%s", proxy.upstream, target[0] == '/' ? target + 1 : target);
+        }
+
+        char path[512];
+        const char *how = "MISS";
+        int ret;
+        if (proxy_get(url, path, sizeof(path), &how) == 0) {
+            printf("%-5s %s\n", how, url);
+            ret = proxy_send_file(fd, path, head_only, keep_alive);
+        } else {
+            printf("FAIL  %s\n", url);
+            ret = proxy_send_status(fd, 404, "Not Found", keep_alive);
+        }
+        if (ret != 0 || !keep_alive) break;
+    }
+    close(fd);
+    proxy_release_slot();
+    return NULL;
+}
+
+// 缓存代理主循环：--cache-proxy [--listen ADDR] [--port N] [--upstream URL] [--dir DIR] [--size MB] [--ttl SEC]
+//                                [--max-conn N]
+// 默认上游是 https，内置客户端不支持 TLS，每次未命中都会启动 curl/wget 回源；
+// 上游在可信网络内时用 --upstream http://... 由内置客户端直接回源
+int run_cache_proxy(int argc, char *argv[]) {
+    const char *listen_addr = NULL;   // 默认监听所有地址
+    int port = PROXY_DEFAULT_PORT;
+    long long size_mb = PROXY_DEFAULT_SIZE_MB;
+    snprintf(proxy.cache_dir, sizeof(proxy.cache_dir), "%s", PROXY_DEFAULT_DIR);
+    snprintf(proxy.upstream, sizeof(proxy.upstream), "%s", DEFAULT_MIRROR_ROOT);
+    proxy.ttl = PROXY_DEFAULT_TTL;
+    proxy.max_conn = PROXY_DEFAULT_MAX_CONN;
+
+    int i;
+    for (i = 0; i < argc; i++) {
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(argv[i], "--listen") && val) listen_addr = argv[++i];
+        else if (!strcmp(argv[i], "--port") && val) port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--upstream") && val) snprintf(proxy.upstream, sizeof(proxy.upstream), "%s", argv[++i]);
+        else if (!strcmp(argv[i], "--dir") && val) snprintf(proxy.cache_dir, sizeof(proxy.cache_dir), "%s", argv[++i]);
+        else if (!strcmp(argv[i], "--size") && val) size_mb = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--ttl") && val) proxy.ttl = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-conn") && val) proxy.max_conn = atoi(argv[++i]);
+        else {
+            printf("用法: --cache-proxy [--listen 地址] [--port N] [--upstream URL] [--dir DIR] [--size MB] [--ttl SEC]\n"
+                   "                    [--max-conn N]\n"
+                   "默认上游 %s 为 https，未命中时通过 curl/wget 回源（需已安装）；\n"
+                   "上游可信时可指定 --upstream http://...，由内置客户端直接回源并省去每次启动进程\n",
+                   DEFAULT_MIRROR_ROOT);
+            return 1;
+        }
+    }
+    if (proxy.max_conn <= 0) {
+        printf("无效的连接数上限: %d\n", proxy.max_conn);
+        return 1;
+    }
+    size_t ulen = strlen(proxy.upstream);
+    if (ulen && proxy.upstream[ulen - 1] != '/' && ulen + 1 < sizeof(proxy.upstream)) strcat(proxy.upstream, "/");
+    proxy.max_bytes = size_mb * 1024 * 1024;
+    char upstream_path[256];
+    if (parse_http_url(proxy.upstream, proxy.upstream_host, sizeof(proxy.upstream_host),
+                       proxy.upstream_port, sizeof(proxy.upstream_port),
+                       upstream_path, sizeof(upstream_path), &proxy.upstream_tls) != 0) {
+        printf("无效的上游地址: %s\n", proxy.upstream);
+        return 1;
+    }
+
+    if (mkdir_p(proxy.cache_dir) != 0) {
+        perror("无法创建缓存目录");
+        return 1;
+    }
+    proxy_load_index();
+
+    // 未指定 --listen 时优先用双栈 IPv6 套接字监听所有地址，不支持 IPv6 时退回 IPv4
+    struct sockaddr_in6 addr6;
+    struct sockaddr_in addr4;
+    memset(&addr6, 0, sizeof(addr6));
+    memset(&addr4, 0, sizeof(addr4));
+    addr6.sin6_family = AF_INET6;
+    addr6.sin6_addr = in6addr_any;
+    addr6.sin6_port = htons(port);
+    addr4.sin_family = AF_INET;
+    addr4.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr4.sin_port = htons(port);
+    int family = 0;
+    if (listen_addr) {
+        if (inet_pton(AF_INET, listen_addr, &addr4.sin_addr) == 1) family = AF_INET;
+        else if (inet_pton(AF_INET6, listen_addr, &addr6.sin6_addr) == 1) family = AF_INET6;
+        else {
+            printf("无效的监听地址: %s\n", listen_addr);
+            return 1;
+        }
+    }
+
+    int lfd = socket(family == AF_INET ? AF_INET : AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0 && !family) {
+        family = AF_INET;
+        lfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    }
+    if (lfd < 0) {
+        perror("socket");
+        return 1;
+    }
+    int on = 1, off = 0;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    int ret;
+    if (family != AF_INET) {
+        // 只有监听全部地址时才需要同时接受 IPv4
+        if (!family) setsockopt(lfd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        ret = bind(lfd, (struct sockaddr *)&addr6, sizeof(addr6));
+    } else {
+        ret = bind(lfd, (struct sockaddr *)&addr4, sizeof(addr4));
+    }
+    if (ret != 0 || listen(lfd, 512) != 0) {
+        perror("监听失败");
+        close(lfd);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);   // 日志可能重定向到文件，按行输出
+    printf("缓存代理已启动: %s 端口 %d，上游 %s，缓存目录 %s（上限 %lld MiB，最多 %d 个连接）\n",
+           listen_addr ? listen_addr : "所有地址", port, proxy.upstream, proxy.cache_dir, size_mb, proxy.max_conn);
+    if (proxy.upstream_tls)
+        printf("上游为 https，未命中时通过 curl/wget 回源\n");
+
+    int starved = 0;
+    while (1) {
+        // 连接数到上限时暂停 accept，新连接留在 listen 队列里，等有连接结束再接
+        pthread_mutex_lock(&proxy.lock);
+        while (proxy.active >= proxy.max_conn) pthread_cond_wait(&proxy.slot_free, &proxy.lock);
+        pthread_mutex_unlock(&proxy.lock);
+
+        int cfd = accept(lfd, NULL, NULL);
+        if (cfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // fd 或内存耗尽时连接还在队列里，马上重试只会空转，等已有连接释放资源
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                if (!starved) perror("accept 资源不足，稍后重试");
+                starved = 1;
+                usleep(100 * 1000);
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+        starved = 0;
+        struct timeval tv = { 60, 0 };
+        setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        pthread_mutex_lock(&proxy.lock);
+        proxy.active++;
+        pthread_mutex_unlock(&proxy.lock);
+        pthread_t tid;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&tid, &attr, proxy_client, (void *)(long)cfd) != 0) {
+            close(cfd);
+            proxy_release_slot();
+        }
+        pthread_attr_destroy(&attr);
+    }
+    close(lfd);
+    return 1;
+}
+
+// 功能示例：功能一
+void feature_1() {
+    printf("👉 功能 1 已执行。\n");
+}
+
+// 功能三：修改源
+void feature_3() {
+    printf("👉 功能 3：自动更换YUM/APT源\n");
+    change_package_source();
+}
+
+// 校验IP地址格式
+int is_valid_ip(const char *ip) {
+    struct in_addr addr;
+    return inet_pton(AF_INET, ip, &addr) == 1;
+}
+
+// 校验掩码格式（255.255.255.0 或 /24）
+int is_valid_mask(const char *mask) {
+    // 支持 /24
+    if (mask[0] == '/' && atoi(mask+1) >= 0 && atoi(mask+1) <= 32) return 1;
+    // 支持 255.255.255.0
+    struct in_addr addr;
+    return inet_pton(AF_INET, mask, &addr) == 1;
+}
+
+// 获取所有物理网卡名，返回数量，names为输出数组
+int get_all_ifnames(char names[][IFNAMSIZ], int max) {
+    struct ifaddrs *ifaddr, *ifa;
+    int count = 0;
+    if (getifaddrs(&ifaddr) == -1) return 0;
+    for (ifa = ifaddr; ifa != NULL && count < max; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_PACKET) {
+            // 不重复
+            int found = 0;
+            int i;
+            for (i = 0; i < count; ++i) if (strcmp(names[i], ifa->ifa_name) == 0) { found = 1; break; }
+            if (!found) strncpy(names[count++], ifa->ifa_name, IFNAMSIZ);
+        }
+    }
+    freeifaddrs(ifaddr);
+    return count;
+}
+
+
+
+// ==================== 网卡调优（ethtool） ====================
+
+#define NIC_TUNING_FILE "/etc/menu_project/nic_tuning.conf"
+#define NIC_TUNING_UNIT "/etc/systemd/system/menu-project-nic-tuning.service"
+
+enum { NIC_PRESET_THROUGHPUT, NIC_PRESET_LATENCY, NIC_PRESET_COUNT };
+static const char *nic_preset_names[NIC_PRESET_COUNT] = { "throughput", "latency" };
+
+// 展示和调优关心的特性（内核特性字符串 -> 显示名）
+static const struct { const char *name; const char *label; } nic_feature_list[] = {
+    { "rx-checksum", "rx 校验和" },
+    { "tx-scatter-gather", "SG" },
+    { "tx-tcp-segmentation", "TSO" },
+    { "tx-tcp6-segmentation", "TSO6" },
+    { "tx-generic-segmentation", "GSO" },
+    { "rx-gro", "GRO" },
+    { "rx-lro", "LRO" },
+    { "rx-hashing", "RSS 哈希" },
+};
+#define NIC_FEATURE_COUNT ((int)(sizeof(nic_feature_list) / sizeof(nic_feature_list[0])))
+
+// 两个预设都打开的卸载特性（TSO 依赖 SG）
+static const char *nic_offload_features[] = {
+    "tx-scatter-gather", "tx-tcp-segmentation", "tx-tcp6-segmentation", "tx-generic-segmentation", "rx-gro"
+};
+
+// SIOCETHTOOL 调用，保留 errno 供调用方区分“不支持”
+static int ethtool_ioctl(const char *ifname, void *data) {
+    struct ifreq ifr;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    ifr.ifr_data = data;
+    int rc = ioctl(fd, SIOCETHTOOL, &ifr);
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return rc;
+}
+
+static const char *ethtool_error() {
+    return (errno == EOPNOTSUPP || errno == EINVAL) ? "驱动不支持" : strerror(errno);
+}
+
+// 特性名表和状态块
+typedef struct {
+    int count;
+    char (*names)[ETH_GSTRING_LEN];
+    struct ethtool_gfeatures *state;
+} NicFeatures;
+
+static void nic_features_free(NicFeatures *nf) {
+    free(nf->names);
+    free(nf->state);
+    memset(nf, 0, sizeof(*nf));
+}
+
+static int nic_features_load(const char *ifname, NicFeatures *nf) {
+    memset(nf, 0, sizeof(*nf));
+    struct {
+        struct ethtool_sset_info hdr;
+        __u32 count;
+    } sset;
+    memset(&sset, 0, sizeof(sset));
+    sset.hdr.cmd = ETHTOOL_GSSET_INFO;
+    sset.hdr.sset_mask = 1ULL << ETH_SS_FEATURES;
+    if (ethtool_ioctl(ifname, &sset) != 0 || !(sset.hdr.sset_mask & (1ULL << ETH_SS_FEATURES)))
+        return -1;
+    nf->count = (int)sset.count;
+
+    struct ethtool_gstrings *strings = calloc(1, sizeof(*strings) + (size_t)nf->count * ETH_GSTRING_LEN);
+    int blocks = (nf->count + 31) / 32;
+    nf->state = calloc(1, sizeof(*nf->state) + (size_t)blocks * sizeof(nf->state->features[0]));
+    if (!strings || !nf->state) {
+        free(strings);
+        nic_features_free(nf);
+        return -1;
+    }
+    strings->cmd = ETHTOOL_GSTRINGS;
+    strings->string_set = ETH_SS_FEATURES;
+    strings->len = (__u32)nf->count;
+    nf->state->cmd = ETHTOOL_GFEATURES;
+    nf->state->size = (__u32)blocks;
+    if (ethtool_ioctl(ifname, strings) != 0 || ethtool_ioctl(ifname, nf->state) != 0) {
+        free(strings);
+        nic_features_free(nf);
+        return -1;
+    }
+    // 名称表单独保存，strings 结构本身可以释放
+    nf->names = malloc((size_t)nf->count * ETH_GSTRING_LEN);
+    if (nf->names) memcpy(nf->names, strings->data, (size_t)nf->count * ETH_GSTRING_LEN);
+    free(strings);
+    if (!nf->names) {
+        nic_features_free(nf);
+        return -1;
+    }
+    return 0;
+}
+
+static int nic_feature_index(const NicFeatures *nf, const char *name) {
+    int i;
+    for (i = 0; i < nf->count; i++)
+        if (!strncmp(nf->names[i], name, ETH_GSTRING_LEN)) return i;
+    return -1;
+}
+
+// 返回 1 开启、0 关闭、-1 不存在；fixed 为 1 表示驱动不允许修改
+static int nic_feature_active(const NicFeatures *nf, int idx, int *fixed) {
+    if (idx < 0) return -1;
+    const struct ethtool_get_features_block *b = &nf->state->features[idx / 32];
+    __u32 bit = 1U << (idx % 32);
+    *fixed = !(b->available & bit) || (b->never_changed & bit);
+    return (b->active & bit) ? 1 : 0;
+}
+
+// 网卡当前值与上限
+void nic_show(const char *ifname) {
+    struct ethtool_ringparam ring = { .cmd = ETHTOOL_GRINGPARAM };
+    struct ethtool_channels ch = { .cmd = ETHTOOL_GCHANNELS };
+    struct ethtool_coalesce co = { .cmd = ETHTOOL_GCOALESCE };
+    NicFeatures nf;
+    int i;
+
+    printf("========== 网卡 %s ==========\n", ifname);
+    if (ethtool_ioctl(ifname, &ring) == 0)
+        printf("  环形缓冲区  rx %u/%u   tx %u/%u（当前/最大）\n",
+               ring.rx_pending, ring.rx_max_pending, ring.tx_pending, ring.tx_max_pending);
+    else
+        printf("  环形缓冲区  %s\n", ethtool_error());
+
+    if (ethtool_ioctl(ifname, &ch) == 0)
+        printf("  队列        combined %u/%u   rx %u/%u   tx %u/%u（当前/最大）\n",
+               ch.combined_count, ch.max_combined, ch.rx_count, ch.max_rx, ch.tx_count, ch.max_tx);
+    else
+        printf("  队列        %s\n", ethtool_error());
+
+    if (ethtool_ioctl(ifname, &co) == 0)
+        printf("  中断合并    rx-usecs %u  rx-frames %u  tx-usecs %u  自适应 rx %s / tx %s\n",
+               co.rx_coalesce_usecs, co.rx_max_coalesced_frames, co.tx_coalesce_usecs,
+               co.use_adaptive_rx_coalesce ? "开" : "关", co.use_adaptive_tx_coalesce ? "开" : "关");
+    else
+        printf("  中断合并    %s\n", ethtool_error());
+
+    if (nic_features_load(ifname, &nf) == 0) {
+        printf("  卸载特性   ");
+        for (i = 0; i < NIC_FEATURE_COUNT; i++) {
+            int fixed;
+            int on = nic_feature_active(&nf, nic_feature_index(&nf, nic_feature_list[i].name), &fixed);
+            if (on < 0) continue;
+            printf(" %s:%s%s", nic_feature_list[i].label, on ? "开" : "关", fixed ? "(固定)" : "");
+        }
+        printf("\n");
+        nic_features_free(&nf);
+    } else {
+        printf("  卸载特性    %s\n", ethtool_error());
+    }
+}
+
+// 批量开关特性，返回实际生效后仍未达到要求的个数
+static int nic_set_features(const char *ifname, const char *const *names, int n, int on) {
+    NicFeatures nf;
+    int i, missing = 0;
+    if (nic_features_load(ifname, &nf) != 0) {
+        printf("  卸载特性    %s\n", ethtool_error());
+        return -1;
+    }
+    int blocks = (nf.count + 31) / 32;
+    struct ethtool_sfeatures *set = calloc(1, sizeof(*set) + (size_t)blocks * sizeof(set->features[0]));
+    if (!set) {
+        nic_features_free(&nf);
+        return -1;
+    }
+    set->cmd = ETHTOOL_SFEATURES;
+    set->size = (__u32)blocks;
+    for (i = 0; i < n; i++) {
+        int idx = nic_feature_index(&nf, names[i]), fixed;
+        if (idx < 0 || nic_feature_active(&nf, idx, &fixed) == on || fixed) continue;
+        set->features[idx / 32].valid |= 1U << (idx % 32);
+        if (on) set->features[idx / 32].requested |= 1U << (idx % 32);
+    }
+    if (ethtool_ioctl(ifname, set) < 0)
+        printf("  卸载特性    设置失败: %s\n", ethtool_error());
+    free(set);
+    nic_features_free(&nf);
+
+    // 重新读取，报告每个特性的最终状态（依赖关系可能让内核拒绝部分请求）
+    if (nic_features_load(ifname, &nf) != 0) return -1;
+    for (i = 0; i < n; i++) {
+        int fixed, idx = nic_feature_index(&nf, names[i]);
+        int state = nic_feature_active(&nf, idx, &fixed);
+        if (state < 0) continue;
+        if (state != on) missing++;
+        printf("  %-24s %s%s\n", names[i], state ? "开" : "关",
+               state != on ? (fixed ? "（驱动固定，无法修改）" : "（未生效）") : "");
+    }
+    nic_features_free(&nf);
+    return missing;
+}
+
+// 按预设调整一块网卡，每一步独立，驱动不支持的项跳过
+int nic_apply_preset(const char *ifname, int preset) {
+    struct ethtool_ringparam ring = { .cmd = ETHTOOL_GRINGPARAM };
+    struct ethtool_channels ch = { .cmd = ETHTOOL_GCHANNELS };
+    struct ethtool_coalesce co = { .cmd = ETHTOOL_GCOALESCE };
+    int failures = 0;
+
+    printf("对 %s 应用 %s 预设:\n", ifname, nic_preset_names[preset]);
+
+    // 吞吐预设把环形缓冲区开到最大，延迟预设保持原样（更大的队列意味着更长的排队）
+    if (preset == NIC_PRESET_THROUGHPUT) {
+        if (ethtool_ioctl(ifname, &ring) != 0) {
+            printf("  环形缓冲区  %s\n", ethtool_error());
+        } else if (ring.rx_pending == ring.rx_max_pending && ring.tx_pending == ring.tx_max_pending) {
+            printf("  环形缓冲区  已是最大 rx %u tx %u\n", ring.rx_pending, ring.tx_pending);
+        } else {
+            __u32 rx = ring.rx_pending, tx = ring.tx_pending;
+            ring.cmd = ETHTOOL_SRINGPARAM;
+            ring.rx_pending = ring.rx_max_pending;
+            ring.tx_pending = ring.tx_max_pending;
+            if (ethtool_ioctl(ifname, &ring) == 0) {
+                printf("  环形缓冲区  rx %u -> %u   tx %u -> %u\n", rx, ring.rx_pending, tx, ring.tx_pending);
+            } else {
+                printf("  环形缓冲区  设置失败: %s\n", ethtool_error());
+                failures++;
+            }
+        }
+    }
+
+    // 队列数开到 min(上限, 在线 CPU 数)，队列数有变化时把 RSS 间接表恢复为在所有队列间均分
+    if (ethtool_ioctl(ifname, &ch) != 0) {
+        printf("  队列        %s\n", ethtool_error());
+    } else {
+        __u32 cpus = (__u32)sysconf(_SC_NPROCESSORS_ONLN);
+        struct ethtool_channels want = ch;
+        want.cmd = ETHTOOL_SCHANNELS;
+        if (ch.max_combined) {
+            want.combined_count = ch.max_combined < cpus ? ch.max_combined : cpus;
+        } else {
+            want.rx_count = ch.max_rx < cpus ? ch.max_rx : cpus;
+            want.tx_count = ch.max_tx < cpus ? ch.max_tx : cpus;
+        }
+        if (want.combined_count == ch.combined_count && want.rx_count == ch.rx_count && want.tx_count == ch.tx_count) {
+            printf("  队列        已是 combined %u rx %u tx %u\n", ch.combined_count, ch.rx_count, ch.tx_count);
+        } else if (ethtool_ioctl(ifname, &want) == 0) {
+            printf("  队列        combined %u -> %u   rx %u -> %u   tx %u -> %u\n", ch.combined_count,
+                   want.combined_count, ch.rx_count, want.rx_count, ch.tx_count, want.tx_count);
+            // 只有队列数真正变化后才重置间接表，否则会抹掉运维手工配置的 RSS 分布
+            struct ethtool_rxfh_indir indir = { .cmd = ETHTOOL_SRXFHINDIR, .size = 0 };
+            if (ethtool_ioctl(ifname, &indir) == 0) {
+                printf("  RSS         间接表已恢复为均分到全部队列\n");
+            } else if (errno == EOPNOTSUPP) {
+                // 不支持设置间接表的驱动也不会有自定义的表，内核默认就是均分
+                printf("  RSS         驱动不支持设置间接表\n");
+            } else {
+                printf("  RSS         重置间接表失败: %s\n", ethtool_error());
+                failures++;
+            }
+        } else {
+            printf("  队列        设置失败: %s\n", ethtool_error());
+            failures++;
+        }
+    }
+
+    // 吞吐预设打开自适应合并；延迟预设关闭自适应并立即中断
+    if (ethtool_ioctl(ifname, &co) != 0) {
+        printf("  中断合并    %s\n", ethtool_error());
+    } else {
+        co.cmd = ETHTOOL_SCOALESCE;
+        if (preset == NIC_PRESET_THROUGHPUT) {
+            co.use_adaptive_rx_coalesce = 1;
+            co.use_adaptive_tx_coalesce = 1;
+        } else {
+            co.use_adaptive_rx_coalesce = 0;
+            co.use_adaptive_tx_coalesce = 0;
+            co.rx_coalesce_usecs = 0;
+            co.tx_coalesce_usecs = 0;
+            co.rx_max_coalesced_frames = 1;
+        }
+        if (ethtool_ioctl(ifname, &co) == 0) {
+            printf("  中断合并    自适应 %s，rx-usecs %u\n", co.use_adaptive_rx_coalesce ? "开" : "关",
+                   co.rx_coalesce_usecs);
+        } else if (errno == EOPNOTSUPP || errno == EINVAL) {
+            // 很多驱动只实现了部分参数，整体写入被拒绝时不算失败
+            printf("  中断合并    驱动不支持这些参数\n");
+        } else {
+            printf("  中断合并    设置失败: %s\n", strerror(errno));
+            failures++;
+        }
+    }
+
+    int missing = nic_set_features(ifname, nic_offload_features,
+                                   (int)(sizeof(nic_offload_features) / sizeof(nic_offload_features[0])), 1);
+    if (missing < 0) failures++;
+    return failures;
+}
+
+// 保存预设并安装开机时重新应用的 systemd 服务
+static void nic_persist(const char *ifname, int preset) {
+    char lines[32][64], line[64], name[IFNAMSIZ + 1], exe[512];
+    int n = 0, i;
+    FILE *fp = fopen(NIC_TUNING_FILE, "r");
+    if (fp) {
+        while (n < 32 && fgets(line, sizeof(line), fp)) {
+            if (sscanf(line, "%16s", name) == 1 && strcmp(name, ifname))
+                snprintf(lines[n++], sizeof(lines[0]), "%s", line);
+        }
+        fclose(fp);
+    }
+    if (mkdir_p("/etc/menu_project") != 0 || !(fp = fopen(NIC_TUNING_FILE, "w"))) {
+        perror("无法保存网卡调优配置");
+        return;
+    }
+    for (i = 0; i < n; i++) fputs(lines[i], fp);
+    fprintf(fp, "%s %s\n", ifname, nic_preset_names[preset]);
+    fclose(fp);
+    printf("已保存到 %s\n", NIC_TUNING_FILE);
+
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0 || access("/etc/systemd/system", W_OK) != 0) {
+        printf("未安装开机服务（没有 systemd），可在启动脚本中执行 <本程序> --apply-nic-tuning\n");
+        return;
+    }
+    exe[len] = '\0';
+    fp = fopen(NIC_TUNING_UNIT, "w");
+    if (!fp) {
+        perror("无法写入 systemd 服务");
+        return;
+    }
+    fprintf(fp, "[Unit]\nDescription=Apply menu_project NIC tuning\nAfter=network.target\n\n"
+                "[Service]\nType=oneshot\nExecStart=%s --apply-nic-tuning\n\n"
+                "[Install]\nWantedBy=multi-user.target\n", exe);
+    fclose(fp);
+    if (system("systemctl daemon-reload > /dev/null 2>&1 && "
+               "systemctl enable menu-project-nic-tuning.service > /dev/null 2>&1") == 0)
+        printf("已启用开机服务 menu-project-nic-tuning\n");
+    else
+        printf("已写入 %s，但未能启用，请手动执行 systemctl enable menu-project-nic-tuning\n", NIC_TUNING_UNIT);
+}
+
+// --apply-nic-tuning：按保存的配置重新应用，返回失败的网卡数
+int nic_apply_saved() {
+    FILE *fp = fopen(NIC_TUNING_FILE, "r");
+    char ifname[IFNAMSIZ + 1], preset[32];
+    int failed = 0, i;
+    if (!fp) return 0;
+    while (fscanf(fp, "%16s %31s", ifname, preset) == 2) {
+        for (i = 0; i < NIC_PRESET_COUNT && strcmp(preset, nic_preset_names[i]); i++) {}
+        if (i == NIC_PRESET_COUNT || nic_apply_preset(ifname, i) != 0) failed++;
+    }
+    fclose(fp);
+    return failed;
+}
+
+// 网卡调优界面；ifname 为 NULL 时先选择网卡
+void nic_tuning(const char *ifname) {
+    char ifnames[32][IFNAMSIZ];
+    if (!ifname) {
+        int n = get_all_ifnames(ifnames, 32), i, sel = 0;
+        if (n == 0) { printf("未检测到网卡！\n"); return; }
+        printf("请选择要调优的网卡：\n");
+        for (i = 0; i < n; ++i) printf("%d) %s\n", i + 1, ifnames[i]);
+        printf("输入序号: ");
+        scanf("%d", &sel);
+        if (sel < 1 || sel > n) { printf("无效选择！\n"); return; }
+        ifname = ifnames[sel - 1];
+    }
+    nic_show(ifname);
+    printf("1) 吞吐优先（环形缓冲区最大、全部队列、自适应中断合并、开启 GRO/GSO/TSO）\n");
+    printf("2) 延迟优先（全部队列、关闭中断合并、开启 GRO/GSO/TSO）\n");
+    printf("3) 返回\n");
+    char select;
+    printf("请选择一个选项: ");
+    scanf(" %c", &select);
+    if (select != '1' && select != '2') return;
+    int preset = select == '1' ? NIC_PRESET_THROUGHPUT : NIC_PRESET_LATENCY;
+    int failures = nic_apply_preset(ifname, preset);
+    printf("\n");
+    nic_show(ifname);
+    if (failures)
+        printf("有 %d 项设置失败\n", failures);
+
+    printf("是否保存并在开机时自动应用？(y/N): ");
+    scanf(" %c", &select);
+    if (select == 'y' || select == 'Y')
+        nic_persist(ifname, preset);
+}
+
+// 掩码长度转点分十进制
+void masklen_to_str(int masklen, char *out) {
+    unsigned int mask = masklen == 0 ? 0 : 0xFFFFFFFF << (32 - masklen);
+    sprintf(out, "%u.%u.%u.%u",
+        (mask >> 24) & 0xFF,
+        (mask >> 16) & 0xFF,
+        (mask >> 8) & 0xFF,
+        mask & 0xFF);
+}
+
+// 检查文件是否存在
+int file_exists(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp) { fclose(fp); return 1; }
+    return 0;
+}
+
+// 查找下一个可用的 IPADDRX 编号
+int find_next_ip_index(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int max_idx = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        int idx;
+        if (sscanf(line, "IPADDR%d=", &idx) == 1) {
+            if (idx > max_idx) max_idx = idx;
+        } else if (strncmp(line, "IPADDR=", 7) == 0 && max_idx == 0) {
+            max_idx = 0; // IPADDR= 视为0号
+        }
+    }
+    fclose(f);
+    return max_idx + 1;
+}
+
+// 实际添加IP到配置文件；gw 为 NULL 时新建配置文件需要交互询问网关，空字符串表示不设网关
+// 返回 0 已添加，1 已存在未修改，-1 失败
+int do_add_ip(const char *ifname, const char *ip, const char *mask, const char *gw_arg) {
+    // 检查 NetworkManager 是否 running
+    int is_nm_running = (system("systemctl is-active --quiet NetworkManager") == 0);
+    if (is_nm_running) {
+        // 优先用 nmcli 配置
+        char nmcli_cmd[512];
+        // 先查找对应网卡的 connection 名称
+        char con_name[128] = "";
+        char nmcli_query_cmd[256];
+        snprintf(nmcli_query_cmd, sizeof(nmcli_query_cmd), "nmcli -g GENERAL.CONNECTION device show %s 2>/dev/null", ifname);
+        FILE *con_fp = popen(nmcli_query_cmd, "r");
+        if (con_fp) {
+            if (fgets(con_name, sizeof(con_name), con_fp)) {
+                con_name[strcspn(con_name, "\n")] = '\0'; // 去除换行
+            }
+            pclose(con_fp);
+        }
+        if (strlen(con_name) == 0 || strcmp(con_name, "--") == 0) {
+            printf("未找到网卡 %s 的 NetworkManager 连接名，自动切换为配置文件方式。\n", ifname);
+            // 不 return，继续走后面配置文件逻辑
+        } else {
+            // 需要拼接 CIDR 掩码
+            int masklen = 0;
+            if (strchr(mask, '.')) {
+                // 点分十进制转掩码长度
+                unsigned int m1, m2, m3, m4;
+                if (sscanf(mask, "%u.%u.%u.%u", &m1, &m2, &m3, &m4) == 4) {
+                    int i;
+                    unsigned int mask32 = (m1 << 24) | (m2 << 16) | (m3 << 8) | m4;
+                    for (i = 31; i >= 0; --i) {
+                        if ((mask32 >> i) & 1) masklen++;
+                    }
+                }
+            } else if (mask[0] == '/' && atoi(mask+1) > 0) {
+                masklen = atoi(mask+1);
+            }
+            if (masklen <= 0 || masklen > 32) masklen = 24; // 默认
+            int len = snprintf(nmcli_cmd, sizeof(nmcli_cmd),
+                "nmcli connection modify '%s' +ipv4.addresses %s/%d",
+                con_name, ip, masklen);
+            if (gw_arg && gw_arg[0] && len > 0 && (size_t)len < sizeof(nmcli_cmd))
+                snprintf(nmcli_cmd + len, sizeof(nmcli_cmd) - len, " ipv4.gateway %s", gw_arg);
+            printf("检测到 NetworkManager 正在运行，推荐使用 nmcli 配置：\n%s\n", nmcli_cmd);
+            int ret = system(nmcli_cmd);
+            if (ret == 0) {
+                // 配置成功后激活连接
+                char up_cmd[256];
+                snprintf(up_cmd, sizeof(up_cmd), "nmcli connection up '%s' || ifup %s", con_name, ifname);
+                printf("正在激活连接: %s\n", up_cmd);
+                run_job("激活连接", up_cmd, NULL, NULL);
+                printf("IP 已通过 nmcli 添加并激活。\n");
+                return 0;
+            } else {
+                printf("nmcli 配置失败，建议用 'nmcli connection show' 查看所有连接名，并手动配置。\n");
+                // 失败时也继续走配置文件逻辑
+            }
+        }
+    }
+    // 检测系统类型
+    FILE *fp = fopen("/etc/os-release", "r");
+    char osid[64] = "", line[256];
+    if (fp) {
+        while (fgets(line, sizeof(line), fp)) {
+            if (strncmp(line, "ID=", 3) == 0) {
+                sscanf(line, "ID=%63s", osid);
+                // 去除引号
+                size_t len = strlen(osid);
+                if (osid[0] == '"' || osid[0] == '\'') memmove(osid, osid+1, len-1);
+                if (osid[strlen(osid)-1] == '"' || osid[strlen(osid)-1] == '\'') osid[strlen(osid)-1] = 0;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    // Ubuntu/Debian
+    if (strstr(osid, "ubuntu") || strstr(osid, "debian")) {
+        char path[256];
+        snprintf(path, sizeof(path), "/etc/network/interfaces.d/%s.cfg", ifname);
+        if (!file_exists(path)) {
+            // 若主 interfaces 存在但 interfaces.d 不存在，则写主文件
+            if (!file_exists("/etc/network/interfaces.d") && file_exists("/etc/network/interfaces")) {
+                strcpy(path, "/etc/network/interfaces");
+            }
+        }
+        // 检查IP是否已存在
+        int ip_exists = 0;
+        FILE *checkf = fopen(path, "r");
+        if (checkf) {
+            char linebuf[256];
+            while (fgets(linebuf, sizeof(linebuf), checkf)) {
+                if (strstr(linebuf, ip)) { ip_exists = 1; break; }
+            }
+            fclose(checkf);
+        }
+        if (ip_exists) {
+            printf("该IP %s 已存在于 %s ，不重复添加。\n", ip, path);
+            return 1;
+        }
+        FILE *f = fopen(path, "a");
+        if (!f) { printf("无法写入 %s\n", path); return -1; }
+        fprintf(f, "auto %s\niface %s inet static\n    address %s\n    netmask %s\n", ifname, ifname, ip, mask);
+        if (gw_arg && gw_arg[0]) fprintf(f, "    gateway %s\n", gw_arg);
+        fclose(f);
+        printf("已写入 %s\n", path);
+        // 配置文件方式直接重启network服务
+        printf("正在重启网络服务: systemctl restart network\n");
+        run_job("重启网络服务", "systemctl restart network", NULL, NULL);
+        return 0;
+    }
+    // CentOS/RHEL/Fedora
+    if (strstr(osid, "centos") || strstr(osid, "rhel") || strstr(osid, "fedora")) {
+        char path[256];
+        snprintf(path, sizeof(path), "/etc/sysconfig/network-scripts/ifcfg-%s", ifname);
+        int is_new_file = 0;
+        if (!file_exists(path)) {
+            snprintf(path, sizeof(path), "/etc/sysconfig/network-scripts/ifcfg-%s", ifname);
+            if (!file_exists(path)) {
+                is_new_file = 1;
+            }
+        }
+        // 检查IP是否已存在
+        int ip_exists = 0;
+        FILE *checkf = fopen(path, "r");
+        if (checkf) {
+            char linebuf[256];
+            while (fgets(linebuf, sizeof(linebuf), checkf)) {
+                if (strstr(linebuf, ip)) { ip_exists = 1; break; }
+            }
+            fclose(checkf);
+        }
+        if (ip_exists) {
+            printf("该IP %s 已存在于 %s ，不重复添加。\n", ip, path);
+            return 1;
+        }
+        int idx = file_exists(path) ? find_next_ip_index(path) : 0;
+        FILE *f = fopen(path, is_new_file ? "w" : "a");
+        if (!f) { printf("无法写入 %s\n", path); return -1; }
+        if (is_new_file) {
+            // 新建文件，写入完整配置
+            char gw[64] = "";
+            if (gw_arg) {
+                snprintf(gw, sizeof(gw), "%s", gw_arg);
+            } else {
+                printf("请输入网关地址（可直接回车跳过）：");
+                fgets(gw, sizeof(gw), stdin); // 先清空输入缓冲
+                if (gw[0] == '\0' || gw[0] == '\n') {
+                    // 可能上次scanf未清空，补一次
+                    fgets(gw, sizeof(gw), stdin);
+                }
+                gw[strcspn(gw, "\n")] = '\0';
+            }
+            // 校验网关格式
+            int gw_valid = 0;
+            if (gw[0]) {
+                struct in_addr gw_addr;
+                if (inet_pton(AF_INET, gw, &gw_addr) == 1) {
+                    gw_valid = 1;
+                } else {
+                    printf("网关格式无效，未写入GATEWAY字段！\n");
+                }
+            }
+            fprintf(f, "DEVICE=%s\nBOOTPROTO=static\nONBOOT=yes\nIPADDR=%s\nNETMASK=%s\n", ifname, ip, mask);
+            if (gw_valid) {
+                fprintf(f, "GATEWAY=%s\n", gw);
+            }
+        } else {
+            fprintf(f, "IPADDR%d=%s\nNETMASK%d=%s\n", idx, ip, idx, mask);
+        }
+        fclose(f);
+        printf("已写入 %s\n", path);
+        // 判断是否为 CentOS 6
+        int is_centos6 = 0;
+        FILE *rel = fopen("/etc/centos-release", "r");
+        if (rel) {
+            char relstr[128] = "";
+            if (fgets(relstr, sizeof(relstr), rel)) {
+                if (strstr(relstr, "release 6")) is_centos6 = 1;
+            }
+            fclose(rel);
+        }
+        if (is_centos6) {
+            printf("正在重启网络服务: service network restart\n");
+            run_job("重启网络服务", "service network restart", NULL, NULL);
+        } else {
+            printf("正在重启网络服务: systemctl restart network\n");
+            run_job("重启网络服务", "systemctl restart network", NULL, NULL);
+        }
+        return 0;
+    }
+    printf("暂不支持该系统自动写入配置，请手动配置。\n");
+    return -1;
+}
+
+// 新增IP交互
+void add_ip() {
+    char ifnames[32][IFNAMSIZ];
+    int n = get_all_ifnames(ifnames, 32);
+    if (n == 0) { printf("未检测到物理网卡！\n"); return; }
+    printf("请选择要添加IP的网卡：\n");
+    int i;
+    for (i = 0; i < n; ++i) printf("%d) %s\n", i+1, ifnames[i]);
+    int sel = 0;
+    printf("输入序号: ");
+    scanf("%d", &sel);
+    if (sel < 1 || sel > n) { printf("无效选择！\n"); return; }
+    printf("你选择的网卡是: %s\n", ifnames[sel-1]);
+    // 输入IP
+    char ip[64] = {0}, mask[64] = {0};
+    printf("请输入新IP地址 (支持 1.1.1.1/24 或 1.1.1.1): ");
+    scanf("%63s", ip);
+    char *slash = strchr(ip, '/');
+    if (slash) {
+        // 1.1.1.1/24
+        *slash = '\0';
+        int masklen = atoi(slash+1);
+        if (!is_valid_ip(ip) || masklen < 0 || masklen > 32) {
+            printf("IP或掩码格式错误！\n"); return;
+        }
+        masklen_to_str(masklen, mask);
+        printf("输入的IP: %s, 掩码: %s\n", ip, mask);
+    } else {
+        if (!is_valid_ip(ip)) { printf("IP格式错误！\n"); return; }
+        printf("请输入子网掩码 (如 255.255.255.0): ");
+        scanf("%63s", mask);
+        if (!is_valid_mask(mask)) { printf("掩码格式错误！\n"); return; }
+        printf("输入的IP: %s, 掩码: %s\n", ip, mask);
+    }
+    do_add_ip(ifnames[sel-1], ip, mask, NULL);
+
+    char tune;
+    printf("是否对 %s 进行网卡性能调优（环形缓冲区/队列/卸载特性）？(y/N): ", ifnames[sel-1]);
+    if (scanf(" %c", &tune) == 1 && (tune == 'y' || tune == 'Y'))
+        nic_tuning(ifnames[sel-1]);
+}
+
+// 从配置中删除 IP；返回 0 已删除，1 配置中没有该 IP，-1 失败
+int do_delete_ip(const char *ifname, const char *del_ip) {
+    // 检查 NetworkManager 是否 running
+    int is_nm_running = (system("systemctl is-active --quiet NetworkManager") == 0);
+    if (is_nm_running) {
+        // 查找 connection 名称
+        char con_name[128] = "";
+        char nmcli_query_cmd[256];
+        snprintf(nmcli_query_cmd, sizeof(nmcli_query_cmd), "nmcli -g GENERAL.CONNECTION device show %s 2>/dev/null", ifname);
+        FILE *con_fp = popen(nmcli_query_cmd, "r");
+        if (con_fp) {
+            if (fgets(con_name, sizeof(con_name), con_fp)) {
+                con_name[strcspn(con_name, "\n")] = '\0';
+            }
+            pclose(con_fp);
+        }
+        if (strlen(con_name) > 0 && strcmp(con_name, "--") != 0) {
+            // nmcli 删除IP
+            char nmcli_cmd[512];
+            snprintf(nmcli_cmd, sizeof(nmcli_cmd), "nmcli connection modify '%s' -ipv4.addresses %s", con_name, del_ip);
+            printf("检测到 NetworkManager 正在运行，推荐使用 nmcli 删除：\n%s\n", nmcli_cmd);
+            int ret = system(nmcli_cmd);
+            if (ret == 0) {
+                char up_cmd[256];
+                snprintf(up_cmd, sizeof(up_cmd), "nmcli connection up '%s' || ifup %s", con_name, ifname);
+                printf("正在激活连接: %s\n", up_cmd);
+                run_job("激活连接", up_cmd, NULL, NULL);
+                printf("IP 已通过 nmcli 删除并激活。\n");
+                return 0;
+            } else {
+                printf("nmcli 删除失败，建议用 'nmcli connection show' 查看所有连接名，并手动配置。\n");
+            }
+        } else {
+            printf("未找到网卡 %s 的 NetworkManager 连接名，自动切换为配置文件方式。\n", ifname);
+        }
+    }
+    // 检测系统类型
+    FILE *fp = fopen("/etc/os-release", "r");
+    char osid[64] = "", line[256];
+    if (fp) {
+        while (fgets(line, sizeof(line), fp)) {
+            if (strncmp(line, "ID=", 3) == 0) {
+                sscanf(line, "ID=%63s", osid);
+                size_t len = strlen(osid);
+                if (osid[0] == '"' || osid[0] == '\'') memmove(osid, osid+1, len-1);
+                if (osid[strlen(osid)-1] == '"' || osid[strlen(osid)-1] == '\'') osid[strlen(osid)-1] = 0;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    // Ubuntu/Debian
+    if (strstr(osid, "ubuntu") || strstr(osid, "debian")) {
+        char path[256];
+        snprintf(path, sizeof(path), "/etc/network/interfaces.d/%s.cfg", ifname);
+        if (!file_exists(path)) {
+            if (!file_exists("/etc/network/interfaces.d") && file_exists("/etc/network/interfaces")) {
+                strcpy(path, "/etc/network/interfaces");
+            }
+        }
+        // 读取原内容，过滤掉包含del_ip的address/netmask行
+        FILE *f = fopen(path, "r");
+        if (!f) { printf("无法打开 %s\n", path); return -1; }
+        char lines[1024][256];
+        int count = 0;
+        // int skip_next = 0;
+        for (; fgets(lines[count], sizeof(lines[count]), f) && count < 1024; count++) {}
+        fclose(f);
+        // 查找包含del_ip的行，并同时删除紧跟的netmask行
+        int i, removed = 0;
+        for (i = 0; i < count; ++i) {
+            if (strstr(lines[i], del_ip)) {
+                lines[i][0] = '\0';
+                removed++;
+                // 如果下一行是netmask，也删掉
+                if (i+1 < count && strstr(lines[i+1], "netmask")) lines[i+1][0] = '\0';
+            }
+        }
+        if (!removed) {
+            printf("%s 中没有IP %s\n", path, del_ip);
+            return 1;
+        }
+        // 重写文件
+        f = fopen(path, "w");
+        if (!f) { printf("无法写入 %s\n", path); return -1; }
+        for (i = 0; i < count; ++i) {
+            if (lines[i][0] != '\0') fprintf(f, "%s", lines[i]);
+        }
+        fclose(f);
+        printf("已从 %s 删除IP %s\n", path, del_ip);
+        printf("正在重启网络服务: systemctl restart network\n");
+        run_job("重启网络服务", "systemctl restart network", NULL, NULL);
+        return 0;
+    }
+    // CentOS/RHEL/Fedora
+    if (strstr(osid, "centos") || strstr(osid, "rhel") || strstr(osid, "fedora")) {
+        char path[256];
+        snprintf(path, sizeof(path), "/etc/sysconfig/network-scripts/ifcfg-%s", ifname);
+        if (!file_exists(path)) {
+            printf("配置文件 %s 不存在！\n", path);
+            return -1;
+        }
+        // 读取原内容，过滤掉包含del_ip的IPADDR/NETMASK行
+        FILE *f = fopen(path, "r");
+        if (!f) { printf("无法打开 %s\n", path); return -1; }
+        char lines[1024][256];
+        int count = 0;
+        for (; fgets(lines[count], sizeof(lines[count]), f) && count < 1024; count++) {}
+        fclose(f);
+        // 查找与del_ip相关的IPADDR/NETMASK行号
+        int i;
+        int to_delete[32] = {0};
+        int del_count = 0;
+        for (i = 0; i < count; ++i) {
+            if (strstr(lines[i], del_ip)) {
+                to_delete[del_count++] = i;
+                // 检查下一行/上一行是否是NETMASK
+                if (i+1 < count && strstr(lines[i+1], "NETMASK")) to_delete[del_count++] = i+1;
+                if (i-1 >= 0 && strstr(lines[i-1], "NETMASK")) to_delete[del_count++] = i-1;
+            }
+        }
+        if (!del_count) {
+            printf("%s 中没有IP %s\n", path, del_ip);
+            return 1;
+        }
+        // 重写文件
+        f = fopen(path, "w");
+        if (!f) { printf("无法写入 %s\n", path); return -1; }
+        for (i = 0; i < count; ++i) {
+            int skip = 0;
+            int j;
+            for (j = 0; j < del_count; ++j) if (i == to_delete[j]) { skip = 1; break; }
+            if (skip) continue;
+            fprintf(f, "%s", lines[i]);
+        }
+        fclose(f);
+        printf("已从 %s 删除IP %s\n", path, del_ip);
+        // 判断是否为 CentOS 6
+        int is_centos6 = 0;
+        FILE *rel = fopen("/etc/centos-release", "r");
+        if (rel) {
+            char relstr[128] = "";
+            if (fgets(relstr, sizeof(relstr), rel)) {
+                if (strstr(relstr, "release 6")) is_centos6 = 1;
+            }
+            fclose(rel);
+        }
+        if (is_centos6) {
+            printf("正在重启网络服务: service network restart\n");
+            run_job("重启网络服务", "service network restart", NULL, NULL);
+        } else {
+            printf("正在重启网络服务: systemctl restart network\n");
+            run_job("重启网络服务", "systemctl restart network", NULL, NULL);
+        }
+        return 0;
+    }
+    printf("暂不支持该系统自动删除配置，请手动处理。\n");
+    return -1;
+}
+
+void delete_ip() {
+    char ifnames[32][IFNAMSIZ];
+    int n = get_all_ifnames(ifnames, 32);
+    if (n == 0) { printf("未检测到物理网卡！\n"); return; }
+    int i;
+    for (i = 0; i < n; ++i) printf("%d) %s\n", i+1, ifnames[i]);
+    int sel;
+    printf("请输入需要删除IP的网卡: ");
+    scanf("%d", &sel);
+    if (sel < 1 || sel > n) { printf("无效选择！\n"); return; }
+    const char *ifname = ifnames[sel-1];
+    printf("你选择的网卡是: %s\n", ifname);
+
+    // 1. 获取该网卡所有IP
+    struct ifaddrs *ifaddr, *ifa;
+    char ips[16][64];
+    int ip_count = 0;
+    if (getifaddrs(&ifaddr) == -1) {
+        perror("getifaddrs");
+        return;
+    }
+    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL) continue;
+        if (ifa->ifa_addr->sa_family == AF_INET && strcmp(ifa->ifa_name, ifname) == 0) {
+            struct sockaddr_in *sa = (struct sockaddr_in *)ifa->ifa_addr;
+            strncpy(ips[ip_count], inet_ntoa(sa->sin_addr), 63);
+            ips[ip_count][63] = '\0';
+            ip_count++;
+        }
+    }
+    freeifaddrs(ifaddr);
+
+    if (ip_count == 0) {
+        printf("该网卡没有IP可删除！\n");
+        return;
+    }
+
+    // 2. 列出所有IP供选择
+    for (i = 0; i < ip_count; ++i) {
+        printf("%d) %s\n", i+1, ips[i]);
+    }
+    int ip_sel;
+    printf("请输入要删除的IP序号: ");
+    scanf("%d", &ip_sel);
+    if (ip_sel < 1 || ip_sel > ip_count) {
+        printf("无效选择！\n");
+        return;
+    }
+    const char *del_ip = ips[ip_sel-1];
+    printf("你选择删除的IP是: %s\n", del_ip);
+
+    // 3. 查找配置文件并删除对应IP和掩码
+    do_delete_ip(ifname, del_ip);
+}
+
+
+// 网卡IP信息列表功能
+// ==================== 中断分布与网卡中断均衡 ====================
+
+#define IRQ_SAMPLE_MS 1000
+#define IRQ_AFFINITY_BACKUP "/var/cache/menu_project/irq_affinity.bak"
+#define IRQ_MAX_CPUS 1024
+
+// 在另一份采样中找到同名中断（两次采样之间可能有设备增减）
+static int irq_find(const SiIrqTable *t, const char *name, int hint) {
+    int i;
+    if (hint < t->nirq && !strcmp(t->irqs[hint].name, name)) return hint;
+    for (i = 0; i < t->nirq; i++)
+        if (!strcmp(t->irqs[i].name, name)) return i;
+    return -1;
+}
+
+// 第 i 个中断在第 c 列上两次采样的差值
+static unsigned long long irq_delta(const SiIrqTable *before, const SiIrqTable *after, int i, int c) {
+    int j = irq_find(before, after->irqs[i].name, i);
+    unsigned long long now = after->counts[(size_t)i * after->ncpu + c];
+    if (j < 0 || c >= before->ncpu) return now;
+    unsigned long long then = before->counts[(size_t)j * before->ncpu + c];
+    return now >= then ? now - then : 0;
+}
+
+static unsigned long long softirq_delta(const SiIrqTable *before, const SiIrqTable *after, const char *name, int c) {
+    int a = si_softirq_index(after, name), b = si_softirq_index(before, name);
+    if (a < 0) return 0;
+    unsigned long long now = after->soft_counts[(size_t)a * after->ncpu + c];
+    if (b < 0 || c >= before->ncpu) return now;
+    unsigned long long then = before->soft_counts[(size_t)b * before->ncpu + c];
+    return now >= then ? now - then : 0;
+}
+
+static void irq_affinity(int irq, char *buf, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq);
+    if (si_read_line(path, buf, size) != 0) snprintf(buf, size, "?");
+}
+
+// 采样 1 秒，按 CPU 列出中断速率，并逐块网卡列出队列中断落在哪个 CPU 上
+void irq_report() {
+    SiIrqTable before, after;
+    int i, c;
+    if (si_probe_irqs(&before) != 0) {
+        perror("无法读取 /proc/interrupts");
+        return;
+    }
+    usleep(IRQ_SAMPLE_MS * 1000);
+    if (si_probe_irqs(&after) != 0) {
+        si_irq_free(&before);
+        perror("无法读取 /proc/interrupts");
+        return;
+    }
+
+    printf("========== 中断分布（采样 %d ms）==========\n", IRQ_SAMPLE_MS);
+    printf("   CPU    硬中断/s  网卡中断/s    NET_RX/s    NET_TX/s\n");
+    // 每个 CPU 三列：全部硬中断、网卡中断、网卡中断 + NET_RX（用于判断热点）
+    unsigned long long *rates = calloc((size_t)after.ncpu * 3, sizeof(*rates));
+    unsigned long long sum = 0;
+    for (c = 0; c < after.ncpu && rates; c++) {
+        for (i = 0; i < after.nirq; i++) {
+            if (after.irqs[i].irq < 0) continue;
+            unsigned long long d = irq_delta(&before, &after, i, c);
+            rates[c * 3] += d;
+            if (after.irqs[i].ifname[0]) rates[c * 3 + 1] += d;
+        }
+        rates[c * 3 + 2] = rates[c * 3 + 1] + softirq_delta(&before, &after, "NET_RX", c);
+        sum += rates[c * 3 + 2];
+    }
+    // 网卡负载超过平均值两倍的 CPU 视为热点
+    double mean = after.ncpu ? (double)sum / after.ncpu : 0;
+    for (c = 0; c < after.ncpu && rates; c++) {
+        unsigned long long load = rates[c * 3 + 2];
+        int hot = after.ncpu > 1 && load > 1000 && load > 2 * mean;
+        printf("  %4d  %10llu  %10llu  %10llu  %10llu%s\n", after.cpu_ids[c], rates[c * 3], rates[c * 3 + 1],
+               softirq_delta(&before, &after, "NET_RX", c), softirq_delta(&before, &after, "NET_TX", c),
+               hot ? "  \e[1;31m← 热点\e[0m" : "");
+    }
+    free(rates);
+
+    // 按网卡列出队列中断
+    char done[32][IFNAMSIZ];
+    int ndone = 0, k;
+    for (i = 0; i < after.nirq; i++) {
+        const char *ifname = after.irqs[i].ifname;
+        if (!ifname[0]) continue;
+        for (k = 0; k < ndone && strcmp(done[k], ifname); k++) {}
+        if (k < ndone || ndone == 32) continue;
+        snprintf(done[ndone++], IFNAMSIZ, "%s", ifname);
+
+        int cpus[IRQ_MAX_CPUS], node;
+        int ncpus = si_nic_cpus(ifname, cpus, IRQ_MAX_CPUS, &node);
+        printf("\n网卡 %s（NUMA 节点 %d，可用 CPU %d 个）\n", ifname, node, ncpus);
+        printf("     IRQ  队列    中断/s  主要 CPU  亲和性      动作\n");
+        int j;
+        for (j = i; j < after.nirq; j++) {
+            if (strcmp(after.irqs[j].ifname, ifname)) continue;
+            unsigned long long rate = 0, top = 0;
+            int top_cpu = -1;
+            for (c = 0; c < after.ncpu; c++) {
+                unsigned long long d = irq_delta(&before, &after, j, c);
+                rate += d;
+                if (d > top) {
+                    top = d;
+                    top_cpu = after.cpu_ids[c];
+                }
+            }
+            char aff[64], queue[8], main_cpu[8];
+            irq_affinity(after.irqs[j].irq, aff, sizeof(aff));
+            snprintf(queue, sizeof(queue), after.irqs[j].queue >= 0 ? "%d" : "-", after.irqs[j].queue);
+            snprintf(main_cpu, sizeof(main_cpu), top_cpu >= 0 ? "%d" : "-", top_cpu);
+            printf("    %4d  %4s  %8llu  %8s  %-10s  %s\n", after.irqs[j].irq, queue, rate, main_cpu, aff,
+                   after.irqs[j].desc);
+        }
+    }
+    if (!ndone) printf("\n未找到带 MSI 中断的网卡\n");
+
+    si_irq_free(&before);
+    si_irq_free(&after);
+}
+
+// 回滚文件中是否已记录该中断（只保留第一次修改前的原值）
+static int irq_backup_has(int irq) {
+    FILE *fp = fopen(IRQ_AFFINITY_BACKUP, "r");
+    int n, found = 0;
+    char list[256];
+    if (!fp) return 0;
+    while (fscanf(fp, "%d %255s", &n, list) == 2) {
+        if (n == irq) {
+            found = 1;
+            break;
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+static int irq_set_affinity(int irq, const char *list) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq);
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) return -1;
+    int ret = write_all(fd, list, strlen(list));
+    close(fd);
+    return ret;
+}
+
+// 把每块网卡的队列中断轮流分配到网卡所在 NUMA 节点的 CPU 上；dry_run 时只打印方案
+void irq_balance(int dry_run) {
+    SiIrqTable t;
+    int i, k;
+    if (si_probe_irqs(&t) != 0) {
+        perror("无法读取 /proc/interrupts");
+        return;
+    }
+    if (!dry_run && system("pidof irqbalance > /dev/null 2>&1") == 0)
+        printf("⚠️ irqbalance 正在运行，可能会覆盖这里的设置（可执行 systemctl stop irqbalance）\n");
+
+    FILE *backup = NULL;
+
+    char done[32][IFNAMSIZ];
+    int ndone = 0, changed = 0, failed = 0;
+    for (i = 0; i < t.nirq; i++) {
+        const char *ifname = t.irqs[i].ifname;
+        if (!ifname[0] || t.irqs[i].queue < 0) continue;
+        for (k = 0; k < ndone && strcmp(done[k], ifname); k++) {}
+        if (k < ndone || ndone == 32) continue;
+        snprintf(done[ndone++], IFNAMSIZ, "%s", ifname);
+
+        int cpus[IRQ_MAX_CPUS], node;
+        int ncpus = si_nic_cpus(ifname, cpus, IRQ_MAX_CPUS, &node);
+        if (ncpus <= 0) continue;
+        printf("网卡 %s：%d 个 CPU（NUMA 节点 %d）\n", ifname, ncpus, node);
+
+        // 队列中断按在 /proc/interrupts 中的顺序（即队列顺序）轮流分配
+        int j, slot = 0;
+        for (j = i; j < t.nirq; j++) {
+            if (strcmp(t.irqs[j].ifname, ifname) || t.irqs[j].queue < 0) continue;
+            char old[256], target[16];
+            irq_affinity(t.irqs[j].irq, old, sizeof(old));
+            snprintf(target, sizeof(target), "%d", cpus[slot++ % ncpus]);
+            int same = !strcmp(old, target);
+            printf("    IRQ %-5d %-24s %s -> %s%s\n", t.irqs[j].irq, t.irqs[j].desc, old, target,
+                   same ? "（不变）" : "");
+            if (dry_run || same) continue;
+            // 先记下原值再修改，写不了回滚文件就不动
+            if (!backup && (mkdir_p("/var/cache/menu_project") != 0
+                            || (backup = fopen(IRQ_AFFINITY_BACKUP, "a")) == NULL)) {
+                perror("        无法写入回滚文件，跳过");
+                failed++;
+                continue;
+            }
+            if (!irq_backup_has(t.irqs[j].irq)) {
+                fprintf(backup, "%d %s\n", t.irqs[j].irq, old);
+                fflush(backup);
+            }
+            if (irq_set_affinity(t.irqs[j].irq, target) == 0) {
+                changed++;
+            } else {
+                // 内核托管的中断（managed IRQ）不允许修改亲和性
+                printf("        设置失败: %s\n", strerror(errno));
+                failed++;
+            }
+        }
+    }
+    if (backup) fclose(backup);
+    si_irq_free(&t);
+
+    if (!ndone)
+        printf("未找到带队列中断的网卡\n");
+    else if (dry_run)
+        printf("以上为预览，未做修改\n");
+    else if (!changed && !failed)
+        printf("当前分布已符合方案，无需修改\n");
+    else
+        printf("已修改 %d 个中断，失败 %d 个；原设置保存在 %s\n", changed, failed, IRQ_AFFINITY_BACKUP);
+}
+
+// 按回滚文件恢复修改前的中断亲和性
+void irq_rollback() {
+    FILE *fp = fopen(IRQ_AFFINITY_BACKUP, "r");
+    int irq, restored = 0, failed = 0;
+    char list[256];
+    if (!fp) {
+        printf("没有可回滚的记录\n");
+        return;
+    }
+    while (fscanf(fp, "%d %255s", &irq, list) == 2) {
+        if (irq_set_affinity(irq, list) == 0) {
+            printf("    IRQ %-5d 恢复为 %s\n", irq, list);
+            restored++;
+        } else {
+            printf("    IRQ %-5d 恢复失败: %s\n", irq, strerror(errno));
+            failed++;
+        }
+    }
+    fclose(fp);
+    if (!failed) unlink(IRQ_AFFINITY_BACKUP);
+    printf("已恢复 %d 个中断%s\n", restored, failed ? "，部分失败，回滚文件已保留" : "");
+}
+
+// 中断分布子菜单
+void irq_menu() {
+    irq_report();
+    printf("\n======== 网卡中断均衡 ========\n");
+    printf("1) 预览均衡方案\n2) 应用均衡\n3) 回滚\n4) 返回\n");
+    char select;
+    printf("请选择一个选项: ");
+    scanf(" %c", &select);
+    switch (select) {
+        case '1':
+            irq_balance(1);
+            break;
+        case '2':
+            irq_balance(0);
+            break;
+        case '3':
+            irq_rollback();
+            break;
+        default:
+            break;
+    }
+}
+
+// TCP 连接状态统计（sock_diag 直接向内核查询，百万连接也不用解析 /proc/net/tcp）
+void connection_summary() {
+    static SiSockScan scan;
+    int i;
+    printf("========== TCP 连接统计 ==========\n");
+    if (si_scan_sockets(&scan, SI_SOCK_ALL_STATES) != 0) {
+        perror("sock_diag 查询失败");
+        return;
+    }
+    printf("共 %u 个连接，耗时 %.1f ms\n", scan.total, scan.elapsed_ms);
+    for (i = 1; i < SI_TCP_STATES; i++) {
+        if (scan.states[i])
+            printf("    %-12s %8u\n", si_tcp_state_name(i), scan.states[i]);
+    }
+    printf("    孤儿连接     %8u\n", scan.orphans);
+
+    if (scan.listener_count) {
+        printf("监听端口（共 %u 个，按全连接队列排序）:\n", scan.listen_total);
+        for (i = 0; i < scan.listener_count; i++) {
+            const SiListener *l = &scan.listeners[i];
+            char addr[INET6_ADDRSTRLEN + 8];
+            snprintf(addr, sizeof(addr), l->family == AF_INET6 ? "[%s]:%d" : "%s:%d", l->addr, l->port);
+            printf("    %-32s 队列 %u / %u%s\n", addr, l->rqueue, l->backlog,
+                   l->rqueue >= l->backlog ? "  ← 队列已满" : "");
+        }
+    }
+
+    int ports[SI_SOCK_TOP];
+    unsigned int counts[SI_SOCK_TOP];
+    int n = si_sock_top_ports(&scan, ports, counts, SI_SOCK_TOP);
+    if (n) {
+        printf("本地端口连接数:\n");
+        for (i = 0; i < n; i++)
+            printf("    %-8d %8u\n", ports[i], counts[i]);
+    }
+
+    SiRemoteBucket remotes[SI_SOCK_TOP];
+    n = si_sock_top_remotes(&scan, remotes, SI_SOCK_TOP);
+    if (n) {
+        printf("远端网段连接数:\n");
+        for (i = 0; i < n; i++) {
+            char net[INET6_ADDRSTRLEN + 8];
+            si_sock_remote_str(remotes[i].key, net, sizeof(net));
+            printf("    %-32s %8u\n", net, remotes[i].count);
+        }
+        if (scan.remote_overflow)
+            printf("    （另有 %u 个连接的网段超出统计表容量）\n", scan.remote_overflow);
+    }
+}
+
+// 获取默认网关，没有时为空字符串（netlink 转储路由表，全量路由的设备上也不经过 ip route 文本）
+void default_gateway(char *gw, size_t size) {
+    static SiRouteScan scan;
+    gw[0] = '\0';
+    if (si_scan_routes(&scan, AF_INET) == 0)
+        si_default_gateway(&scan, gw, size);
+}
+
+static void print_route_nexthops(const SiRoute *r) {
+    int i;
+    for (i = 0; i < r->nhop_count; i++) {
+        const SiNextHop *nh = &r->nhops[i];
+        printf("        via %-24s dev %-10s", nh->gateway[0] ? nh->gateway : "（直连）", nh->ifname);
+        if (r->nhop_count > 1) printf(" 权重 %d", nh->weight);
+        printf("\n");
+    }
+}
+
+// 路由表概览：默认路由（含 ECMP）、各表路由条数，可查询某个目的地址命中的路由
+void route_summary() {
+    static SiRouteScan scan;
+    char name[16], dst[INET6_ADDRSTRLEN];
+    int i;
+    printf("========== 路由表概览 ==========\n");
+    if (si_scan_routes(&scan, AF_UNSPEC) != 0) {
+        perror("路由表查询失败");
+        return;
+    }
+    printf("共 %lu 条路由，耗时 %.1f ms%s\n", scan.total, scan.elapsed_ms,
+           scan.interrupted ? "（转储期间路由有变化，计数可能不精确）" : "");
+    printf("%-10s %12s %12s\n", "路由表", "IPv4", "IPv6");
+    for (i = 0; i < scan.table_count; i++) {
+        const SiRouteTable *t = &scan.tables[i];
+        printf("%-10s %12lu %12lu\n", si_route_table_name(t->table, name, sizeof(name)), t->v4, t->v6);
+    }
+    if (scan.table_overflow)
+        printf("（另有 %lu 条路由所在的表超出统计容量）\n", scan.table_overflow);
+
+    printf("默认路由:\n");
+    if (!scan.default_count) printf("    无\n");
+    for (i = 0; i < scan.default_count; i++) {
+        const SiRoute *r = &scan.defaults[i];
+        printf("    %s 表 %s metric %u 来源 %s%s\n", r->family == AF_INET ? "IPv4" : "IPv6",
+               si_route_table_name(r->table, name, sizeof(name)), r->metric,
+               si_route_protocol_name(r->protocol), r->nhop_count > 1 ? "（ECMP）" : "");
+        print_route_nexthops(r);
+    }
+
+    // 丢掉选择菜单时 scanf 留下的换行，再读一整行
+    int ch;
+    while ((ch = getchar()) != '\n' && ch != EOF) {}
+    printf("输入要查询的目的地址（直接回车跳过）: ");
+    fflush(stdout);
+    if (!fgets(dst, sizeof(dst), stdin)) return;
+    dst[strcspn(dst, " \r\n")] = '\0';
+    if (!dst[0]) return;
+    SiRoute matched;
+    SiNextHop via;
+    if (si_route_lookup(dst, &matched, &via) != 0) {
+        printf("查询失败: %s\n", strerror(errno));
+        return;
+    }
+    printf("%s 命中 %s/%d 表 %s metric %u 源地址 %s\n", dst, matched.dst[0] ? matched.dst : "default",
+           matched.dst_len, si_route_table_name(matched.table, name, sizeof(name)), matched.metric,
+           matched.prefsrc[0] ? matched.prefsrc : "-");
+    print_route_nexthops(&matched);
+    if (matched.nhop_count > 1)
+        printf("    本地址选中: via %s dev %s\n", via.gateway[0] ? via.gateway : "（直连）", via.ifname);
+}
+
+// ==================== 网络栈吞吐自测 ====================
+
+// 在本机起若干对收发线程，对比普通 send/recv、sendfile/splice 和 MSG_ZEROCOPY 的吞吐与 CPU 开销，
+// 用来检查 sysctl、网卡调优前后内核网络路径的变化。veth 模式把接收端放进临时网络命名空间，
+// 数据经过完整的 veth 收发路径，而不是回环的捷径
+#define NET_TCP_CHUNK (128 * 1024)
+#define NET_UDP_PAYLOAD 1472                  // 1500 MTU 下不分片的最大 UDP 负载
+#define NET_FILE_SIZE (16 << 20)              // sendfile 的源文件
+#define NET_MAX_PAIRS 64
+#define NET_VETH_HOST "mpbench0"
+#define NET_VETH_PEER "mpbench1"
+#define NET_VETH_HOST_IP "10.213.0.1"
+#define NET_VETH_PEER_IP "10.213.0.2"
+
+// 读一行输入，直接回车时保留 buf 中的默认值
+static void prompt_default(const char *prompt, char *buf, size_t size) {
+    char line[256];
+    printf("%s [%s]: ", prompt, buf);
+    fflush(stdout);
+    if (!fgets(line, sizeof(line), stdin)) return;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0]) snprintf(buf, size, "%s", line);
+}
+
+enum { NET_PLAIN, NET_SENDFILE, NET_ZEROCOPY };
+static const char *net_mode_names[] = { "send/recv", "sendfile/splice", "MSG_ZEROCOPY" };
+
+typedef struct {
+    int udp;
+    int mode;
+    int send_fd;
+    int recv_fd;
+    int file_fd;                              // sendfile 的源文件
+    double deadline;
+    unsigned long long sent_bytes, sent_msgs;
+    unsigned long long recv_bytes, recv_msgs;
+    unsigned long long zc_done, zc_copied;    // 零拷贝完成通知，以及其中内核退回复制的次数
+    int error;
+} NetPair;
+
+typedef struct {
+    int ns_fd;                                // 接收端所在的网络命名空间，回环模式为 -1
+    int host_fd;                              // 本线程原来的命名空间
+    const char *recv_ip;
+} NetTarget;
+
+// ---------- veth 与网络命名空间（rtnetlink） ----------
+
+typedef struct {
+    struct nlmsghdr nlh;
+    char buf[1024];
+} NetLinkReq;
+
+static struct rtattr *nl_attr(NetLinkReq *req, int type, const void *data, size_t len) {
+    struct rtattr *a = (struct rtattr *)((char *)req + NLMSG_ALIGN(req->nlh.nlmsg_len));
+    a->rta_type = (unsigned short)type;
+    a->rta_len = (unsigned short)RTA_LENGTH(len);
+    if (len) memcpy(RTA_DATA(a), data, len);
+    req->nlh.nlmsg_len = NLMSG_ALIGN(req->nlh.nlmsg_len) + RTA_ALIGN(a->rta_len);
+    return a;
+}
+
+// 嵌套属性：先放一个空属性，子属性写完后用 nl_nest_end 修正长度
+static void nl_nest_end(NetLinkReq *req, struct rtattr *nest) {
+    nest->rta_len = (unsigned short)((char *)req + req->nlh.nlmsg_len - (char *)nest);
+}
+
+// 发送请求并等待内核确认，失败时 errno 为内核返回的错误
+static int nl_talk(NetLinkReq *req) {
+    struct sockaddr_nl nladdr;
+    long buf[1024];
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return -1;
+    memset(&nladdr, 0, sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+    req->nlh.nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+    if (sendto(fd, req, req->nlh.nlmsg_len, 0, (struct sockaddr *)&nladdr, sizeof(nladdr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    for (;;) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0 && errno == EINTR) continue;
+        if (len < 0) break;
+        struct nlmsghdr *h = (struct nlmsghdr *)buf;
+        for (; NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_type != NLMSG_ERROR) continue;
+            struct nlmsgerr *err = NLMSG_DATA(h);
+            close(fd);
+            errno = -err->error;
+            return err->error ? -1 : 0;
+        }
+    }
+    close(fd);
+    return -1;
+}
+
+static void nl_link_req(NetLinkReq *req, int type, int flags, int ifindex) {
+    memset(req, 0, sizeof(*req));
+    req->nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    req->nlh.nlmsg_type = (unsigned short)type;
+    req->nlh.nlmsg_flags = (unsigned short)flags;
+    struct ifinfomsg *ifi = NLMSG_DATA(&req->nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_index = ifindex;
+}
+
+// 创建 veth 对，对端直接放进 ns_fd 指向的命名空间
+static int net_veth_create(int ns_fd) {
+    NetLinkReq req;
+    struct ifinfomsg peer;
+    unsigned int fd = (unsigned int)ns_fd;
+    nl_link_req(&req, RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL, 0);
+    nl_attr(&req, IFLA_IFNAME, NET_VETH_HOST, strlen(NET_VETH_HOST) + 1);
+    struct rtattr *info = nl_attr(&req, IFLA_LINKINFO, NULL, 0);
+    nl_attr(&req, IFLA_INFO_KIND, "veth", 4);
+    struct rtattr *data = nl_attr(&req, IFLA_INFO_DATA, NULL, 0);
+    // VETH_INFO_PEER 的内容是一个 ifinfomsg 加上对端自己的属性
+    memset(&peer, 0, sizeof(peer));
+    struct rtattr *pa = nl_attr(&req, VETH_INFO_PEER, &peer, sizeof(peer));
+    nl_attr(&req, IFLA_IFNAME, NET_VETH_PEER, strlen(NET_VETH_PEER) + 1);
+    nl_attr(&req, IFLA_NET_NS_FD, &fd, sizeof(fd));
+    nl_nest_end(&req, pa);
+    nl_nest_end(&req, data);
+    nl_nest_end(&req, info);
+    return nl_talk(&req);
+}
+
+static int net_link_up(const char *ifname) {
+    NetLinkReq req;
+    int index = (int)if_nametoindex(ifname);
+    if (!index) return -1;
+    nl_link_req(&req, RTM_NEWLINK, 0, index);
+    struct ifinfomsg *ifi = NLMSG_DATA(&req.nlh);
+    ifi->ifi_flags = IFF_UP;
+    ifi->ifi_change = IFF_UP;
+    return nl_talk(&req);
+}
+
+static int net_link_delete(const char *ifname) {
+    NetLinkReq req;
+    int index = (int)if_nametoindex(ifname);
+    if (!index) return -1;
+    nl_link_req(&req, RTM_DELLINK, 0, index);
+    return nl_talk(&req);
+}
+
+static int net_addr_add(const char *ifname, const char *ip, int prefix) {
+    NetLinkReq req;
+    struct in_addr addr;
+    int index = (int)if_nametoindex(ifname);
+    if (!index || inet_pton(AF_INET, ip, &addr) != 1) return -1;
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    req.nlh.nlmsg_type = RTM_NEWADDR;
+    req.nlh.nlmsg_flags = NLM_F_CREATE | NLM_F_EXCL;
+    struct ifaddrmsg *ifa = NLMSG_DATA(&req.nlh);
+    ifa->ifa_family = AF_INET;
+    ifa->ifa_prefixlen = (unsigned char)prefix;
+    ifa->ifa_index = (unsigned int)index;
+    nl_attr(&req, IFA_LOCAL, &addr, sizeof(addr));
+    nl_attr(&req, IFA_ADDRESS, &addr, sizeof(addr));
+    return nl_talk(&req);
+}
+
+static int net_setns(int fd) {
+    return (int)syscall(SYS_setns, fd, CLONE_NEWNET);
+}
+
+// 网络命名空间按线程生效：主线程进入新命名空间拿到它的 fd 后立即切回，之后只在建接收端套接字时短暂进入
+static int net_target_open(NetTarget *t, int veth) {
+    t->ns_fd = t->host_fd = -1;
+    t->recv_ip = "127.0.0.1";
+    if (!veth) return 0;
+    t->host_fd = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    if (t->host_fd < 0) return -1;
+    if (syscall(SYS_unshare, CLONE_NEWNET) != 0) goto fail;
+    t->ns_fd = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    if (net_setns(t->host_fd) != 0) {
+        printf("无法切回原网络命名空间: %s\n", strerror(errno));
+        exit(1);
+    }
+    if (t->ns_fd < 0) goto fail;
+    if (net_veth_create(t->ns_fd) != 0 || net_addr_add(NET_VETH_HOST, NET_VETH_HOST_IP, 30) != 0
+        || net_link_up(NET_VETH_HOST) != 0)
+        goto fail;
+    if (net_setns(t->ns_fd) != 0) goto fail;
+    int rc = net_addr_add(NET_VETH_PEER, NET_VETH_PEER_IP, 30) == 0 && net_link_up(NET_VETH_PEER) == 0
+             && net_link_up("lo") == 0 ? 0 : -1;
+    int saved = errno;
+    if (net_setns(t->host_fd) != 0) exit(1);
+    errno = saved;
+    if (rc != 0) goto fail;
+    t->recv_ip = NET_VETH_PEER_IP;
+    return 0;
+fail:
+    {
+        int saved_errno = errno;
+        net_link_delete(NET_VETH_HOST);
+        if (t->ns_fd >= 0) close(t->ns_fd);
+        if (t->host_fd >= 0) close(t->host_fd);
+        t->ns_fd = t->host_fd = -1;
+        errno = saved_errno;
+    }
+    return -1;
+}
+
+// 删除 veth 一端即同时删除对端；关闭最后一个 fd 后命名空间被内核回收
+static void net_target_close(NetTarget *t) {
+    if (t->ns_fd < 0) return;
+    net_link_delete(NET_VETH_HOST);
+    close(t->ns_fd);
+    close(t->host_fd);
+}
+
+// ---------- 收发线程 ----------
+
+// 读取零拷贝完成通知（错误队列），wait_ms > 0 时等到全部发送都有通知或超时
+static void net_zc_drain(NetPair *p, int wait_ms) {
+    char control[256];
+    double until = now_ms() + wait_ms;
+    for (;;) {
+        struct msghdr msg;
+        struct cmsghdr *cm;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(p->send_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (wait_ms <= 0 || p->zc_done >= p->sent_msgs || now_ms() >= until) return;
+            struct pollfd pfd = { p->send_fd, 0, 0 };
+            poll(&pfd, 1, 10);
+            continue;
+        }
+        for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)) continue;
+            struct sock_extended_err *ee = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (ee->ee_errno || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            // 通知按区间合并：[ee_info, ee_data] 内的发送都已完成
+            unsigned long long n = (unsigned long long)(ee->ee_data - ee->ee_info) + 1;
+            p->zc_done += n;
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) p->zc_copied += n;
+        }
+    }
+}
+
+static void *net_sender(void *arg) {
+    NetPair *p = arg;
+    static char buf[NET_TCP_CHUNK];
+    size_t len = p->udp ? NET_UDP_PAYLOAD : NET_TCP_CHUNK;
+    off_t off = 0;
+    int flags = MSG_NOSIGNAL | (p->mode == NET_ZEROCOPY ? MSG_ZEROCOPY : 0);
+    while (now_ms() < p->deadline) {
+        ssize_t n;
+        if (p->mode == NET_SENDFILE) {
+            if (off >= NET_FILE_SIZE) off = 0;
+            n = sendfile(p->send_fd, p->file_fd, &off, len);
+        } else {
+            n = send(p->send_fd, buf, len, flags);
+        }
+        if (n < 0) {
+            // 零拷贝通知积压超过 optmem 限制时返回 ENOBUFS，先收通知再继续
+            if (errno == ENOBUFS && p->mode == NET_ZEROCOPY) {
+                net_zc_drain(p, 0);
+                continue;
+            }
+            // UDP 接收端来不及处理时的 ICMP 错误不算失败
+            if (errno == EINTR || (p->udp && errno == ECONNREFUSED)) continue;
+            p->error = errno;
+            break;
+        }
+        p->sent_bytes += (unsigned long long)n;
+        p->sent_msgs++;
+        if (p->mode == NET_ZEROCOPY && (p->sent_msgs & 63) == 0) net_zc_drain(p, 0);
+    }
+    if (p->mode == NET_ZEROCOPY) net_zc_drain(p, 500);
+    if (!p->udp) shutdown(p->send_fd, SHUT_WR);
+    return NULL;
+}
+
+static void *net_receiver(void *arg) {
+    NetPair *p = arg;
+    size_t cap = 256 * 1024;
+    char *buf = malloc(cap);
+    int pipefd[2] = { -1, -1 }, devnull = -1;
+    if (!buf) {
+        p->error = ENOMEM;
+        return NULL;
+    }
+    if (p->mode == NET_SENDFILE && !p->udp) {
+        if (pipe(pipefd) != 0 || (devnull = open("/dev/null", O_WRONLY | O_CLOEXEC)) < 0) {
+            p->error = errno;
+            free(buf);
+            return NULL;
+        }
+    }
+    for (;;) {
+        ssize_t n;
+        if (devnull >= 0) {
+            // 套接字 -> 管道 -> /dev/null，数据页不复制到用户态
+            n = syscall(SYS_splice, p->recv_fd, NULL, pipefd[1], NULL, (size_t)NET_TCP_CHUNK, 1);
+            if (n > 0 && syscall(SYS_splice, pipefd[0], NULL, devnull, NULL, (size_t)n, 1) != n) n = -1;
+        } else {
+            n = recv(p->recv_fd, buf, cap, 0);
+        }
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // UDP 没有结束标志，超过截止时间后收不到数据即结束
+            if (p->udp && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (now_ms() >= p->deadline) break;
+                continue;
+            }
+            p->error = errno;
+            break;
+        }
+        p->recv_bytes += (unsigned long long)n;
+        p->recv_msgs++;
+    }
+    if (devnull >= 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        close(devnull);
+    }
+    free(buf);
+    return NULL;
+}
+
+// 建立一对已连接的套接字；接收端在目标命名空间里创建
+static int net_pair_open(NetPair *p, const NetTarget *t, int listen_fd) {
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    int type = p->udp ? SOCK_DGRAM : SOCK_STREAM, one = 1;
+    p->send_fd = p->recv_fd = -1;
+    if (p->udp) {
+        int size = 8 << 20;
+        if (t->ns_fd >= 0 && net_setns(t->ns_fd) != 0) return -1;
+        p->recv_fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+        if (t->ns_fd >= 0 && net_setns(t->host_fd) != 0) exit(1);
+        if (p->recv_fd < 0) return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        inet_pton(AF_INET, t->recv_ip, &addr.sin_addr);
+        if (bind(p->recv_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) return -1;
+        setsockopt(p->recv_fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size));
+        struct timeval tv = { 0, 200000 };
+        setsockopt(p->recv_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    } else {
+        memset(&addr, 0, sizeof(addr));
+    }
+    if (getsockname(p->udp ? p->recv_fd : listen_fd, (struct sockaddr *)&addr, &alen) != 0) return -1;
+    p->send_fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+    if (p->send_fd < 0) return -1;
+    if (p->mode == NET_ZEROCOPY && setsockopt(p->send_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0)
+        return -1;
+    if (connect(p->send_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) return -1;
+    if (!p->udp) {
+        p->recv_fd = accept(listen_fd, NULL, NULL);
+        if (p->recv_fd < 0) return -1;
+    }
+    return 0;
+}
+
+// /proc/net/snmp 中 Tcp 或 Udp 的某个计数，表头行与数值行按列对应
+static long long net_snmp_counter(const char *proto, const char *name) {
+    FILE *fp = fopen("/proc/net/snmp", "r");
+    char head[1024], vals[1024], prefix[16];
+    long long result = -1;
+    if (!fp) return -1;
+    snprintf(prefix, sizeof(prefix), "%s:", proto);
+    while (fgets(head, sizeof(head), fp) && fgets(vals, sizeof(vals), fp)) {
+        if (strncmp(head, prefix, strlen(prefix))) continue;
+        char *hs = NULL, *vs = NULL, *h = strtok_r(head, " \n", &hs), *v = strtok_r(vals, " \n", &vs);
+        while (h && v) {
+            if (!strcmp(h, name)) {
+                result = atoll(v);
+                break;
+            }
+            h = strtok_r(NULL, " \n", &hs);
+            v = strtok_r(NULL, " \n", &vs);
+        }
+        break;
+    }
+    fclose(fp);
+    return result;
+}
+
+// 运行一项测试并打印一行结果
+static void net_run_case(const NetTarget *t, int udp, int mode, int pairs, int seconds, int file_fd) {
+    NetPair *p = calloc((size_t)pairs, sizeof(NetPair));
+    pthread_t *tids = calloc((size_t)pairs * 2, sizeof(pthread_t));
+    int *started = calloc((size_t)pairs * 2, sizeof(int));
+    int listen_fd = -1, i, ok = p && tids && started;
+    long long total0, idle0, total1, idle1;
+    // 中途失败时后面的对没有打开过，清理时不能把 calloc 留下的 0（标准输入）当成套接字关掉
+    for (i = 0; p && i < pairs; i++) p[i].send_fd = p[i].recv_fd = -1;
+    printf("%-4s %-16s %4d ", udp ? "UDP" : "TCP", net_mode_names[mode], pairs);
+    fflush(stdout);
+
+    if (ok && !udp) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        inet_pton(AF_INET, t->recv_ip, &addr.sin_addr);
+        if (t->ns_fd >= 0 && net_setns(t->ns_fd) != 0) ok = 0;
+        if (ok) listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (t->ns_fd >= 0 && net_setns(t->host_fd) != 0) exit(1);
+        ok = listen_fd >= 0 && bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0
+             && listen(listen_fd, pairs) == 0;
+    }
+    for (i = 0; ok && i < pairs; i++) {
+        p[i].udp = udp;
+        p[i].mode = mode;
+        p[i].file_fd = file_fd;
+        ok = net_pair_open(&p[i], t, listen_fd) == 0;
+    }
+    if (!ok) {
+        printf("不支持: %s\n", strerror(errno));
+    } else {
+        long long segs0 = udp ? 0 : net_snmp_counter("Tcp", "OutSegs");
+        si_cpu_ticks(&total0, &idle0);
+        double t0 = now_ms();
+        for (i = 0; i < pairs; i++) {
+            p[i].deadline = t0 + seconds * 1000.0;
+            started[2 * i] = pthread_create(&tids[2 * i], NULL, net_receiver, &p[i]) == 0;
+            started[2 * i + 1] = pthread_create(&tids[2 * i + 1], NULL, net_sender, &p[i]) == 0;
+            // 发送线程没起来时接收端收不到结束标志，关掉写端让它退出
+            if (!started[2 * i + 1]) shutdown(p[i].send_fd, SHUT_WR);
+        }
+        for (i = 0; i < pairs * 2; i++)
+            if (started[i]) pthread_join(tids[i], NULL);
+        double secs = (now_ms() - t0) / 1000.0;
+        si_cpu_ticks(&total1, &idle1);
+        long long segs1 = udp ? 0 : net_snmp_counter("Tcp", "OutSegs");
+
+        unsigned long long sent = 0, sent_msgs = 0, recv = 0, recv_msgs = 0, zc_done = 0, zc_copied = 0;
+        int error = 0;
+        for (i = 0; i < pairs; i++) {
+            sent += p[i].sent_bytes;
+            sent_msgs += p[i].sent_msgs;
+            recv += p[i].recv_bytes;
+            recv_msgs += p[i].recv_msgs;
+            zc_done += p[i].zc_done;
+            zc_copied += p[i].zc_copied;
+            if (p[i].error) error = p[i].error;
+        }
+        double busy = (double)((total1 - total0) - (idle1 - idle0)) / (double)sysconf(_SC_CLK_TCK);
+        // UDP 每次 recv 是一个数据报；TCP 按发送端命名空间的 OutSegs 计算段数
+        double pps = udp ? recv_msgs / secs : (segs0 >= 0 && segs1 >= segs0 ? (segs1 - segs0) / secs : 0);
+        printf("%9.2f %11.0f %10.2f", recv * 8.0 / secs / 1e9, pps, recv ? busy / (recv / 1e9) : 0);
+        if (udp && sent)
+            printf("  丢包 %.1f%%", sent > recv ? (double)(sent - recv) * 100.0 / (double)sent : 0.0);
+        if (mode == NET_ZEROCOPY && zc_done)
+            printf("  %.0f%% 退回复制", (double)zc_copied * 100.0 / (double)zc_done);
+        else if (mode == NET_ZEROCOPY && sent_msgs)
+            printf("  未收到完成通知");
+        if (error) printf("  错误: %s", strerror(error));
+        printf("\n");
+    }
+    for (i = 0; p && i < pairs; i++) {
+        if (p[i].send_fd >= 0) close(p[i].send_fd);
+        if (p[i].recv_fd >= 0) close(p[i].recv_fd);
+    }
+    if (listen_fd >= 0) close(listen_fd);
+    free(p);
+    free(tids);
+    free(started);
+}
+
+// veth 为 0 时走回环，否则在临时命名空间里建 veth 对
+int net_selftest_run(int veth, int pairs, int seconds) {
+    NetTarget t;
+    static char block[1 << 20];
+    char path[] = "/tmp/menu_net_bench.XXXXXX";
+    int i;
+    if (pairs < 1) pairs = 1;
+    if (pairs > NET_MAX_PAIRS) pairs = NET_MAX_PAIRS;
+    if (net_target_open(&t, veth) != 0) {
+        printf("无法创建 veth 测试环境: %s\n", strerror(errno));
+        return 1;
+    }
+    // sendfile 的源文件，建好后立即删除目录项
+    int file_fd = mkstemp(path);
+    if (file_fd >= 0) {
+        unlink(path);
+        memset(block, 0x5a, sizeof(block));
+        for (i = 0; i < NET_FILE_SIZE / (int)sizeof(block); i++)
+            if (write(file_fd, block, sizeof(block)) != (ssize_t)sizeof(block)) break;
+    }
+    void (*old_pipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    printf("路径: %s，并发连接: %d，每项 %d 秒\n",
+           veth ? NET_VETH_HOST " <-> " NET_VETH_PEER "（独立网络命名空间）" : "回环 127.0.0.1", pairs, seconds);
+    printf("%-4s %-16s %4s %9s %11s %10s\n", "协议", "方式", "连接", "Gbit/s", "包/秒", "CPU秒/GB");
+    net_run_case(&t, 0, NET_PLAIN, pairs, seconds, file_fd);
+    if (file_fd >= 0) net_run_case(&t, 0, NET_SENDFILE, pairs, seconds, file_fd);
+    net_run_case(&t, 0, NET_ZEROCOPY, pairs, seconds, file_fd);
+    net_run_case(&t, 1, NET_PLAIN, pairs, seconds, file_fd);
+    net_run_case(&t, 1, NET_ZEROCOPY, pairs, seconds, file_fd);
+    printf("包/秒: TCP 为发送的段数（整机计数），UDP 为收到的数据报；CPU秒/GB 按整机 CPU 时间计算（含软中断）\n");
+    printf("零拷贝发送投递给本机套接字（回环、veth）时内核会退回复制，只有从物理网卡发出才真正免复制\n");
+
+    signal(SIGPIPE, old_pipe);
+    if (file_fd >= 0) close(file_fd);
+    net_target_close(&t);
+    return 0;
+}
+
+// 网络菜单入口
+void net_selftest() {
+    char mode[16] = "lo", pairs[16], secs[16] = "3";
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    snprintf(pairs, sizeof(pairs), "%d", n > 4 ? 4 : (n > 0 ? n : 1));
+    printf("========== 网络栈吞吐自测 ==========\n");
+    // 丢掉选择菜单时 scanf 留下的换行
+    int ch;
+    while ((ch = getchar()) != '\n' && ch != EOF) {}
+    prompt_default("测试路径 lo/veth", mode, sizeof(mode));
+    prompt_default("并发连接数", pairs, sizeof(pairs));
+    prompt_default("每项测试秒数", secs, sizeof(secs));
+    net_selftest_run(!strcmp(mode, "veth"), atoi(pairs), atoi(secs) > 0 ? atoi(secs) : 3);
+}
+
+void list_ip_config() {
+    printf("========== 网卡配置信息 ==========\n");
+    char gw[64];
+    default_gateway(gw, sizeof(gw));
+    printf("当前默认网关是：%s，别删除网关的同段IP\n", gw[0] ? gw : "未知");
+
+    // 收集所有网卡及IP，按网卡名分组
+    struct ifaddrs *ifaddr, *ifa;
+    struct ip_entry { char ifname[IFNAMSIZ]; char ip[64]; } iplist[128];
+    int ipcount = 0;
+    if (getifaddrs(&ifaddr) == -1) {
+        perror("getifaddrs");
+        return;
+    }
+    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL) continue;
+        if (ifa->ifa_addr->sa_family == AF_INET) {
+            struct sockaddr_in *sa = (struct sockaddr_in *)ifa->ifa_addr;
+            strncpy(iplist[ipcount].ifname, ifa->ifa_name, IFNAMSIZ);
+            strncpy(iplist[ipcount].ip, inet_ntoa(sa->sin_addr), 63);
+            iplist[ipcount].ip[63] = '\0';
+            ipcount++;
+        }
+    }
+    // 获取所有物理网卡名
+    char ifnames[32][IFNAMSIZ];
+    int n = get_all_ifnames(ifnames, 32);
+    // lo放第一个，其余排序
+    int i, j;
+    for (i = 0; i < n; ++i) {
+        if (strcmp(ifnames[i], "lo") == 0 && i != 0) {
+            char tmp[IFNAMSIZ];
+            strcpy(tmp, ifnames[0]);
+            strcpy(ifnames[0], ifnames[i]);
+            strcpy(ifnames[i], tmp);
+            break;
+        }
+    }
+    for (i = 1; i < n-1; ++i) {
+        for (j = i+1; j < n; ++j) {
+            if (strcmp(ifnames[i], ifnames[j]) > 0) {
+                char tmp[IFNAMSIZ];
+                strcpy(tmp, ifnames[i]);
+                strcpy(ifnames[i], ifnames[j]);
+                strcpy(ifnames[j], tmp);
+            }
+        }
+    }
+    // 显示，序号连续，每个网卡聚合所有IP，没有IP的网卡也显示
+    int idx = 1;
+    for (i = 0; i < n; ++i) {
+        printf("%2d. 网卡: %s\n", idx++, ifnames[i]);
+        int has_ip = 0;
+        for (j = 0; j < ipcount; ++j) {
+            if (strcmp(ifnames[i], iplist[j].ifname) == 0) {
+                printf("    IP地址: %s\n", iplist[j].ip);
+                has_ip = 1;
+            }
+        }
+        if (!has_ip) {
+            printf("    (无IP)\n");
+        }
+        printf(" --------------------------\n");
+    }
+    freeifaddrs(ifaddr);
+    printf("======== 请选择需要的操作 ========\n");
+    printf("1) 添加\n2) 删除\n3) 替换\n4) 退出\n5) TCP 连接统计\n6) 中断分布与网卡中断均衡\n7) 网卡性能调优\n8) 路由表概览\n9) 网络栈吞吐自测\n");
+    char select;
+    printf("请选择一个选项: ");
+    scanf(" %c", &select);
+    switch (select) {
+        case '1':
+            // 添加IP
+            add_ip();
+            break;
+        case '2':
+            // 删除IP
+            delete_ip();
+            break;
+        case '3':
+            // 替换IP
+            break;
+        case '4':
+            // 退出
+            break;
+        case '5':
+            connection_summary();
+            break;
+        case '6':
+            irq_menu();
+            break;
+        case '7':
+            nic_tuning(NULL);
+            break;
+        case '8':
+            route_summary();
+            break;
+        case '9':
+            net_selftest();
+            break;
+        default:
+            printf("❗ 未知选项，请重新选择。\n");
+            break;
+    }
+}
+
+// ==================== CPU 与内存带宽基准测试 ====================
+
+// 每个在线 CPU 一个绑定线程，各项测试在所有核上同时运行（与整机满载时的频率、散热状态一致），
+// 用来发现内存条接触不良、BIOS 节能限频、散热不良的核
+#define BENCH_MAX_CPUS 1024
+#define BENCH_REPS 5                         // STREAM 每项重复次数，取最好的一次
+#define BENCH_STREAM_BYTES (256UL << 20)     // 每个 STREAM 数组的总大小（各线程平分），需远大于末级缓存
+#define BENCH_SLOW_RATIO 0.85                // 低于中位数的这一比例视为异常
+#define BENCH_INT_ITERS 40000000L
+#define BENCH_FP_ITERS 40000000L
+#define BENCH_SIMD_ITERS 40000000L
+
+// 测试内核固定按 -O2 编译，结果不受整体编译选项影响；标量测试关闭自动向量化
+#define BENCH_SCALAR __attribute__((noinline, optimize("O2", "no-tree-vectorize")))
+#define BENCH_VECTOR __attribute__((noinline, optimize("O2")))
+#define BENCH_STREAM __attribute__((noinline, optimize("O3")))
+
+enum { BENCH_COPY, BENCH_SCALE, BENCH_ADD, BENCH_TRIAD, BENCH_STREAMS };
+static const char *bench_stream_names[BENCH_STREAMS] = { "Copy", "Scale", "Add", "Triad" };
+static const int bench_stream_arrays[BENCH_STREAMS] = { 2, 2, 3, 3 };   // 每个元素读写的数组个数
+
+enum { BENCH_SIMD_BASE, BENCH_SIMD_AVX2, BENCH_SIMD_AVX512 };
+
+typedef struct {
+    int cpu;
+    int pinned;
+    int failed;                              // STREAM 数组分配失败
+    double sink;                             // 测试结果的校验值，防止计算被优化掉
+    double int_gops;
+    double fp_gflops;
+    double simd_gflops;
+    double stream_secs[BENCH_STREAMS][BENCH_REPS];
+    double stream_gbs[BENCH_STREAMS];        // 本核最好的一次
+} BenchCore;
+
+// 启动闸门：工作线程在第一个屏障前等待，全部创建成功后放行；有线程创建失败时中止，
+// 已启动的线程直接退出，不会卡在永远等不齐的屏障上
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int state;                               // 0 等待，1 放行，-1 中止
+} BenchGate;
+
+typedef struct {
+    BenchCore *cores;
+    int count;
+    int simd;
+    size_t stream_n;                         // 每个线程的数组元素数
+    BenchGate gate;
+    pthread_barrier_t barrier;
+} BenchPool;
+
+typedef struct {
+    BenchPool *pool;
+    int self;
+} BenchArg;
+
+// 8 条互不依赖的 64 位乘加链（LCG），每轮 16 次整数运算
+BENCH_SCALAR static unsigned long long bench_int_kernel(long iters) {
+    unsigned long long a = 1, b = 2, c = 3, d = 4, e = 5, f = 6, g = 7, h = 8;
+    const unsigned long long m = 6364136223846793005ULL, k = 1442695040888963407ULL;
+    long i;
+    for (i = 0; i < iters; i++) {
+        a = a * m + k; b = b * m + k; c = c * m + k; d = d * m + k;
+        e = e * m + k; f = f * m + k; g = g * m + k; h = h * m + k;
+    }
+    return a ^ b ^ c ^ d ^ e ^ f ^ g ^ h;
+}
+
+// 8 条标量双精度乘加链，每轮 16 次浮点运算
+BENCH_SCALAR static double bench_fp_kernel(long iters) {
+    double a = 1.0, b = 1.1, c = 1.2, d = 1.3, e = 1.4, f = 1.5, g = 1.6, h = 1.7;
+    const double m = 0.9999999, k = 1e-7;
+    long i;
+    for (i = 0; i < iters; i++) {
+        a = a * m + k; b = b * m + k; c = c * m + k; d = d * m + k;
+        e = e * m + k; f = f * m + k; g = g * m + k; h = h * m + k;
+    }
+    return a + b + c + d + e + f + g + h;
+}
+
+typedef double bench_v2d __attribute__((vector_size(16)));
+
+// 8 条向量乘加链足以填满两个 FMA 单元的流水线；目标支持 FMA 时乘加会合并为一条指令
+#define BENCH_FMA_BODY(type)                                                        \
+    const type zero = { 0 };                                                        \
+    type a = zero + 1.0, b = zero + 1.1, c = zero + 1.2, d = zero + 1.3;            \
+    type e = zero + 1.4, f = zero + 1.5, g = zero + 1.6, h = zero + 1.7;            \
+    const type m = zero + 0.9999999, k = zero + 1e-7;                               \
+    double sum = 0;                                                                 \
+    long i;                                                                         \
+    for (i = 0; i < iters; i++) {                                                   \
+        a = a * m + k; b = b * m + k; c = c * m + k; d = d * m + k;                 \
+        e = e * m + k; f = f * m + k; g = g * m + k; h = h * m + k;                 \
+    }                                                                               \
+    a = a + b + c + d + e + f + g + h;                                              \
+    for (i = 0; i < (long)(sizeof(type) / sizeof(double)); i++) sum += a[i];        \
+    return sum;
+
+BENCH_VECTOR static double bench_fma_base(long iters) {
+    BENCH_FMA_BODY(bench_v2d)
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+typedef double bench_v4d __attribute__((vector_size(32)));
+typedef double bench_v8d __attribute__((vector_size(64)));
+
+BENCH_VECTOR __attribute__((target("avx2,fma"))) static double bench_fma_avx2(long iters) {
+    BENCH_FMA_BODY(bench_v4d)
+}
+
+BENCH_VECTOR __attribute__((target("avx512f"))) static double bench_fma_avx512(long iters) {
+    BENCH_FMA_BODY(bench_v8d)
+}
+#endif
+
+// 运行时按 CPU 支持的指令集选择 SIMD 测试
+static int bench_simd_detect() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return BENCH_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return BENCH_SIMD_AVX2;
+#endif
+    return BENCH_SIMD_BASE;
+}
+
+static const char *bench_simd_name(int simd) {
+    switch (simd) {
+    case BENCH_SIMD_AVX512: return "AVX-512 FMA";
+    case BENCH_SIMD_AVX2: return "AVX2 FMA";
+    default:
+#if defined(__x86_64__) || defined(__i386__)
+        return "SSE2";
+#else
+        return "128 位向量";
+#endif
+    }
+}
+
+// 返回双精度浮点运算次数
+static double bench_simd_run(int simd, long iters, double *sink) {
+    int lanes = 2;
+#if defined(__x86_64__) || defined(__i386__)
+    if (simd == BENCH_SIMD_AVX512) {
+        *sink += bench_fma_avx512(iters);
+        lanes = 8;
+    } else if (simd == BENCH_SIMD_AVX2) {
+        *sink += bench_fma_avx2(iters);
+        lanes = 4;
+    } else
+#endif
+    *sink += bench_fma_base(iters);
+    return 16.0 * lanes * (double)iters;
+}
+
+// STREAM 的四个内核（McCalpin），数组互不重叠
+BENCH_STREAM static void bench_copy(double *restrict c, const double *restrict a, size_t n) {
+    size_t j;
+    for (j = 0; j < n; j++) c[j] = a[j];
+}
+
+BENCH_STREAM static void bench_scale(double *restrict b, const double *restrict c, double s, size_t n) {
+    size_t j;
+    for (j = 0; j < n; j++) b[j] = s * c[j];
+}
+
+BENCH_STREAM static void bench_add(double *restrict c, const double *restrict a, const double *restrict b, size_t n) {
+    size_t j;
+    for (j = 0; j < n; j++) c[j] = a[j] + b[j];
+}
+
+BENCH_STREAM static void bench_triad(double *restrict a, const double *restrict b, const double *restrict c,
+                                     double s, size_t n) {
+    size_t j;
+    for (j = 0; j < n; j++) a[j] = b[j] + s * c[j];
+}
+
+static void bench_stream_run(BenchPool *pool, BenchCore *core) {
+    size_t n = pool->stream_n, j;
+    double *a = NULL, *b = NULL, *c = NULL;
+    int k, rep;
+    // 绑定后由本线程首次写入，页面落在本核所在的 NUMA 节点
+    if (posix_memalign((void **)&a, 64, n * sizeof(double)) || posix_memalign((void **)&b, 64, n * sizeof(double))
+        || posix_memalign((void **)&c, 64, n * sizeof(double))) {
+        core->failed = 1;
+    } else {
+        for (j = 0; j < n; j++) {
+            a[j] = 1.0;
+            b[j] = 2.0;
+            c[j] = 0.0;
+        }
+    }
+    // 分配失败的线程也要参与每一次同步，否则其他线程会一直等待
+    for (rep = 0; rep < BENCH_REPS; rep++) {
+        for (k = 0; k < BENCH_STREAMS; k++) {
+            pthread_barrier_wait(&pool->barrier);
+            if (core->failed) continue;
+            double t0 = now_ms();
+            switch (k) {
+            case BENCH_COPY: bench_copy(c, a, n); break;
+            case BENCH_SCALE: bench_scale(b, c, 3.0, n); break;
+            case BENCH_ADD: bench_add(c, a, b, n); break;
+            case BENCH_TRIAD: bench_triad(a, b, c, 3.0, n); break;
+            }
+            core->stream_secs[k][rep] = (now_ms() - t0) / 1000.0;
+        }
+    }
+    if (!core->failed) {
+        core->sink += a[n / 2] + b[n / 3] + c[n - 1];
+        for (k = 0; k < BENCH_STREAMS; k++) {
+            double best = core->stream_secs[k][0];
+            for (rep = 1; rep < BENCH_REPS; rep++)
+                if (core->stream_secs[k][rep] < best) best = core->stream_secs[k][rep];
+            core->stream_gbs[k] = best > 0 ? bench_stream_arrays[k] * n * sizeof(double) / best / 1e9 : 0;
+        }
+    }
+    free(a);
+    free(b);
+    free(c);
+}
+
+static void bench_gate_init(BenchGate *g) {
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->cond, NULL);
+    g->state = 0;
+}
+
+static void bench_gate_destroy(BenchGate *g) {
+    pthread_cond_destroy(&g->cond);
+    pthread_mutex_destroy(&g->lock);
+}
+
+// go 为 1 放行，为 0 中止
+static void bench_gate_open(BenchGate *g, int go) {
+    pthread_mutex_lock(&g->lock);
+    g->state = go ? 1 : -1;
+    pthread_cond_broadcast(&g->cond);
+    pthread_mutex_unlock(&g->lock);
+}
+
+// 返回 0 表示放行，-1 表示测试已中止
+static int bench_gate_wait(BenchGate *g) {
+    pthread_mutex_lock(&g->lock);
+    while (g->state == 0) pthread_cond_wait(&g->cond, &g->lock);
+    int state = g->state;
+    pthread_mutex_unlock(&g->lock);
+    return state > 0 ? 0 : -1;
+}
+
+// 创建 count 个线程，全部成功后放行；失败时中止并回收已启动的线程，返回 -1
+static int bench_start_threads(BenchGate *gate, pthread_t *tids, int count,
+                               void *(*fn)(void *), void *args, size_t arg_size) {
+    int started;
+    for (started = 0; started < count; started++)
+        if (pthread_create(&tids[started], NULL, fn, (char *)args + (size_t)started * arg_size) != 0) break;
+    bench_gate_open(gate, started == count);
+    if (started == count) return 0;
+    while (started-- > 0) pthread_join(tids[started], NULL);
+    return -1;
+}
+
+static void *bench_worker(void *arg) {
+    BenchArg *ba = arg;
+    BenchPool *pool = ba->pool;
+    BenchCore *core = &pool->cores[ba->self];
+    double t0;
+    if (bench_gate_wait(&pool->gate) != 0) return NULL;
+    core->pinned = si_pin_thread(core->cpu) == 0;
+
+    pthread_barrier_wait(&pool->barrier);
+    t0 = now_ms();
+    core->sink += (double)bench_int_kernel(BENCH_INT_ITERS);
+    core->int_gops = 16.0 * BENCH_INT_ITERS / ((now_ms() - t0) * 1e6);
+
+    pthread_barrier_wait(&pool->barrier);
+    t0 = now_ms();
+    core->sink += bench_fp_kernel(BENCH_FP_ITERS);
+    core->fp_gflops = 16.0 * BENCH_FP_ITERS / ((now_ms() - t0) * 1e6);
+
+    pthread_barrier_wait(&pool->barrier);
+    t0 = now_ms();
+    double flops = bench_simd_run(pool->simd, BENCH_SIMD_ITERS, &core->sink);
+    core->simd_gflops = flops / ((now_ms() - t0) * 1e6);
+
+    bench_stream_run(pool, core);
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// offset 为 BenchCore 中某项得分的偏移
+static double bench_median(const BenchCore *cores, int count, size_t offset) {
+    double *v = malloc((size_t)count * sizeof(double));
+    int i;
+    if (!v) return 0;
+    for (i = 0; i < count; i++) v[i] = *(const double *)((const char *)&cores[i] + offset);
+    qsort(v, (size_t)count, sizeof(double), compare_double);
+    double m = count % 2 ? v[count / 2] : (v[count / 2 - 1] + v[count / 2]) / 2;
+    free(v);
+    return m;
+}
+
+void cpu_benchmark() {
+    static int cpus[BENCH_MAX_CPUS];
+    SiArena arena;
+    SiReport r;
+    BenchPool pool;
+    int i, k, rep;
+
+    printf("========== CPU 与内存带宽基准测试 ==========\n");
+    si_arena_init(&arena, report_arena_buf, sizeof(report_arena_buf));
+    si_collect(&r, &arena, 0);
+    print_cpu_info(&r);
+
+    int count = si_online_cpus(cpus, BENCH_MAX_CPUS);
+    if (count <= 0) {
+        printf("无法获取在线 CPU 列表\n");
+        return;
+    }
+    // 三个数组合计不超过可用内存的 3/8
+    size_t total = BENCH_STREAM_BYTES;
+    if (r.mem.available > 0 && r.mem.available * (1UL << 30) / 8 < total)
+        total = (size_t)(r.mem.available * (1UL << 30) / 8);
+    memset(&pool, 0, sizeof(pool));
+    pool.count = count;
+    pool.simd = bench_simd_detect();
+    pool.stream_n = total / sizeof(double) / (size_t)count;
+    if (pool.stream_n < 4096) pool.stream_n = 4096;
+    pool.cores = calloc((size_t)count, sizeof(BenchCore));
+    pthread_t *tids = calloc((size_t)count, sizeof(pthread_t));
+    BenchArg *args = calloc((size_t)count, sizeof(BenchArg));
+    if (!pool.cores || !tids || !args || pthread_barrier_init(&pool.barrier, NULL, (unsigned)count)) {
+        printf("内存不足\n");
+        free(pool.cores);
+        free(tids);
+        free(args);
+        return;
+    }
+    printf("        SIMD: %s，线程: %d（每个在线 CPU 一个），STREAM 数组: 每线程 %.1f MiB x 3\n",
+           bench_simd_name(pool.simd), count, pool.stream_n * sizeof(double) / 1048576.0);
+    printf("正在测试，约需数秒...\n");
+    fflush(stdout);
+
+    for (i = 0; i < count; i++) {
+        pool.cores[i].cpu = cpus[i];
+        args[i].pool = &pool;
+        args[i].self = i;
+    }
+    // 屏障要求所有线程都到齐，有线程创建失败时只能放弃本次测试
+    bench_gate_init(&pool.gate);
+    int started = bench_start_threads(&pool.gate, tids, count, bench_worker, args, sizeof(BenchArg)) == 0;
+    if (started)
+        for (i = 0; i < count; i++) pthread_join(tids[i], NULL);
+    pthread_barrier_destroy(&pool.barrier);
+    bench_gate_destroy(&pool.gate);
+    free(tids);
+    free(args);
+    if (!started) {
+        printf("创建测试线程失败，测试中止\n");
+        free(pool.cores);
+        return;
+    }
+
+    double med_int = bench_median(pool.cores, count, offsetof(BenchCore, int_gops));
+    double med_fp = bench_median(pool.cores, count, offsetof(BenchCore, fp_gflops));
+    double med_simd = bench_median(pool.cores, count, offsetof(BenchCore, simd_gflops));
+    double med_triad = bench_median(pool.cores, count, offsetof(BenchCore, stream_gbs) + BENCH_TRIAD * sizeof(double));
+    double sum_int = 0, sum_fp = 0, sum_simd = 0;
+    int slow = 0;
+
+    printf("%-6s %12s %12s %12s %12s\n", "CPU", "整数 Gops", "浮点 GFLOPS", "SIMD GFLOPS", "Triad GB/s");
+    for (i = 0; i < count; i++) {
+        const BenchCore *c = &pool.cores[i];
+        char flags[128] = "";
+        sum_int += c->int_gops;
+        sum_fp += c->fp_gflops;
+        sum_simd += c->simd_gflops;
+        if (c->int_gops < med_int * BENCH_SLOW_RATIO) strcat(flags, " 整数");
+        if (c->fp_gflops < med_fp * BENCH_SLOW_RATIO) strcat(flags, " 浮点");
+        if (c->simd_gflops < med_simd * BENCH_SLOW_RATIO) strcat(flags, " SIMD");
+        if (!c->failed && c->stream_gbs[BENCH_TRIAD] < med_triad * BENCH_SLOW_RATIO) strcat(flags, " 带宽");
+        if (flags[0]) slow++;
+        printf("%-6d %12.2f %12.2f %12.2f ", c->cpu, c->int_gops, c->fp_gflops, c->simd_gflops);
+        if (c->failed) printf("%12s", "分配失败");
+        else printf("%12.2f", c->stream_gbs[BENCH_TRIAD]);
+        printf("%s%s%s\n", c->pinned ? "" : "  (未能绑定)", flags[0] ? "  ← 偏低:" : "", flags);
+    }
+    printf("%-6s %12.2f %12.2f %12.2f\n", "合计", sum_int, sum_fp, sum_simd);
+
+    // 整机带宽：每轮按最慢线程的耗时计算，取最好的一轮
+    printf("STREAM 整机带宽 (GB/s):");
+    for (k = 0; k < BENCH_STREAMS; k++) {
+        double best = 0;
+        for (rep = 0; rep < BENCH_REPS; rep++) {
+            double slowest = 0, bytes = 0;
+            for (i = 0; i < count; i++) {
+                if (pool.cores[i].failed) continue;
+                bytes += (double)bench_stream_arrays[k] * pool.stream_n * sizeof(double);
+                if (pool.cores[i].stream_secs[k][rep] > slowest) slowest = pool.cores[i].stream_secs[k][rep];
+            }
+            if (slowest > 0 && bytes / slowest / 1e9 > best) best = bytes / slowest / 1e9;
+        }
+        printf("  %s %.2f", bench_stream_names[k], best);
+    }
+    printf("\n");
+    if (slow)
+        printf("⚠ %d 个核有指标低于中位数的 %.0f%%，检查 BIOS 节能设置、散热和内存插槽\n", slow, BENCH_SLOW_RATIO * 100);
+    else
+        printf("各核得分均在中位数的 %.0f%% 以上\n", BENCH_SLOW_RATIO * 100);
+
+    free(pool.cores);
+}
+
+// ==================== 磁盘基准测试 ====================
+
+// 对文件或块设备做顺序/随机读写测试，O_DIRECT 绕过页缓存。优先使用 io_uring，内核不支持或被禁用时
+// 退到内核 AIO，再退到每个队列深度一个线程的 pread/pwrite（两者都直接走系统调用，不依赖 liburing/libaio）
+#define DISK_MAX_LIST 8
+#define DISK_MAX_QD 256
+#define DISK_ALIGN 4096
+#define DISK_HIST_SHIFT 5                        // 每个 2 的幂区间再分 32 格，误差约 3%
+#define DISK_HIST_SUB (1 << DISK_HIST_SHIFT)
+#define DISK_HIST_BUCKETS (64 * DISK_HIST_SUB)
+#define DISK_FILE_NAME "menu_disk_bench.dat"
+#define DISK_FILL_BS (1 << 20)
+
+#ifndef O_DIRECT
+#define O_DIRECT __O_DIRECT                      // 未定义 _GNU_SOURCE 时 fcntl.h 不导出 O_DIRECT
+#endif
+
+enum { DISK_ENGINE_AUTO, DISK_ENGINE_URING, DISK_ENGINE_AIO, DISK_ENGINE_THREAD, DISK_ENGINES };
+static const char *disk_engine_names[DISK_ENGINES] = { "auto", "io_uring", "aio", "thread" };
+
+typedef struct {
+    const char *path;
+    long long size;
+    int bs[DISK_MAX_LIST];
+    int nbs;
+    int qd[DISK_MAX_LIST];
+    int nqd;
+    int seconds;                                 // 每项测试的时长
+    int engine;
+    int allow_write;                             // 块设备和已有文件上只有显式允许才做写测试
+} DiskOpt;
+
+typedef struct {
+    int fd;
+    long long size;
+    int is_device;
+    int created;                                 // 测试文件由本次创建，结束后删除
+    int writable;                                // 可以做写测试（自己的测试文件或指定了 --write）
+    int direct;
+    char path[512];
+} DiskTarget;
+
+typedef struct {
+    unsigned long long ios;
+    unsigned long long errors;
+    int last_error;
+    unsigned long long hist[DISK_HIST_BUCKETS];  // 完成延迟（纳秒）
+} DiskStats;
+
+typedef struct {
+    int fd;
+    long long size;                              // 测试范围，bs 的整数倍
+    int bs;
+    int qd;
+    int random;
+    int write;
+    long long seq_next;                          // 顺序测试的下一个偏移，线程引擎下原子递增
+    char *pool;                                  // qd 个 bs 大小的缓冲区，DISK_ALIGN 对齐
+    double deadline;                             // now_ms 时间
+    DiskStats stats;
+} DiskJob;
+
+static long long disk_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 对数-线性分桶：小于 64ns 每纳秒一格，之后每个 2 的幂区间 32 格
+static int disk_hist_index(unsigned long long ns) {
+    if (ns < 2 * DISK_HIST_SUB) return (int)ns;
+    int e = 63 - __builtin_clzll(ns) - DISK_HIST_SHIFT;
+    return (e + 1) * DISK_HIST_SUB + (int)((ns >> e) - DISK_HIST_SUB);
+}
+
+static double disk_hist_value(int idx) {
+    if (idx < 2 * DISK_HIST_SUB) return idx;
+    int e = idx / DISK_HIST_SUB - 1;
+    return (idx % DISK_HIST_SUB + DISK_HIST_SUB + 0.5) * (double)(1ULL << e);
+}
+
+// 返回第 p 分位的延迟（纳秒）
+static double disk_hist_percentile(const DiskStats *s, double p) {
+    unsigned long long want = (unsigned long long)ceil((double)s->ios * p), seen = 0;
+    int i;
+    if (want == 0) want = 1;
+    for (i = 0; i < DISK_HIST_BUCKETS; i++) {
+        seen += s->hist[i];
+        if (seen >= want) return disk_hist_value(i);
+    }
+    return 0;
+}
+
+static void disk_complete(DiskStats *s, int bs, long long lat_ns, long res) {
+    if (res != bs) {
+        s->errors++;
+        s->last_error = res < 0 ? (int)-res : EIO;
         return;
     }
-    printf("暂不支持该系统自动写入配置，请手动配置。\n");
+    s->ios++;
+    s->hist[disk_hist_index(lat_ns > 0 ? (unsigned long long)lat_ns : 0)]++;
 }
 
-// 新增IP交互
-void add_ip() {
-    char ifnames[32][IFNAMSIZ];
-    int n = get_all_ifnames(ifnames, 32);
-    if (n == 0) { printf("未检测到物理网卡！\n"); return; }
-    printf("请选择要添加IP的网卡：\n");
-    int i;
-    for (i = 0; i < n; ++i) printf("%d) %s\n", i+1, ifnames[i]);
-    int sel = 0;
-    printf("输入序号: ");
-    scanf("%d", &sel);
-    if (sel < 1 || sel > n) { printf("无效选择！\n"); return; }
-    printf("你选择的网卡是: %s\n", ifnames[sel-1]);
-    // 输入IP
-    char ip[64] = {0}, mask[64] = {0};
-    printf("请输入新IP地址 (支持 1.1.1.1/24 或 1.1.1.1): ");
-    scanf("%63s", ip);
-    char *slash = strchr(ip, '/');
-    if (slash) {
-        // 1.1.1.1/24
-        *slash = '\0';
-        int masklen = atoi(slash+1);
-        if (!is_valid_ip(ip) || masklen < 0 || masklen > 32) {
-            printf("IP或掩码格式错误！\n"); return;
-        }
-        masklen_to_str(masklen, mask);
-        printf("输入的IP: %s, 掩码: %s\n", ip, mask);
+static unsigned long long disk_rand(unsigned long long *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 2685821657736338717ULL;
+}
+
+static long long disk_next_offset(DiskJob *job, unsigned long long *rng) {
+    if (job->random) return (long long)(disk_rand(rng) % (unsigned long long)(job->size / job->bs)) * job->bs;
+    return __atomic_fetch_add(&job->seq_next, job->bs, __ATOMIC_RELAXED) % job->size;
+}
+
+// ---------- io_uring ----------
+
+typedef struct {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map, *cq_map;
+    size_t sq_len, cq_len, sqe_len;
+} DiskRing;
+
+static void disk_ring_close(DiskRing *r) {
+    if (r->sqes) munmap(r->sqes, r->sqe_len);
+    if (r->cq_map && r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_len);
+    if (r->sq_map) munmap(r->sq_map, r->sq_len);
+    close(r->fd);
+}
+
+static int disk_ring_open(DiskRing *r, unsigned entries) {
+    struct io_uring_params p;
+    void *map;
+    memset(r, 0, sizeof(*r));
+    memset(&p, 0, sizeof(p));
+    r->fd = (int)syscall(SYS_io_uring_setup, entries, &p);
+    if (r->fd < 0) return -1;
+    r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    // 5.4 起 SQ、CQ 两个环可以一次映射
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_len > r->sq_len) r->sq_len = r->cq_len;
+        r->cq_len = r->sq_len;
+    }
+    map = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQ_RING);
+    if (map == MAP_FAILED) goto fail;
+    r->sq_map = map;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_map = r->sq_map;
     } else {
-        if (!is_valid_ip(ip)) { printf("IP格式错误！\n"); return; }
-        printf("请输入子网掩码 (如 255.255.255.0): ");
-        scanf("%63s", mask);
-        if (!is_valid_mask(mask)) { printf("掩码格式错误！\n"); return; }
-        printf("输入的IP: %s, 掩码: %s\n", ip, mask);
+        map = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_CQ_RING);
+        if (map == MAP_FAILED) goto fail;
+        r->cq_map = map;
     }
-    do_add_ip(ifnames[sel-1], ip, mask);
+    r->sqe_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    map = mmap(NULL, r->sqe_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQES);
+    if (map == MAP_FAILED) goto fail;
+    r->sqes = map;
+
+    r->sq_tail = (unsigned *)((char *)r->sq_map + p.sq_off.tail);
+    r->sq_mask = (unsigned *)((char *)r->sq_map + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((char *)r->sq_map + p.sq_off.array);
+    r->cq_head = (unsigned *)((char *)r->cq_map + p.cq_off.head);
+    r->cq_tail = (unsigned *)((char *)r->cq_map + p.cq_off.tail);
+    r->cq_mask = (unsigned *)((char *)r->cq_map + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)((char *)r->cq_map + p.cq_off.cqes);
+    return 0;
+fail:
+    {
+        int saved = errno;
+        disk_ring_close(r);
+        errno = saved;
+    }
+    return -1;
 }
 
-void do_delete_ip(const char *ifname, const char *del_ip) {
-    // 检查 NetworkManager 是否 running
-    int is_nm_running = (system("systemctl is-active --quiet NetworkManager") == 0);
-    if (is_nm_running) {
-        // 查找 connection 名称
-        char con_name[128] = "";
-        char nmcli_query_cmd[256];
-        snprintf(nmcli_query_cmd, sizeof(nmcli_query_cmd), "nmcli -g GENERAL.CONNECTION device show %s 2>/dev/null", ifname);
-        FILE *con_fp = popen(nmcli_query_cmd, "r");
-        if (con_fp) {
-            if (fgets(con_name, sizeof(con_name), con_fp)) {
-                con_name[strcspn(con_name, "\n")] = '\0';
-            }
-            pclose(con_fp);
+static void disk_uring_prep(DiskRing *r, unsigned *tail, DiskJob *job, int slot, int fixed,
+                            struct iovec *iov, unsigned long long *rng) {
+    unsigned idx = *tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    if (fixed) {
+        sqe->opcode = job->write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->addr = (unsigned long)iov[slot].iov_base;
+        sqe->len = (unsigned)job->bs;
+        sqe->buf_index = (unsigned short)slot;
+    } else {
+        sqe->opcode = job->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->addr = (unsigned long)&iov[slot];
+        sqe->len = 1;
+    }
+    sqe->fd = job->fd;
+    sqe->off = (unsigned long long)disk_next_offset(job, rng);
+    sqe->user_data = (unsigned long long)slot;
+    r->sq_array[idx] = idx;
+    (*tail)++;
+}
+
+static int disk_run_uring(DiskJob *job) {
+    DiskRing ring;
+    struct iovec iov[DISK_MAX_QD];
+    long long start[DISK_MAX_QD];
+    unsigned long long rng = (unsigned long long)disk_now_ns() | 1;
+    int i, inflight = job->qd, rc = 0;
+    if (disk_ring_open(&ring, (unsigned)job->qd) != 0) return -1;
+    for (i = 0; i < job->qd; i++) {
+        iov[i].iov_base = job->pool + (size_t)i * (size_t)job->bs;
+        iov[i].iov_len = (size_t)job->bs;
+    }
+    // 注册缓冲池后用 READ_FIXED/WRITE_FIXED，省去每次 IO 固定页面；超出 memlock 限制时用普通 readv/writev
+    int fixed = syscall(SYS_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iov, job->qd) == 0;
+
+    unsigned tail = *ring.sq_tail;
+    long long now = disk_now_ns();
+    for (i = 0; i < job->qd; i++) {
+        disk_uring_prep(&ring, &tail, job, i, fixed, iov, &rng);
+        start[i] = now;
+    }
+    __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+    unsigned to_submit = (unsigned)job->qd;
+
+    while (inflight > 0) {
+        int ret = (int)syscall(SYS_io_uring_enter, ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            rc = -1;
+            break;
         }
-        if (strlen(con_name) > 0 && strcmp(con_name, "--") != 0) {
-            // nmcli 删除IP
-            char nmcli_cmd[512];
-            snprintf(nmcli_cmd, sizeof(nmcli_cmd), "nmcli connection modify '%s' -ipv4.addresses %s", con_name, del_ip);
-            printf("检测到 NetworkManager 正在运行，推荐使用 nmcli 删除：\n%s\n", nmcli_cmd);
-            int ret = system(nmcli_cmd);
-            if (ret == 0) {
-                char up_cmd[256];
-                snprintf(up_cmd, sizeof(up_cmd), "nmcli connection up '%s' || ifup %s", con_name, ifname);
-                printf("正在激活连接: %s\n", up_cmd);
-                system(up_cmd);
-                printf("IP 已通过 nmcli 删除并激活。\n");
-                return;
+        to_submit -= (unsigned)ret;
+        unsigned head = *ring.cq_head;
+        unsigned ctail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        int again = now_ms() < job->deadline;
+        now = disk_now_ns();
+        for (; head != ctail; head++) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            int slot = (int)cqe->user_data;
+            disk_complete(&job->stats, job->bs, now - start[slot], cqe->res);
+            if (again) {
+                disk_uring_prep(&ring, &tail, job, slot, fixed, iov, &rng);
+                start[slot] = now;
+                to_submit++;
             } else {
-                printf("nmcli 删除失败，建议用 'nmcli connection show' 查看所有连接名，并手动配置。\n");
+                inflight--;
             }
-        } else {
-            printf("未找到网卡 %s 的 NetworkManager 连接名，自动切换为配置文件方式。\n", ifname);
         }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+        __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
     }
-    // 检测系统类型
-    FILE *fp = fopen("/etc/os-release", "r");
-    char osid[64] = "", line[256];
-    if (fp) {
-        while (fgets(line, sizeof(line), fp)) {
-            if (strncmp(line, "ID=", 3) == 0) {
-                sscanf(line, "ID=%63s", osid);
-                size_t len = strlen(osid);
-                if (osid[0] == '"' || osid[0] == '\'') memmove(osid, osid+1, len-1);
-                if (osid[strlen(osid)-1] == '"' || osid[strlen(osid)-1] == '\'') osid[strlen(osid)-1] = 0;
-                break;
-            }
-        }
-        fclose(fp);
+    disk_ring_close(&ring);
+    return rc;
+}
+
+// ---------- 内核 AIO ----------
+
+static void disk_aio_prep(struct iocb *cb, DiskJob *job, int slot, unsigned long long *rng) {
+    memset(cb, 0, sizeof(*cb));
+    cb->aio_lio_opcode = job->write ? IOCB_CMD_PWRITE : IOCB_CMD_PREAD;
+    cb->aio_fildes = (unsigned)job->fd;
+    cb->aio_buf = (unsigned long)(job->pool + (size_t)slot * (size_t)job->bs);
+    cb->aio_nbytes = (unsigned long long)job->bs;
+    cb->aio_offset = disk_next_offset(job, rng);
+    cb->aio_data = (unsigned long long)slot;
+}
+
+static int disk_run_aio(DiskJob *job) {
+    aio_context_t ctx = 0;
+    struct iocb cbs[DISK_MAX_QD], *ptrs[DISK_MAX_QD];
+    struct io_event events[DISK_MAX_QD];
+    long long start[DISK_MAX_QD];
+    unsigned long long rng = (unsigned long long)disk_now_ns() | 1;
+    int i, inflight, nsub;
+    if (syscall(SYS_io_setup, job->qd, &ctx) != 0) return -1;
+    long long now = disk_now_ns();
+    for (i = 0; i < job->qd; i++) {
+        disk_aio_prep(&cbs[i], job, i, &rng);
+        ptrs[i] = &cbs[i];
+        start[i] = now;
     }
-    // Ubuntu/Debian
-    if (strstr(osid, "ubuntu") || strstr(osid, "debian")) {
-        char path[256];
-        snprintf(path, sizeof(path), "/etc/network/interfaces.d/%s.cfg", ifname);
-        if (!file_exists(path)) {
-            if (!file_exists("/etc/network/interfaces.d") && file_exists("/etc/network/interfaces")) {
-                strcpy(path, "/etc/network/interfaces");
-            }
+    inflight = (int)syscall(SYS_io_submit, ctx, job->qd, ptrs);
+    if (inflight <= 0) {
+        int saved = errno;
+        syscall(SYS_io_destroy, ctx);
+        errno = inflight == 0 ? EAGAIN : saved;
+        return -1;
+    }
+    while (inflight > 0) {
+        int n = (int)syscall(SYS_io_getevents, ctx, 1, job->qd, events, NULL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
         }
-        // 读取原内容，过滤掉包含del_ip的address/netmask行
-        FILE *f = fopen(path, "r");
-        if (!f) { printf("无法打开 %s\n", path); return; }
-        char lines[1024][256];
-        int count = 0;
-        // int skip_next = 0;
-        for (; fgets(lines[count], sizeof(lines[count]), f) && count < 1024; count++) {}
-        fclose(f);
-        // 查找包含del_ip的行，并同时删除紧跟的netmask行
-        int i;
-        for (i = 0; i < count; ++i) {
-            if (strstr(lines[i], del_ip)) {
-                lines[i][0] = '\0';
-                // 如果下一行是netmask，也删掉
-                if (i+1 < count && strstr(lines[i+1], "netmask")) lines[i+1][0] = '\0';
+        int again = now_ms() < job->deadline;
+        now = disk_now_ns();
+        nsub = 0;
+        for (i = 0; i < n; i++) {
+            int slot = (int)events[i].data;
+            disk_complete(&job->stats, job->bs, now - start[slot], (long)events[i].res);
+            if (again) {
+                disk_aio_prep(&cbs[slot], job, slot, &rng);
+                start[slot] = now;
+                ptrs[nsub++] = &cbs[slot];
+            } else {
+                inflight--;
             }
         }
-        // 重写文件
-        f = fopen(path, "w");
-        if (!f) { printf("无法写入 %s\n", path); return; }
-        for (i = 0; i < count; ++i) {
-            if (lines[i][0] != '\0') fprintf(f, "%s", lines[i]);
+        if (nsub) {
+            int ret = (int)syscall(SYS_io_submit, ctx, nsub, ptrs);
+            if (ret < nsub) inflight -= nsub - (ret > 0 ? ret : 0);
         }
-        fclose(f);
-        printf("已从 %s 删除IP %s\n", path, del_ip);
-        printf("正在重启网络服务: systemctl restart network\n");
-        system("systemctl restart network");
-        return;
     }
-    // CentOS/RHEL/Fedora
-    if (strstr(osid, "centos") || strstr(osid, "rhel") || strstr(osid, "fedora")) {
-        char path[256];
-        snprintf(path, sizeof(path), "/etc/sysconfig/network-scripts/ifcfg-%s", ifname);
-        if (!file_exists(path)) {
-            printf("配置文件 %s 不存在！\n", path);
-            return;
-        }
-        // 读取原内容，过滤掉包含del_ip的IPADDR/NETMASK行
-        FILE *f = fopen(path, "r");
-        if (!f) { printf("无法打开 %s\n", path); return; }
-        char lines[1024][256];
-        int count = 0;
-        for (; fgets(lines[count], sizeof(lines[count]), f) && count < 1024; count++) {}
-        fclose(f);
-        // 查找与del_ip相关的IPADDR/NETMASK行号
-        int i;
-        int to_delete[32] = {0};
-        int del_count = 0;
-        for (i = 0; i < count; ++i) {
-            if (strstr(lines[i], del_ip)) {
-                to_delete[del_count++] = i;
-                // 检查下一行/上一行是否是NETMASK
-                if (i+1 < count && strstr(lines[i+1], "NETMASK")) to_delete[del_count++] = i+1;
-                if (i-1 >= 0 && strstr(lines[i-1], "NETMASK")) to_delete[del_count++] = i-1;
-            }
+    syscall(SYS_io_destroy, ctx);
+    return 0;
+}
+
+// ---------- 线程池 pread/pwrite ----------
+
+typedef struct {
+    DiskJob *job;
+    int slot;
+    DiskStats stats;
+} DiskThread;
+
+static void *disk_thread_worker(void *arg) {
+    DiskThread *t = arg;
+    DiskJob *job = t->job;
+    char *buf = job->pool + (size_t)t->slot * (size_t)job->bs;
+    unsigned long long rng = ((unsigned long long)disk_now_ns() + (unsigned long long)t->slot * 7919) | 1;
+    while (now_ms() < job->deadline) {
+        long long off = disk_next_offset(job, &rng);
+        long long t0 = disk_now_ns();
+        ssize_t n = job->write ? pwrite(job->fd, buf, (size_t)job->bs, off) : pread(job->fd, buf, (size_t)job->bs, off);
+        disk_complete(&t->stats, job->bs, disk_now_ns() - t0, n < 0 ? -errno : (long)n);
+    }
+    return NULL;
+}
+
+static int disk_run_threads(DiskJob *job) {
+    DiskThread *threads = calloc((size_t)job->qd, sizeof(DiskThread));
+    pthread_t *tids = calloc((size_t)job->qd, sizeof(pthread_t));
+    int *started = calloc((size_t)job->qd, sizeof(int));
+    int i, b, any = 0;
+    if (!threads || !tids || !started) {
+        free(threads);
+        free(tids);
+        free(started);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (i = 0; i < job->qd; i++) {
+        threads[i].job = job;
+        threads[i].slot = i;
+        started[i] = pthread_create(&tids[i], NULL, disk_thread_worker, &threads[i]) == 0;
+        any |= started[i];
+    }
+    for (i = 0; i < job->qd; i++) {
+        if (!started[i]) continue;
+        pthread_join(tids[i], NULL);
+        job->stats.ios += threads[i].stats.ios;
+        job->stats.errors += threads[i].stats.errors;
+        if (threads[i].stats.last_error) job->stats.last_error = threads[i].stats.last_error;
+        for (b = 0; b < DISK_HIST_BUCKETS; b++) job->stats.hist[b] += threads[i].stats.hist[b];
+    }
+    free(threads);
+    free(tids);
+    free(started);
+    return any ? 0 : -1;
+}
+
+// 按选定的引擎运行，auto 时依次退让；*engine 更新为实际使用的引擎，后续测试不再重复探测
+static int disk_run_job(DiskJob *job, int *engine) {
+    if (*engine == DISK_ENGINE_AUTO || *engine == DISK_ENGINE_URING) {
+        if (disk_run_uring(job) == 0) {
+            *engine = DISK_ENGINE_URING;
+            return 0;
         }
-        // 重写文件
-        f = fopen(path, "w");
-        if (!f) { printf("无法写入 %s\n", path); return; }
-        for (i = 0; i < count; ++i) {
-            int skip = 0;
-            int j;
-            for (j = 0; j < del_count; ++j) if (i == to_delete[j]) { skip = 1; break; }
-            if (skip) continue;
-            fprintf(f, "%s", lines[i]);
+        printf("    io_uring 不可用（%s），改用内核 AIO\n", strerror(errno));
+        *engine = DISK_ENGINE_AIO;
+    }
+    if (*engine == DISK_ENGINE_AIO) {
+        if (disk_run_aio(job) == 0) return 0;
+        printf("    内核 AIO 不可用（%s），改用线程池 pread/pwrite\n", strerror(errno));
+        *engine = DISK_ENGINE_THREAD;
+    }
+    return disk_run_threads(job);
+}
+
+// ---------- 测试目标与参数 ----------
+
+// "4k" / "128K" / "1m" / "2g"，按 1024 进制
+static long long disk_parse_size(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || v <= 0) return -1;
+    switch (*end) {
+    case 'k': case 'K': v *= 1024; end++; break;
+    case 'm': case 'M': v *= 1024 * 1024; end++; break;
+    case 'g': case 'G': v *= 1024.0 * 1024 * 1024; end++; break;
+    }
+    if (*end == 'b' || *end == 'B') end++;
+    return *end ? -1 : (long long)v;
+}
+
+static void disk_size_str(long long v, char *buf, size_t size) {
+    if (v >= (1LL << 30) && v % (1LL << 30) == 0) snprintf(buf, size, "%lldg", v >> 30);
+    else if (v >= (1LL << 20) && v % (1LL << 20) == 0) snprintf(buf, size, "%lldm", v >> 20);
+    else if (v >= 1024 && v % 1024 == 0) snprintf(buf, size, "%lldk", v >> 10);
+    else snprintf(buf, size, "%lld", v);
+}
+
+// 逗号分隔的列表；is_size 时按大小解析，否则为整数
+static int disk_parse_list(const char *text, int *out, int max, int is_size) {
+    char buf[256], *save = NULL, *tok;
+    int n = 0;
+    snprintf(buf, sizeof(buf), "%s", text);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        long long v = is_size ? disk_parse_size(tok) : atoll(tok);
+        if (n == max || v <= 0 || v > (is_size ? 64LL << 20 : DISK_MAX_QD)) return -1;
+        if (is_size && v % 512) return -1;
+        out[n++] = (int)v;
+    }
+    return n > 0 ? n : -1;
+}
+
+static void disk_opt_default(DiskOpt *opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->path = "/var/tmp";
+    opt->size = 1LL << 30;
+    opt->bs[0] = 4096;
+    opt->bs[1] = 128 * 1024;
+    opt->nbs = 2;
+    opt->qd[0] = 1;
+    opt->qd[1] = 32;
+    opt->nqd = 2;
+    opt->seconds = 3;
+}
+
+// 随机内容，避免带压缩/去重的存储虚高
+static void disk_fill_random(char *buf, size_t len) {
+    unsigned long long rng = (unsigned long long)disk_now_ns() | 1;
+    size_t i;
+    for (i = 0; i + sizeof(rng) <= len; i += sizeof(rng)) {
+        unsigned long long v = disk_rand(&rng);
+        memcpy(buf + i, &v, sizeof(v));
+    }
+}
+
+// 目标为目录时在其中创建测试文件，上次中断留下的同名文件也当作自己的；自己的测试文件不足 size 时
+// 先顺序写满，读测试才有真实数据。已有的文件和块设备只读，--write 才允许写（会覆盖其中的数据）
+static int disk_open_target(DiskTarget *t, const DiskOpt *opt, int max_bs) {
+    struct stat st;
+    int own = 0;
+    memset(t, 0, sizeof(*t));
+    t->fd = -1;
+    snprintf(t->path, sizeof(t->path), "%s", opt->path);
+    if (stat(t->path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        snprintf(t->path, sizeof(t->path), "%s/%s", opt->path, DISK_FILE_NAME);
+        own = 1;
+    }
+    int exists = stat(t->path, &st) == 0;
+    if (own && exists && !S_ISREG(st.st_mode)) {
+        printf("%s 已存在且不是普通文件\n", t->path);
+        return -1;
+    }
+    t->is_device = exists && S_ISBLK(st.st_mode);
+    t->writable = own || !exists || opt->allow_write;
+    int flags = t->writable ? O_RDWR | O_CREAT : O_RDONLY;
+    t->fd = open(t->path, flags | O_DIRECT | O_CLOEXEC, 0600);
+    t->direct = t->fd >= 0;
+    // 不支持 O_DIRECT 的文件系统（如较老内核的 tmpfs）退回到带页缓存的读写
+    if (t->fd < 0 && errno == EINVAL) t->fd = open(t->path, flags | O_CLOEXEC, 0600);
+    if (t->fd < 0) {
+        printf("无法打开 %s: %s\n", t->path, strerror(errno));
+        return -1;
+    }
+    t->created = own || !exists;
+
+    long long size = opt->size;
+    if (t->is_device) {
+        unsigned long long dev_size = 0;
+        if (ioctl(t->fd, BLKGETSIZE64, &dev_size) == 0 && (long long)dev_size < size) size = (long long)dev_size;
+    } else if (exists && !t->writable && st.st_size < size) {
+        // 只读的已有文件不能补写，只测已有的部分
+        size = st.st_size;
+    }
+    long long unit = max_bs > DISK_FILL_BS ? max_bs : DISK_FILL_BS;
+    size -= size % unit;
+    if (size <= 0) {
+        printf("测试范围太小，至少需要 %lld 字节\n", unit);
+        return -1;
+    }
+    t->size = size;
+    if (t->is_device || !t->writable || (exists && st.st_size >= size)) return 0;
+
+    printf("正在生成 %lld MiB 测试文件 %s ...\n", size >> 20, t->path);
+    fflush(stdout);
+    char *buf;
+    long long off;
+    if (posix_memalign((void **)&buf, DISK_ALIGN, DISK_FILL_BS) != 0) return -1;
+    disk_fill_random(buf, DISK_FILL_BS);
+    for (off = 0; off < size; off += DISK_FILL_BS) {
+        if (pwrite(t->fd, buf, DISK_FILL_BS, off) != DISK_FILL_BS) {
+            printf("写入测试文件失败: %s\n", strerror(errno));
+            free(buf);
+            return -1;
         }
-        fclose(f);
-        printf("已从 %s 删除IP %s\n", path, del_ip);
-        // 判断是否为 CentOS 6
-        int is_centos6 = 0;
-        FILE *rel = fopen("/etc/centos-release", "r");
-        if (rel) {
-            char relstr[128] = "";
-            if (fgets(relstr, sizeof(relstr), rel)) {
-                if (strstr(relstr, "release 6")) is_centos6 = 1;
+    }
+    free(buf);
+    fsync(t->fd);
+    return 0;
+}
+
+static void disk_close_target(DiskTarget *t) {
+    if (t->fd >= 0) close(t->fd);
+    if (t->created) unlink(t->path);
+}
+
+// 依次运行顺序读、顺序写、随机读、随机写 × 块大小 × 队列深度；有 IO 错误时返回 1
+int disk_benchmark_run(const DiskOpt *opt) {
+    static const struct { const char *name; int random, write; } patterns[] = {
+        { "顺序读", 0, 0 }, { "顺序写", 0, 1 }, { "随机读", 1, 0 }, { "随机写", 1, 1 },
+    };
+    DiskTarget t;
+    DiskJob *job;
+    int engine = opt->engine, max_bs = 0, p, b, q, failed = 0;
+    char text[32];
+    for (b = 0; b < opt->nbs; b++)
+        if (opt->bs[b] > max_bs) max_bs = opt->bs[b];
+    if (disk_open_target(&t, opt, max_bs) != 0) {
+        disk_close_target(&t);
+        return 1;
+    }
+    job = malloc(sizeof(DiskJob));
+    if (!job) {
+        disk_close_target(&t);
+        return 1;
+    }
+    disk_size_str(t.size, text, sizeof(text));
+    printf("目标: %s（%s，测试范围 %s%s），每项 %d 秒\n", t.path, t.is_device ? "块设备" : "文件", text,
+           t.direct ? "，O_DIRECT" : "，不支持 O_DIRECT，结果含页缓存", opt->seconds);
+    if (!t.writable) printf("%s未指定 --write，跳过写测试\n", t.is_device ? "块设备" : "已有文件");
+    printf("%-8s %6s %5s %-9s %10s %10s %9s %9s %9s\n", "模式", "块", "队列", "引擎", "IOPS", "MiB/s",
+           "p50(us)", "p99(us)", "p99.9(us)");
+
+    for (p = 0; p < (int)(sizeof(patterns) / sizeof(patterns[0])); p++) {
+        if (patterns[p].write && !t.writable) continue;
+        for (b = 0; b < opt->nbs; b++) {
+            for (q = 0; q < opt->nqd; q++) {
+                memset(job, 0, sizeof(*job));
+                job->fd = t.fd;
+                job->size = t.size - t.size % opt->bs[b];
+                job->bs = opt->bs[b];
+                job->qd = opt->qd[q];
+                job->random = patterns[p].random;
+                job->write = patterns[p].write;
+                if (posix_memalign((void **)&job->pool, DISK_ALIGN, (size_t)job->bs * (size_t)job->qd) != 0) {
+                    printf("内存不足\n");
+                    failed = 1;
+                    continue;
+                }
+                disk_fill_random(job->pool, (size_t)job->bs * (size_t)job->qd);
+                double t0 = now_ms();
+                job->deadline = t0 + opt->seconds * 1000.0;
+                int rc = disk_run_job(job, &engine);
+                double secs = (now_ms() - t0) / 1000.0;
+                free(job->pool);
+
+                disk_size_str(job->bs, text, sizeof(text));
+                printf("%-8s %6s %5d %-9s ", patterns[p].name, text, job->qd, disk_engine_names[engine]);
+                if (rc != 0 || !job->stats.ios) {
+                    printf("失败: %s\n", strerror(rc != 0 ? errno : job->stats.last_error));
+                    failed = 1;
+                    continue;
+                }
+                printf("%10.0f %10.1f %9.1f %9.1f %9.1f", job->stats.ios / secs,
+                       job->stats.ios * (double)job->bs / secs / 1048576.0,
+                       disk_hist_percentile(&job->stats, 0.50) / 1000, disk_hist_percentile(&job->stats, 0.99) / 1000,
+                       disk_hist_percentile(&job->stats, 0.999) / 1000);
+                if (job->stats.errors) {
+                    printf("  错误 %llu 次: %s", job->stats.errors, strerror(job->stats.last_error));
+                    failed = 1;
+                }
+                printf("\n");
+                fflush(stdout);
             }
-            fclose(rel);
         }
-        if (is_centos6) {
-            printf("正在重启网络服务: service network restart\n");
-            system("service network restart");
+    }
+    free(job);
+    disk_close_target(&t);
+    return failed;
+}
+
+// 命令行：--disk-bench 路径 [--size 1g] [--bs 4k,128k] [--qd 1,32] [--time 秒] [--engine auto|uring|aio|thread] [--write]
+int disk_bench_command(int argc, char *argv[]) {
+    DiskOpt opt;
+    int i, bad = argc < 1;
+    disk_opt_default(&opt);
+    if (argc >= 1) opt.path = argv[0];
+    for (i = 1; i < argc && !bad; i++) {
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(argv[i], "--write")) {
+            opt.allow_write = 1;
+        } else if (!val) {
+            bad = 1;
+        } else if (!strcmp(argv[i], "--size")) {
+            bad = (opt.size = disk_parse_size(val)) <= 0;
+            i++;
+        } else if (!strcmp(argv[i], "--bs")) {
+            bad = (opt.nbs = disk_parse_list(val, opt.bs, DISK_MAX_LIST, 1)) < 0;
+            i++;
+        } else if (!strcmp(argv[i], "--qd")) {
+            bad = (opt.nqd = disk_parse_list(val, opt.qd, DISK_MAX_LIST, 0)) < 0;
+            i++;
+        } else if (!strcmp(argv[i], "--time")) {
+            bad = (opt.seconds = atoi(val)) <= 0;
+            i++;
+        } else if (!strcmp(argv[i], "--engine")) {
+            for (opt.engine = 0; opt.engine < DISK_ENGINES; opt.engine++)
+                if (!strcmp(val, disk_engine_names[opt.engine]) || (opt.engine == DISK_ENGINE_URING && !strcmp(val, "uring")))
+                    break;
+            bad = opt.engine == DISK_ENGINES;
+            i++;
         } else {
-            printf("正在重启网络服务: systemctl restart network\n");
-            system("systemctl restart network");
+            bad = 1;
         }
-        return;
     }
-    printf("暂不支持该系统自动删除配置，请手动处理。\n");
+    if (bad) {
+        printf("用法: --disk-bench 文件|目录|块设备 [--size 1g] [--bs 4k,128k] [--qd 1,32] [--time 3]\n");
+        printf("                   [--engine auto|uring|aio|thread] [--write]\n");
+        printf("      目标为目录时在其中创建临时测试文件；块设备和已有文件默认只读，--write 允许写测试（会破坏数据）\n");
+        return 2;
+    }
+    return disk_benchmark_run(&opt);
 }
 
-void delete_ip() {
-    char ifnames[32][IFNAMSIZ];
-    int n = get_all_ifnames(ifnames, 32);
-    if (n == 0) { printf("未检测到物理网卡！\n"); return; }
-    int i;
-    for (i = 0; i < n; ++i) printf("%d) %s\n", i+1, ifnames[i]);
-    int sel;
-    printf("请输入需要删除IP的网卡: ");
-    scanf("%d", &sel);
-    if (sel < 1 || sel > n) { printf("无效选择！\n"); return; }
-    const char *ifname = ifnames[sel-1];
-    printf("你选择的网卡是: %s\n", ifname);
+// 菜单入口：逐项询问参数，回车使用默认值
+void disk_benchmark() {
+    DiskOpt opt;
+    char path[256], size[32], bs[128], qd[64], secs[16], engine[16];
+    disk_opt_default(&opt);
+    printf("========== 磁盘基准测试 ==========\n");
+    snprintf(path, sizeof(path), "%s", opt.path);
+    snprintf(size, sizeof(size), "1g");
+    snprintf(bs, sizeof(bs), "4k,128k");
+    snprintf(qd, sizeof(qd), "1,32");
+    snprintf(secs, sizeof(secs), "%d", opt.seconds);
+    snprintf(engine, sizeof(engine), "auto");
+    prompt_default("测试目标（目录、文件或块设备）", path, sizeof(path));
+    prompt_default("测试范围大小", size, sizeof(size));
+    prompt_default("块大小列表", bs, sizeof(bs));
+    prompt_default("队列深度列表", qd, sizeof(qd));
+    prompt_default("每项测试秒数", secs, sizeof(secs));
+    prompt_default("引擎 auto/uring/aio/thread", engine, sizeof(engine));
 
-    // 1. 获取该网卡所有IP
-    struct ifaddrs *ifaddr, *ifa;
-    char ips[16][64];
-    int ip_count = 0;
-    if (getifaddrs(&ifaddr) == -1) {
-        perror("getifaddrs");
-        return;
-    }
-    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == NULL) continue;
-        if (ifa->ifa_addr->sa_family == AF_INET && strcmp(ifa->ifa_name, ifname) == 0) {
-            struct sockaddr_in *sa = (struct sockaddr_in *)ifa->ifa_addr;
-            strncpy(ips[ip_count], inet_ntoa(sa->sin_addr), 63);
-            ips[ip_count][63] = '\0';
-            ip_count++;
+    char *argv[] = { path, "--size", size, "--bs", bs, "--qd", qd, "--time", secs, "--engine", engine };
+    struct stat st;
+    int argc = sizeof(argv) / sizeof(argv[0]);
+    if (stat(path, &st) == 0 && (S_ISBLK(st.st_mode) || S_ISREG(st.st_mode))) {
+        char answer[16] = "n";
+        prompt_default(S_ISBLK(st.st_mode) ? "块设备写测试会破坏其中的数据，确定要做写测试吗 y/n"
+                                           : "写测试会覆盖该文件的内容，确定要做写测试吗 y/n", answer, sizeof(answer));
+        if (answer[0] == 'y' || answer[0] == 'Y') {
+            char *argv_w[12];
+            memcpy(argv_w, argv, sizeof(argv));
+            argv_w[argc] = "--write";
+            disk_bench_command(argc + 1, argv_w);
+            return;
         }
     }
-    freeifaddrs(ifaddr);
+    disk_bench_command(argc, argv);
+}
 
-    if (ip_count == 0) {
-        printf("该网卡没有IP可删除！\n");
-        return;
+// ==================== NUMA 访存矩阵 ====================
+
+// 每个节点上的缓冲区用 mbind 绑定到该节点（直接走系统调用，不依赖 libnuma），再从每个节点上绑定的线程
+// 做指针追逐测延迟、并行顺序读测带宽，得到 N×N 矩阵。跨 socket 访问代价随 SNC、内存交织等 BIOS 设置变化很大
+#define NUMA_MAX_NODES 64
+#define NUMA_MAX_THREADS 16                 // 带宽测试每个节点最多用的线程数
+#define NUMA_BUF_BYTES (256UL << 20)        // 每个节点的缓冲区，需远大于末级缓存
+#define NUMA_LINE 64
+#define NUMA_CHASE_STEPS (1L << 22)
+#define NUMA_BW_REPS 3
+
+typedef struct {
+    char *buf;
+    size_t len;
+    int bound;                              // mbind 成功；不支持 NUMA 的内核上为 0
+    int error;                              // 该节点无法分配（如没有内存的节点）
+} NumaBuffer;
+
+typedef struct {
+    const NumaBuffer *mem;
+    int cpu;
+    int threads;
+    int self;
+    pthread_barrier_t *barrier;
+    BenchGate *gate;
+    double secs[NUMA_BW_REPS];
+    unsigned long long sink;
+    double latency_ns;
+} NumaWorker;
+
+// 随机环形链表：每个缓存行存下一行的地址，访问顺序随机，硬件预取失效
+BENCH_SCALAR static void **numa_chase(void **p, long steps) {
+    while (steps-- > 0) p = (void **)*p;
+    return p;
+}
+
+BENCH_STREAM static unsigned long long numa_read(const unsigned long long *restrict a, size_t n) {
+    unsigned long long s = 0;
+    size_t j;
+    for (j = 0; j < n; j++) s += a[j];
+    return s;
+}
+
+// 分配并绑定到 node，写入随机环（Sattolo 算法生成单一循环的排列）
+static int numa_buffer_init(NumaBuffer *b, int node, size_t len) {
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+    size_t lines = len / NUMA_LINE, i;
+    memset(b, 0, sizeof(*b));
+    b->len = lines * NUMA_LINE;
+    b->buf = mmap(NULL, b->len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (b->buf == MAP_FAILED) {
+        b->buf = NULL;
+        b->error = errno;
+        return -1;
+    }
+    // 透明大页减少随机访问的 TLB 缺失，测到的更接近内存本身的延迟
+    madvise(b->buf, b->len, MADV_HUGEPAGE);
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    // maxnode 按内核约定比位数多 1
+    if (syscall(SYS_mbind, b->buf, b->len, MPOL_BIND, mask, sizeof(mask) * 8 + 1, MPOL_MF_STRICT) == 0) {
+        b->bound = 1;
+    } else if (errno != ENOSYS) {
+        b->error = errno;
+        munmap(b->buf, b->len);
+        b->buf = NULL;
+        return -1;
     }
 
-    // 2. 列出所有IP供选择
-    for (i = 0; i < ip_count; ++i) {
-        printf("%d) %s\n", i+1, ips[i]);
+    unsigned int *perm = malloc(lines * sizeof(unsigned int));
+    if (!perm) {
+        b->error = ENOMEM;
+        munmap(b->buf, b->len);
+        b->buf = NULL;
+        return -1;
     }
-    int ip_sel;
-    printf("请输入要删除的IP序号: ");
-    scanf("%d", &ip_sel);
-    if (ip_sel < 1 || ip_sel > ip_count) {
-        printf("无效选择！\n");
-        return;
+    unsigned long long rng = 0x9e3779b97f4a7c15ULL;
+    for (i = 0; i < lines; i++) perm[i] = (unsigned int)i;
+    for (i = lines - 1; i > 0; i--) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        size_t j = (size_t)(rng % i);
+        unsigned int t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
     }
-    const char *del_ip = ips[ip_sel-1];
-    printf("你选择删除的IP是: %s\n", del_ip);
+    for (i = 0; i < lines; i++) *(void **)(b->buf + i * NUMA_LINE) = b->buf + (size_t)perm[i] * NUMA_LINE;
+    free(perm);
+    return 0;
+}
 
-    // 3. 查找配置文件并删除对应IP和掩码
-    do_delete_ip(ifname, del_ip);
+static void *numa_latency_worker(void *arg) {
+    NumaWorker *w = arg;
+    si_pin_thread(w->cpu);
+    void **p = (void **)w->mem->buf;
+    // 先走一段预热 TLB 和页表缓存
+    p = numa_chase(p, NUMA_CHASE_STEPS / 8);
+    double t0 = now_ms();
+    p = numa_chase(p, NUMA_CHASE_STEPS);
+    w->latency_ns = (now_ms() - t0) * 1e6 / NUMA_CHASE_STEPS;
+    w->sink = (unsigned long long)(unsigned long)p;
+    return NULL;
 }
 
+// 各线程读缓冲区中互不重叠的一段
+static void *numa_bandwidth_worker(void *arg) {
+    NumaWorker *w = arg;
+    size_t words = w->mem->len / sizeof(unsigned long long), per = words / (size_t)w->threads;
+    const unsigned long long *slice = (const unsigned long long *)w->mem->buf + per * (size_t)w->self;
+    int rep;
+    if (bench_gate_wait(w->gate) != 0) return NULL;
+    si_pin_thread(w->cpu);
+    for (rep = 0; rep < NUMA_BW_REPS; rep++) {
+        pthread_barrier_wait(w->barrier);
+        double t0 = now_ms();
+        w->sink += numa_read(slice, per);
+        w->secs[rep] = (now_ms() - t0) / 1000.0;
+    }
+    return NULL;
+}
 
-// 网卡IP信息列表功能
-void list_ip_config() {
-    printf("========== 网卡配置信息 ==========\n");
-    // 获取默认网关
-    char gw[64] = "";
-    FILE *fp = popen("ip route | grep default | awk '{print $3}'", "r");
-    if (fp && fgets(gw, sizeof(gw), fp)) {
-        gw[strcspn(gw, "\n")] = '\0';
+// 从 cpus 上的线程访问 mem，返回延迟（ns）和带宽（GB/s），失败时为负数
+static void numa_measure(const NumaBuffer *mem, const int *cpus, int ncpu, double *latency, double *bandwidth) {
+    NumaWorker workers[NUMA_MAX_THREADS];
+    pthread_t tids[NUMA_MAX_THREADS];
+    pthread_barrier_t barrier;
+    BenchGate gate;
+    int i, rep;
+    *latency = *bandwidth = -1;
+
+    memset(workers, 0, sizeof(workers));
+    workers[0].mem = mem;
+    workers[0].cpu = cpus[0];
+    if (pthread_create(&tids[0], NULL, numa_latency_worker, &workers[0]) != 0) return;
+    pthread_join(tids[0], NULL);
+    *latency = workers[0].latency_ns;
+
+    int threads = ncpu < NUMA_MAX_THREADS ? ncpu : NUMA_MAX_THREADS;
+    if (pthread_barrier_init(&barrier, NULL, (unsigned)threads) != 0) return;
+    memset(workers, 0, sizeof(workers));
+    for (i = 0; i < threads; i++) {
+        workers[i].mem = mem;
+        workers[i].cpu = cpus[i];
+        workers[i].threads = threads;
+        workers[i].self = i;
+        workers[i].barrier = &barrier;
+        workers[i].gate = &gate;
     }
-    if (fp) pclose(fp);
-    printf("当前默认网关是：%s，别删除网关的同段IP\n", gw[0] ? gw : "未知");
+    // 屏障要求全部线程到齐，有线程创建失败时放弃这一格的带宽
+    bench_gate_init(&gate);
+    int ok = bench_start_threads(&gate, tids, threads, numa_bandwidth_worker, workers, sizeof(NumaWorker)) == 0;
+    if (ok)
+        for (i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+    bench_gate_destroy(&gate);
+    pthread_barrier_destroy(&barrier);
+    if (!ok) return;
 
-    // 收集所有网卡及IP，按网卡名分组
-    struct ifaddrs *ifaddr, *ifa;
-    struct ip_entry { char ifname[IFNAMSIZ]; char ip[64]; } iplist[128];
-    int ipcount = 0;
-    if (getifaddrs(&ifaddr) == -1) {
-        perror("getifaddrs");
-        return;
+    double bytes = (double)(mem->len / sizeof(unsigned long long) / (size_t)threads) * threads * sizeof(unsigned long long);
+    for (rep = 0; rep < NUMA_BW_REPS; rep++) {
+        double slowest = 0;
+        for (i = 0; i < threads; i++)
+            if (workers[i].secs[rep] > slowest) slowest = workers[i].secs[rep];
+        if (slowest > 0 && bytes / slowest / 1e9 > *bandwidth) *bandwidth = bytes / slowest / 1e9;
     }
-    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == NULL) continue;
-        if (ifa->ifa_addr->sa_family == AF_INET) {
-            struct sockaddr_in *sa = (struct sockaddr_in *)ifa->ifa_addr;
-            strncpy(iplist[ipcount].ifname, ifa->ifa_name, IFNAMSIZ);
-            strncpy(iplist[ipcount].ip, inet_ntoa(sa->sin_addr), 63);
-            iplist[ipcount].ip[63] = '\0';
-            ipcount++;
+}
+
+static void numa_print_matrix(const char *title, const int *nodes, int n, const int *has_cpu,
+                              double m[][NUMA_MAX_NODES], const char *fmt) {
+    int i, j;
+    printf("%-12s", title);
+    for (j = 0; j < n; j++) printf("  内存@%-4d", nodes[j]);
+    printf("\n");
+    for (i = 0; i < n; i++) {
+        if (!has_cpu[i]) continue;
+        printf("CPU@%-8d", nodes[i]);
+        for (j = 0; j < n; j++) {
+            if (m[i][j] < 0) printf("  %9s", "-");
+            else printf(fmt, m[i][j]);
         }
+        printf("\n");
     }
-    // 获取所有物理网卡名
-    char ifnames[32][IFNAMSIZ];
-    int n = get_all_ifnames(ifnames, 32);
-    // lo放第一个，其余排序
+}
+
+void numa_benchmark() {
+    static int nodes[NUMA_MAX_NODES], cpus[BENCH_MAX_CPUS];
+    static double latency[NUMA_MAX_NODES][NUMA_MAX_NODES], bandwidth[NUMA_MAX_NODES][NUMA_MAX_NODES];
+    static NumaBuffer bufs[NUMA_MAX_NODES];
+    int has_cpu[NUMA_MAX_NODES] = {0};
+    SiMemory mem;
     int i, j;
-    for (i = 0; i < n; ++i) {
-        if (strcmp(ifnames[i], "lo") == 0 && i != 0) {
-            char tmp[IFNAMSIZ];
-            strcpy(tmp, ifnames[0]);
-            strcpy(ifnames[0], ifnames[i]);
-            strcpy(ifnames[i], tmp);
-            break;
-        }
+
+    printf("========== NUMA 访存延迟与带宽矩阵 ==========\n");
+    int n = si_numa_nodes(nodes, NUMA_MAX_NODES);
+    size_t len = NUMA_BUF_BYTES;
+    if (si_probe_memory(&mem, 0) == 0 && mem.available > 0 && mem.available * (1UL << 30) / 4 / n < len)
+        len = (size_t)(mem.available * (1UL << 30) / 4 / n);
+    printf("节点数: %d，每节点缓冲区 %zu MiB%s\n", n, len >> 20, n == 1 ? "（单节点主机，只有本地访问一格）" : "");
+    for (i = 0; i < n; i++) {
+        int c = si_numa_node_cpus(nodes[i], cpus, BENCH_MAX_CPUS);
+        has_cpu[i] = c > 0;
+        if (c > 0) printf("    节点 %d: %d 个 CPU（%d 起）\n", nodes[i], c, cpus[0]);
+        else printf("    节点 %d: 无 CPU，只作为内存端测试\n", nodes[i]);
     }
-    for (i = 1; i < n-1; ++i) {
-        for (j = i+1; j < n; ++j) {
-            if (strcmp(ifnames[i], ifnames[j]) > 0) {
-                char tmp[IFNAMSIZ];
-                strcpy(tmp, ifnames[i]);
-                strcpy(ifnames[i], ifnames[j]);
-                strcpy(ifnames[j], tmp);
-            }
+    printf("正在准备缓冲区...\n");
+    fflush(stdout);
+    for (j = 0; j < n; j++) {
+        if (numa_buffer_init(&bufs[j], nodes[j], len) != 0)
+            printf("    节点 %d 无法分配: %s\n", nodes[j], strerror(bufs[j].error));
+        else if (!bufs[j].bound && n == 1)
+            printf("    内核未启用 NUMA，缓冲区未绑定节点\n");
+    }
+
+    for (i = 0; i < n; i++) {
+        int c = si_numa_node_cpus(nodes[i], cpus, BENCH_MAX_CPUS);
+        for (j = 0; j < n; j++) {
+            latency[i][j] = bandwidth[i][j] = -1;
+            if (c > 0 && bufs[j].buf) numa_measure(&bufs[j], cpus, c, &latency[i][j], &bandwidth[i][j]);
         }
     }
-    // 显示，序号连续，每个网卡聚合所有IP，没有IP的网卡也显示
-    int idx = 1;
-    for (i = 0; i < n; ++i) {
-        printf("%2d. 网卡: %s\n", idx++, ifnames[i]);
-        int has_ip = 0;
-        for (j = 0; j < ipcount; ++j) {
-            if (strcmp(ifnames[i], iplist[j].ifname) == 0) {
-                printf("    IP地址: %s\n", iplist[j].ip);
-                has_ip = 1;
+    for (j = 0; j < n; j++)
+        if (bufs[j].buf) munmap(bufs[j].buf, bufs[j].len);
+
+    numa_print_matrix("延迟 (ns)", nodes, n, has_cpu, latency, "  %9.1f");
+    numa_print_matrix("带宽 (GB/s)", nodes, n, has_cpu, bandwidth, "  %9.2f");
+    // 远端与本地的比值，SNC / 交织设置不当时差异会明显偏离预期
+    for (i = 0; i < n && n > 1; i++) {
+        double worst = 0;
+        if (!has_cpu[i] || latency[i][i] <= 0) continue;
+        for (j = 0; j < n; j++)
+            if (j != i && latency[i][j] > worst) worst = latency[i][j];
+        if (worst > 0) printf("节点 %d 远端最慢延迟为本地的 %.2f 倍\n", nodes[i], worst / latency[i][i]);
+    }
+}
+
+// ==================== 脚本化子命令 ====================
+
+// 用法：ip list | ip add IF ADDR/PREFIX [--gw GW] | ip del IF ADDR | ip route [DEST]
+//       | mirror switch [--mirror URL] | mirror probe PATH [URL...]
+//       | mirror fetch URL FILE [--cache-dir DIR] | info
+// 结果为一行 JSON 写到标准输出，执行过程中的提示信息转到标准错误；不显示横幅、不等待输入
+// 退出码：0 成功，1 执行失败，2 用法错误
+#define CLI_OK 0
+#define CLI_FAIL 1
+#define CLI_USAGE 2
+
+static int cli_saved_stdout = -1;
+
+// 执行菜单原有的操作函数期间，把它们打印的过程信息改到标准错误
+static void cli_quiet_begin() {
+    fflush(stdout);
+    cli_saved_stdout = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+}
+
+static void cli_quiet_end() {
+    fflush(stdout);
+    if (cli_saved_stdout >= 0) {
+        dup2(cli_saved_stdout, STDOUT_FILENO);
+        close(cli_saved_stdout);
+        cli_saved_stdout = -1;
+    }
+}
+
+static void json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c == '\n') printf("\\n");
+        else if (c < 0x20) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+static int cli_error(int code, const char *msg) {
+    printf("{\"ok\":false,\"error\":");
+    json_string(msg);
+    printf("}\n");
+    return code;
+}
+
+static int cli_need_root() {
+    return getuid() == 0 ? 0 : cli_error(CLI_FAIL, "需要 root 权限");
+}
+
+// 接口名必须是本机存在的网卡
+static int cli_valid_ifname(const char *ifname) {
+    char ifnames[32][IFNAMSIZ];
+    int n = get_all_ifnames(ifnames, 32), i;
+    for (i = 0; i < n; i++)
+        if (!strcmp(ifnames[i], ifname)) return 1;
+    return 0;
+}
+
+static int cli_ip_list() {
+    struct ifaddrs *ifaddr, *ifa;
+    char ifnames[32][IFNAMSIZ], gw[64];
+    int n = get_all_ifnames(ifnames, 32), i;
+    if (getifaddrs(&ifaddr) == -1) return cli_error(CLI_FAIL, strerror(errno));
+    default_gateway(gw, sizeof(gw));
+    printf("{\"ok\":true,\"gateway\":");
+    json_string(gw);
+    printf(",\"interfaces\":[");
+    for (i = 0; i < n; i++) {
+        int first = 1;
+        printf("%s{\"name\":", i ? "," : "");
+        json_string(ifnames[i]);
+        printf(",\"addresses\":[");
+        for (ifa = ifaddr; ifa; ifa = ifa->ifa_next) {
+            if (!ifa->ifa_addr || !ifa->ifa_netmask || strcmp(ifa->ifa_name, ifnames[i])) continue;
+            int family = ifa->ifa_addr->sa_family, prefix = 0, k, len;
+            char text[INET6_ADDRSTRLEN];
+            const unsigned char *mask;
+            if (family == AF_INET) {
+                inet_ntop(AF_INET, &((struct sockaddr_in *)ifa->ifa_addr)->sin_addr, text, sizeof(text));
+                mask = (const unsigned char *)&((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr;
+                len = 4;
+            } else if (family == AF_INET6) {
+                inet_ntop(AF_INET6, &((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr, text, sizeof(text));
+                mask = (const unsigned char *)&((struct sockaddr_in6 *)ifa->ifa_netmask)->sin6_addr;
+                len = 16;
+            } else {
+                continue;
             }
+            for (k = 0; k < len; k++) prefix += __builtin_popcount(mask[k]);
+            printf("%s\"%s/%d\"", first ? "" : ",", text, prefix);
+            first = 0;
         }
-        if (!has_ip) {
-            printf("    (无IP)\n");
-        }
-        printf(" --------------------------\n");
+        printf("]}");
     }
+    printf("]}\n");
     freeifaddrs(ifaddr);
-    printf("======== 请选择需要的操作 ========\n");
-    printf("1) 添加\n2) 删除\n3) 替换\n4) 退出\n");
-    char select;
-    printf("请选择一个选项: ");
-    scanf(" %c", &select);
+    return CLI_OK;
+}
+
+static void json_route(const SiRoute *r) {
+    char name[16];
+    int i;
+    printf("{\"family\":%d,\"dst\":\"%s/%d\",\"table\":", r->family == AF_INET ? 4 : 6,
+           r->dst[0] ? r->dst : (r->family == AF_INET ? "0.0.0.0" : "::"), r->dst_len);
+    json_string(si_route_table_name(r->table, name, sizeof(name)));
+    printf(",\"metric\":%u,\"protocol\":\"%s\",\"prefsrc\":", r->metric, si_route_protocol_name(r->protocol));
+    json_string(r->prefsrc);
+    printf(",\"nexthops\":[");
+    for (i = 0; i < r->nhop_count; i++) {
+        printf("%s{\"gateway\":", i ? "," : "");
+        json_string(r->nhops[i].gateway);
+        printf(",\"dev\":");
+        json_string(r->nhops[i].ifname);
+        printf(",\"weight\":%d}", r->nhops[i].weight);
+    }
+    printf("]}");
+}
+
+// ip route [DEST]：无参数时输出默认路由和各表条数，带目的地址时输出其命中的路由
+static int cli_ip_route(int argc, char *argv[]) {
+    static SiRouteScan scan;
+    char name[16];
+    int i;
+    if (argc > 1) return cli_error(CLI_USAGE, "用法: ip route [DEST]");
+    if (argc == 1) {
+        SiRoute matched;
+        SiNextHop via;
+        if (si_route_lookup(argv[0], &matched, &via) != 0)
+            return cli_error(errno == EINVAL ? CLI_USAGE : CLI_FAIL, strerror(errno));
+        printf("{\"ok\":true,\"route\":");
+        json_route(&matched);
+        printf(",\"via\":{\"gateway\":");
+        json_string(via.gateway);
+        printf(",\"dev\":");
+        json_string(via.ifname);
+        printf("}}\n");
+        return CLI_OK;
+    }
+    if (si_scan_routes(&scan, AF_UNSPEC) != 0) return cli_error(CLI_FAIL, strerror(errno));
+    printf("{\"ok\":true,\"total\":%lu,\"interrupted\":%s,\"tables\":[", scan.total,
+           scan.interrupted ? "true" : "false");
+    for (i = 0; i < scan.table_count; i++) {
+        printf("%s{\"table\":", i ? "," : "");
+        json_string(si_route_table_name(scan.tables[i].table, name, sizeof(name)));
+        printf(",\"ipv4\":%lu,\"ipv6\":%lu}", scan.tables[i].v4, scan.tables[i].v6);
+    }
+    printf("],\"defaults\":[");
+    for (i = 0; i < scan.default_count; i++) {
+        if (i) putchar(',');
+        json_route(&scan.defaults[i]);
+    }
+    printf("]}\n");
+    return CLI_OK;
+}
+
+// ip add IF ADDR/PREFIX [--gw GW]
+static int cli_ip_add(int argc, char *argv[]) {
+    const char *gw = "";
+    char ip[64], mask[32];
+    if (argc == 4 && !strcmp(argv[2], "--gw")) gw = argv[3];
+    else if (argc != 2) return cli_error(CLI_USAGE, "用法: ip add IF ADDR/PREFIX [--gw GW]");
+    snprintf(ip, sizeof(ip), "%s", argv[1]);
+    char *slash = strchr(ip, '/');
+    if (!slash) return cli_error(CLI_USAGE, "地址需带前缀长度，如 10.0.0.5/24");
+    *slash = '\0';
+    char *end;
+    long masklen = strtol(slash + 1, &end, 10);
+    if (!is_valid_ip(ip) || *end || end == slash + 1 || masklen < 0 || masklen > 32)
+        return cli_error(CLI_USAGE, "IP或掩码格式错误");
+    if (gw[0] && !is_valid_ip(gw)) return cli_error(CLI_USAGE, "网关格式错误");
+    if (!cli_valid_ifname(argv[0])) return cli_error(CLI_USAGE, "网卡不存在");
+    if (cli_need_root()) return CLI_FAIL;
+    masklen_to_str((int)masklen, mask);
+
+    cli_quiet_begin();
+    int ret = do_add_ip(argv[0], ip, mask, gw);
+    cli_quiet_end();
+    if (ret < 0) return cli_error(CLI_FAIL, "写入网卡配置失败");
+    printf("{\"ok\":true,\"changed\":%s,\"interface\":", ret == 0 ? "true" : "false");
+    json_string(argv[0]);
+    printf(",\"address\":\"%s/%ld\",\"gateway\":", ip, masklen);
+    json_string(gw);
+    printf("}\n");
+    return CLI_OK;
+}
+
+// ip del IF ADDR（可带 /PREFIX）
+static int cli_ip_del(int argc, char *argv[]) {
+    char ip[64];
+    if (argc != 2) return cli_error(CLI_USAGE, "用法: ip del IF ADDR");
+    snprintf(ip, sizeof(ip), "%s", argv[1]);
+    ip[strcspn(ip, "/")] = '\0';
+    if (!is_valid_ip(ip)) return cli_error(CLI_USAGE, "IP格式错误");
+    if (!cli_valid_ifname(argv[0])) return cli_error(CLI_USAGE, "网卡不存在");
+    if (cli_need_root()) return CLI_FAIL;
+
+    cli_quiet_begin();
+    int ret = do_delete_ip(argv[0], ip);
+    cli_quiet_end();
+    if (ret < 0) return cli_error(CLI_FAIL, "修改网卡配置失败");
+    printf("{\"ok\":true,\"changed\":%s,\"interface\":", ret == 0 ? "true" : "false");
+    json_string(argv[0]);
+    printf(",\"address\":\"%s\"}\n", ip);
+    return CLI_OK;
+}
+
+// mirror probe PATH [URL...]：只测速不换源，不需要 root。不给地址时使用 mirrors.list 或内置列表
+static int cli_mirror_probe(int argc, char *argv[]) {
+    static MirrorProbe probes[MIRROR_MAX];
+    int n = 0, i;
+    if (argc < 1 || argc > MIRROR_MAX + 1) return cli_error(CLI_USAGE, "用法: mirror probe PATH [URL...]");
+    for (i = 1; i < argc; i++) {
+        memset(&probes[n], 0, sizeof(probes[n]));
+        if (parse_mirror_url(argv[i], &probes[n]) != 0) return cli_error(CLI_USAGE, "无效的镜像地址");
+        if (!mirror_listed(probes, n, probes[n].root)) n++;
+    }
+    if (argc == 1) n = load_mirror_candidates(probes, MIRROR_MAX, NULL);
+    if (n == 0) return cli_error(CLI_FAIL, "没有候选镜像");
+
+    rank_mirrors(probes, n, argv[0]);
+    printf("{\"ok\":%s,\"path\":", probes[0].state == PROBE_DONE ? "true" : "false");
+    json_string(argv[0]);
+    printf(",\"mirrors\":[");
+    for (i = 0; i < n; i++) {
+        const MirrorProbe *p = &probes[i];
+        printf("%s{\"mirror\":", i ? "," : "");
+        json_string(p->root);
+        if (p->state == PROBE_DONE) {
+            printf(",\"ok\":true,\"ttfb_ms\":%.1f,\"kib_per_sec\":%.1f,\"score\":%.1f}",
+                   p->t_first_byte - p->t_start, mirror_throughput(p) * 1000.0 / 1024.0, mirror_score(p));
+        } else {
+            printf(",\"ok\":false,\"error\":");
+            json_string(p->error);
+            printf("}");
+        }
+    }
+    printf("]}\n");
+    return probes[0].state == PROBE_DONE ? CLI_OK : CLI_FAIL;
+}
+
+// mirror fetch URL FILE [--cache-dir DIR]：用内置客户端下载（http 走条件请求缓存），
+// 可用来预热黄金镜像的缓存。status 为 304 表示内容未变、文件取自本地缓存
+static int cli_mirror_fetch(int argc, char *argv[]) {
+    int status = 0;
+    if (argc == 4 && !strcmp(argv[2], "--cache-dir")) http_cache_dir = argv[3];
+    else if (argc != 2) return cli_error(CLI_USAGE, "用法: mirror fetch URL FILE [--cache-dir DIR]");
+
+    cli_quiet_begin();
+    int ret = http_fetch(argv[0], argv[1], 1, &status);
+    cli_quiet_end();
+    printf("{\"ok\":%s,\"url\":", ret == 0 ? "true" : "false");
+    json_string(argv[0]);
+    printf(",\"file\":");
+    json_string(argv[1]);
+    printf(",\"status\":%d}\n", status);
+    return ret == 0 ? CLI_OK : CLI_FAIL;
+}
+
+// mirror switch [--mirror URL]
+static int cli_mirror(int argc, char *argv[]) {
+    const char *mirror = NULL;
+    char chosen[256] = "";
+    if (argc >= 1 && !strcmp(argv[0], "probe")) return cli_mirror_probe(argc - 1, argv + 1);
+    if (argc >= 1 && !strcmp(argv[0], "fetch")) return cli_mirror_fetch(argc - 1, argv + 1);
+    if (argc < 1 || strcmp(argv[0], "switch"))
+        return cli_error(CLI_USAGE, "用法: mirror switch [--mirror URL] | mirror probe PATH [URL...] | mirror fetch URL FILE");
+    if (argc == 3 && !strcmp(argv[1], "--mirror")) mirror = argv[2];
+    else if (argc != 1) return cli_error(CLI_USAGE, "用法: mirror switch [--mirror URL]");
+    if (mirror && strncmp(mirror, "http://", 7) && strncmp(mirror, "https://", 8))
+        return cli_error(CLI_USAGE, "镜像地址需以 http:// 或 https:// 开头");
+    if (cli_need_root()) return CLI_FAIL;
+
+    cli_quiet_begin();
+    int ret = switch_package_source(mirror, chosen, sizeof(chosen));
+    cli_quiet_end();
+    if (ret < 0) return cli_error(CLI_FAIL, "更换软件源失败");
+    printf("{\"ok\":true,\"mirror\":");
+    json_string(chosen);
+    printf(",\"refreshed\":%s}\n", ret == 0 ? "true" : "false");
+    return ret == 0 ? CLI_OK : CLI_FAIL;
+}
+
+// info：不调用 dmidecode，毫秒级返回
+static int cli_info() {
+    SiArena arena;
+    SiReport r;
+    int i;
+    si_arena_init(&arena, report_arena_buf, sizeof(report_arena_buf));
+    if (si_collect(&r, &arena, 0) != 0) return cli_error(CLI_FAIL, strerror(errno));
+    printf("{\"ok\":true,\"time\":%lld,\"hostname\":", (long long)r.now);
+    json_string(r.uts.nodename);
+    printf(",\"distro\":");
+    json_string(r.distro.name);
+    printf(",\"version\":");
+    json_string(r.distro.version);
+    printf(",\"kernel\":");
+    json_string(r.uts.release);
+    printf(",\"arch\":");
+    json_string(r.uts.machine);
+    printf(",\"hardware\":");
+    json_string(r.hardware_model);
+    printf(",\"cpu_model\":");
+    json_string(r.cpu.model);
+    printf(",\"cpu_cores\":%d,\"mem_total_gib\":%.2f,\"mem_available_gib\":%.2f",
+           r.cpu.logical_cores, r.mem.total, r.mem.available);
+    printf(",\"load\":[%.2f,%.2f,%.2f],\"uptime_seconds\":%ld,\"local_ip\":",
+           r.load[0], r.load[1], r.load[2], r.uptime.seconds);
+    json_string(r.local_ip);
+    printf(",\"psi_some_avg10\":{");
+    for (i = 0; i < SI_PSI_KINDS; i++) {
+        printf("%s\"%s\":", i ? "," : "", si_psi_name(i));
+        if (r.psi[i].present) printf("%.2f", r.psi[i].some[0]);
+        else printf("null");
+    }
+    printf("}}\n");
+    return CLI_OK;
+}
+
+static int is_cli_command(const char *name) {
+    return !strcmp(name, "ip") || !strcmp(name, "mirror") || !strcmp(name, "info");
+}
+
+// argv[0] 为子命令名
+int cli_main(int argc, char *argv[]) {
+    if (!strcmp(argv[0], "info")) return argc == 1 ? cli_info() : cli_error(CLI_USAGE, "用法: info");
+    if (!strcmp(argv[0], "mirror")) return cli_mirror(argc - 1, argv + 1);
+    if (argc >= 2 && !strcmp(argv[1], "list")) return argc == 2 ? cli_ip_list() : cli_error(CLI_USAGE, "用法: ip list");
+    if (argc >= 2 && !strcmp(argv[1], "add")) return cli_ip_add(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "del")) return cli_ip_del(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "route")) return cli_ip_route(argc - 2, argv + 2);
+    return cli_error(CLI_USAGE, "用法: ip list | ip add IF ADDR/PREFIX [--gw GW] | ip del IF ADDR | ip route [DEST]");
+}
+
+// ==================== 主菜单 ====================
+
+// 菜单项
+static const struct { char key; const char *label; } menu_items[] = {
+    { '0', "显示系统信息" },
+    { '1', "IP增删改查" },
+    { '2', "进程资源排行" },
+    { '3', "自动更换YUM/APT源" },
+    { '4', "资源压力监控" },
+    { '5', "CPU与内存基准测试" },
+    { '6', "磁盘基准测试" },
+    { '7', "NUMA访存矩阵" },
+};
+#define MENU_ITEM_COUNT ((int)(sizeof(menu_items) / sizeof(menu_items[0])))
+
+static const char *banner_lines[] = {
+    "||=============================||",
+    "||          Auto Script        ||",
+    "||          Version: 2.1       ||",
+    "||          Use: C语言         ||",
+    "||          By : 喝口雪碧      ||",
+    "||=============================||",
+};
+
+static struct termios menu_orig_termios;
+static int menu_raw = 0;
+
+// 恢复终端模式
+static void menu_cooked_mode() {
+    if (!menu_raw) return;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &menu_orig_termios);
+    menu_raw = 0;
+}
+
+// 设置终端为非规范模式（无缓冲，实时读取）
+static void menu_raw_mode() {
+    if (menu_raw) return;
+    struct termios raw = menu_orig_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+    menu_raw = 1;
+}
+
+// 执行菜单项，返回 1 表示退出菜单
+static int run_menu_action(char select) {
     switch (select) {
+        case '0':
+            system_info();
+            return 1;
         case '1':
-            // 添加IP
-            add_ip();
+            list_ip_config();
             break;
         case '2':
-            // 删除IP
-            delete_ip();
+            process_top();
             break;
         case '3':
-            // 替换IP
+            feature_3();
             break;
         case '4':
-            // 退出
+            psi_watch();
+            break;
+        case '5':
+            cpu_benchmark();
             break;
+        case '6':
+            disk_benchmark();
+            break;
+        case '7':
+            numa_benchmark();
+            break;
+        case 'q':
+        case 'Q':
+            printf("👋 正在退出程序。\n");
+            exit(0);
         default:
             printf("❗ 未知选项，请重新选择。\n");
             break;
     }
+    return 0;
 }
 
-// 菜单界面与用户交互
-static void menu() {
+// 绘制菜单帧
+static void draw_menu(int selected, int show_stats) {
+    int row = 0, i;
+    scr_clear();
+    for (i = 0; i < (int)(sizeof(banner_lines) / sizeof(banner_lines[0])); i++)
+        scr_put(row++, 0, 0, 0, banner_lines[i]);
+    row++;
+    scr_put(row++, 0, 35, SCR_BOLD, "警告：非新环境中请勿使用 'yum update'");
+    for (i = 0; i < MENU_ITEM_COUNT; i++) {
+        char label[128];
+        snprintf(label, sizeof(label), "%c、%s", menu_items[i].key, menu_items[i].label);
+        int col = scr_put(row, 0, 0, 0, i == selected ? " ▶ " : "   ");
+        scr_put(row++, col, 35, SCR_BOLD | (i == selected ? SCR_REVERSE : 0), label);
+    }
+    int col = scr_put(row, 0, 35, SCR_BOLD, "↑/↓ 选择，回车确认，数字直接选择，q 退出");
+    if (show_stats) {
+        char stats[64];
+        snprintf(stats, sizeof(stats), "  [上一帧 %zu 字节]", screen.last_frame_bytes);
+        scr_put(row, col, 0, 0, stats);
+    }
+    scr_park(row + 1, 0);
+    scr_flush();
+}
+
+// 无终端时（输入被重定向）沿用逐行菜单
+static void menu_plain() {
     char select;
     while (true) {
         printf("\n\e[1;35m警告：非新环境中请勿使用 'yum update'\e[0m\n");
-        printf("   \e[1;35m0、显示系统信息\e[0m\n");
-        printf("   \e[1;35m1、IP增删改查\e[0m\n");
-        printf("   \e[1;35m2、功能二\e[0m\n");
-        printf("   \e[1;35m3、自动更换YUM/APT源\e[0m\n");
-        printf("   \e[1;35m4、功能四\e[0m\n");
-        printf("   \e[1;35m5、功能五\e[0m\n");
-        printf("   \e[1;35m6、功能六\e[0m\n");
-        printf("   \e[1;35m7、功能七\e[0m\n");
+        int i;
+        for (i = 0; i < MENU_ITEM_COUNT; i++)
+            printf("   \e[1;35m%c、%s\e[0m\n", menu_items[i].key, menu_items[i].label);
         printf("\e[1;35m选择选项(0-9)，q 退出: \e[0m ");
 
-        scanf(" %c", &select); // 注意前面空格跳过空白字符
+        if (scanf(" %c", &select) != 1) exit(0); // 注意前面空格跳过空白字符
+        // 丢掉本行剩余内容，功能函数按行读取输入时不会读到残留的换行
+        int ch;
+        while ((ch = getchar()) != '\n' && ch != EOF) {}
+        if (run_menu_action(select)) return;
+    }
+}
 
-        switch (select) {
-            case '0':
-                system_info();
-                return;
-            case '1':
-                list_ip_config();
-                break;
-            case '2':
-                // 功能二的实现
-                break;
-            case '3':
-                feature_3();
-                break;
-            case '4':
-                // 功能四的实现
-                break;
-            case '5':
-                // 功能五的实现
-                break;
-            case '6':
-                // 功能六的实现
-                break;
-            case '7':
-                // 功能七的实现
-                break;
-            case 'q':
-            case 'Q':
-                printf("👋 正在退出程序。\n");
-                exit(0);
-            default:
-                printf("❗ 未知选项，请重新选择。\n");
-                break;
-        }
+// 执行选中的菜单项：恢复行模式让功能函数正常读取输入，结束后整屏重绘
+static int menu_dispatch(char key) {
+    scr_move(screen.park_row, 0);
+    menu_cooked_mode();
+    printf("\n");
+    int quit = run_menu_action(key);
+    if (quit) return 1;
+    // 丢弃功能函数留在 stdio 缓冲区里的输入（如 scanf 后的换行），再等待任意键
+    __fpurge(stdin);
+    printf("\n按任意键返回菜单...");
+    fflush(stdout);
+    menu_raw_mode();
+    if (read_key(-1) == KEY_NONE) return 1;
+    scr_invalidate();
+    return 0;
+}
+
+// 菜单界面与用户交互
+static void menu() {
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO) || tcgetattr(STDIN_FILENO, &menu_orig_termios) != 0) {
+        size_t i;
+        for (i = 0; i < sizeof(banner_lines) / sizeof(banner_lines[0]); i++) printf("%s\n", banner_lines[i]);
+        menu_plain();
+        return;
+    }
+    atexit(menu_cooked_mode);
+    menu_raw_mode();
+    fflush(stdout);
 
-        // 按回车继续
-        // printf("\n按 Enter 键继续...");
-        // while (getchar() != '\n'); // 清空输入缓冲
-        // getchar();                 // 等待按下回车
-        // printf("\033[H\033[J");     // 清屏（可选）
+    int show_stats = getenv("MENU_STATS") != NULL;
+    int selected = 0;
+    scr_invalidate();
+    draw_menu(selected, show_stats);
+
+    while (1) {
+        int c = read_key(-1);
+        if (c == KEY_NONE) break;
+        if (c == KEY_UP) {
+            selected = (selected + MENU_ITEM_COUNT - 1) % MENU_ITEM_COUNT;
+        } else if (c == KEY_DOWN) {
+            selected = (selected + 1) % MENU_ITEM_COUNT;
+        } else if (c == '\n' || c == '\r') {
+            if (menu_dispatch(menu_items[selected].key)) return;
+        } else if (c == 'q' || c == 'Q') {
+            scr_move(screen.park_row, 0);
+            menu_cooked_mode();
+            run_menu_action((char)c);
+        } else {
+            int i;
+            for (i = 0; i < MENU_ITEM_COUNT; i++) {
+                if (menu_items[i].key == c) break;
+            }
+            if (i == MENU_ITEM_COUNT) continue;
+            selected = i;
+            if (menu_dispatch((char)c)) return;
+        }
+        draw_menu(selected, show_stats);
     }
+    menu_cooked_mode();
 }
 
 // 权限检查
@@ -1371,15 +7984,40 @@ static void check_root() {
 }
 
 // 主入口函数
-int main(void) {
+int main(int argc, char *argv[]) {
+    // 脚本化子命令：不显示横幅和提示，结果输出 JSON
+    if (argc > 1 && is_cli_command(argv[1]))
+        return cli_main(argc - 1, argv + 1);
+    // 缓存代理模式不需要 root，也不进入菜单
+    if (argc > 1 && !strcmp(argv[1], "--cache-proxy"))
+        return run_cache_proxy(argc - 2, argv + 2);
+    // 查询采样历史只读文件，不需要 root
+    if (argc > 1 && !strcmp(argv[1], "--history"))
+        return history_query(argc - 2, argv + 2);
+    // 快照和基线比对只读取系统信息，不需要 root
+    if (argc > 1 && !strcmp(argv[1], "--snapshot"))
+        return snapshot_command(argc - 2, argv + 2);
+    if (argc > 1 && !strcmp(argv[1], "--drift"))
+        return drift_command(argc - 2, argv + 2);
+    if (argc > 1 && !strcmp(argv[1], "--aggregate"))
+        return aggregate_command(argc - 2, argv + 2);
+    // 磁盘测试只需要目标的读写权限
+    if (argc > 1 && !strcmp(argv[1], "--disk-bench"))
+        return disk_bench_command(argc - 2, argv + 2);
+
     check_root();
 
-    printf("||=============================||\n");
-    printf("||          Auto Script        ||\n");
-    printf("||          Version: 2.1       ||\n");
-    printf("||          Use: C语言         ||\n");
-    printf("||          By : 喝口雪碧      ||\n");
-    printf("||=============================||\n");
+    // 开机服务调用：按保存的配置重新应用网卡调优
+    if (argc > 1 && !strcmp(argv[1], "--apply-nic-tuning"))
+        return nic_apply_saved() ? 1 : 0;
+
+    // 读取 /dev/kmsg 需要 CAP_SYSLOG，游标保存在 /var/lib 下
+    if (argc > 1 && !strcmp(argv[1], "--kernel-events"))
+        return kernel_events_command(argc - 2, argv + 2);
+
+    // 定时任务或常驻进程调用：追加采样历史
+    if (argc > 1 && !strcmp(argv[1], "--history-record"))
+        return history_record(argc - 2, argv + 2);
 
     menu(); // 主菜单循环直到输入 q
 
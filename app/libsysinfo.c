@@ -0,0 +1,2610 @@
+#include "libsysinfo.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/sysinfo.h>   // 开机时间和负载
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>        // SIOCGIFCONF
+#include <arpa/inet.h>
+#include <pthread.h>        // 进程扫描的工作线程
+#include <sys/syscall.h>    // getdents64
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>  // TCP 连接统计
+#include <linux/inet_diag.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/mman.h>       // 采样历史文件
+#include <sys/file.h>       // flock
+#include <ifaddrs.h>         // 快照中的网卡地址
+#include <linux/rtnetlink.h>  // 路由表转储
+#include <regex.h>          // 内核事件归类
+
+#define SI_LINE_MAX 512
+
+// ==================== arena ====================
+
+void si_arena_init(SiArena *arena, void *buf, size_t size) {
+    arena->base = buf;
+    arena->size = size;
+    si_arena_reset(arena);
+}
+
+void si_arena_reset(SiArena *arena) {
+    arena->used = 0;
+    arena->exhausted = 0;
+}
+
+static char *si_arena_alloc(SiArena *arena, size_t n) {
+    if (arena->exhausted || n > arena->size - arena->used) {
+        arena->exhausted = 1;
+        return NULL;
+    }
+    char *p = arena->base + arena->used;
+    arena->used += n;
+    return p;
+}
+
+const char *si_arena_strdup(SiArena *arena, const char *s) {
+    size_t n = strlen(s) + 1;
+    char *p = si_arena_alloc(arena, n);
+    if (!p) return "";
+    memcpy(p, s, n);
+    return p;
+}
+
+const char *si_arena_printf(SiArena *arena, const char *fmt, ...) {
+    if (arena->exhausted || arena->used >= arena->size) {
+        arena->exhausted = 1;
+        return "";
+    }
+    char *p = arena->base + arena->used;
+    size_t room = arena->size - arena->used;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(p, room, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= room) {
+        arena->exhausted = 1;
+        return "";
+    }
+    arena->used += (size_t)n + 1;
+    return p;
+}
+
+// ==================== 文件读取（不经过 stdio，避免 FILE 缓冲区分配） ====================
+
+// 按行读取文件的固定缓冲区读取器
+typedef struct {
+    int fd;
+    char buf[4096];
+    size_t pos, len;
+} SiLineReader;
+
+static int si_reader_open(SiLineReader *r, const char *path) {
+    r->fd = open(path, O_RDONLY | O_CLOEXEC);
+    r->pos = r->len = 0;
+    return r->fd < 0 ? -1 : 0;
+}
+
+static void si_reader_close(SiLineReader *r) {
+    if (r->fd >= 0) close(r->fd);
+    r->fd = -1;
+}
+
+// 读取一行（去掉换行符，超长部分丢弃）；读到行返回 1，文件结束返回 0
+static int si_reader_next(SiLineReader *r, char *line, size_t size) {
+    size_t n = 0;
+    int got = 0;
+    for (;;) {
+        if (r->pos == r->len) {
+            ssize_t k;
+            do {
+                k = read(r->fd, r->buf, sizeof(r->buf));
+            } while (k < 0 && errno == EINTR);
+            if (k <= 0) break;
+            r->pos = 0;
+            r->len = (size_t)k;
+        }
+        got = 1;
+        char c = r->buf[r->pos++];
+        if (c == '\n') break;
+        if (n + 1 < size) line[n++] = c;
+    }
+    if (size) line[n] = '\0';
+    return got;
+}
+
+// 读取文件第一行到 buf（去除换行符）
+int si_read_line(const char *path, char *buf, size_t size) {
+    SiLineReader r;
+    if (si_reader_open(&r, path) != 0) return -1;
+    int got = si_reader_next(&r, buf, size);
+    si_reader_close(&r);
+    return got ? 0 : -1;
+}
+
+// 去除字符串两端的引号和空格
+void si_trim_quotes(char *str) {
+    char *src = str;
+    char *dst = str;
+
+    while (isspace((unsigned char)*src)) src++;
+    if (*src == '"' || *src == '\'') src++;
+
+    while (*src && !((*src == '"' || *src == '\'') && src[1] == '\0' && src != dst))
+        *dst++ = *src++;
+
+    while (dst > str && isspace((unsigned char)*(dst - 1)))
+        dst--;
+
+    *dst = '\0';
+}
+
+static int si_directory_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// ==================== 硬件型号 ====================
+
+// 执行命令读取第一行输出
+static int si_command_line(const char *cmd, char *buf, size_t size) {
+    FILE *fp = popen(cmd, "r");
+    if (!fp) return -1;
+    buf[0] = '\0';
+    if (fgets(buf, (int)size, fp))
+        buf[strcspn(buf, "\n")] = '\0';
+    pclose(fp);
+    return buf[0] ? 0 : -1;
+}
+
+// 硬件型号在运行期间不会变化，首次探测后缓存（Android 需要调用 getprop）
+static char si_model_cache[256];
+
+static void si_detect_hardware_model(char *out, size_t size) {
+    char a[128], b[128];
+
+    // Android 品牌和型号
+    if (si_directory_exists("/system/app") && si_directory_exists("/system/priv-app")
+        && si_command_line("getprop ro.product.brand", a, sizeof(a)) == 0
+        && si_command_line("getprop ro.product.model", b, sizeof(b)) == 0) {
+        snprintf(out, size, "%s %s", a, b);
+        return;
+    }
+
+    // DMI 设备信息（x86/PC/虚拟机）
+    if (si_read_line("/sys/devices/virtual/dmi/id/product_name", a, sizeof(a)) == 0
+        && si_read_line("/sys/devices/virtual/dmi/id/product_version", b, sizeof(b)) == 0) {
+        snprintf(out, size, "%s %s", a, b);
+        return;
+    }
+
+    // ARM 设备树信息，其次是 tmp 文件缓存
+    if (si_read_line("/sys/firmware/devicetree/base/model", out, size) == 0) return;
+    if (si_read_line("/tmp/sysinfo/model", out, size) == 0) return;
+
+    snprintf(out, size, "Unknown Hardware");
+}
+
+const char *si_probe_hardware_model(SiArena *arena) {
+    if (!si_model_cache[0])
+        si_detect_hardware_model(si_model_cache, sizeof(si_model_cache));
+    return si_arena_strdup(arena, si_model_cache);
+}
+
+// ==================== 发行版 ====================
+
+static int si_load_os_release(const char *path, SiDistro *distro, SiArena *arena) {
+    SiLineReader r;
+    if (si_reader_open(&r, path) != 0) return -1;
+
+    char line[SI_LINE_MAX];
+    distro->name = distro->version = NULL;
+    while ((!distro->name || !distro->version) && si_reader_next(&r, line, sizeof(line))) {
+        if (line[0] == '#' || line[0] == '\0') continue;
+        char *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        si_trim_quotes(eq + 1);
+        if (!strcmp(line, "NAME"))
+            distro->name = si_arena_strdup(arena, eq + 1);
+        else if (!strcmp(line, "VERSION_ID"))
+            distro->version = si_arena_strdup(arena, eq + 1);
+    }
+    si_reader_close(&r);
+    return (distro->name && distro->version) ? 0 : -1;
+}
+
+int si_probe_distro(SiDistro *distro, SiArena *arena) {
+    if (si_load_os_release("/etc/os-release", distro, arena) == 0)
+        return 0;
+
+    const char *paths[] = {
+        "/etc/lsb-release",
+        "/etc/fedora-release",
+        "/etc/centos-release"
+    };
+    char line[SI_LINE_MAX];
+    size_t i;
+    for (i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        if (access(paths[i], R_OK) != 0) continue;
+        if (si_read_line(paths[i], line, sizeof(line)) != 0) line[0] = '\0';
+        line[strcspn(line, " ")] = '\0';
+        distro->name = si_arena_strdup(arena, line);
+        distro->version = "";
+        return 0;
+    }
+
+#ifdef __FreeBSD__
+    char name[128], version[128];
+    if (si_command_line("uname -sr", line, sizeof(line)) == 0
+        && sscanf(line, "%127s %127s", name, version) == 2) {
+        distro->name = si_arena_strdup(arena, name);
+        distro->version = si_arena_strdup(arena, version);
+        return 0;
+    }
+#endif
+
+    distro->name = "Unknown";
+    distro->version = "Unknown";
+    return -1;
+}
+
+// ==================== CPU ====================
+
+int si_probe_cpu(SiCpu *cpu, SiArena *arena) {
+    cpu->model = "Unknown";
+    cpu->logical_cores = 0;
+
+    SiLineReader r;
+    if (si_reader_open(&r, "/proc/cpuinfo") == 0) {
+        char line[SI_LINE_MAX];
+        int have_model = 0;
+        while (si_reader_next(&r, line, sizeof(line))) {
+            // 获取 CPU 型号
+            if (!have_model && strncmp(line, "model name", 10) == 0) {
+                char *colon = strchr(line, ':');
+                if (colon) {
+                    const char *model = colon + 1;
+                    while (*model == ' ') model++;
+                    cpu->model = si_arena_strdup(arena, model);
+                    have_model = 1;
+                }
+            }
+            // 统计逻辑处理器数量
+            if (strncmp(line, "processor", 9) == 0 && line[9] == '\t')
+                cpu->logical_cores++;
+        }
+        si_reader_close(&r);
+    }
+
+    // Fallback 到 sysconf 如果 processor 行不存在
+    if (cpu->logical_cores == 0)
+        cpu->logical_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return 0;
+}
+
+// ==================== 内存 ====================
+
+// 内存条总量（通过 dmidecode），硬件不变，首次调用后缓存
+static double si_phys_cache = -1;
+
+static double si_dmi_phys_mem() {
+    if (si_phys_cache >= 0) return si_phys_cache;
+
+    FILE *fp = popen("sudo dmidecode -t memory | grep 'Size' | grep -v 'No Module Installed'", "r");
+    if (!fp) return 0;
+
+    double total = 0;
+    char line[256];
+    int size;
+    char unit[16];
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, " Size: %d %15s", &size, unit) == 2) {
+            if (!strcmp(unit, "MB")) total += size / 1024.0;
+            else if (!strcmp(unit, "GB")) total += size;
+        }
+    }
+    pclose(fp);
+    si_phys_cache = total;
+    return total;
+}
+
+int si_probe_memory(SiMemory *mem, int with_dmi) {
+    mem->phys_total = with_dmi ? si_dmi_phys_mem() : 0;
+    mem->total = mem->available = 0;
+
+    SiLineReader r;
+    if (si_reader_open(&r, "/proc/meminfo") != 0) return -1;
+    char line[SI_LINE_MAX];
+    int found = 0;
+    while (found < 2 && si_reader_next(&r, line, sizeof(line))) {
+        char *colon = strchr(line, ':');
+        if (!colon) continue;
+        *colon = '\0';
+        double kb = strtod(colon + 1, NULL);
+        if (!strcmp(line, "MemTotal")) {
+            mem->total = kb / (1024.0 * 1024.0);   // KB -> GiB
+            found++;
+        } else if (!strcmp(line, "MemAvailable")) {
+            mem->available = kb / (1024.0 * 1024.0);
+            found++;
+        }
+    }
+    si_reader_close(&r);
+    return found ? 0 : -1;
+}
+
+// ==================== 负载与开机时长 ====================
+
+int si_probe_load(double load[3]) {
+    struct sysinfo info;
+    int i;
+    if (sysinfo(&info) != 0) {
+        for (i = 0; i < 3; i++) load[i] = 0;
+        return -1;
+    }
+    for (i = 0; i < 3; i++)
+        load[i] = info.loads[i] / (double)(1 << SI_LOAD_SHIFT);
+    return 0;
+}
+
+int si_probe_uptime(SiUptime *uptime) {
+    struct sysinfo info;
+    memset(uptime, 0, sizeof(*uptime));
+    if (sysinfo(&info) != 0) return -1;
+    uptime->seconds = info.uptime;
+    uptime->days = (int)(info.uptime / (60*60*24));
+    uptime->hours = (int)((info.uptime % (60*60*24)) / 3600);
+    uptime->minutes = (int)((info.uptime % 3600) / 60);
+    uptime->secs = (int)(info.uptime % 60);
+    return 0;
+}
+
+// ==================== 本机 IP ====================
+
+// 第一个非 lo 的 IPv4 地址（SIOCGIFCONF 填充栈上数组，不像 getifaddrs 那样分配链表）
+int si_probe_local_ip(char *buf, size_t size) {
+    struct ifreq ifr[64];
+    struct ifconf ifc;
+    buf[0] = '\0';
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    ifc.ifc_len = sizeof(ifr);
+    ifc.ifc_req = ifr;
+    int rc = ioctl(fd, SIOCGIFCONF, &ifc);
+    close(fd);
+    if (rc != 0) return -1;
+
+    int i, n = ifc.ifc_len / (int)sizeof(struct ifreq);
+    for (i = 0; i < n; i++) {
+        if (ifr[i].ifr_addr.sa_family != AF_INET || !strcmp(ifr[i].ifr_name, "lo"))
+            continue;
+        struct sockaddr_in *sa = (struct sockaddr_in *)&ifr[i].ifr_addr;
+        if (inet_ntop(AF_INET, &sa->sin_addr, buf, (socklen_t)size))
+            return 0;
+    }
+    return -1;
+}
+
+// ==================== 资源压力（PSI） ====================
+
+static const char *si_psi_names[SI_PSI_KINDS] = { "cpu", "memory", "io" };
+
+const char *si_psi_name(int kind) {
+    return (kind >= 0 && kind < SI_PSI_KINDS) ? si_psi_names[kind] : "?";
+}
+
+static void si_psi_path(const char *cgroup_dir, int kind, char *buf, size_t size) {
+    if (cgroup_dir)
+        snprintf(buf, size, "%s/%s.pressure", cgroup_dir, si_psi_name(kind));
+    else
+        snprintf(buf, size, "/proc/pressure/%s", si_psi_name(kind));
+}
+
+// 格式：some avg10=0.00 avg60=0.00 avg300=0.00 total=0（full 行相同）
+int si_probe_psi(SiPsi *psi, const char *cgroup_dir, int kind) {
+    char path[512], line[SI_LINE_MAX];
+    memset(psi, 0, sizeof(*psi));
+    si_psi_path(cgroup_dir, kind, path, sizeof(path));
+
+    SiLineReader r;
+    if (si_reader_open(&r, path) != 0) return -1;
+    while (si_reader_next(&r, line, sizeof(line))) {
+        double avg[3];
+        unsigned long long total;
+        if (sscanf(line + 5, "avg10=%lf avg60=%lf avg300=%lf total=%llu",
+                   &avg[0], &avg[1], &avg[2], &total) != 4)
+            continue;
+        if (!strncmp(line, "some ", 5)) {
+            memcpy(psi->some, avg, sizeof(avg));
+            psi->some_total = total;
+            psi->present = 1;
+        } else if (!strncmp(line, "full ", 5)) {
+            memcpy(psi->full, avg, sizeof(avg));
+            psi->full_total = total;
+        }
+    }
+    si_reader_close(&r);
+    return psi->present ? 0 : -1;
+}
+
+int si_psi_trigger(const char *cgroup_dir, int kind, int full, unsigned int stall_us, unsigned int window_us) {
+    char path[512], spec[64];
+    si_psi_path(cgroup_dir, kind, path, sizeof(path));
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -1;
+    // 触发器描述需连同结尾的 '\0' 一起写入，fd 关闭时触发器自动注销
+    int len = snprintf(spec, sizeof(spec), "%s %u %u", full ? "full" : "some", stall_us, window_us);
+    if (write(fd, spec, (size_t)len + 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ==================== cgroup v2 ====================
+
+// cgroup v2 挂载点和挂载根，挂载关系运行期间基本不变，首次查找后缓存
+static char si_cg_mount[256];
+static char si_cg_mount_root[256];
+static int si_cg_mount_state;    // 0 未查找，1 已找到，-1 不存在
+
+static int si_find_cgroup2_mount() {
+    if (si_cg_mount_state) return si_cg_mount_state > 0 ? 0 : -1;
+    si_cg_mount_state = -1;
+
+    SiLineReader r;
+    if (si_reader_open(&r, "/proc/self/mountinfo") != 0) return -1;
+    char line[1024];
+    while (si_reader_next(&r, line, sizeof(line))) {
+        // 格式：ID 父ID 主:次 挂载根 挂载点 选项... - 类型 来源 超级块选项
+        char *sep = strstr(line, " - ");
+        if (!sep || strncmp(sep + 3, "cgroup2 ", 8) != 0) continue;
+        char root[256], mount[256];
+        if (sscanf(line, "%*s %*s %*s %255s %255s", root, mount) != 2) continue;
+        snprintf(si_cg_mount, sizeof(si_cg_mount), "%s", mount);
+        snprintf(si_cg_mount_root, sizeof(si_cg_mount_root), "%s", strcmp(root, "/") ? root : "");
+        si_cg_mount_state = 1;
+        break;
+    }
+    si_reader_close(&r);
+    return si_cg_mount_state > 0 ? 0 : -1;
+}
+
+// 读取 dir/name 的第一行；路径放不下时按读取失败处理（即限制未知），不去读截断后的别的文件
+static int si_cg_read(const char *dir, const char *name, char *buf, size_t size) {
+    char path[512];
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return si_read_line(path, buf, size);
+}
+
+// 读取单个数值文件，"max" 和不可读都返回 -1
+static long long si_cg_read_value(const char *dir, const char *name) {
+    char buf[64];
+    if (si_cg_read(dir, name, buf, sizeof(buf)) != 0 || !strncmp(buf, "max", 3)) return -1;
+    return strtoll(buf, NULL, 10);
+}
+
+// 解析 "0-3,6,8-9" 形式的 CPU 列表，cpus 为 NULL 时只计数
+int si_parse_cpu_list(const char *list, int *cpus, int max) {
+    int count = 0;
+    while (*list) {
+        char *end;
+        long a = strtol(list, &end, 10);
+        if (end == list) break;
+        long b = a, c;
+        if (*end == '-') b = strtol(end + 1, &end, 10);
+        for (c = a; c <= b; c++, count++)
+            if (cpus && count < max) cpus[count] = (int)c;
+        list = end;
+        if (*list == ',') list++;
+    }
+    return cpus && count > max ? max : count;
+}
+
+// 读取 key value 形式的统计文件，按 keys 填入 values（未出现的保持 -1）
+static void si_cg_read_keyed(const char *dir, const char *name,
+                             const char *const *keys, long long *const *values, int n) {
+    char path[512], line[SI_LINE_MAX];
+    int i, found = 0;
+    for (i = 0; i < n; i++) *values[i] = -1;
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    SiLineReader r;
+    if (si_reader_open(&r, path) != 0) return;
+    while (found < n && si_reader_next(&r, line, sizeof(line))) {
+        char *space = strchr(line, ' ');
+        if (!space) continue;
+        *space = '\0';
+        for (i = 0; i < n; i++) {
+            if (!strcmp(line, keys[i])) {
+                *values[i] = strtoll(space + 1, NULL, 10);
+                found++;
+                break;
+            }
+        }
+    }
+    si_reader_close(&r);
+}
+
+int si_probe_cgroup_at(SiCgroup *cg, const char *root, const char *dir, SiArena *arena) {
+    char buf[SI_LINE_MAX], walk[512];
+    size_t root_len = strlen(root);
+    int kind;
+
+    memset(cg, 0, sizeof(*cg));
+    cg->path = si_arena_strdup(arena, dir[root_len] ? dir + root_len : "/");
+    cg->dir = si_arena_strdup(arena, dir);
+    cg->cpuset = "";
+    cg->cpu_quota_us = cg->cpu_period_us = -1;
+    cg->mem_max = cg->pids_max = -1;
+
+    if (access(dir, R_OK) != 0) return -1;
+    cg->present = 1;
+
+    // 限制可能设在任意一级祖先上，逐级向上取最紧的值
+    snprintf(walk, sizeof(walk), "%s", dir);
+    for (;;) {
+        long long quota, period, v;
+        if (si_cg_read(walk, "cpu.max", buf, sizeof(buf)) == 0
+            && sscanf(buf, "%lld %lld", &quota, &period) == 2 && quota > 0 && period > 0
+            && (cg->cpu_quota_us < 0
+                || (double)quota / period < (double)cg->cpu_quota_us / cg->cpu_period_us)) {
+            cg->cpu_quota_us = quota;
+            cg->cpu_period_us = period;
+        }
+        v = si_cg_read_value(walk, "memory.max");
+        if (v >= 0 && (cg->mem_max < 0 || v < cg->mem_max)) cg->mem_max = v;
+        v = si_cg_read_value(walk, "pids.max");
+        if (v >= 0 && (cg->pids_max < 0 || v < cg->pids_max)) cg->pids_max = v;
+
+        char *slash = strrchr(walk, '/');
+        if (strlen(walk) <= root_len || !slash || (size_t)(slash - walk) < root_len) break;
+        *slash = '\0';
+    }
+
+    // 其余数据只看进程所在的叶子 cgroup
+    if (si_cg_read(dir, "cpuset.cpus.effective", buf, sizeof(buf)) == 0 && buf[0]) {
+        cg->cpuset = si_arena_strdup(arena, buf);
+        cg->cpuset_count = si_parse_cpu_list(buf, NULL, 0);
+    }
+    cg->effective_cpus = cg->cpuset_count ? cg->cpuset_count : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cg->cpu_quota_us > 0 && (double)cg->cpu_quota_us / cg->cpu_period_us < cg->effective_cpus)
+        cg->effective_cpus = (double)cg->cpu_quota_us / cg->cpu_period_us;
+
+    cg->mem_current = si_cg_read_value(dir, "memory.current");
+    cg->pids_current = si_cg_read_value(dir, "pids.current");
+    {
+        const char *const keys[] = { "anon", "file" };
+        long long *const values[] = { &cg->mem_anon, &cg->mem_file };
+        si_cg_read_keyed(dir, "memory.stat", keys, values, 2);
+    }
+    {
+        const char *const keys[] = { "nr_periods", "nr_throttled", "throttled_usec" };
+        long long *const values[] = { &cg->nr_periods, &cg->nr_throttled, &cg->throttled_usec };
+        si_cg_read_keyed(dir, "cpu.stat", keys, values, 3);
+    }
+    for (kind = 0; kind < SI_PSI_KINDS; kind++)
+        si_probe_psi(&cg->psi[kind], dir, kind);
+    return 0;
+}
+
+int si_probe_cgroup(SiCgroup *cg, SiArena *arena) {
+    char line[SI_LINE_MAX], dir[512];
+    const char *rel = NULL;
+
+    memset(cg, 0, sizeof(*cg));
+    cg->path = cg->dir = cg->cpuset = "";
+    if (si_find_cgroup2_mount() != 0) return -1;
+
+    // cgroup v2 的条目形如 "0::/system.slice/foo.service"
+    SiLineReader r;
+    if (si_reader_open(&r, "/proc/self/cgroup") == 0) {
+        while (si_reader_next(&r, line, sizeof(line))) {
+            if (!strncmp(line, "0::", 3)) {
+                rel = line + 3;
+                break;
+            }
+        }
+        si_reader_close(&r);
+    }
+    if (!rel) rel = "/";
+
+    // 挂载根不是 / 时（未启用 cgroup 命名空间的容器），路径需去掉挂载根前缀
+    size_t root_len = strlen(si_cg_mount_root);
+    if (root_len && !strncmp(rel, si_cg_mount_root, root_len)) rel += root_len;
+    // 路径过长时视为没有 cgroup 信息，不探测截断后的上级目录
+    if (snprintf(dir, sizeof(dir), "%s%s", si_cg_mount, strcmp(rel, "/") ? rel : "") >= (int)sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return si_probe_cgroup_at(cg, si_cg_mount, dir, arena);
+}
+
+// ==================== 汇总采集 ====================
+
+int si_collect(SiReport *report, SiArena *arena, unsigned int flags) {
+    int i;
+    si_arena_reset(arena);
+    if (uname(&report->uts) == -1)
+        return -1;
+
+    report->now = time(NULL);
+    report->hardware_model = si_probe_hardware_model(arena);
+    report->distro_ok = si_probe_distro(&report->distro, arena) == 0;
+    si_probe_cpu(&report->cpu, arena);
+    si_probe_memory(&report->mem, (flags & SI_PROBE_DMI) != 0);
+    si_probe_load(report->load);
+    si_probe_uptime(&report->uptime);
+    si_probe_local_ip(report->local_ip, sizeof(report->local_ip));
+    for (i = 0; i < SI_PSI_KINDS; i++)
+        si_probe_psi(&report->psi[i], NULL, i);
+    si_probe_cgroup(&report->cgroup, arena);
+    return 0;
+}
+
+// ==================== 进程资源排行 ====================
+
+// 每个工作线程的状态：独立的读缓冲区和局部排行，结束后再合并，扫描期间无需加锁
+typedef struct {
+    int proc_fd;
+    const int *pids;
+    int pid_count;
+    int *next;               // 共享的分片游标（原子递增）
+    int n;
+    int with_pss;
+    long page_kb;
+    double ticks_per_sec;
+    pthread_t thread;
+    SiProcTop part;
+    char buf[4096];
+} SiScanWorker;
+
+#define SI_SCAN_CHUNK 64
+
+static double si_top_key(const SiProcess *p, int kind) {
+    switch (kind) {
+        case SI_TOP_RSS: return (double)p->rss_kb;
+        case SI_TOP_PSS: return (double)p->pss_kb;
+        case SI_TOP_CPU: return p->cpu_seconds;
+        default: return p->threads;
+    }
+}
+
+// 插入降序排行，列表未满或大于末尾时才会移动数据
+static void si_top_insert(SiProcess *list, int count, int n, const SiProcess *p, int kind) {
+    double key = si_top_key(p, kind);
+    int i = count < n ? count : n - 1;
+    if (count >= n && key <= si_top_key(&list[n - 1], kind)) return;
+    while (i > 0 && si_top_key(&list[i - 1], kind) < key) {
+        list[i] = list[i - 1];
+        i--;
+    }
+    list[i] = *p;
+}
+
+static void si_top_add(SiProcTop *t, int n, const SiProcess *p) {
+    int kind;
+    for (kind = 0; kind < SI_TOP_KINDS; kind++)
+        si_top_insert(t->top[kind], t->n, n, p, kind);
+    if (t->n < n) t->n++;
+}
+
+// 读取 /proc/<pid>/<name>，进程已退出时返回 -1
+static ssize_t si_read_proc(int proc_fd, int pid, const char *name, char *buf, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "%d/%s", pid, name);
+    int fd = openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0) return -1;
+    buf[len] = '\0';
+    return len;
+}
+
+static int si_scan_one(SiScanWorker *w, int pid, SiProcess *p) {
+    char *buf = w->buf;
+    memset(p, 0, sizeof(*p));
+    p->pid = pid;
+    p->pss_kb = -1;
+
+    // stat：comm 可能含空格和括号，以最后一个 ')' 为界
+    if (si_read_proc(w->proc_fd, pid, "stat", buf, sizeof(w->buf)) <= 0) return -1;
+    char *open_paren = strchr(buf, '(');
+    char *close_paren = strrchr(buf, ')');
+    if (!open_paren || !close_paren || close_paren < open_paren) return -1;
+    size_t comm_len = (size_t)(close_paren - open_paren - 1);
+    if (comm_len >= sizeof(p->comm)) comm_len = sizeof(p->comm) - 1;
+    memcpy(p->comm, open_paren + 1, comm_len);
+    p->comm[comm_len] = '\0';
+
+    // ')' 之后从第 3 个字段（state）开始：utime 第 14，stime 第 15，num_threads 第 20，
+    // rss 第 24（与 statm 的 resident 相同，省去一次 open）
+    unsigned long long utime = 0, stime = 0;
+    long threads = 0;
+    long long resident_pages = 0;
+    if (sscanf(close_paren + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %ld %*d %*u %*u %lld",
+               &utime, &stime, &threads, &resident_pages) != 4)
+        return -1;
+    p->cpu_seconds = (utime + stime) / w->ticks_per_sec;
+    p->threads = (int)threads;
+    p->rss_kb = resident_pages * w->page_kb;
+
+    // 内核线程没有用户态内存（打开 smaps_rollup 会返回 ESRCH），直接跳过；
+    // stat 已读到说明进程仍在，此处失败只记为 PSS 不可用
+    if (w->with_pss && p->rss_kb > 0) {
+        ssize_t len = si_read_proc(w->proc_fd, pid, "smaps_rollup", buf, sizeof(w->buf));
+        if (len > 0) {
+            char *pss = strstr(buf, "\nPss:");
+            if (pss) p->pss_kb = strtoll(pss + 5, NULL, 10);
+        } else if (len < 0 && errno == EACCES) {
+            w->part.pss_denied++;
+        }
+    }
+    return 0;
+}
+
+static void *si_scan_worker(void *arg) {
+    SiScanWorker *w = arg;
+    for (;;) {
+        int start = __sync_fetch_and_add(w->next, SI_SCAN_CHUNK);
+        if (start >= w->pid_count) break;
+        int end = start + SI_SCAN_CHUNK < w->pid_count ? start + SI_SCAN_CHUNK : w->pid_count;
+        int i;
+        for (i = start; i < end; i++) {
+            SiProcess p;
+            if (si_scan_one(w, w->pids[i], &p) != 0) {
+                w->part.vanished++;
+                continue;
+            }
+            w->part.scanned++;
+            si_top_add(&w->part, w->n, &p);
+        }
+    }
+    return NULL;
+}
+
+// getdents64 列出 /proc 下的数字目录
+static int si_list_pids(int proc_fd, int **pids_out) {
+    char buf[32768];
+    int *pids = NULL;
+    int count = 0, cap = 0;
+    lseek(proc_fd, 0, SEEK_SET);
+    for (;;) {
+        long len = syscall(SYS_getdents64, proc_fd, buf, sizeof(buf));
+        if (len <= 0) break;
+        long off = 0;
+        while (off < len) {
+            struct si_dirent64 {
+                unsigned long long d_ino;
+                long long d_off;
+                unsigned short d_reclen;
+                unsigned char d_type;
+                char d_name[];
+            } *d = (struct si_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            if (d->d_name[0] < '1' || d->d_name[0] > '9') continue;
+            if (count == cap) {
+                int *grown = realloc(pids, (cap ? cap * 2 : 1024) * sizeof(int));
+                if (!grown) break;
+                pids = grown;
+                cap = cap ? cap * 2 : 1024;
+            }
+            pids[count++] = atoi(d->d_name);
+        }
+    }
+    *pids_out = pids;
+    return count;
+}
+
+int si_scan_processes(SiProcTop *result, int n, int workers, int with_pss) {
+    struct timespec t0, t1;
+    int i, kind, next = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    memset(result, 0, sizeof(*result));
+    if (n > SI_TOP_MAX) n = SI_TOP_MAX;
+    if (n < 1) n = 1;
+
+    int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0) return -1;
+    int *pids;
+    int pid_count = si_list_pids(proc_fd, &pids);
+
+    // 线程数：默认按在线 CPU，每个线程至少分到几个分片
+    if (workers <= 0) workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > 64) workers = 64;
+    if (workers > pid_count / (SI_SCAN_CHUNK * 2)) workers = pid_count / (SI_SCAN_CHUNK * 2);
+    if (workers < 1) workers = 1;
+
+    SiScanWorker *w = calloc((size_t)workers, sizeof(SiScanWorker));
+    if (!w) {
+        free(pids);
+        close(proc_fd);
+        return -1;
+    }
+    for (i = 0; i < workers; i++) {
+        w[i].proc_fd = proc_fd;
+        w[i].pids = pids;
+        w[i].pid_count = pid_count;
+        w[i].next = &next;
+        w[i].n = n;
+        w[i].with_pss = with_pss;
+        w[i].page_kb = sysconf(_SC_PAGESIZE) / 1024;
+        w[i].ticks_per_sec = (double)sysconf(_SC_CLK_TCK);
+    }
+    // 第 0 份在当前线程执行，创建失败的线程也由当前线程兜底
+    for (i = 1; i < workers; i++)
+        if (pthread_create(&w[i].thread, NULL, si_scan_worker, &w[i]) != 0)
+            w[i].thread = 0;
+    si_scan_worker(&w[0]);
+    for (i = 1; i < workers; i++)
+        if (w[i].thread) pthread_join(w[i].thread, NULL);
+
+    // 合并各线程的局部排行
+    for (i = 0; i < workers; i++) {
+        result->scanned += w[i].part.scanned;
+        result->vanished += w[i].part.vanished;
+        result->pss_denied += w[i].part.pss_denied;
+        int j, merged = result->n;
+        for (kind = 0; kind < SI_TOP_KINDS; kind++) {
+            for (j = 0; j < w[i].part.n; j++) {
+                int count = merged + j < n ? merged + j : n;
+                si_top_insert(result->top[kind], count, n, &w[i].part.top[kind][j], kind);
+            }
+        }
+        result->n = merged + w[i].part.n < n ? merged + w[i].part.n : n;
+    }
+
+    result->workers = workers;
+    free(w);
+    free(pids);
+    close(proc_fd);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    result->elapsed_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    return 0;
+}
+
+// ==================== TCP 连接统计 ====================
+
+static const char *si_tcp_state_names[SI_TCP_STATES] = {
+    "UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2",
+    "TIME_WAIT", "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING"
+};
+
+#define SI_TCP_LISTEN 10
+
+const char *si_tcp_state_name(int state) {
+    return (state > 0 && state < SI_TCP_STATES) ? si_tcp_state_names[state] : "UNKNOWN";
+}
+
+// IPv4 远端取 /24，IPv6 取 /64；最高位标记 IPv4，避免和 IPv6 前缀冲突
+static unsigned long long si_remote_key(const struct inet_diag_msg *m) {
+    const unsigned char *a = (const unsigned char *)m->id.idiag_dst;
+    if (m->idiag_family == AF_INET)
+        return (1ULL << 63) | ((unsigned long long)a[0] << 16) | ((unsigned long long)a[1] << 8) | a[2];
+    unsigned long long key = 0;
+    int i;
+    for (i = 0; i < 8; i++) key = (key << 8) | a[i];
+    return key & ~(1ULL << 63);
+}
+
+void si_sock_remote_str(unsigned long long key, char *buf, size_t size) {
+    if (key >> 63) {
+        snprintf(buf, size, "%llu.%llu.%llu.0/24", (key >> 16) & 0xff, (key >> 8) & 0xff, key & 0xff);
+    } else {
+        unsigned char a[16] = {0};
+        int i;
+        for (i = 0; i < 8; i++) a[i] = (unsigned char)(key >> (56 - 8 * i));
+        char addr[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, a, addr, sizeof(addr));
+        snprintf(buf, size, "%s/64", addr);
+    }
+}
+
+// 开放寻址计数，表满时只记溢出数，内存不随连接数增长
+static void si_remote_count(SiSockScan *scan, unsigned long long key) {
+    unsigned long long h = key * 0x9E3779B97F4A7C15ULL;
+    unsigned int i = (unsigned int)(h >> 50) & (SI_REMOTE_BUCKETS - 1);
+    unsigned int probes;
+    for (probes = 0; probes < SI_REMOTE_BUCKETS; probes++) {
+        SiRemoteBucket *b = &scan->remotes[i];
+        if (b->count && b->key == key) {
+            b->count++;
+            return;
+        }
+        if (b->count == 0) {
+            if (scan->remote_used >= SI_REMOTE_BUCKETS * 3 / 4) break;
+            b->key = key;
+            b->count = 1;
+            scan->remote_used++;
+            return;
+        }
+        i = (i + 1) & (SI_REMOTE_BUCKETS - 1);
+    }
+    scan->remote_overflow++;
+}
+
+static void si_listener_add(SiSockScan *scan, const struct inet_diag_msg *m) {
+    SiListener l;
+    l.family = m->idiag_family;
+    l.port = ntohs(m->id.idiag_sport);
+    l.rqueue = m->idiag_rqueue;
+    l.backlog = m->idiag_wqueue;
+    inet_ntop(m->idiag_family, m->id.idiag_src, l.addr, sizeof(l.addr));
+
+    int i = scan->listener_count < SI_SOCK_TOP ? scan->listener_count : SI_SOCK_TOP - 1;
+    if (scan->listener_count >= SI_SOCK_TOP && l.rqueue <= scan->listeners[i].rqueue) return;
+    while (i > 0 && scan->listeners[i - 1].rqueue < l.rqueue) {
+        scan->listeners[i] = scan->listeners[i - 1];
+        i--;
+    }
+    scan->listeners[i] = l;
+    if (scan->listener_count < SI_SOCK_TOP) scan->listener_count++;
+}
+
+static void si_sock_account(SiSockScan *scan, const struct inet_diag_msg *m) {
+    int state = m->idiag_state < SI_TCP_STATES ? m->idiag_state : 0;
+    scan->states[state]++;
+    scan->total++;
+    if (state == SI_TCP_LISTEN) {
+        scan->listen_total++;
+        si_listener_add(scan, m);
+        return;
+    }
+    scan->port_counts[ntohs(m->id.idiag_sport)]++;
+    si_remote_count(scan, si_remote_key(m));
+}
+
+// 对一个地址族发起 inet_diag 转储，边收边统计
+static int si_sock_dump(int fd, SiSockScan *scan, int family, unsigned int state_mask) {
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } msg;
+    struct sockaddr_nl nladdr;
+    memset(&msg, 0, sizeof(msg));
+    memset(&nladdr, 0, sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    msg.nlh.nlmsg_seq = (unsigned int)family;
+    msg.req.sdiag_family = (unsigned char)family;
+    msg.req.sdiag_protocol = IPPROTO_TCP;
+    msg.req.idiag_states = state_mask;
+    if (sendto(fd, &msg, sizeof(msg), 0, (struct sockaddr *)&nladdr, sizeof(nladdr)) < 0)
+        return -1;
+
+    // 固定大小的接收缓冲区（64KB，足够容纳内核单批转储），每批处理完即丢弃
+    long buf[8192];
+    for (;;) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        struct nlmsghdr *h = (struct nlmsghdr *)buf;
+        for (; NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_type == NLMSG_DONE) return 0;
+            if (h->nlmsg_type == NLMSG_ERROR) {
+                struct nlmsgerr *err = NLMSG_DATA(h);
+                errno = err->error ? -err->error : EIO;
+                return -1;
+            }
+            if (h->nlmsg_type == SOCK_DIAG_BY_FAMILY)
+                si_sock_account(scan, NLMSG_DATA(h));
+        }
+    }
+}
+
+int si_scan_sockets(SiSockScan *scan, unsigned int state_mask) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    memset(scan, 0, sizeof(*scan));
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) return -1;
+    int rc = si_sock_dump(fd, scan, AF_INET, state_mask);
+    // 未启用 IPv6 的内核会返回错误，不影响 IPv4 的结果
+    if (rc == 0) si_sock_dump(fd, scan, AF_INET6, state_mask);
+    close(fd);
+
+    // 孤儿连接由内核直接计数（inode 为 0 的还可能是尚未 accept 的连接，不能据此判断）
+    SiLineReader r;
+    if (si_reader_open(&r, "/proc/net/sockstat") == 0) {
+        char line[SI_LINE_MAX];
+        while (si_reader_next(&r, line, sizeof(line))) {
+            char *orphan = strstr(line, " orphan ");
+            if (!strncmp(line, "TCP:", 4) && orphan) {
+                scan->orphans = (unsigned int)strtoul(orphan + 8, NULL, 10);
+                break;
+            }
+        }
+        si_reader_close(&r);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    scan->elapsed_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    return rc;
+}
+
+int si_sock_top_ports(const SiSockScan *scan, int *ports, unsigned int *counts, int n) {
+    int port, count = 0;
+    for (port = 0; port < 65536; port++) {
+        unsigned int c = scan->port_counts[port];
+        if (!c || (count == n && c <= counts[n - 1])) continue;
+        int i = count < n ? count : n - 1;
+        while (i > 0 && counts[i - 1] < c) {
+            ports[i] = ports[i - 1];
+            counts[i] = counts[i - 1];
+            i--;
+        }
+        ports[i] = port;
+        counts[i] = c;
+        if (count < n) count++;
+    }
+    return count;
+}
+
+int si_sock_top_remotes(const SiSockScan *scan, SiRemoteBucket *out, int n) {
+    int b, count = 0;
+    for (b = 0; b < SI_REMOTE_BUCKETS; b++) {
+        const SiRemoteBucket *r = &scan->remotes[b];
+        if (!r->count || (count == n && r->count <= out[n - 1].count)) continue;
+        int i = count < n ? count : n - 1;
+        while (i > 0 && out[i - 1].count < r->count) {
+            out[i] = out[i - 1];
+            i--;
+        }
+        out[i] = *r;
+        if (count < n) count++;
+    }
+    return count;
+}
+
+// ==================== 中断分布 ====================
+
+// 动作名末尾的数字作为队列号（eth0-TxRx-3、virtio3-input.0），以 config 等结尾的为 -1。
+// mlx5 的完成队列形如 mlx5_comp3@pci:0000:3b:00.0，去掉 @ 之后的设备后缀，数字紧跟在 comp 之后
+static int si_irq_queue(const char *desc) {
+    size_t len = strcspn(desc, "@");
+    size_t i = len;
+    while (i > 0 && isdigit((unsigned char)desc[i - 1])) i--;
+    if (i == len || i == 0) return -1;
+    if (desc[i - 1] != '-' && desc[i - 1] != '.' && desc[i - 1] != '_'
+        && !(i >= 5 && !strncmp(desc + i - 5, "_comp", 5)))
+        return -1;
+    return atoi(desc + i);
+}
+
+// 网卡的 MSI 中断号列表：PCI 网卡在 device/msi_irqs，virtio 网卡在上一级 PCI 设备下
+static void si_irq_map_nics(SiIrqTable *t) {
+    DIR *net = opendir("/sys/class/net");
+    struct dirent *de;
+    if (!net) return;
+    while ((de = readdir(net)) != NULL) {
+        // 网卡名不超过 IFNAMSIZ - 1 字节，更长的名字截断后会对应到别的网卡，直接跳过
+        size_t name_len = strlen(de->d_name);
+        if (de->d_name[0] == '.' || name_len >= IFNAMSIZ) continue;
+        char path[512];
+        DIR *msi;
+        snprintf(path, sizeof(path), "/sys/class/net/%s/device/msi_irqs", de->d_name);
+        msi = opendir(path);
+        if (!msi) {
+            snprintf(path, sizeof(path), "/sys/class/net/%s/device/../msi_irqs", de->d_name);
+            msi = opendir(path);
+        }
+        if (!msi) continue;
+        struct dirent *me;
+        while ((me = readdir(msi)) != NULL) {
+            if (!isdigit((unsigned char)me->d_name[0])) continue;
+            int irq = atoi(me->d_name), i;
+            for (i = 0; i < t->nirq; i++) {
+                if (t->irqs[i].irq == irq) {
+                    memcpy(t->irqs[i].ifname, de->d_name, name_len + 1);
+                    break;
+                }
+            }
+        }
+        closedir(msi);
+    }
+    closedir(net);
+}
+
+// 解析表头 "CPU0 CPU1 ..." 得到列数和 CPU 编号
+static int si_irq_header(const char *line, int **ids) {
+    int n = 0, cap = 16;
+    int *cpu_ids = malloc(cap * sizeof(int));
+    const char *p = line;
+    while (cpu_ids && (p = strstr(p, "CPU")) != NULL) {
+        if (n == cap) {
+            int *grown = realloc(cpu_ids, (size_t)cap * 2 * sizeof(int));
+            if (!grown) break;
+            cpu_ids = grown;
+            cap *= 2;
+        }
+        cpu_ids[n++] = atoi(p + 3);
+        p += 3;
+    }
+    *ids = cpu_ids;
+    return n;
+}
+
+// 从 p 开始读 ncpu 个计数，返回读完后的位置
+static char *si_irq_counts(char *p, int ncpu, unsigned long long *out, unsigned long long *total) {
+    int c;
+    *total = 0;
+    for (c = 0; c < ncpu; c++) {
+        char *end;
+        out[c] = strtoull(p, &end, 10);
+        if (end == p) {
+            // ERR/MIS 等行只有一个总数
+            for (; c < ncpu; c++) out[c] = 0;
+            break;
+        }
+        *total += out[c];
+        p = end;
+    }
+    return p;
+}
+
+int si_probe_irqs(SiIrqTable *t) {
+    memset(t, 0, sizeof(*t));
+    FILE *fp = fopen("/proc/interrupts", "r");
+    if (!fp) return -1;
+
+    // 每行长度随 CPU 数增长（每列约 11 字节，上千个 CPU 时表头就有十几 KB），用 getline 整行读取
+    char *line = NULL;
+    size_t line_cap = 0;
+    int cap = 0;
+    if (getline(&line, &line_cap, fp) < 0 || (t->ncpu = si_irq_header(line, &t->cpu_ids)) == 0) {
+        free(line);
+        fclose(fp);
+        si_irq_free(t);
+        return -1;
+    }
+
+    while (getline(&line, &line_cap, fp) >= 0) {
+        line[strcspn(line, "\n")] = '\0';
+        char *colon = strchr(line, ':');
+        if (!colon) continue;
+        if (t->nirq == cap) {
+            int ncap = cap ? cap * 2 : 64;
+            SiIrq *irqs = realloc(t->irqs, (size_t)ncap * sizeof(SiIrq));
+            unsigned long long *counts = irqs ? realloc(t->counts, (size_t)ncap * t->ncpu * sizeof(*counts)) : NULL;
+            if (irqs) t->irqs = irqs;
+            if (!irqs || !counts) break;
+            t->counts = counts;
+            cap = ncap;
+        }
+        SiIrq *q = &t->irqs[t->nirq];
+        memset(q, 0, sizeof(*q));
+        *colon = '\0';
+        char *name = line;
+        while (*name == ' ') name++;
+        snprintf(q->name, sizeof(q->name), "%s", name);
+        q->irq = isdigit((unsigned char)name[0]) ? atoi(name) : -1;
+
+        char *rest = si_irq_counts(colon + 1, t->ncpu, &t->counts[(size_t)t->nirq * t->ncpu], &q->total);
+        // 数字中断行剩余部分为 "芯片 硬件中断号 动作名"，动作名取最后一个字段
+        while (*rest == ' ') rest++;
+        char *desc = rest;
+        if (q->irq >= 0) {
+            char *last = strrchr(rest, ' ');
+            if (last) desc = last + 1;
+        }
+        snprintf(q->desc, sizeof(q->desc), "%s", desc);
+        q->queue = q->irq >= 0 ? si_irq_queue(q->desc) : -1;
+        t->nirq++;
+    }
+    fclose(fp);
+
+    // softirq 的列与 /proc/interrupts 相同（在线 CPU）
+    t->soft_counts = calloc((size_t)SI_SOFTIRQ_MAX * t->ncpu, sizeof(*t->soft_counts));
+    if (t->soft_counts && (fp = fopen("/proc/softirqs", "r")) != NULL) {
+        // 跳过表头
+        int header = getline(&line, &line_cap, fp) >= 0;
+        while (header && t->nsoft < SI_SOFTIRQ_MAX && getline(&line, &line_cap, fp) >= 0) {
+            char *colon = strchr(line, ':');
+            if (!colon) continue;
+            *colon = '\0';
+            char *name = line;
+            unsigned long long total;
+            while (*name == ' ') name++;
+            snprintf(t->soft_names[t->nsoft], sizeof(t->soft_names[0]), "%s", name);
+            si_irq_counts(colon + 1, t->ncpu, &t->soft_counts[(size_t)t->nsoft * t->ncpu], &total);
+            t->nsoft++;
+        }
+        fclose(fp);
+    }
+    free(line);
+
+    si_irq_map_nics(t);
+    return 0;
+}
+
+void si_irq_free(SiIrqTable *t) {
+    free(t->cpu_ids);
+    free(t->irqs);
+    free(t->counts);
+    free(t->soft_counts);
+    memset(t, 0, sizeof(*t));
+}
+
+int si_softirq_index(const SiIrqTable *t, const char *name) {
+    int i;
+    for (i = 0; i < t->nsoft; i++)
+        if (!strcmp(t->soft_names[i], name)) return i;
+    return -1;
+}
+
+int si_nic_cpus(const char *ifname, int *cpus, int max, int *node) {
+    char path[512], buf[SI_LINE_MAX];
+    *node = -1;
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", ifname);
+    if (si_read_line(path, buf, sizeof(buf)) == 0) *node = atoi(buf);
+    if (*node >= 0) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", *node);
+        if (si_read_line(path, buf, sizeof(buf)) == 0)
+            return si_parse_cpu_list(buf, cpus, max);
+    }
+    return si_online_cpus(cpus, max);
+}
+
+int si_online_cpus(int *cpus, int max) {
+    char buf[SI_LINE_MAX];
+    if (si_read_line("/sys/devices/system/cpu/online", buf, sizeof(buf)) == 0)
+        return si_parse_cpu_list(buf, cpus, max);
+    return 0;
+}
+
+int si_numa_nodes(int *nodes, int max) {
+    char buf[SI_LINE_MAX];
+    if (si_read_line("/sys/devices/system/node/online", buf, sizeof(buf)) == 0)
+        return si_parse_cpu_list(buf, nodes, max);
+    if (max < 1) return 0;
+    nodes[0] = 0;
+    return 1;
+}
+
+int si_numa_node_cpus(int node, int *cpus, int max) {
+    char path[128], buf[SI_LINE_MAX];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (si_read_line(path, buf, sizeof(buf)) == 0)
+        return buf[0] ? si_parse_cpu_list(buf, cpus, max) : 0;
+    return node == 0 ? si_online_cpus(cpus, max) : 0;
+}
+
+#define SI_CPU_MASK_WORDS (4096 / (8 * sizeof(unsigned long)))
+
+int si_pin_thread(int cpu) {
+    unsigned long mask[SI_CPU_MASK_WORDS];
+    size_t bits = 8 * sizeof(unsigned long);
+    if (cpu < 0 || (size_t)cpu >= SI_CPU_MASK_WORDS * bits) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(mask, 0, sizeof(mask));
+    mask[cpu / bits] |= 1UL << (cpu % bits);
+    // pid 为 0 时作用于调用线程本身
+    return syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0 ? 0 : -1;
+}
+
+// ==================== 采样历史 ====================
+
+#define SI_HIST_MAGIC "SIHIST1"
+#define SI_HIST_BASE_COLS 9
+#define SI_HIST_COLS (SI_HIST_BASE_COLS + 2 * SI_HIST_IFACES)
+
+// 文件头，独占第一个块
+typedef struct {
+    char magic[8];
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t ncols;
+    uint32_t niface;
+    uint32_t head;                   // 正在写入的块
+    uint32_t used;                   // 写过的块数，绕回后等于 block_count
+    char ifaces[SI_HIST_IFACES][16];
+    int64_t last[SI_HIST_COLS];      // 最后一条样本，追加时据此求差值
+    int64_t delta[SI_HIST_COLS];     // 最后一条相对前一条的差值
+} SiHistHeader;
+
+// 数据块：块头 + ncols 列原值 + 差值流；count 为 0 表示空块
+typedef struct {
+    uint32_t count;
+    uint32_t bytes;
+    int64_t first_ts;
+    int64_t last_ts;
+    int64_t base[];
+} SiHistBlock;
+
+// 内存、负载是瞬时值，只存一阶差分；其余列单调递增，存二阶差分，匀速增长时每列只占 1 字节
+static int si_hist_is_gauge(int col) {
+    return col == 1 || col == 2 || col == 5;
+}
+
+static int si_hist_ncols(int niface) {
+    return SI_HIST_BASE_COLS + 2 * niface;
+}
+
+static void si_hist_to_cols(const SiHistSample *s, int niface, int64_t *cols) {
+    int i;
+    cols[0] = s->ts;
+    cols[1] = s->mem_total_mib;
+    cols[2] = s->mem_avail_mib;
+    cols[3] = s->cpu_total;
+    cols[4] = s->cpu_idle;
+    cols[5] = s->load_x100;
+    for (i = 0; i < SI_PSI_KINDS; i++) cols[6 + i] = s->psi_ms[i];
+    for (i = 0; i < niface; i++) {
+        cols[SI_HIST_BASE_COLS + 2 * i] = s->rx_kb[i];
+        cols[SI_HIST_BASE_COLS + 2 * i + 1] = s->tx_kb[i];
+    }
+}
+
+static void si_hist_from_cols(const int64_t *cols, int niface, SiHistSample *s) {
+    int i;
+    memset(s, 0, sizeof(*s));
+    s->ts = cols[0];
+    s->mem_total_mib = cols[1];
+    s->mem_avail_mib = cols[2];
+    s->cpu_total = cols[3];
+    s->cpu_idle = cols[4];
+    s->load_x100 = cols[5];
+    for (i = 0; i < SI_PSI_KINDS; i++) s->psi_ms[i] = cols[6 + i];
+    for (i = 0; i < niface; i++) {
+        s->rx_kb[i] = cols[SI_HIST_BASE_COLS + 2 * i];
+        s->tx_kb[i] = cols[SI_HIST_BASE_COLS + 2 * i + 1];
+    }
+}
+
+static size_t si_put_varint(unsigned char *p, int64_t v) {
+    uint64_t z = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);   // zigzag：小的负数也编码成短字节
+    size_t n = 0;
+    while (z >= 0x80) {
+        p[n++] = (unsigned char)(z | 0x80);
+        z >>= 7;
+    }
+    p[n++] = (unsigned char)z;
+    return n;
+}
+
+// 越过 end 或超过 10 字节时返回 0
+static size_t si_get_varint(const unsigned char *p, const unsigned char *end, int64_t *v) {
+    uint64_t z = 0;
+    size_t n = 0;
+    int shift = 0;
+    while (p + n < end && shift < 64) {
+        unsigned char b = p[n++];
+        z |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+            return n;
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+static SiHistHeader *si_hist_header(const SiHistory *h) {
+    return (SiHistHeader *)h->map;
+}
+
+static SiHistBlock *si_hist_block(const SiHistory *h, unsigned int index) {
+    return (SiHistBlock *)(h->map + (size_t)(index + 1) * SI_HIST_BLOCK_SIZE);
+}
+
+static size_t si_hist_payload_room(int ncols) {
+    return SI_HIST_BLOCK_SIZE - sizeof(SiHistBlock) - (size_t)ncols * sizeof(int64_t);
+}
+
+static int si_hist_name_cmp(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// 新文件：选定网卡列并写入文件头，数据块由 posix_fallocate 清零
+static int si_hist_create(int fd, unsigned int blocks) {
+    SiHistHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SI_HIST_MAGIC, sizeof(SI_HIST_MAGIC));
+    hdr.block_size = SI_HIST_BLOCK_SIZE;
+    hdr.block_count = blocks;
+
+    DIR *dir = opendir("/sys/class/net");
+    if (dir) {
+        struct dirent *de;
+        while ((de = readdir(dir)) && hdr.niface < SI_HIST_IFACES) {
+            if (de->d_name[0] == '.' || !strcmp(de->d_name, "lo")) continue;
+            if (strlen(de->d_name) >= sizeof(hdr.ifaces[0])) continue;
+            strcpy(hdr.ifaces[hdr.niface++], de->d_name);
+        }
+        closedir(dir);
+    }
+    qsort(hdr.ifaces, hdr.niface, sizeof(hdr.ifaces[0]), si_hist_name_cmp);
+    hdr.ncols = (uint32_t)si_hist_ncols((int)hdr.niface);
+
+    int err = posix_fallocate(fd, 0, (off_t)(blocks + 1) * SI_HIST_BLOCK_SIZE);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return pwrite(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) ? 0 : -1;
+}
+
+int si_history_open(SiHistory *h, const char *path, unsigned int blocks, int writable) {
+    memset(h, 0, sizeof(*h));
+    h->fd = -1;
+    if (blocks == 0) blocks = SI_HIST_DEFAULT_BLOCKS;
+
+    int fd = open(path, writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) goto fail;
+    if (st.st_size == 0 && writable) {
+        // 加锁后再确认一次，避免两个进程同时初始化
+        flock(fd, LOCK_EX);
+        if (fstat(fd, &st) == 0 && st.st_size == 0) {
+            if (si_hist_create(fd, blocks) != 0) {
+                int saved = errno;
+                if (ftruncate(fd, 0) != 0) { /* 下次打开时重新初始化 */ }
+                flock(fd, LOCK_UN);
+                errno = saved;
+                goto fail;
+            }
+            fstat(fd, &st);
+        }
+        flock(fd, LOCK_UN);
+    }
+    if (st.st_size < SI_HIST_BLOCK_SIZE) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                     MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) goto fail;
+    const SiHistHeader *hdr = map;
+    if (memcmp(hdr->magic, SI_HIST_MAGIC, sizeof(SI_HIST_MAGIC)) != 0
+        || hdr->block_size != SI_HIST_BLOCK_SIZE || hdr->niface > SI_HIST_IFACES
+        || hdr->ncols != (uint32_t)si_hist_ncols((int)hdr->niface)
+        || hdr->block_count == 0 || hdr->head >= hdr->block_count || hdr->used > hdr->block_count
+        || (off_t)(hdr->block_count + 1) * SI_HIST_BLOCK_SIZE != st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        errno = EINVAL;
+        goto fail;
+    }
+
+    int i;
+    h->fd = fd;
+    h->map = map;
+    h->size = (size_t)st.st_size;
+    h->writable = writable;
+    h->blocks = hdr->block_count;
+    h->niface = (int)hdr->niface;
+    for (i = 0; i < h->niface; i++)
+        snprintf(h->ifaces[i], sizeof(h->ifaces[i]), "%s", hdr->ifaces[i]);
+    return 0;
+
+fail:
+    close(fd);
+    return -1;
+}
+
+void si_history_close(SiHistory *h) {
+    if (h->map) munmap(h->map, h->size);
+    if (h->fd >= 0) close(h->fd);
+    h->map = NULL;
+    h->fd = -1;
+}
+
+// /proc/stat 第一行：cpu user nice system idle iowait irq softirq steal guest guest_nice
+// guest 已计入 user，只累加前 8 项
+int si_cpu_ticks(long long *total, long long *idle) {
+    char line[SI_LINE_MAX];
+    long long v[8] = {0};
+    int i;
+    *total = *idle = 0;
+    if (si_read_line("/proc/stat", line, sizeof(line)) != 0 || strncmp(line, "cpu ", 4)) return -1;
+    if (sscanf(line + 4, "%lld %lld %lld %lld %lld %lld %lld %lld",
+               &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) < 4)
+        return -1;
+    for (i = 0; i < 8; i++) *total += v[i];
+    *idle = v[3] + v[4];
+    return 0;
+}
+
+static long long si_iface_kb(const char *ifname, const char *name) {
+    char path[512], buf[64];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s", ifname, name);
+    if (si_read_line(path, buf, sizeof(buf)) != 0) return 0;
+    return strtoll(buf, NULL, 10) / 1024;
+}
+
+int si_history_sample(const SiHistory *h, SiHistSample *s) {
+    SiMemory mem;
+    SiPsi psi;
+    double load[3];
+    int i;
+    memset(s, 0, sizeof(*s));
+    s->ts = time(NULL);
+    if (si_probe_memory(&mem, 0) == 0) {
+        s->mem_total_mib = (long long)(mem.total * 1024 + 0.5);
+        s->mem_avail_mib = (long long)(mem.available * 1024 + 0.5);
+    }
+    si_cpu_ticks(&s->cpu_total, &s->cpu_idle);
+    if (si_probe_load(load) == 0) s->load_x100 = (long long)(load[0] * 100 + 0.5);
+    for (i = 0; i < SI_PSI_KINDS; i++) {
+        if (si_probe_psi(&psi, NULL, i) == 0) s->psi_ms[i] = (long long)(psi.some_total / 1000);
+    }
+    for (i = 0; i < h->niface; i++) {
+        s->rx_kb[i] = si_iface_kb(h->ifaces[i], "rx_bytes");
+        s->tx_kb[i] = si_iface_kb(h->ifaces[i], "tx_bytes");
+    }
+    return 0;
+}
+
+// 以 cols 为原值开始一个新块
+static void si_hist_start_block(SiHistHeader *hdr, SiHistBlock *blk, const int64_t *cols) {
+    blk->count = 0;
+    blk->bytes = 0;
+    memcpy(blk->base, cols, hdr->ncols * sizeof(int64_t));
+    blk->first_ts = blk->last_ts = cols[0];
+    blk->count = 1;
+    memset(hdr->delta, 0, sizeof(hdr->delta));
+}
+
+int si_history_append(SiHistory *h, const SiHistSample *s) {
+    if (!h->writable) {
+        errno = EBADF;
+        return -1;
+    }
+    SiHistHeader *hdr = si_hist_header(h);
+    int64_t cols[SI_HIST_COLS], deltas[SI_HIST_COLS];
+    unsigned char enc[SI_HIST_COLS * 10 + (SI_HIST_COLS + 7) / 8];
+    int ncols = (int)hdr->ncols;
+    int i;
+    si_hist_to_cols(s, h->niface, cols);
+
+    flock(h->fd, LOCK_EX);
+    SiHistBlock *blk = si_hist_block(h, hdr->head);
+    if (blk->count == 0) {
+        si_hist_start_block(hdr, blk, cols);
+        if (hdr->used == 0) hdr->used = 1;
+    } else if (cols[0] <= blk->last_ts) {
+        // 同一秒重复采样或时钟回拨：保持块内时间递增，二分查找依赖这一点
+        flock(h->fd, LOCK_UN);
+        return 0;
+    } else {
+        // 样本开头是非零列的位图，值为 0 的列（空闲网卡、匀速增长的计数器）不占字节
+        size_t mask_len = ((size_t)ncols + 7) / 8;
+        size_t len = mask_len;
+        memset(enc, 0, mask_len);
+        for (i = 0; i < ncols; i++) {
+            deltas[i] = cols[i] - hdr->last[i];
+            int64_t v = si_hist_is_gauge(i) ? deltas[i] : deltas[i] - hdr->delta[i];
+            if (v == 0) continue;
+            enc[i / 8] |= (unsigned char)(1 << (i % 8));
+            len += si_put_varint(enc + len, v);
+        }
+        if (blk->bytes + len <= si_hist_payload_room(ncols)) {
+            // 先写数据再更新计数，读者看到的 count 总是完整的
+            memcpy((unsigned char *)&blk->base[ncols] + blk->bytes, enc, len);
+            blk->bytes += (uint32_t)len;
+            blk->last_ts = cols[0];
+            blk->count++;
+            memcpy(hdr->delta, deltas, (size_t)ncols * sizeof(int64_t));
+        } else {
+            unsigned int next = (hdr->head + 1) % hdr->block_count;
+            blk = si_hist_block(h, next);
+            blk->count = 0;   // 覆盖最旧的块前先标记为空
+            si_hist_start_block(hdr, blk, cols);
+            hdr->head = next;
+            if (hdr->used < hdr->block_count) hdr->used++;
+        }
+    }
+    memcpy(hdr->last, cols, (size_t)ncols * sizeof(int64_t));
+    flock(h->fd, LOCK_UN);
+    return 0;
+}
+
+// 逻辑序号（0 为最旧的块）对应的块
+static SiHistBlock *si_hist_nth(const SiHistory *h, unsigned int n) {
+    const SiHistHeader *hdr = si_hist_header(h);
+    unsigned int oldest = hdr->used < hdr->block_count ? 0 : (hdr->head + 1) % hdr->block_count;
+    return si_hist_block(h, (oldest + n) % hdr->block_count);
+}
+
+unsigned int si_history_span(const SiHistory *h, long long *oldest, long long *newest) {
+    const SiHistHeader *hdr = si_hist_header(h);
+    *oldest = *newest = 0;
+    flock(h->fd, LOCK_SH);
+    unsigned int used = hdr->used;
+    if (used) {
+        const SiHistBlock *first = si_hist_nth(h, 0);
+        // 绕回后紧邻 head 的块可能刚被清空，往后找第一个非空块
+        unsigned int n = 0;
+        while (first->count == 0 && ++n < used) first = si_hist_nth(h, n);
+        *oldest = first->first_ts;
+        *newest = si_hist_block(h, hdr->head)->last_ts;
+    }
+    flock(h->fd, LOCK_UN);
+    return used;
+}
+
+long si_history_query(const SiHistory *h, long long from, long long to, SiHistFn fn, void *ctx) {
+    const SiHistHeader *hdr = si_hist_header(h);
+    int ncols = (int)hdr->ncols;
+    size_t mask_len = ((size_t)ncols + 7) / 8;
+    int64_t cols[SI_HIST_COLS], deltas[SI_HIST_COLS];
+    SiHistSample cur, prev;
+    int have_prev = 0;
+    long delivered = 0;
+    int i;
+
+    flock(h->fd, LOCK_SH);
+    unsigned int used = hdr->used;
+    // 二分找第一个 last_ts >= from 的块；块按时间递增排列，只访问 log(n) 个块头
+    unsigned int lo = 0, hi = used;
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        const SiHistBlock *b = si_hist_nth(h, mid);
+        if (b->count && b->last_ts < from) lo = mid + 1;
+        else hi = mid;
+    }
+
+    unsigned int n;
+    int stop = 0;
+    for (n = lo; n < used && !stop; n++) {
+        const SiHistBlock *b = si_hist_nth(h, n);
+        if (b->count == 0) continue;
+        if (b->first_ts > to) break;
+        const unsigned char *p = (const unsigned char *)&b->base[ncols];
+        const unsigned char *end = p + (b->bytes <= si_hist_payload_room(ncols) ? b->bytes : 0);
+        uint32_t k;
+        memcpy(cols, b->base, (size_t)ncols * sizeof(int64_t));
+        memset(deltas, 0, sizeof(deltas));
+        for (k = 0; k < b->count && !stop; k++) {
+            if (k > 0) {
+                const unsigned char *mask = p;
+                if ((size_t)(end - p) < mask_len) break;
+                p += mask_len;
+                for (i = 0; i < ncols; i++) {
+                    int64_t v = 0;
+                    if (mask[i / 8] & (1 << (i % 8))) {
+                        size_t n_bytes = si_get_varint(p, end, &v);
+                        if (!n_bytes) break;
+                        p += n_bytes;
+                    }
+                    deltas[i] = si_hist_is_gauge(i) ? v : deltas[i] + v;
+                    cols[i] += deltas[i];
+                }
+                if (i < ncols) break;   // 块内数据损坏，丢弃其余样本
+            }
+            if (cols[0] > to) {
+                stop = 1;
+                break;
+            }
+            si_hist_from_cols(cols, h->niface, &cur);
+            if (cols[0] >= from) {
+                delivered++;
+                if (fn(have_prev ? &prev : NULL, &cur, ctx)) stop = 1;
+            }
+            prev = cur;
+            have_prev = 1;
+        }
+    }
+    flock(h->fd, LOCK_UN);
+    return delivered;
+}
+
+// ==================== 主机快照 ====================
+
+static const char *si_snap_names[SI_SNAP_SECTIONS] = { "host", "system", "net", "sysctl", "sources" };
+
+// 常见的调优项，加上 /etc/sysctl.conf 和 /etc/sysctl.d 中出现的键
+static const char *si_snap_sysctls[] = {
+    "fs.file-max", "kernel.pid_max", "net.core.netdev_max_backlog", "net.core.rmem_max",
+    "net.core.somaxconn", "net.core.wmem_max", "net.ipv4.ip_forward", "net.ipv4.ip_local_port_range",
+    "net.ipv4.tcp_congestion_control", "net.ipv4.tcp_fin_timeout", "net.ipv4.tcp_max_syn_backlog",
+    "net.ipv4.tcp_tw_reuse", "vm.dirty_background_ratio", "vm.dirty_ratio", "vm.max_map_count",
+    "vm.overcommit_memory", "vm.swappiness",
+};
+
+const char *si_snapshot_section_name(int section) {
+    return section >= 0 && section < SI_SNAP_SECTIONS ? si_snap_names[section] : "?";
+}
+
+static unsigned long long si_fnv1a(unsigned long long h, const char *s) {
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static unsigned long long si_snap_hash(const SiSnapEntry *e, int n) {
+    unsigned long long h = 1469598103934665603ULL;
+    int i;
+    for (i = 0; i < n; i++) {
+        h = si_fnv1a(h, e[i].key);
+        h = si_fnv1a(h, "=");
+        h = si_fnv1a(h, e[i].value);
+        h = si_fnv1a(h, "\n");
+    }
+    return h;
+}
+
+static int si_snap_entry_cmp(const void *a, const void *b) {
+    return strcmp(((const SiSnapEntry *)a)->key, ((const SiSnapEntry *)b)->key);
+}
+
+// 开始一个新段
+static void si_snap_begin(SiSnapshot *snap, int section) {
+    snap->present[section] = 1;
+    snap->start[section] = snap->n;
+    snap->count[section] = 0;
+}
+
+// 结束当前段：排序、去掉重复键（保留第一个）
+static void si_snap_end(SiSnapshot *snap, int section) {
+    SiSnapEntry *e = &snap->entries[snap->start[section]];
+    int n = snap->n - snap->start[section];
+    int i, out = 0;
+    qsort(e, n, sizeof(*e), si_snap_entry_cmp);
+    for (i = 0; i < n; i++) {
+        if (out > 0 && !strcmp(e[out - 1].key, e[i].key)) continue;
+        e[out++] = e[i];
+    }
+    snap->n = snap->start[section] + out;
+    snap->count[section] = out;
+}
+
+static void si_snap_add(SiSnapshot *snap, SiArena *arena, const char *key, const char *value) {
+    if (snap->n >= SI_SNAP_ENTRIES) {
+        snap->truncated = 1;
+        return;
+    }
+    SiSnapEntry *e = &snap->entries[snap->n++];
+    e->key = arena ? si_arena_strdup(arena, key) : key;
+    e->value = arena ? si_arena_strdup(arena, value) : value;
+    if (arena && arena->exhausted) snap->truncated = 1;
+}
+
+static void si_snap_add_ll(SiSnapshot *snap, SiArena *arena, const char *key, long long v) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%lld", v);
+    si_snap_add(snap, arena, key, buf);
+}
+
+static void si_snap_collect_system(SiSnapshot *snap, SiArena *arena) {
+    SiDistro distro;
+    SiCpu cpu;
+    SiMemory mem;
+    struct utsname uts;
+    si_snap_begin(snap, SI_SNAP_SYSTEM);
+    if (si_probe_distro(&distro, arena) == 0) {
+        si_snap_add(snap, arena, "distro", distro.name);
+        si_snap_add(snap, arena, "version", distro.version);
+    }
+    si_probe_cpu(&cpu, arena);
+    si_snap_add(snap, arena, "cpu_model", cpu.model);
+    si_snap_add_ll(snap, arena, "cpu_cores", cpu.logical_cores);
+    if (si_probe_memory(&mem, 0) == 0)
+        si_snap_add_ll(snap, arena, "mem_total_mib", (long long)(mem.total * 1024 + 0.5));
+    if (uname(&uts) == 0) {
+        si_snap_add(snap, arena, "kernel", uts.release);
+        si_snap_add(snap, arena, "arch", uts.machine);
+    }
+    si_snap_add(snap, arena, "hardware", si_probe_hardware_model(arena));
+    si_snap_end(snap, SI_SNAP_SYSTEM);
+}
+
+static int si_str_cmp(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// 把若干字符串排序去重后以空格连接
+static void si_join_sorted(char **items, int n, char *buf, size_t size) {
+    size_t len = 0;
+    int i;
+    buf[0] = '\0';
+    qsort(items, n, sizeof(*items), si_str_cmp);
+    for (i = 0; i < n; i++) {
+        if (i > 0 && !strcmp(items[i], items[i - 1])) continue;
+        int k = snprintf(buf + len, size - len, "%s%s", len ? " " : "", items[i]);
+        if (k < 0 || (size_t)k >= size - len) break;
+        len += (size_t)k;
+    }
+}
+
+// 每块网卡一行：地址/前缀 按字典序排列，没有地址的网卡值为空
+// 快照不在采集热路径上，这里直接用 getifaddrs
+static void si_snap_collect_net(SiSnapshot *snap, SiArena *arena) {
+    char names[64][IFNAMSIZ];
+    int nnames = 0, i;
+    si_snap_begin(snap, SI_SNAP_NET);
+    DIR *dir = opendir("/sys/class/net");
+    if (dir) {
+        struct dirent *de;
+        while ((de = readdir(dir)) && nnames < 64) {
+            if (de->d_name[0] == '.' || !strcmp(de->d_name, "lo") || strlen(de->d_name) >= IFNAMSIZ) continue;
+            strcpy(names[nnames++], de->d_name);
+        }
+        closedir(dir);
+    }
+    struct ifaddrs *ifa_list = NULL, *ifa;
+    if (getifaddrs(&ifa_list) != 0) ifa_list = NULL;
+    for (i = 0; i < nnames; i++) {
+        // "地址/前缀"：前缀按 int 留足 10 位，加上 '/'
+        char addrs[64][INET6_ADDRSTRLEN + 11], *items[64], value[1024];
+        int n = 0;
+        for (ifa = ifa_list; ifa && n < 64; ifa = ifa->ifa_next) {
+            if (!ifa->ifa_addr || !ifa->ifa_netmask || strcmp(ifa->ifa_name, names[i])) continue;
+            int family = ifa->ifa_addr->sa_family, prefix = 0, k;
+            char text[INET6_ADDRSTRLEN];
+            const unsigned char *mask;
+            int mask_len;
+            if (family == AF_INET) {
+                inet_ntop(AF_INET, &((struct sockaddr_in *)ifa->ifa_addr)->sin_addr, text, sizeof(text));
+                mask = (const unsigned char *)&((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr;
+                mask_len = 4;
+            } else if (family == AF_INET6) {
+                inet_ntop(AF_INET6, &((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr, text, sizeof(text));
+                mask = (const unsigned char *)&((struct sockaddr_in6 *)ifa->ifa_netmask)->sin6_addr;
+                mask_len = 16;
+            } else {
+                continue;
+            }
+            for (k = 0; k < mask_len; k++) prefix += __builtin_popcount(mask[k]);
+            snprintf(addrs[n], sizeof(addrs[n]), "%s/%d", text, prefix);
+            items[n] = addrs[n];
+            n++;
+        }
+        si_join_sorted(items, n, value, sizeof(value));
+        si_snap_add(snap, arena, names[i], value);
+    }
+    if (ifa_list) freeifaddrs(ifa_list);
+    si_snap_end(snap, SI_SNAP_NET);
+}
+
+// 读取一项 sysctl，多个字段间的空白统一成一个空格
+static int si_read_sysctl(const char *key, char *buf, size_t size) {
+    char path[512], raw[SI_LINE_MAX];
+    size_t i, n = 0;
+    int space = 0;
+    snprintf(path, sizeof(path), "/proc/sys/%s", key);
+    for (i = strlen("/proc/sys/"); path[i]; i++)
+        if (path[i] == '.') path[i] = '/';
+    if (si_read_line(path, raw, sizeof(raw)) != 0) return -1;
+    for (i = 0; raw[i] && n + 1 < size; i++) {
+        if (isspace((unsigned char)raw[i])) {
+            space = n > 0;
+            continue;
+        }
+        if (space && n + 2 < size) buf[n++] = ' ';
+        space = 0;
+        buf[n++] = raw[i];
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+static void si_snap_add_sysctl(SiSnapshot *snap, SiArena *arena, const char *key) {
+    char value[SI_LINE_MAX];
+    if (si_read_sysctl(key, value, sizeof(value)) == 0) si_snap_add(snap, arena, key, value);
+}
+
+// 从 sysctl 配置文件中取出键名（"-key = value" 中的 '-' 表示忽略错误）
+static void si_snap_sysctl_file(SiSnapshot *snap, SiArena *arena, const char *path) {
+    SiLineReader r;
+    char line[SI_LINE_MAX];
+    if (si_reader_open(&r, path) != 0) return;
+    while (si_reader_next(&r, line, sizeof(line))) {
+        char *key = line, *eq = strchr(line, '=');
+        while (isspace((unsigned char)*key) || *key == '-') key++;
+        if (!eq || *key == '#' || *key == ';' || key >= eq) continue;
+        char *end = eq;
+        while (end > key && isspace((unsigned char)end[-1])) end--;
+        *end = '\0';
+        for (end = key; *end; end++)
+            if (*end == '/') *end = '.';
+        si_snap_add_sysctl(snap, arena, key);
+    }
+    si_reader_close(&r);
+}
+
+static int si_has_suffix(const char *name, const char *suffix) {
+    size_t n = strlen(name), k = strlen(suffix);
+    return n > k && !strcmp(name + n - k, suffix);
+}
+
+// 对目录中指定后缀的文件逐个调用 fn，按文件名排序以保证结果稳定
+static void si_for_each_file(const char *dir_path, const char *suffix,
+                             void (*fn)(SiSnapshot *, SiArena *, const char *), SiSnapshot *snap, SiArena *arena) {
+    struct dirent **list;
+    int n = scandir(dir_path, &list, NULL, alphasort), i;
+    if (n < 0) return;
+    for (i = 0; i < n; i++) {
+        if (si_has_suffix(list[i]->d_name, suffix)) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", dir_path, list[i]->d_name);
+            fn(snap, arena, path);
+        }
+        free(list[i]);
+    }
+    free(list);
+}
+
+static void si_snap_collect_sysctl(SiSnapshot *snap, SiArena *arena, const SiSnapshot *keys_from) {
+    size_t i;
+    int k;
+    si_snap_begin(snap, SI_SNAP_SYSCTL);
+    for (i = 0; i < sizeof(si_snap_sysctls) / sizeof(si_snap_sysctls[0]); i++)
+        si_snap_add_sysctl(snap, arena, si_snap_sysctls[i]);
+    si_snap_sysctl_file(snap, arena, "/etc/sysctl.conf");
+    si_for_each_file("/etc/sysctl.d", ".conf", si_snap_sysctl_file, snap, arena);
+    if (keys_from && keys_from->present[SI_SNAP_SYSCTL]) {
+        for (k = 0; k < keys_from->count[SI_SNAP_SYSCTL]; k++)
+            si_snap_add_sysctl(snap, arena, keys_from->entries[keys_from->start[SI_SNAP_SYSCTL] + k].key);
+    }
+    si_snap_end(snap, SI_SNAP_SYSCTL);
+}
+
+// 软件源文件：值为启用的仓库地址（排序去重）
+// .list 取 deb/deb-src 行的 URL，.sources 取 URIs:，.repo 取启用段的 baseurl/mirrorlist/metalink
+static void si_snap_source_file(SiSnapshot *snap, SiArena *arena, const char *path) {
+    SiLineReader r;
+    char line[SI_LINE_MAX], urls[64][256], *items[64], value[2048];
+    int n = 0, enabled = 1, section_start = 0, i;
+    int is_repo = si_has_suffix(path, ".repo"), is_deb822 = si_has_suffix(path, ".sources");
+    if (si_reader_open(&r, path) != 0) return;
+    while (si_reader_next(&r, line, sizeof(line))) {
+        char *p = line, *url = NULL;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '#' || *p == '\0') continue;
+        if (is_repo) {
+            if (*p == '[') {
+                // 上一段被禁用时丢弃它的地址
+                if (!enabled) n = section_start;
+                section_start = n;
+                enabled = 1;
+            } else if (!strncmp(p, "enabled", 7) && strchr(p, '=')) {
+                enabled = atoi(strchr(p, '=') + 1) != 0;
+            } else if (!strncmp(p, "baseurl", 7) || !strncmp(p, "mirrorlist", 10) || !strncmp(p, "metalink", 8)) {
+                url = strchr(p, '=');
+                if (url) url++;
+            }
+        } else if (is_deb822) {
+            if (!strncmp(p, "URIs:", 5)) url = p + 5;
+        } else if (!strncmp(p, "deb ", 4) || !strncmp(p, "deb-src ", 8)) {
+            url = strchr(p, ' ');
+            while (url && isspace((unsigned char)*url)) url++;
+            // 跳过 [arch=amd64 signed-by=...] 选项
+            if (url && *url == '[') {
+                url = strchr(url, ']');
+                if (url) url++;
+            }
+        }
+        if (!url) continue;
+        while (isspace((unsigned char)*url)) url++;
+        url[strcspn(url, " \t")] = '\0';
+        if (*url && n < 64) {
+            snprintf(urls[n], sizeof(urls[n]), "%s", url);
+            n++;
+        }
+    }
+    si_reader_close(&r);
+    if (is_repo && !enabled) n = section_start;
+    for (i = 0; i < n; i++) items[i] = urls[i];
+    si_join_sorted(items, n, value, sizeof(value));
+    si_snap_add(snap, arena, path, value);
+}
+
+static void si_snap_collect_sources(SiSnapshot *snap, SiArena *arena) {
+    si_snap_begin(snap, SI_SNAP_SOURCES);
+    if (access("/etc/apt/sources.list", R_OK) == 0)
+        si_snap_source_file(snap, arena, "/etc/apt/sources.list");
+    si_for_each_file("/etc/apt/sources.list.d", ".list", si_snap_source_file, snap, arena);
+    si_for_each_file("/etc/apt/sources.list.d", ".sources", si_snap_source_file, snap, arena);
+    si_for_each_file("/etc/yum.repos.d", ".repo", si_snap_source_file, snap, arena);
+    si_snap_end(snap, SI_SNAP_SOURCES);
+}
+
+int si_snapshot_collect(SiSnapshot *snap, SiArena *arena, const SiSnapshot *keys_from) {
+    struct utsname uts;
+    int i;
+    memset(snap, 0, sizeof(*snap));
+    si_snap_begin(snap, SI_SNAP_HOST);
+    if (uname(&uts) == 0) si_snap_add(snap, arena, "hostname", uts.nodename);
+    si_snap_add_ll(snap, arena, "time", (long long)time(NULL));
+    si_snap_end(snap, SI_SNAP_HOST);
+    si_snap_collect_system(snap, arena);
+    si_snap_collect_net(snap, arena);
+    si_snap_collect_sysctl(snap, arena, keys_from);
+    si_snap_collect_sources(snap, arena);
+    for (i = 0; i < SI_SNAP_SECTIONS; i++)
+        snap->hash[i] = si_snap_hash(&snap->entries[snap->start[i]], snap->count[i]);
+    return snap->truncated ? -1 : 0;
+}
+
+int si_snapshot_write(const SiSnapshot *snap, int fd) {
+    int i, k;
+    if (dprintf(fd, "# menu_project snapshot v1\n") < 0) return -1;
+    for (i = 0; i < SI_SNAP_SECTIONS; i++) {
+        if (!snap->present[i]) continue;
+        if (dprintf(fd, "[%s] %016llx\n", si_snap_names[i], snap->hash[i]) < 0) return -1;
+        for (k = 0; k < snap->count[i]; k++) {
+            const SiSnapEntry *e = &snap->entries[snap->start[i] + k];
+            if (dprintf(fd, "%s=%s\n", e->key, e->value) < 0) return -1;
+        }
+    }
+    return 0;
+}
+
+static char *si_trim(char *s) {
+    char *end;
+    while (isspace((unsigned char)*s)) s++;
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+int si_snapshot_parse(SiSnapshot *snap, char *text, size_t len, const SiSnapshot *skip_equal, int verify) {
+    char *p = text, *end = text + len;
+    int section = -1, has_hash = 0, i;
+    memset(snap, 0, sizeof(*snap));
+    text[len] = '\0';
+
+    while (p < end) {
+        char *nl = memchr(p, '\n', (size_t)(end - p));
+        char *line = p;
+        if (nl) *nl = '\0';
+        p = nl ? nl + 1 : end;
+        line = si_trim(line);
+        if (*line == '#' || *line == '\0') continue;
+
+        if (*line == '[') {
+            if (section >= 0) {
+                si_snap_end(snap, section);
+                if (verify || !has_hash)
+                    snap->hash[section] = si_snap_hash(&snap->entries[snap->start[section]], snap->count[section]);
+            }
+            char *close = strchr(line, ']');
+            section = -1;
+            if (!close) continue;
+            *close = '\0';
+            for (i = 0; i < SI_SNAP_SECTIONS; i++) {
+                if (!strcmp(line + 1, si_snap_names[i]) && !snap->present[i]) section = i;
+            }
+            if (section < 0) continue;   // 未知段或重复段，忽略其中的条目
+            char *hash_end;
+            unsigned long long hash = strtoull(close + 1, &hash_end, 16);
+            has_hash = hash_end != close + 1;
+            si_snap_begin(snap, section);
+            snap->hash[section] = hash;
+            if (has_hash && !verify && skip_equal && skip_equal->present[section]
+                && skip_equal->hash[section] == hash) {
+                // 与参照相同：直接跳到下一段的开头，不逐行解析
+                snap->skipped[section] = 1;
+                while (p < end && *p != '[') {
+                    nl = memchr(p, '\n', (size_t)(end - p));
+                    p = nl ? nl + 1 : end;
+                }
+                section = -1;
+            }
+            continue;
+        }
+        if (section < 0) continue;
+        char *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        si_snap_add(snap, NULL, si_trim(line), si_trim(eq + 1));
+    }
+    if (section >= 0) {
+        si_snap_end(snap, section);
+        if (verify || !has_hash)
+            snap->hash[section] = si_snap_hash(&snap->entries[snap->start[section]], snap->count[section]);
+    }
+    return snap->truncated ? -1 : 0;
+}
+
+const char *si_snapshot_get(const SiSnapshot *snap, int section, const char *key) {
+    SiSnapEntry probe = { key, NULL };
+    if (!snap->present[section]) return NULL;
+    const SiSnapEntry *e = bsearch(&probe, &snap->entries[snap->start[section]], snap->count[section],
+                                   sizeof(probe), si_snap_entry_cmp);
+    return e ? e->value : NULL;
+}
+
+// ==================== 路由表 ====================
+
+#define SI_ROUTE_RCVBUF (4 << 20)   // 套接字接收缓冲区，转储时内核可一次排队多批
+
+static const char *si_route_tables[] = { "unspec", "default", "main", "local" };
+
+const char *si_route_table_name(unsigned int table, char *buf, size_t size) {
+    if (table == RT_TABLE_UNSPEC) return si_route_tables[0];
+    if (table >= RT_TABLE_DEFAULT && table <= RT_TABLE_LOCAL) return si_route_tables[table - RT_TABLE_DEFAULT + 1];
+    snprintf(buf, size, "%u", table);
+    return buf;
+}
+
+const char *si_route_protocol_name(int protocol) {
+    switch (protocol) {
+    case RTPROT_REDIRECT: return "redirect";
+    case RTPROT_KERNEL: return "kernel";
+    case RTPROT_BOOT: return "boot";
+    case RTPROT_STATIC: return "static";
+    case RTPROT_RA: return "ra";
+    case RTPROT_ZEBRA: return "zebra";
+    case RTPROT_BIRD: return "bird";
+    case RTPROT_DHCP: return "dhcp";
+    case RTPROT_KEEPALIVED: return "keepalived";
+    case RTPROT_BGP: return "bgp";
+    case RTPROT_ISIS: return "isis";
+    case RTPROT_OSPF: return "ospf";
+    case RTPROT_RIP: return "rip";
+    default: return "unknown";
+    }
+}
+
+static void si_route_ifname(int ifindex, char *buf) {
+    buf[0] = '\0';
+    if (ifindex > 0 && !if_indextoname((unsigned int)ifindex, buf))
+        snprintf(buf, IFNAMSIZ, "if%d", ifindex);
+}
+
+// RTA_MULTIPATH：rtnexthop 数组，每项后面跟着该下一跳自己的属性
+static void si_route_multipath(SiRoute *r, struct rtattr *mp) {
+    struct rtnexthop *nh = RTA_DATA(mp);
+    int len = (int)RTA_PAYLOAD(mp);
+    while (len >= (int)sizeof(*nh) && nh->rtnh_len >= sizeof(*nh) && nh->rtnh_len <= len) {
+        if (r->nhop_count < SI_ROUTE_NEXTHOPS) {
+            SiNextHop *hop = &r->nhops[r->nhop_count++];
+            struct rtattr *a = RTNH_DATA(nh);
+            int alen = nh->rtnh_len - (int)sizeof(*nh);
+            memset(hop, 0, sizeof(*hop));
+            hop->weight = nh->rtnh_hops + 1;
+            si_route_ifname(nh->rtnh_ifindex, hop->ifname);
+            for (; RTA_OK(a, alen); a = RTA_NEXT(a, alen))
+                if (a->rta_type == RTA_GATEWAY)
+                    inet_ntop(r->family, RTA_DATA(a), hop->gateway, sizeof(hop->gateway));
+        }
+        len -= RTNH_ALIGN(nh->rtnh_len);
+        nh = RTNH_NEXT(nh);
+    }
+}
+
+// 解析一条 RTM_NEWROUTE 的全部属性
+static void si_route_parse(struct nlmsghdr *h, SiRoute *r) {
+    struct rtmsg *rtm = NLMSG_DATA(h);
+    struct rtattr *a = RTM_RTA(rtm);
+    int len = (int)RTM_PAYLOAD(h), oif = 0;
+    char gw[INET6_ADDRSTRLEN] = "";
+    memset(r, 0, sizeof(*r));
+    r->family = rtm->rtm_family;
+    r->dst_len = rtm->rtm_dst_len;
+    r->table = rtm->rtm_table;
+    r->protocol = rtm->rtm_protocol;
+    for (; RTA_OK(a, len); a = RTA_NEXT(a, len)) {
+        switch (a->rta_type) {
+        case RTA_TABLE: r->table = *(unsigned int *)RTA_DATA(a); break;
+        case RTA_PRIORITY: r->metric = *(unsigned int *)RTA_DATA(a); break;
+        case RTA_OIF: oif = *(int *)RTA_DATA(a); break;
+        case RTA_DST: inet_ntop(r->family, RTA_DATA(a), r->dst, sizeof(r->dst)); break;
+        case RTA_PREFSRC: inet_ntop(r->family, RTA_DATA(a), r->prefsrc, sizeof(r->prefsrc)); break;
+        case RTA_GATEWAY: inet_ntop(r->family, RTA_DATA(a), gw, sizeof(gw)); break;
+        case RTA_MULTIPATH: si_route_multipath(r, a); break;
+        }
+    }
+    if (!r->nhop_count && (oif || gw[0])) {
+        r->nhop_count = 1;
+        snprintf(r->nhops[0].gateway, sizeof(r->nhops[0].gateway), "%s", gw);
+        si_route_ifname(oif, r->nhops[0].ifname);
+        r->nhops[0].weight = 1;
+    }
+}
+
+static int si_route_default_cmp(const SiRoute *a, const SiRoute *b) {
+    if (a->family != b->family) return a->family == AF_INET ? -1 : 1;
+    if (a->table != b->table) return a->table == RT_TABLE_MAIN ? -1 : b->table == RT_TABLE_MAIN ? 1 : a->table < b->table ? -1 : 1;
+    return a->metric < b->metric ? -1 : a->metric > b->metric;
+}
+
+// 旧内核把 IPv6 ECMP 默认路由拆成多条同 metric 的路由转储，这里合并为一条
+static void si_route_add_default(SiRouteScan *scan, const SiRoute *r) {
+    int i, j;
+    for (i = 0; i < scan->default_count; i++) {
+        SiRoute *d = &scan->defaults[i];
+        if (si_route_default_cmp(d, r) == 0) {
+            for (j = 0; j < r->nhop_count && d->nhop_count < SI_ROUTE_NEXTHOPS; j++)
+                d->nhops[d->nhop_count++] = r->nhops[j];
+            return;
+        }
+    }
+    i = scan->default_count < SI_ROUTE_DEFAULTS ? scan->default_count : SI_ROUTE_DEFAULTS - 1;
+    if (scan->default_count >= SI_ROUTE_DEFAULTS && si_route_default_cmp(r, &scan->defaults[i]) >= 0) return;
+    while (i > 0 && si_route_default_cmp(r, &scan->defaults[i - 1]) < 0) {
+        scan->defaults[i] = scan->defaults[i - 1];
+        i--;
+    }
+    scan->defaults[i] = *r;
+    if (scan->default_count < SI_ROUTE_DEFAULTS) scan->default_count++;
+}
+
+// 路由按表连续转储，缓存上一次命中的表，绝大多数路由不需要查找
+static void si_route_count(SiRouteScan *scan, unsigned int table, int family, int *last) {
+    SiRouteTable *t = NULL;
+    int i;
+    scan->total++;
+    if (*last >= 0 && scan->tables[*last].table == table) {
+        t = &scan->tables[*last];
+    } else {
+        for (i = 0; i < scan->table_count && scan->tables[i].table < table; i++) {}
+        if (i < scan->table_count && scan->tables[i].table == table) {
+            t = &scan->tables[i];
+        } else if (scan->table_count < SI_ROUTE_TABLES) {
+            memmove(&scan->tables[i + 1], &scan->tables[i], (size_t)(scan->table_count - i) * sizeof(SiRouteTable));
+            scan->table_count++;
+            t = &scan->tables[i];
+            memset(t, 0, sizeof(*t));
+            t->table = table;
+        } else {
+            scan->table_overflow++;
+            *last = -1;
+            return;
+        }
+        *last = (int)(t - scan->tables);
+    }
+    if (family == AF_INET) t->v4++;
+    else t->v6++;
+}
+
+// 对一个地址族发起路由转储：每条路由只读表号，只有默认路由才完整解析
+static int si_route_dump(int fd, SiRouteScan *scan, int family) {
+    struct {
+        struct nlmsghdr nlh;
+        struct rtmsg rtm;
+    } msg;
+    struct sockaddr_nl nladdr;
+    int last = -1;
+    memset(&msg, 0, sizeof(msg));
+    memset(&nladdr, 0, sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = RTM_GETROUTE;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    msg.nlh.nlmsg_seq = (unsigned int)family;
+    msg.rtm.rtm_family = (unsigned char)family;
+    if (sendto(fd, &msg, sizeof(msg), 0, (struct sockaddr *)&nladdr, sizeof(nladdr)) < 0)
+        return -1;
+
+    // 与连接统计相同，固定 64KB 缓冲区逐批处理
+    long buf[8192];
+    for (;;) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        struct nlmsghdr *h = (struct nlmsghdr *)buf;
+        for (; NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_flags & NLM_F_DUMP_INTR) scan->interrupted = 1;
+            if (h->nlmsg_type == NLMSG_DONE) return 0;
+            if (h->nlmsg_type == NLMSG_ERROR) {
+                struct nlmsgerr *err = NLMSG_DATA(h);
+                errno = err->error ? -err->error : EIO;
+                return -1;
+            }
+            if (h->nlmsg_type != RTM_NEWROUTE) continue;
+
+            struct rtmsg *rtm = NLMSG_DATA(h);
+            unsigned int table = rtm->rtm_table;
+            // 表号大于 255 时 rtm_table 为 RT_TABLE_COMPAT，实际表号在 RTA_TABLE 中
+            struct rtattr *a = RTM_RTA(rtm);
+            int alen = (int)RTM_PAYLOAD(h);
+            for (; RTA_OK(a, alen); a = RTA_NEXT(a, alen)) {
+                if (a->rta_type == RTA_TABLE) {
+                    table = *(unsigned int *)RTA_DATA(a);
+                    break;
+                }
+            }
+            si_route_count(scan, table, rtm->rtm_family, &last);
+            if (rtm->rtm_dst_len == 0 && rtm->rtm_type == RTN_UNICAST) {
+                SiRoute r;
+                si_route_parse(h, &r);
+                si_route_add_default(scan, &r);
+            }
+        }
+    }
+}
+
+static int si_route_socket() {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    int size = SI_ROUTE_RCVBUF;
+    if (fd < 0) return -1;
+    // root 可以越过 rmem_max 限制
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    return fd;
+}
+
+int si_scan_routes(SiRouteScan *scan, int family) {
+    struct timespec t0, t1;
+    int rc = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    memset(scan, 0, sizeof(*scan));
+
+    int fd = si_route_socket();
+    if (fd < 0) return -1;
+    if (family != AF_INET6) rc = si_route_dump(fd, scan, AF_INET);
+    // 未启用 IPv6 的内核会返回错误，同时扫描两个地址族时不影响 IPv4 的结果
+    if (family != AF_INET && rc == 0) {
+        int rc6 = si_route_dump(fd, scan, AF_INET6);
+        if (family == AF_INET6) rc = rc6;
+    }
+    close(fd);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    scan->elapsed_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    return rc;
+}
+
+int si_default_gateway(const SiRouteScan *scan, char *buf, size_t size) {
+    int i, j;
+    buf[0] = '\0';
+    // defaults 已按 main 表优先、metric 升序排列
+    for (i = 0; i < scan->default_count; i++) {
+        const SiRoute *r = &scan->defaults[i];
+        if (r->family != AF_INET || r->table != RT_TABLE_MAIN) continue;
+        for (j = 0; j < r->nhop_count; j++) {
+            if (r->nhops[j].gateway[0]) {
+                snprintf(buf, size, "%s", r->nhops[j].gateway);
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+// 单条 RTM_GETROUTE 查询，flags 为 rtm_flags（如 RTM_F_FIB_MATCH）
+static int si_route_get(int fd, int family, const void *addr, int alen, unsigned int flags, SiRoute *r) {
+    struct {
+        struct nlmsghdr nlh;
+        struct rtmsg rtm;
+        char attrs[RTA_SPACE(16)];
+    } req;
+    struct sockaddr_nl nladdr;
+    memset(&req, 0, sizeof(req));
+    memset(&nladdr, 0, sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+    req.nlh.nlmsg_type = RTM_GETROUTE;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST;
+    req.nlh.nlmsg_seq = flags + 1;
+    req.rtm.rtm_family = (unsigned char)family;
+    req.rtm.rtm_dst_len = (unsigned char)(alen * 8);
+    req.rtm.rtm_flags = flags;
+    struct rtattr *a = RTM_RTA(&req.rtm);
+    a->rta_type = RTA_DST;
+    a->rta_len = RTA_LENGTH(alen);
+    memcpy(RTA_DATA(a), addr, (size_t)alen);
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.rtm)) + RTA_SPACE(alen);
+    if (sendto(fd, &req, req.nlh.nlmsg_len, 0, (struct sockaddr *)&nladdr, sizeof(nladdr)) < 0)
+        return -1;
+
+    long buf[1024];
+    for (;;) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        struct nlmsghdr *h = (struct nlmsghdr *)buf;
+        for (; NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_seq != req.nlh.nlmsg_seq) continue;
+            if (h->nlmsg_type == NLMSG_ERROR) {
+                struct nlmsgerr *err = NLMSG_DATA(h);
+                errno = err->error ? -err->error : EIO;
+                return -1;
+            }
+            if (h->nlmsg_type == RTM_NEWROUTE) {
+                si_route_parse(h, r);
+                return 0;
+            }
+        }
+    }
+}
+
+int si_route_lookup(const char *dst, SiRoute *matched, SiNextHop *via) {
+    unsigned char addr[16];
+    int family = AF_INET, alen = 4;
+    SiRoute resolved;
+    if (inet_pton(AF_INET, dst, addr) != 1) {
+        family = AF_INET6;
+        alen = 16;
+        if (inet_pton(AF_INET6, dst, addr) != 1) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return -1;
+    if (si_route_get(fd, family, addr, alen, 0, &resolved) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    memset(via, 0, sizeof(*via));
+    if (resolved.nhop_count) *via = resolved.nhops[0];
+    // 普通查询只返回目的地址本身和选中的下一跳，RTM_F_FIB_MATCH（4.13+）返回匹配的表项
+    if (si_route_get(fd, family, addr, alen, RTM_F_FIB_MATCH, matched) != 0) *matched = resolved;
+    if (!matched->prefsrc[0]) memcpy(matched->prefsrc, resolved.prefsrc, sizeof(matched->prefsrc));
+    close(fd);
+    return 0;
+}
+
+// ==================== 内核事件 ====================
+
+#define SI_KMSG_MAGIC "SIKMSG1"
+#define SI_KMSG_RECORD 8192   // 内核单条记录上限（CONSOLE_EXT_LOG_MAX），缓冲区不足时 read 返回 EINVAL
+
+typedef struct {
+    char magic[8];
+    uint32_t size;            // sizeof(SiKmsgState)，结构变化后旧文件自动作废
+    SiKmsgState state;
+} SiKmsgFile;
+
+static const char *si_kmsg_names[SI_KMSG_KINDS] = {
+    "OOM 终止进程", "任务挂起", "硬件错误", "网卡链路", "CPU 锁死", "I/O 错误"
+};
+
+// 一次 OOM 会打印十几行，只匹配真正杀进程的那一行，计数才对应事件次数。
+// 链路只匹配网卡驱动的 "Link is Up/Down"、": link up/down"，避免把空 SATA 口的 "SATA link down" 算进来
+static const char *si_kmsg_patterns[SI_KMSG_KINDS] = {
+    "(Out of memory|Memory cgroup out of memory): Kill(ed)? process",
+    "blocked for more than [0-9]+ seconds",
+    "Hardware Error|Machine check events logged|EDAC .*(CE|UE) ",
+    "Link is (Up|Down)|: [Ll]ink (up|down)([ ,]|$)|carrier (lost|acquired)",
+    "soft lockup|hard LOCKUP|detected stalls on CPUs",
+    "I/O error|critical (medium|target) error|EXT4-fs error|XFS .*([Cc]orruption|metadata I/O error)",
+};
+
+static regex_t si_kmsg_regex[SI_KMSG_KINDS];
+static pthread_once_t si_kmsg_once = PTHREAD_ONCE_INIT;
+static int si_kmsg_regex_ok;
+
+static void si_kmsg_compile(void) {
+    int k;
+    for (k = 0; k < SI_KMSG_KINDS; k++) {
+        if (regcomp(&si_kmsg_regex[k], si_kmsg_patterns[k], REG_EXTENDED | REG_NOSUB) != 0) {
+            while (--k >= 0) regfree(&si_kmsg_regex[k]);
+            return;
+        }
+    }
+    si_kmsg_regex_ok = 1;
+}
+
+const char *si_kmsg_kind_name(int kind) {
+    return kind >= 0 && kind < SI_KMSG_KINDS ? si_kmsg_names[kind] : "?";
+}
+
+int si_kmsg_load(SiKmsgState *st, const char *path) {
+    char boot_id[sizeof(st->boot_id)];
+    SiKmsgFile file;
+    memset(st, 0, sizeof(*st));
+    if (si_read_line("/proc/sys/kernel/random/boot_id", boot_id, sizeof(boot_id)) != 0) return -1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (read(fd, &file, sizeof(file)) == (ssize_t)sizeof(file)
+            && !memcmp(file.magic, SI_KMSG_MAGIC, sizeof(SI_KMSG_MAGIC))
+            && file.size == sizeof(SiKmsgState)
+            && !strcmp(file.state.boot_id, boot_id))
+            *st = file.state;
+        close(fd);
+    }
+    memset(st->fresh, 0, sizeof(st->fresh));
+    snprintf(st->boot_id, sizeof(st->boot_id), "%s", boot_id);
+    return 0;
+}
+
+int si_kmsg_save(const SiKmsgState *st, const char *path) {
+    char tmp_path[512];
+    SiKmsgFile file;
+    memset(&file, 0, sizeof(file));
+    memcpy(file.magic, SI_KMSG_MAGIC, sizeof(SI_KMSG_MAGIC));
+    file.size = sizeof(SiKmsgState);
+    file.state = *st;
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    int ok = write(fd, &file, sizeof(file)) == (ssize_t)sizeof(file);
+    if (close(fd) != 0 || !ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int si_kmsg_open(void) {
+    return open("/dev/kmsg", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+// 记录格式 "优先级,序号,时间戳,标志[,...];消息\n"，之后可能有以空格开头的 KEY=value 续行
+static int si_kmsg_parse(char *rec, SiKmsgEvent *ev, char **msg) {
+    unsigned int prio;
+    char *semi = strchr(rec, ';');
+    if (!semi || sscanf(rec, "%u,%llu,%lld", &prio, &ev->seq, &ev->usec) != 3) return -1;
+    ev->level = (int)(prio & 7);
+    *msg = semi + 1;
+    char *nl = strchr(*msg, '\n');
+    if (nl) *nl = '\0';
+    // 只看内核自身（facility 0）的消息，用户态写入 /dev/kmsg 的日志不参与归类
+    return prio >> 3 == 0 ? 0 : 1;
+}
+
+long si_kmsg_scan(int fd, SiKmsgState *st, SiKmsgFn fn, void *ctx) {
+    char rec[SI_KMSG_RECORD + 1];
+    SiKmsgEvent ev;
+    char *msg;
+    long n = 0;
+    int k;
+
+    pthread_once(&si_kmsg_once, si_kmsg_compile);
+    if (!si_kmsg_regex_ok) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(st->fresh, 0, sizeof(st->fresh));
+    for (;;) {
+        ssize_t len = read(fd, rec, SI_KMSG_RECORD);
+        if (len < 0) {
+            // EPIPE：读指针所在记录已被覆盖，内核已把读指针移到最旧的记录，继续读即可
+            if (errno == EPIPE) continue;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            return n ? n : -1;
+        }
+        if (len == 0) break;
+        rec[len] = '\0';
+        memset(&ev, 0, sizeof(ev));
+        int facility = si_kmsg_parse(rec, &ev, &msg);
+        if (facility < 0) continue;
+        // /dev/kmsg 不能按序号定位，游标之前的记录只解析头部后跳过
+        if (ev.seq < st->next_seq) continue;
+        if (ev.seq > st->next_seq && st->scanned > 0) st->lost += ev.seq - st->next_seq;
+        st->next_seq = ev.seq + 1;
+        st->scanned++;
+        n++;
+        if (facility != 0) continue;
+        for (k = 0; k < SI_KMSG_KINDS; k++) {
+            if (regexec(&si_kmsg_regex[k], msg, 0, NULL, 0) != 0) continue;
+            ev.kind = k;
+            snprintf(ev.text, sizeof(ev.text), "%s", msg);
+            st->latest[k][st->counts[k] % SI_KMSG_EXAMPLES] = ev;
+            st->counts[k]++;
+            st->fresh[k]++;
+            if (fn) fn(&ev, ctx);
+            break;
+        }
+    }
+    return n;
+}
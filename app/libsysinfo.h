@@ -0,0 +1,398 @@
+// libsysinfo：系统信息探测库
+//
+// 探测结果以结构体返回，字符串存放在调用方提供的 arena 中，
+// 每次采集前 si_arena_reset 即可复用，稳态采集循环不分配堆内存。
+// 编译：gcc hello.c libsysinfo.c -o hello -lm -lpthread
+#ifndef LIBSYSINFO_H
+#define LIBSYSINFO_H
+
+#include <stddef.h>
+#include <time.h>
+#include <sys/utsname.h>
+#include <netinet/in.h>   // INET_ADDRSTRLEN
+#include <net/if.h>       // IFNAMSIZ
+
+// 调用方提供的字符串缓冲区（顺序分配，整体重置）
+typedef struct {
+    char *base;
+    size_t size;
+    size_t used;
+    int exhausted;        // 空间不足时置 1，此后分配返回空字符串
+} SiArena;
+
+void si_arena_init(SiArena *arena, void *buf, size_t size);
+void si_arena_reset(SiArena *arena);
+const char *si_arena_strdup(SiArena *arena, const char *s);
+const char *si_arena_printf(SiArena *arena, const char *fmt, ...);
+
+// 发行版信息
+typedef struct {
+    const char *name;
+    const char *version;  // 未知时为空字符串
+} SiDistro;
+
+// CPU 型号和逻辑核心数
+typedef struct {
+    const char *model;    // 未知时为 "Unknown"
+    int logical_cores;
+} SiCpu;
+
+// 内存信息，单位 GiB
+typedef struct {
+    double phys_total;    // dmidecode 统计的内存条总量，未采集或失败时为 0
+    double total;         // MemTotal
+    double available;     // MemAvailable
+} SiMemory;
+
+// 开机时长
+typedef struct {
+    long seconds;
+    int days, hours, minutes, secs;
+} SiUptime;
+
+// 资源压力（PSI），avg 为最近 10/60/300 秒内处于停顿的时间百分比
+enum { SI_PSI_CPU, SI_PSI_MEMORY, SI_PSI_IO, SI_PSI_KINDS };
+
+typedef struct {
+    int present;                 // 内核未启用 PSI 或文件不可读时为 0
+    double some[3];
+    double full[3];
+    unsigned long long some_total;   // 累计停顿时间，微秒
+    unsigned long long full_total;
+} SiPsi;
+
+// 当前进程所在 cgroup v2 的有效资源限制；-1 表示无限制或不可读
+typedef struct {
+    int present;                 // 找到 cgroup v2 挂载时为 1
+    const char *path;            // 相对 cgroup 根的路径
+    const char *dir;             // cgroup 目录的绝对路径
+    long long cpu_quota_us;      // cpu.max（沿祖先取最紧的一级）
+    long long cpu_period_us;
+    const char *cpuset;          // cpuset.cpus.effective，不可读时为空字符串
+    int cpuset_count;
+    double effective_cpus;       // 综合 cpuset 和配额后的可用 CPU 数
+    long long mem_max;           // memory.max（沿祖先取最小），字节
+    long long mem_current;
+    long long mem_anon;          // memory.stat 中的 anon / file
+    long long mem_file;
+    long long pids_max;
+    long long pids_current;
+    long long nr_periods;        // cpu.stat 限流计数
+    long long nr_throttled;
+    long long throttled_usec;
+    SiPsi psi[SI_PSI_KINDS];     // cpu.pressure / memory.pressure / io.pressure
+} SiCgroup;
+
+// 一次完整采集的结果
+typedef struct {
+    time_t now;
+    const char *hardware_model;
+    SiDistro distro;
+    int distro_ok;        // 识别出发行版时为 1
+    struct utsname uts;   // sysname / release / nodename
+    SiCpu cpu;
+    SiMemory mem;
+    double load[3];       // 1/5/15 分钟负载
+    SiUptime uptime;
+    char local_ip[INET_ADDRSTRLEN];   // 第一个非 lo 的 IPv4 地址，没有时为空字符串
+    SiPsi psi[SI_PSI_KINDS];     // /proc/pressure
+    SiCgroup cgroup;
+} SiReport;
+
+// si_collect 的采集项
+#define SI_PROBE_DMI  0x01   // 调用 dmidecode 统计内存条（首次较慢，结果会缓存）
+#define SI_PROBE_ALL  0xff
+
+// 单项探测：成功返回 0，失败返回 -1
+int si_read_line(const char *path, char *buf, size_t size);
+void si_trim_quotes(char *str);
+const char *si_probe_hardware_model(SiArena *arena);
+int si_probe_distro(SiDistro *distro, SiArena *arena);
+int si_probe_cpu(SiCpu *cpu, SiArena *arena);
+int si_probe_memory(SiMemory *mem, int with_dmi);
+int si_probe_load(double load[3]);
+int si_probe_uptime(SiUptime *uptime);
+int si_probe_local_ip(char *buf, size_t size);
+int si_probe_cgroup(SiCgroup *cg, SiArena *arena);
+// cgroup_dir 为 NULL 时读取整机的 /proc/pressure，否则读取该 cgroup 的 *.pressure
+const char *si_psi_name(int kind);
+int si_probe_psi(SiPsi *psi, const char *cgroup_dir, int kind);
+// 注册 PSI 触发器：window_us 内停顿超过 stall_us 时 fd 上出现 POLLPRI；返回 fd，失败返回 -1
+int si_psi_trigger(const char *cgroup_dir, int kind, int full, unsigned int stall_us, unsigned int window_us);
+// 读取指定 cgroup 目录（root 为 cgroup v2 挂载点，限制沿 dir 到 root 的各级汇总）
+int si_probe_cgroup_at(SiCgroup *cg, const char *root, const char *dir, SiArena *arena);
+
+// 采集全部信息（先重置 arena）；uname 失败时返回 -1
+int si_collect(SiReport *report, SiArena *arena, unsigned int flags);
+
+// 进程资源排行
+#define SI_TOP_MAX 32
+
+enum { SI_TOP_RSS, SI_TOP_PSS, SI_TOP_CPU, SI_TOP_THREADS, SI_TOP_KINDS };
+
+typedef struct {
+    int pid;
+    char comm[32];
+    long long rss_kb;     // 常驻内存
+    long long pss_kb;     // smaps_rollup Pss，未采集或无权限时为 -1
+    double cpu_seconds;   // utime + stime
+    int threads;
+} SiProcess;
+
+typedef struct {
+    int n;                // 每个排行的实际条数
+    int scanned;          // 成功读取的进程数
+    int vanished;         // 扫描途中退出的进程数
+    int pss_denied;       // smaps_rollup 不可读的进程数
+    int workers;
+    double elapsed_ms;
+    SiProcess top[SI_TOP_KINDS][SI_TOP_MAX];   // 按 SI_TOP_* 分别降序排列
+} SiProcTop;
+
+// 并行扫描 /proc/[pid]，workers <= 0 时按在线 CPU 数决定线程数
+int si_scan_processes(SiProcTop *result, int n, int workers, int with_pss);
+
+// TCP 连接统计（NETLINK_SOCK_DIAG），结果结构体大小固定，与连接数无关
+#define SI_TCP_STATES 12              // 下标为内核 TCP 状态值 1..11
+#define SI_SOCK_TOP 10
+#define SI_REMOTE_BUCKETS 16384       // 远端网段哈希表容量，满了之后计入 remote_overflow
+#define SI_SOCK_ALL_STATES 0xfff
+
+typedef struct {
+    int family;
+    char addr[INET6_ADDRSTRLEN];
+    int port;
+    unsigned int rqueue;              // 全连接队列当前长度
+    unsigned int backlog;             // listen() 的 backlog 上限
+} SiListener;
+
+typedef struct {
+    unsigned long long key;           // IPv4 为 /24，IPv6 为 /64
+    unsigned int count;               // 0 表示空槽
+} SiRemoteBucket;
+
+typedef struct {
+    unsigned int states[SI_TCP_STATES];
+    unsigned int total;
+    unsigned int orphans;             // 已无进程持有的连接（/proc/net/sockstat）
+    unsigned int listen_total;
+    unsigned int port_counts[65536];  // 非监听连接按本地端口计数
+    SiRemoteBucket remotes[SI_REMOTE_BUCKETS];
+    unsigned int remote_used;
+    unsigned int remote_overflow;
+    SiListener listeners[SI_SOCK_TOP];   // 按队列长度降序
+    int listener_count;
+    double elapsed_ms;
+} SiSockScan;
+
+const char *si_tcp_state_name(int state);
+// state_mask 按 1 << 状态值 过滤，SI_SOCK_ALL_STATES 为全部
+int si_scan_sockets(SiSockScan *scan, unsigned int state_mask);
+// 取连接数最多的本地端口 / 远端网段，返回实际条数
+int si_sock_top_ports(const SiSockScan *scan, int *ports, unsigned int *counts, int n);
+int si_sock_top_remotes(const SiSockScan *scan, SiRemoteBucket *out, int n);
+void si_sock_remote_str(unsigned long long key, char *buf, size_t size);
+
+// 中断分布：/proc/interrupts 与 /proc/softirqs 的每 CPU 计数矩阵（自开机累计）
+#define SI_SOFTIRQ_MAX 16
+
+typedef struct {
+    int irq;                  // 数字中断号，NMI/LOC 等命名行为 -1
+    char name[16];            // 中断号或 NMI 等名称
+    char desc[64];            // 动作名，如 eth0-TxRx-3、virtio3-input.0
+    char ifname[IFNAMSIZ];    // 通过 msi_irqs 对应到的网卡，非网卡中断为空
+    int queue;                // 动作名末尾的队列号，config 等非队列向量为 -1
+    unsigned long long total;
+} SiIrq;
+
+typedef struct {
+    int ncpu;                 // 表头中的 CPU 列数（只含在线 CPU）
+    int *cpu_ids;             // 每列对应的 CPU 编号
+    int nirq;
+    SiIrq *irqs;
+    unsigned long long *counts;        // nirq × ncpu
+    int nsoft;
+    char soft_names[SI_SOFTIRQ_MAX][16];
+    unsigned long long *soft_counts;   // nsoft × ncpu
+} SiIrqTable;
+
+// 结果数组在堆上分配，用完调用 si_irq_free
+int si_probe_irqs(SiIrqTable *table);
+void si_irq_free(SiIrqTable *table);
+int si_softirq_index(const SiIrqTable *table, const char *name);
+// 解析 "0-3,8-11" 形式的 CPU 列表，返回个数
+int si_parse_cpu_list(const char *list, int *cpus, int max);
+// 网卡所在 NUMA 节点的 CPU；不区分节点时返回全部在线 CPU
+int si_nic_cpus(const char *ifname, int *cpus, int max, int *node);
+// 在线 CPU 列表，返回个数
+int si_online_cpus(int *cpus, int max);
+// 把调用线程绑定到一个 CPU（直接调用 sched_setaffinity，不依赖 _GNU_SOURCE）
+int si_pin_thread(int cpu);
+// NUMA 节点列表（/sys/devices/system/node/online），内核不支持 NUMA 时视为单节点 0
+int si_numa_nodes(int *nodes, int max);
+// 节点上的 CPU，只有内存没有 CPU 的节点返回 0
+int si_numa_node_cpus(int node, int *cpus, int max);
+// 整机 CPU 时间（/proc/stat，单位 USER_HZ 节拍），idle 含 iowait
+int si_cpu_ticks(long long *total, long long *idle);
+
+// 采样历史：固定大小的 mmap 环形文件。文件按 4 KiB 定长块组织，每块开头存一条原值样本，
+// 之后的样本逐列以 zigzag varint 存差值（累计计数器存二阶差分），块写满后覆盖最旧的块
+#define SI_HIST_IFACES 8
+#define SI_HIST_BLOCK_SIZE 4096
+#define SI_HIST_DEFAULT_BLOCKS 1024   // 4 MiB，10 秒一条时通常可保存 30 天以上
+
+typedef struct {
+    long long ts;                     // Unix 时间，秒
+    long long mem_total_mib;
+    long long mem_avail_mib;
+    long long cpu_total;              // /proc/stat 累计 tick
+    long long cpu_idle;               // idle + iowait
+    long long load_x100;              // 1 分钟负载 × 100
+    long long psi_ms[SI_PSI_KINDS];   // some 累计停顿，毫秒
+    long long rx_kb[SI_HIST_IFACES];  // 网卡累计收发，KiB，顺序同 SiHistory.ifaces
+    long long tx_kb[SI_HIST_IFACES];
+} SiHistSample;
+
+typedef struct {
+    int fd;
+    unsigned char *map;
+    size_t size;
+    int writable;
+    unsigned int blocks;
+    int niface;
+    char ifaces[SI_HIST_IFACES][IFNAMSIZ];   // 建文件时的非 lo 网卡，之后不再变化
+} SiHistory;
+
+// prev 为环中紧邻的上一条样本（可能早于查询范围），没有时为 NULL；返回非 0 停止遍历
+typedef int (*SiHistFn)(const SiHistSample *prev, const SiHistSample *cur, void *ctx);
+
+// writable 时文件不存在则按 blocks 块预分配创建（blocks 为 0 取默认值）
+int si_history_open(SiHistory *h, const char *path, unsigned int blocks, int writable);
+void si_history_close(SiHistory *h);
+int si_history_sample(const SiHistory *h, SiHistSample *s);
+// 追加一条样本；时间不晚于最后一条的样本被忽略
+int si_history_append(SiHistory *h, const SiHistSample *s);
+// 按块首尾时间二分定位，只解码与 [from, to] 相交的块；返回回调的样本数
+long si_history_query(const SiHistory *h, long long from, long long to, SiHistFn fn, void *ctx);
+// 最早、最晚样本时间；返回已写入的块数，空文件返回 0
+unsigned int si_history_span(const SiHistory *h, long long *oldest, long long *newest);
+
+// 主机快照：基线比对和批量汇总使用的文本格式。每段以 "[名称] 十六位哈希" 开头，
+// 段内为按键排序的 key=value 行，哈希为段内各行（key=value\n）的 FNV-1a
+#define SI_SNAP_ENTRIES 1024
+
+enum { SI_SNAP_HOST, SI_SNAP_SYSTEM, SI_SNAP_NET, SI_SNAP_SYSCTL, SI_SNAP_SOURCES, SI_SNAP_SECTIONS };
+
+typedef struct {
+    const char *key;
+    const char *value;
+} SiSnapEntry;
+
+typedef struct {
+    int present[SI_SNAP_SECTIONS];
+    int skipped[SI_SNAP_SECTIONS];   // 与参照快照哈希相同，未解析段内条目
+    unsigned long long hash[SI_SNAP_SECTIONS];
+    int start[SI_SNAP_SECTIONS];     // 段内条目在 entries 中的范围，按键排序
+    int count[SI_SNAP_SECTIONS];
+    int n;
+    int truncated;                   // 条目超过 SI_SNAP_ENTRIES 或 arena 不足
+    SiSnapEntry entries[SI_SNAP_ENTRIES];
+} SiSnapshot;
+
+const char *si_snapshot_section_name(int section);
+// 采集本机快照，字符串放在 arena 中；keys_from 不为 NULL 时额外采集其中列出的 sysctl
+int si_snapshot_collect(SiSnapshot *snap, SiArena *arena, const SiSnapshot *keys_from);
+int si_snapshot_write(const SiSnapshot *snap, int fd);
+// 原地解析 text（换行被改写为 '\0'，text[len] 须可写）。skip_equal 不为 NULL 时，
+// 文件头哈希与其相同的段直接跳过；verify 为 1 时忽略文件中的哈希、按内容重新计算
+int si_snapshot_parse(SiSnapshot *snap, char *text, size_t len, const SiSnapshot *skip_equal, int verify);
+const char *si_snapshot_get(const SiSnapshot *snap, int section, const char *key);
+
+// 路由表（NETLINK_ROUTE）：一次转储全部路由表，边收边统计，只保留默认路由和各表条数，
+// 内存占用与路由条数无关，全量 BGP 表（百万条）也不需要经过文本解析
+#define SI_ROUTE_TABLES 32
+#define SI_ROUTE_DEFAULTS 16
+#define SI_ROUTE_NEXTHOPS 16
+
+typedef struct {
+    char gateway[INET6_ADDRSTRLEN];   // 直连路由为空
+    char ifname[IFNAMSIZ];
+    int weight;                       // ECMP 权重，单一下一跳为 1
+} SiNextHop;
+
+typedef struct {
+    int family;
+    char dst[INET6_ADDRSTRLEN];       // 默认路由为空
+    int dst_len;
+    unsigned int table;
+    unsigned int metric;
+    int protocol;                     // RTPROT_*
+    char prefsrc[INET6_ADDRSTRLEN];
+    int nhop_count;
+    SiNextHop nhops[SI_ROUTE_NEXTHOPS];
+} SiRoute;
+
+typedef struct {
+    unsigned int table;
+    unsigned long v4;
+    unsigned long v6;
+} SiRouteTable;
+
+typedef struct {
+    SiRouteTable tables[SI_ROUTE_TABLES];   // 按表号升序
+    int table_count;
+    unsigned long table_overflow;           // 超出 SI_ROUTE_TABLES 的表中的路由条数
+    unsigned long total;
+    SiRoute defaults[SI_ROUTE_DEFAULTS];    // 按地址族、表号、metric 排序
+    int default_count;
+    int interrupted;                        // 转储期间路由表有变化（NLM_F_DUMP_INTR），计数可能不精确
+    double elapsed_ms;
+} SiRouteScan;
+
+// family 为 AF_INET、AF_INET6 或 AF_UNSPEC（两者都扫描）
+int si_scan_routes(SiRouteScan *scan, int family);
+// 首选的 IPv4 默认网关（main 表中 metric 最小的一条），没有时返回 -1
+int si_default_gateway(const SiRouteScan *scan, char *buf, size_t size);
+// 目的地址实际命中的路由（RTM_GETROUTE + RTA_DST）。matched 为 FIB 中匹配的条目（含全部 ECMP 下一跳），
+// matched->prefsrc 为出口源地址，via 为内核对该地址选中的下一跳；内核不支持 RTM_F_FIB_MATCH 时 matched 只含 via
+int si_route_lookup(const char *dst, SiRoute *matched, SiNextHop *via);
+const char *si_route_table_name(unsigned int table, char *buf, size_t size);
+const char *si_route_protocol_name(int protocol);
+
+// 内核事件：非阻塞读取 /dev/kmsg，只处理游标之后的新记录，按预编译的正则归类。
+// 状态（开机 ID、游标、本次开机累计计数、每类最近几条）保存在文件中，重启后自动从头开始
+enum { SI_KMSG_OOM, SI_KMSG_HUNG, SI_KMSG_HWERR, SI_KMSG_LINK, SI_KMSG_LOCKUP, SI_KMSG_IOERR, SI_KMSG_KINDS };
+#define SI_KMSG_EXAMPLES 3
+#define SI_KMSG_TEXT 200
+
+typedef struct {
+    unsigned long long seq;
+    long long usec;                   // 开机后的微秒数（printk 时间戳）
+    int level;
+    int kind;
+    char text[SI_KMSG_TEXT];
+} SiKmsgEvent;
+
+typedef struct {
+    char boot_id[40];
+    unsigned long long next_seq;      // 游标：下一条要处理的记录序号
+    unsigned long long scanned;       // 本次开机累计处理的记录数
+    unsigned long long lost;          // 游标之后被环形缓冲区覆盖、未能读到的记录数
+    unsigned int counts[SI_KMSG_KINDS];
+    unsigned int fresh[SI_KMSG_KINDS];   // 最近一次 si_kmsg_scan 新增，不保存
+    SiKmsgEvent latest[SI_KMSG_KINDS][SI_KMSG_EXAMPLES];   // 按 counts 取模轮换
+} SiKmsgState;
+
+typedef void (*SiKmsgFn)(const SiKmsgEvent *ev, void *ctx);
+
+const char *si_kmsg_kind_name(int kind);
+// 读取状态文件；文件不存在、格式不符或开机 ID 变化时从头开始（返回 0），只有读取开机 ID 失败返回 -1
+int si_kmsg_load(SiKmsgState *st, const char *path);
+// 先写临时文件再改名，读到一半的状态不会被其他进程看到
+int si_kmsg_save(const SiKmsgState *st, const char *path);
+// 打开 /dev/kmsg（非阻塞），follow 模式可对返回的 fd 做 poll
+int si_kmsg_open(void);
+// 读到当前末尾为止，每条归类成功的记录更新 st 并回调 fn（可为 NULL）；返回新处理的记录数
+long si_kmsg_scan(int fd, SiKmsgState *st, SiKmsgFn fn, void *ctx);
+
+#endif
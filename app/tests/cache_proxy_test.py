@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+# 缓存代理检查：本机替身上游 + 大量并发客户端。覆盖并发请求合并为一次回源、命中缓存、
+# 拒绝其他源的绝对地址、连接数上限，以及 fd 耗尽时 accept 不空转。
+# 不需要 root，缓存放在临时目录。
+# 用法（在 app 目录下）：
+#   gcc -o hello hello.c libsysinfo.c -lm -lpthread && python3 tests/cache_proxy_test.py ./hello
+import os
+import resource
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+BODY = os.urandom(512 * 1024)
+upstream_hits = []
+
+
+class Upstream(BaseHTTPRequestHandler):
+    def do_GET(self):
+        upstream_hits.append(self.path)
+        if self.path != "/mirror/pool/pkg.deb":
+            self.send_error(404)
+            return
+        time.sleep(0.3)      # 回源慢一些，让并发请求有机会合并
+        self.send_response(200)
+        self.send_header("Content-Length", str(len(BODY)))
+        self.end_headers()
+        self.wfile.write(BODY)
+
+    def log_message(self, *args):
+        pass
+
+
+def free_port():
+    s = socket.socket()
+    s.bind(("127.0.0.1", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+def cpu_seconds(pid):
+    with open("/proc/%d/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def get(port, path, timeout=10):
+    with urllib.request.urlopen("http://127.0.0.1:%d%s" % (port, path), timeout=timeout) as r:
+        return r.status, r.read()
+
+
+def raw_status(port, target):
+    s = socket.create_connection(("127.0.0.1", port), timeout=10)
+    s.sendall(("GET %s HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n" % target).encode())
+    status = s.recv(64).split(b" ")[1]
+    s.close()
+    return int(status)
+
+
+def start_proxy(binary, upstream_port, max_conn, nofile=None):
+    port = free_port()
+    cache = tempfile.mkdtemp()
+
+    def limit_fds():
+        if nofile:
+            resource.setrlimit(resource.RLIMIT_NOFILE, (nofile, nofile))
+    proxy = subprocess.Popen([binary, "--cache-proxy", "--listen", "127.0.0.1", "--port", str(port),
+                              "--upstream", "http://127.0.0.1:%d/mirror/" % upstream_port,
+                              "--dir", cache, "--max-conn", str(max_conn)],
+                             stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, preexec_fn=limit_fds)
+    for _ in range(50):
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=1).close()
+            break
+        except OSError:
+            time.sleep(0.1)
+    return proxy, port
+
+
+def main():
+    binary = sys.argv[1] if len(sys.argv) > 1 else "./hello"
+    up = ThreadingHTTPServer(("127.0.0.1", 0), Upstream)
+    threading.Thread(target=up.serve_forever, daemon=True).start()
+    failures = []
+
+    def check(name, ok, detail=""):
+        print(("ok   " if ok else "FAIL ") + name + (" " + str(detail) if detail else ""))
+        if not ok:
+            failures.append(name)
+
+    # 连接数上限 8：40 个客户端同时请求同一个包，超出上限的在队列里等待，全部拿到完整内容，
+    # 上游只被请求一次
+    proxy, port = start_proxy(binary, up.server_address[1], 8)
+    try:
+        results = [None] * 40
+
+        def client(i):
+            try:
+                results[i] = get(port, "/pool/pkg.deb")
+            except Exception as e:
+                results[i] = e
+        threads = [threading.Thread(target=client, args=(i,)) for i in range(40)]
+        upstream_hits.clear()
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        good = sum(1 for r in results if r == (200, BODY))
+        check("40 个并发客户端全部成功", good == 40, "%d/40" % good)
+        check("并发请求合并为一次回源", upstream_hits == ["/mirror/pool/pkg.deb"], upstream_hits)
+
+        upstream_hits.clear()
+        check("再次请求命中缓存", get(port, "/pool/pkg.deb") == (200, BODY) and not upstream_hits)
+        check("拒绝其他源的绝对地址", raw_status(port, "http://169.254.169.254/latest/meta-data/") == 403)
+
+        # 8 个空闲连接占满名额后新请求要等待，空闲连接关闭后得到服务
+        idle = [socket.create_connection(("127.0.0.1", port)) for _ in range(8)]
+        time.sleep(0.3)
+        try:
+            get(port, "/pool/pkg.deb", timeout=1)
+            check("名额占满时新连接等待", False)
+        except Exception:
+            check("名额占满时新连接等待", True)
+        for s in idle:
+            s.close()
+        check("名额释放后继续服务", get(port, "/pool/pkg.deb") == (200, BODY))
+    finally:
+        proxy.kill()
+        proxy.wait()
+
+    # fd 上限 24、连接数上限 64：30 个空闲连接让 accept 返回 EMFILE，代理不能空转，释放后恢复
+    proxy, port = start_proxy(binary, up.server_address[1], 64, nofile=24)
+    try:
+        idle = [socket.create_connection(("127.0.0.1", port)) for _ in range(30)]
+        time.sleep(0.5)
+        before = cpu_seconds(proxy.pid)
+        time.sleep(2)
+        used = cpu_seconds(proxy.pid) - before
+        check("fd 耗尽时不空转", used < 0.5, "2 秒内 CPU %.2f 秒" % used)
+        for s in idle:
+            s.close()
+        check("释放后恢复服务", get(port, "/pool/pkg.deb") == (200, BODY))
+        check("代理进程仍在运行", proxy.poll() is None)
+    finally:
+        proxy.kill()
+        proxy.wait()
+
+    print("PASS" if not failures else "FAILED")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
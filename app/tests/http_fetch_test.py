@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# 内置 HTTP 客户端检查：在本机起一个替身服务器，运行 `hello mirror fetch`，覆盖 200、
+# ETag/If-Modified-Since 条件请求的 304、chunked 正文、各种形式的重定向和重定向循环。
+# 不需要 root，缓存放在临时目录。
+# 用法（在 app 目录下）：
+#   gcc -o hello hello.c libsysinfo.c -lm -lpthread && python3 tests/http_fetch_test.py ./hello
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+FILES = {
+    "/repo/a.repo": b"[base]\nbaseurl=http://example/a\n",
+    "/repo/b.repo": b"[base]\nbaseurl=http://example/b\n",
+}
+LAST_MODIFIED = "Mon, 01 Jan 2024 00:00:00 GMT"
+requests = []
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def redirect(self, code, location):
+        self.send_response(code)
+        self.send_header("Location", location)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def do_GET(self):
+        requests.append((self.path, self.headers.get("If-None-Match"), self.headers.get("If-Modified-Since")))
+        port = self.server.server_address[1]
+        if self.path in FILES:
+            etag = '"%s"' % self.path.rsplit("/", 1)[1]
+            if self.headers.get("If-None-Match") == etag:
+                self.send_response(304)
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            self.send_response(200)
+            self.send_header("ETag", etag)
+            self.send_header("Last-Modified", LAST_MODIFIED)
+            self.send_header("Content-Length", str(len(FILES[self.path])))
+            self.end_headers()
+            self.wfile.write(FILES[self.path])
+        elif self.path == "/repo/chunked.repo":
+            # 只有 Last-Modified 的响应，复查时靠 If-Modified-Since 命中
+            if self.headers.get("If-Modified-Since") == LAST_MODIFIED:
+                self.send_response(304)
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            self.send_response(200)
+            self.send_header("Last-Modified", LAST_MODIFIED)
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            for part in (b"[chunked]\n", b"baseurl=http://example/c\n"):
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(part), part))
+            self.wfile.write(b"0\r\n\r\n")
+        elif self.path == "/old/absolute":
+            self.redirect(301, "http://127.0.0.1:%d/repo/b.repo" % port)
+        elif self.path == "/old/rooted":
+            self.redirect(302, "/repo/b.repo")
+        elif self.path == "/repo/relative":
+            self.redirect(307, "b.repo")
+        elif self.path == "/old/chain":
+            self.redirect(308, "/old/rooted")
+        elif self.path == "/old/loop":
+            self.redirect(302, "/old/loop")
+        else:
+            self.send_response(404)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+
+    def log_message(self, *args):
+        pass
+
+
+def main():
+    binary = sys.argv[1] if len(sys.argv) > 1 else "./hello"
+    server = ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    base = "http://127.0.0.1:%d" % server.server_address[1]
+    work = tempfile.mkdtemp()
+    cache = os.path.join(work, "cache")
+    failures = []
+
+    def fetch(path, name, want_ok, want_status, want_body=None):
+        dest = os.path.join(work, name)
+        out = subprocess.run([binary, "mirror", "fetch", base + path, dest, "--cache-dir", cache],
+                             capture_output=True, text=True, timeout=30)
+        result = json.loads(out.stdout)
+        got = None
+        if os.path.exists(dest):
+            with open(dest, "rb") as f:
+                got = f.read()
+        line = "%-22s ok=%s status=%s" % (path, result["ok"], result["status"])
+        bad = result["ok"] != want_ok or result["status"] != want_status
+        if want_body is not None and got != want_body:
+            bad = True
+            line += " 内容不符"
+        if (out.returncode == 0) != want_ok:
+            bad = True
+            line += " 退出码 %d" % out.returncode
+        print(("FAIL " if bad else "ok   ") + line)
+        if bad:
+            failures.append(line)
+
+    chunked = b"[chunked]\nbaseurl=http://example/c\n"
+    fetch("/repo/a.repo", "a1", True, 200, FILES["/repo/a.repo"])
+    fetch("/repo/a.repo", "a2", True, 304, FILES["/repo/a.repo"])
+    fetch("/repo/chunked.repo", "c1", True, 200, chunked)
+    fetch("/repo/chunked.repo", "c2", True, 304, chunked)
+    fetch("/old/absolute", "b1", True, 200, FILES["/repo/b.repo"])
+    fetch("/old/rooted", "b2", True, 304, FILES["/repo/b.repo"])
+    fetch("/repo/relative", "b3", True, 304, FILES["/repo/b.repo"])
+    fetch("/old/chain", "b4", True, 304, FILES["/repo/b.repo"])
+    fetch("/missing", "m", False, 404)
+    fetch("/old/loop", "l", False, 302)
+
+    # 第二次请求 a.repo 必须带上第一次拿到的 ETag 和 Last-Modified
+    cond = [r for r in requests if r[0] == "/repo/a.repo"]
+    if len(cond) != 2 or cond[1][1] != '"a.repo"' or cond[1][2] != LAST_MODIFIED:
+        failures.append("条件请求头不对: %s" % cond)
+        print("FAIL 条件请求头:", cond)
+    # 失败的下载不能留下目标文件或临时文件
+    leftovers = [n for n in os.listdir(work) if n in ("m", "l") or n.endswith(".tmp")]
+    if leftovers:
+        failures.append("残留文件: %s" % leftovers)
+        print("FAIL 残留文件:", leftovers)
+
+    print("PASS" if not failures else "FAILED")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+# 镜像测速排名检查：在本机起几个带延迟/限速的 HTTP 替身镜像，运行 `hello mirror probe`，
+# 检查排名顺序。不需要 root，也不访问外网。
+# 用法（在 app 目录下）：
+#   gcc -o hello hello.c libsysinfo.c -lm -lpthread && python3 tests/mirror_probe_test.py ./hello
+import json
+import socket
+import subprocess
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+PREFIX = "/mirror/"
+PATH = "ubuntu/dists/noble/Release"
+BODY = b"x" * (256 * 1024)
+
+
+def make_handler(delay, chunk_pause):
+    class Handler(BaseHTTPRequestHandler):
+        def do_GET(self):
+            if self.path != PREFIX + PATH:
+                self.send_error(404)
+                return
+            time.sleep(delay)                    # 首字节延迟
+            self.send_response(200)
+            self.send_header("Content-Length", str(len(BODY)))
+            self.end_headers()
+            for i in range(0, len(BODY), 16384):  # 限速：每 16KiB 停一下
+                self.wfile.write(BODY[i:i + 16384])
+                if chunk_pause:
+                    time.sleep(chunk_pause)
+
+        def log_message(self, *args):
+            pass
+    return Handler
+
+
+def start(delay=0.0, chunk_pause=0.0):
+    server = ThreadingHTTPServer(("127.0.0.1", 0), make_handler(delay, chunk_pause))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return "http://127.0.0.1:%d%s" % (server.server_address[1], PREFIX)
+
+
+def closed_port():
+    s = socket.socket()
+    s.bind(("127.0.0.1", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return "http://127.0.0.1:%d%s" % (port, PREFIX)
+
+
+def main():
+    binary = sys.argv[1] if len(sys.argv) > 1 else "./hello"
+    mirrors = {
+        "fast": start(),
+        "delayed": start(delay=0.4),
+        "throttled": start(chunk_pause=0.05),   # 约 320KiB/s，按 1MiB 估算约 3 秒
+        "missing": start().replace(PREFIX, "/other/"),
+        "refused": closed_port(),
+    }
+    names = {url: name for name, url in mirrors.items()}
+    # 故意打乱顺序传入，排名不能依赖参数顺序
+    order = ["refused", "throttled", "missing", "delayed", "fast"]
+    out = subprocess.run([binary, "mirror", "probe", PATH] + [mirrors[n] for n in order],
+                         capture_output=True, text=True, timeout=30)
+    result = json.loads(out.stdout)
+    ranked = [names[m["mirror"]] for m in result["mirrors"]]
+    for m in result["mirrors"]:
+        print("%-10s %s" % (names[m["mirror"]], m))
+
+    failures = []
+    if out.returncode != 0 or not result["ok"]:
+        failures.append("退出码 %d，ok=%s" % (out.returncode, result["ok"]))
+    if ranked[:3] != ["fast", "delayed", "throttled"]:
+        failures.append("排名错误: %s" % ranked)
+    failed = {names[m["mirror"]]: m.get("error") for m in result["mirrors"] if not m["ok"]}
+    if set(failed) != {"missing", "refused"}:
+        failures.append("失败的镜像不对: %s" % failed)
+    elif failed["missing"] != "HTTP 404":
+        failures.append("404 镜像的错误信息不对: %s" % failed["missing"])
+
+    for f in failures:
+        print("FAIL:", f)
+    print("PASS" if not failures else "FAILED")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())